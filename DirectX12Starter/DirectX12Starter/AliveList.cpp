@@ -0,0 +1,81 @@
+#include "AliveList.h"
+
+// the vector constructor takes it by reference, so it needs a definition
+const unsigned int AliveList::NotListed;
+
+AliveList::AliveList(int maxParticles) :
+	indices(maxParticles),
+	slots(maxParticles, NotListed)
+{
+	count = 0;
+}
+
+void AliveList::Clear()
+{
+	for (unsigned int i = 0; i < count; ++i)
+		slots[indices[i]] = NotListed;
+
+	count = 0;
+}
+
+void AliveList::Assign(const unsigned int* indices, unsigned int count)
+{
+	Clear();
+
+	for (unsigned int i = 0; i < count; ++i)
+		Append(indices[i]);
+}
+
+void AliveList::Append(unsigned int index)
+{
+	slots[index] = count;
+	indices[count++] = index;
+}
+
+void AliveList::Remove(unsigned int index)
+{
+	unsigned int slot = slots[index];
+	unsigned int last = indices[--count];
+
+	// swap-remove
+	indices[slot] = last;
+	slots[last] = slot;
+	slots[index] = NotListed;
+}
+
+void AliveList::RemoveAll(const unsigned int* indices, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; ++i)
+		Remove(indices[i]);
+}
+
+bool AliveList::Contains(unsigned int index) const
+{
+	return slots[index] != NotListed;
+}
+
+unsigned int AliveList::GetCount() const
+{
+	return count;
+}
+
+const unsigned int* AliveList::GetIndices() const
+{
+	return indices.data();
+}
+
+unsigned int AliveList::WriteDrawList(ParticleSort* drawList) const
+{
+	for (unsigned int i = 0; i < count; ++i)
+		drawList[i].index = indices[i];
+
+	return count;
+}
+
+void AliveList::BuildDrawArgs(unsigned int drawArgs[9]) const
+{
+	drawArgs[0] = count; // vertexCountPerInstance
+	drawArgs[1] = 1; // instanceCount
+	for (int i = 2; i < 9; ++i)
+		drawArgs[i] = 0; // offsets
+}
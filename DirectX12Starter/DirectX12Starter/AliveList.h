@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+#include "Emitter.h"
+
+// dense list of live particle indices so an update only touches live particles
+// Emit appends, a death swaps the last entry into the dead one's slot, and every index remembers its slot
+// so the swap is O(1), the order is arbitrary but the contents always match the live set
+class AliveList
+{
+public:
+	AliveList(int maxParticles);
+
+	void Clear();
+
+	// replaces the list with count indices in the given order
+	void Assign(const unsigned int* indices, unsigned int count);
+
+	void Append(unsigned int index);
+	void Remove(unsigned int index);
+
+	// removes every index in the list, e.g. the dead indices an update just appended
+	void RemoveAll(const unsigned int* indices, unsigned int count);
+
+	bool Contains(unsigned int index) const;
+	unsigned int GetCount() const;
+	const unsigned int* GetIndices() const;
+
+	// the draw list and the 9 uint indirect draw arguments CopyDrawCountComputeShader would produce for the live set
+	unsigned int WriteDrawList(ParticleSort* drawList) const;
+	void BuildDrawArgs(unsigned int drawArgs[9]) const;
+
+private:
+	static const unsigned int NotListed = 0xffffffff;
+
+	std::vector<unsigned int> indices;
+	std::vector<unsigned int> slots;
+	unsigned int count;
+};
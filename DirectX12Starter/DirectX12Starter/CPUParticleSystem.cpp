@@ -0,0 +1,964 @@
+#include "CPUParticleSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+using namespace DirectX;
+
+static_assert(sizeof(Particle) == 64, "Particle must match the structured buffer stride used by the shaders");
+
+namespace
+{
+	typedef std::chrono::high_resolution_clock StageClock;
+
+	void RecordStage(ParticleStageStats& stats, StageClock::time_point start, unsigned long long particles)
+	{
+		stats.Dispatches += 1;
+		stats.Particles += particles;
+		stats.Seconds += std::chrono::duration<double>(StageClock::now() - start).count();
+	}
+}
+
+CPUParticleSystem::CPUParticleSystem(int maxParticles) :
+	maxParticles(maxParticles),
+	aliveList(maxParticles)
+{
+	particlePool.resize(maxParticles);
+	deadList.resize(maxParticles);
+	drawList.resize(maxParticles);
+
+	// default heap buffers start out zeroed
+	memset(particlePool.data(), 0, sizeof(Particle) * maxParticles);
+	memset(drawArgs, 0, sizeof(drawArgs));
+
+	deadListCounter = 0;
+	drawListCounter = 0;
+	ringTail = 0;
+	ringCount = 0;
+	ringHoles = 0;
+	emitUnderflowCount = 0;
+	culledCount = 0;
+
+	kernelLevel = ParticleUpdateKernel::DetectLevel();
+	curlVolume = nullptr;
+	noiseLod = nullptr;
+	timeSlicer = nullptr;
+	integratedCount = 0;
+	updateMode = ParticleUpdatePool;
+
+	// a float clock at 1024 s still resolves 0.12 ms
+	timeMode = ParticleTimeAge;
+	clockTime = 0.0f;
+	clockOrigin = 0.0;
+	rebasePeriod = 1024.0f;
+	rebaseCount = 0;
+
+	chunkSize = 4096;
+	deterministicOrder = true;
+}
+
+CPUParticleSystem::~CPUParticleSystem()
+{
+
+}
+
+void CPUParticleSystem::DeadListInit(const ParticleConstants& particleConstants)
+{
+	// the ring has no list to fill, an empty ring leaves the whole pool free
+	if (UsesRing())
+	{
+		ringTail = 0;
+		ringCount = 0;
+		ringHoles = 0;
+		return;
+	}
+
+	auto start = StageClock::now();
+
+	aliveList.Clear();
+
+	for (unsigned int id = 0; id < (unsigned int)particleConstants.MaxParticles; ++id)
+	{
+		// add the index to the dead list
+		AppendDeadList(id);
+	}
+
+	RecordStage(stageStats[ParticleStageDeadListInit], start, particleConstants.MaxParticles);
+}
+
+void CPUParticleSystem::Emit(const TimeConstants& timeConstants, const ParticleConstants& particleConstants, unsigned int emitterIndex,
+	const EmissionShape* shape)
+{
+	auto start = StageClock::now();
+
+	unsigned int emitted = 0;
+	unsigned int gridSize = (unsigned int)particleConstants.GridSize;
+
+	// a slot is consumed at most once per frame, so slot and time name a spawn without any state to checkpoint
+	unsigned int timeBits;
+	memcpy(&timeBits, &timeConstants.TotalTime, sizeof(timeBits));
+	unsigned int frameSeed = EmissionShape::Hash(timeBits);
+
+	// the oldest spawn comes first, so the ring still holds its particles from oldest to newest
+	bool spread = particleConstants.EmitSpacing > 0.0f;
+	bool advances = spread && updateMode != ParticleUpdateBallistic;
+	if (advances && spawnIndices.size() < (size_t)particleConstants.EmitCount)
+	{
+		spawnIndices.resize(particleConstants.EmitCount);
+		spawnOffsets.resize(particleConstants.EmitCount);
+	}
+
+	for (unsigned int id = 0; id < (unsigned int)particleConstants.EmitCount; ++id)
+	{
+		// the GPU consumes garbage once the dead list runs dry, here we just stop
+		unsigned int emitIndex;
+		if (!(UsesRing() ? PushRing(emitIndex) : ConsumeDeadList(emitIndex)))
+		{
+			emitUnderflowCount++;
+			break;
+		}
+
+		Particle& emitParticle = particlePool[emitIndex];
+
+		if (shape != nullptr && shape->Type != EmissionShapeGrid)
+		{
+			// a constant number of operations for every shape, the mesh included
+			float u[4];
+			EmissionShape::Random(EmissionShape::Hash(emitIndex) ^ frameSeed, u);
+
+			emitParticle.Position = shape->Sample(u);
+			emitParticle.Color = XMFLOAT4(u[0], u[1], u[2], 1.0f);
+		}
+		else
+		{
+			XMFLOAT3 gridPosition;
+			unsigned int gridIndex = emitIndex;
+			gridPosition.x = (float)(gridIndex % (gridSize + 1));
+			gridIndex /= (gridSize + 1);
+			gridPosition.y = (float)(gridIndex % (gridSize + 1));
+			gridIndex /= (gridSize + 1);
+			gridPosition.z = (float)gridIndex;
+
+			// color and position depend on the grid position and size
+			emitParticle.Position.x = gridPosition.x / 10.0f - particleConstants.GridSize / 20.0f;
+			emitParticle.Position.y = gridPosition.y / 10.0f - particleConstants.GridSize / 20.0f;
+			emitParticle.Position.z = gridPosition.z / 10.0f + particleConstants.GridSize / 10.0f;
+			emitParticle.Color = XMFLOAT4(
+				gridPosition.x / particleConstants.GridSize,
+				gridPosition.y / particleConstants.GridSize,
+				gridPosition.z / particleConstants.GridSize,
+				1.0f);
+		}
+
+		// only the closed form uses the emitter velocity, the update replaces it with the curl
+		emitParticle.Velocity = updateMode == ParticleUpdateBallistic ? particleConstants.velocity : XMFLOAT3(0.0f, 0.0f, 0.0f);
+		// measured from the start of the step, the update that follows adds the step to age and position
+		float offset = spread ? particleConstants.EmitNewestAge + (float)(particleConstants.EmitCount - 1 - (int)id) * particleConstants.EmitSpacing -
+			timeConstants.DeltaTime : 0.0f;
+		emitParticle.Age = timeMode == ParticleTimeBirth ? clockTime - offset : offset;
+		emitParticle.Size = 0.5f;
+		emitParticle.Alive = 1.0f;
+		emitParticle.EmitterIndex = emitterIndex;
+
+		if (updateMode == ParticleUpdateAliveList)
+			aliveList.Append(emitIndex);
+
+		if (advances)
+		{
+			spawnIndices[emitted] = emitIndex;
+			spawnOffsets[emitted] = offset;
+		}
+
+		emitted++;
+	}
+
+	if (advances)
+		ParticleUpdateKernel::Advance(kernelLevel, particlePool.data(), spawnIndices.data(), spawnOffsets.data(), emitted, curlVolume);
+
+	RecordStage(stageStats[ParticleStageEmit], start, emitted);
+}
+
+void CPUParticleSystem::ResetDrawList()
+{
+	drawListCounter = 0;
+	culledCount = 0;
+}
+
+void CPUParticleSystem::Update(const TimeConstants& timeConstants, const ParticleConstants& particleConstants)
+{
+	UpdatePass(timeConstants.DeltaTime, particleConstants.LifeTime, nullptr, particleConstants.MaxParticles);
+}
+
+void CPUParticleSystem::UpdateEmitters(const TimeConstants& timeConstants, const float* emitterLifeTimes)
+{
+	UpdatePass(timeConstants.DeltaTime, 0.0f, emitterLifeTimes, maxParticles);
+}
+
+void CPUParticleSystem::UpdatePass(float deltaTime, float lifeTime, const float* emitterLifeTimes, unsigned int poolCount)
+{
+	auto start = StageClock::now();
+	integratedCount = 0;
+
+	// the clock reads the end of the step, so a particle emitted just before has an age of deltaTime like in age mode
+	if (clockTime + deltaTime >= rebasePeriod)
+		RebaseClock();
+	clockTime += deltaTime;
+
+	if (updateMode == ParticleUpdateBallistic)
+	{
+		unsigned int expired = ExpireRing(lifeTime, emitterLifeTimes);
+
+		RecordStage(stageStats[ParticleStageUpdate], start, expired);
+		return;
+	}
+
+	if (updateMode == ParticleUpdateRing)
+	{
+		unsigned int ringSpan = ringCount;
+		UpdateRing(deltaTime, lifeTime, emitterLifeTimes);
+
+		RecordStage(stageStats[ParticleStageUpdate], start, ringSpan);
+		return;
+	}
+
+	if (updateMode == ParticleUpdateAliveList)
+	{
+		unsigned int aliveCount = aliveList.GetCount();
+		unsigned int firstDead = deadListCounter;
+
+		if (scheduler != nullptr)
+		{
+			UpdateParallel(deltaTime, lifeTime, emitterLifeTimes, 0, aliveCount, aliveList.GetIndices());
+		}
+		else
+		{
+			ParticleUpdateOutput output;
+			output.DeadList = deadList.data() + deadListCounter;
+			output.DrawList = drawList.data() + drawListCounter;
+
+			UpdateIndexedRange(deltaTime, lifeTime, emitterLifeTimes, aliveList.GetIndices(), aliveCount, output);
+
+			deadListCounter += output.DeadCount;
+			drawListCounter += output.DrawCount;
+			integratedCount += output.IntegratedCount;
+		}
+
+		// the list is only compacted once the update no longer reads it
+		aliveList.RemoveAll(deadList.data() + firstDead, deadListCounter - firstDead);
+
+		RecordStage(stageStats[ParticleStageUpdate], start, aliveCount);
+		return;
+	}
+
+	if (scheduler != nullptr)
+	{
+		UpdateParallel(deltaTime, lifeTime, emitterLifeTimes, 0, poolCount, nullptr);
+	}
+	else
+	{
+		// the kernel appends in index order, exactly like a sequential run of the shader
+		ParticleUpdateOutput output;
+		output.DeadList = deadList.data() + deadListCounter;
+		output.DrawList = drawList.data() + drawListCounter;
+
+		UpdateRange(deltaTime, lifeTime, emitterLifeTimes, 0, poolCount, output);
+
+		deadListCounter += output.DeadCount;
+		drawListCounter += output.DrawCount;
+		integratedCount += output.IntegratedCount;
+	}
+
+	RecordStage(stageStats[ParticleStageUpdate], start, poolCount);
+}
+
+void CPUParticleSystem::UpdateRing(float deltaTime, float lifeTime, const float* emitterLifeTimes)
+{
+	// the span up to the end of the pool and the part that wrapped around to the start
+	unsigned int firstCount = (std::min)(ringCount, (unsigned int)maxParticles - ringTail);
+	unsigned int ranges[2][2] = { { ringTail, firstCount }, { 0, ringCount - firstCount } };
+	unsigned int firstDraw = drawListCounter;
+
+	// the kernel still writes the indices that died, the dead list only serves as scratch for them
+	deadListCounter = 0;
+
+	for (int range = 0; range < 2; ++range)
+	{
+		unsigned int first = ranges[range][0];
+		unsigned int count = ranges[range][1];
+		if (count == 0)
+			continue;
+
+		if (scheduler != nullptr)
+		{
+			UpdateParallel(deltaTime, lifeTime, emitterLifeTimes, first, count, nullptr);
+		}
+		else
+		{
+			ParticleUpdateOutput output;
+			output.DeadList = deadList.data() + deadListCounter;
+			output.DrawList = drawList.data() + drawListCounter;
+
+			UpdateRange(deltaTime, lifeTime, emitterLifeTimes, first, first + count, output);
+
+			deadListCounter += output.DeadCount;
+			drawListCounter += output.DrawCount;
+			integratedCount += output.IntegratedCount;
+		}
+	}
+
+	deadListCounter = 0;
+
+	// the oldest particles sit at the tail, so whatever expired this step is a run starting there
+	while (ringCount > 0 && particlePool[ringTail].Alive == 0.0f)
+	{
+		ringTail = (ringTail + 1) % (unsigned int)maxParticles;
+		ringCount--;
+	}
+
+	ringHoles = ringCount - (drawListCounter - firstDraw);
+}
+
+unsigned int CPUParticleSystem::ExpireRing(float lifeTime, const float* emitterLifeTimes)
+{
+	unsigned int expired = 0;
+
+	// the oldest particle decides, anything younger behind it is still alive unless its emitter lives shorter
+	while (ringCount > 0)
+	{
+		Particle& oldest = particlePool[ringTail];
+		float oldestLifeTime = emitterLifeTimes != nullptr ? emitterLifeTimes[oldest.EmitterIndex] : lifeTime;
+
+		if (clockTime - oldest.Age < oldestLifeTime)
+			break;
+
+		oldest.Alive = 0.0f;
+		ringTail = (ringTail + 1) % (unsigned int)maxParticles;
+		ringCount--;
+		expired++;
+	}
+
+	return expired;
+}
+
+void CPUParticleSystem::UpdateRange(float deltaTime, float lifeTime, const float* emitterLifeTimes, unsigned int begin, unsigned int end,
+	ParticleUpdateOutput& output)
+{
+	if (timeMode == ParticleTimeBirth)
+		ParticleUpdateKernel::UpdateBirth(kernelLevel, particlePool.data(), begin, end, deltaTime, clockTime, lifeTime, emitterLifeTimes, output, curlVolume, noiseLod, timeSlicer);
+	else if (emitterLifeTimes != nullptr)
+		ParticleUpdateKernel::UpdateEmitters(kernelLevel, particlePool.data(), begin, end, deltaTime, emitterLifeTimes, output, curlVolume, noiseLod, timeSlicer);
+	else
+		ParticleUpdateKernel::Update(kernelLevel, particlePool.data(), begin, end, deltaTime, lifeTime, output, curlVolume, noiseLod, timeSlicer);
+}
+
+void CPUParticleSystem::UpdateIndexedRange(float deltaTime, float lifeTime, const float* emitterLifeTimes, const unsigned int* indices,
+	unsigned int count, ParticleUpdateOutput& output)
+{
+	if (timeMode == ParticleTimeBirth)
+		ParticleUpdateKernel::UpdateIndexedBirth(kernelLevel, particlePool.data(), indices, count, deltaTime, clockTime, lifeTime, emitterLifeTimes, output, curlVolume, noiseLod, timeSlicer);
+	else if (emitterLifeTimes != nullptr)
+		ParticleUpdateKernel::UpdateIndexedEmitters(kernelLevel, particlePool.data(), indices, count, deltaTime, emitterLifeTimes, output, curlVolume, noiseLod, timeSlicer);
+	else
+		ParticleUpdateKernel::UpdateIndexed(kernelLevel, particlePool.data(), indices, count, deltaTime, lifeTime, output, curlVolume, noiseLod, timeSlicer);
+}
+
+void CPUParticleSystem::CullDrawList(const XMFLOAT4X4& view, const XMFLOAT4X4& projection)
+{
+	auto start = StageClock::now();
+	unsigned int count = drawListCounter;
+
+	frustumCuller.SetMatrices(view, projection);
+
+	// compacts in place, the visible entries keep their update order
+	drawListCounter = frustumCuller.Cull(kernelLevel, particlePool.data(), drawList.data(), count, drawList.data());
+	culledCount += count - drawListCounter;
+
+	RecordStage(stageStats[ParticleStageCull], start, count);
+}
+
+void CPUParticleSystem::SortDrawList(const XMFLOAT4X4& view)
+{
+	auto start = StageClock::now();
+
+	if (depthSort == nullptr)
+		depthSort.reset(new ParticleDepthSort(maxParticles));
+
+	depthSort->Sort(particlePool.data(), drawList.data(), drawListCounter, view, scheduler.get());
+
+	RecordStage(stageStats[ParticleStageDepthSort], start, drawListCounter);
+}
+
+void CPUParticleSystem::CopyDrawCount()
+{
+	auto start = StageClock::now();
+
+	if (updateMode == ParticleUpdateBallistic)
+	{
+		// the vertex shader finds slot (tail + SV_VertexID) % MaxParticles, holes included
+		drawArgs[0] = ringCount; // vertexCountPerInstance
+		drawArgs[1] = 1; // instanceCount
+		for (int i = 2; i < 9; ++i)
+			drawArgs[i] = 0; // offsets
+
+		RecordStage(stageStats[ParticleStageCopyDrawCount], start, 1);
+		return;
+	}
+
+	if (updateMode == ParticleUpdateAliveList)
+	{
+		aliveList.BuildDrawArgs(drawArgs);
+
+		// a culled draw list is shorter than the alive list
+		if (culledCount > 0)
+			drawArgs[0] = drawListCounter; // vertexCountPerInstance
+
+		RecordStage(stageStats[ParticleStageCopyDrawCount], start, 1);
+		return;
+	}
+
+	// the shader increments the counter to read it, so the counter ends one past the draw count
+	drawArgs[0] = IncrementDrawListCounter(); // vertexCountPerInstance
+	drawArgs[1] = 1; // instanceCount
+	drawArgs[2] = 0; // offsets
+	drawArgs[3] = 0; // offsets
+	drawArgs[4] = 0; // offsets
+	drawArgs[5] = 0; // offsets
+	drawArgs[6] = 0; // offsets
+	drawArgs[7] = 0; // offsets
+	drawArgs[8] = 0; // offsets
+
+	RecordStage(stageStats[ParticleStageCopyDrawCount], start, 1);
+}
+
+void CPUParticleSystem::CopyEmitterDrawCounts(int emitterCount)
+{
+	auto start = StageClock::now();
+
+	emitterDrawArgs.assign(9 * emitterCount, 0);
+	emitterOffsets.resize(emitterCount);
+	emitterDrawList.resize(maxParticles);
+
+	// counting sort by emitter, a stable scatter keeps the update or depth order inside each group
+	for (unsigned int i = 0; i < drawListCounter; ++i)
+		emitterDrawArgs[9 * particlePool[drawList[i].index].EmitterIndex]++;
+
+	unsigned int offset = 0;
+	for (int emitter = 0; emitter < emitterCount; ++emitter)
+	{
+		unsigned int* record = &emitterDrawArgs[9 * emitter];
+
+		// record[0] already holds vertexCountPerInstance
+		record[1] = 1; // instanceCount
+		record[2] = offset; // startVertexLocation, SV_VertexID starts here so the vertex shader reads the emitter's group
+
+		emitterOffsets[emitter] = offset;
+		offset += record[0];
+	}
+
+	for (unsigned int i = 0; i < drawListCounter; ++i)
+	{
+		unsigned int emitter = particlePool[drawList[i].index].EmitterIndex;
+		emitterDrawList[emitterOffsets[emitter]++] = drawList[i];
+	}
+
+	memcpy(drawList.data(), emitterDrawList.data(), sizeof(ParticleSort) * drawListCounter);
+
+	drawArgs[0] = drawListCounter; // vertexCountPerInstance
+	drawArgs[1] = 1; // instanceCount
+	for (int i = 2; i < 9; ++i)
+		drawArgs[i] = 0; // offsets
+
+	RecordStage(stageStats[ParticleStageCopyDrawCount], start, drawListCounter);
+}
+
+unsigned int CPUParticleSystem::EvaluateBallistic(const TimeConstants& timeConstants, const ParticleConstants& particleConstants,
+	const float* emitterLifeTimes, ParticleVertex* vertices)
+{
+	auto start = StageClock::now();
+
+	// the closed form holds at any time, so the frame is drawn where it is instead of extrapolated
+	float drawTime = clockTime + timeConstants.InterpolationAlpha * timeConstants.DeltaTime;
+	XMFLOAT3 halfAcceleration(particleConstants.acceleration.x * 0.5f, particleConstants.acceleration.y * 0.5f,
+		particleConstants.acceleration.z * 0.5f);
+	XMFLOAT4 startColor = particleConstants.startColor;
+	XMFLOAT4 colorRange(particleConstants.endColor.x - startColor.x, particleConstants.endColor.y - startColor.y,
+		particleConstants.endColor.z - startColor.z, particleConstants.endColor.w - startColor.w);
+
+	unsigned int aliveCount = 0;
+	unsigned int id = ringTail;
+
+	for (unsigned int i = 0; i < ringCount; ++i)
+	{
+		const Particle& spawn = particlePool[id];
+		ParticleVertex& vertex = vertices[i];
+
+		float lifeTime = emitterLifeTimes != nullptr ? emitterLifeTimes[spawn.EmitterIndex] : particleConstants.LifeTime;
+		float age = drawTime - spawn.Age;
+		float lifeFraction = age / lifeTime;
+
+		// alive as of the last step, like the draw list of the other modes
+		bool alive = clockTime - spawn.Age < lifeTime;
+
+		vertex.Position.x = spawn.Position.x + (spawn.Velocity.x + halfAcceleration.x * age) * age;
+		vertex.Position.y = spawn.Position.y + (spawn.Velocity.y + halfAcceleration.y * age) * age;
+		vertex.Position.z = spawn.Position.z + (spawn.Velocity.z + halfAcceleration.z * age) * age;
+		vertex.Size = alive ? spawn.Size : 0.0f;
+		vertex.Color.x = startColor.x + colorRange.x * lifeFraction;
+		vertex.Color.y = startColor.y + colorRange.y * lifeFraction;
+		vertex.Color.z = startColor.z + colorRange.z * lifeFraction;
+		vertex.Color.w = startColor.w + colorRange.w * lifeFraction;
+
+		aliveCount += alive ? 1 : 0;
+
+		if (++id == (unsigned int)maxParticles)
+			id = 0;
+	}
+
+	RecordStage(stageStats[ParticleStageEvaluate], start, ringCount);
+	return aliveCount;
+}
+
+const unsigned int* CPUParticleSystem::GetEmitterDrawArgs() const
+{
+	return emitterDrawArgs.data();
+}
+
+void CPUParticleSystem::RestoreState(const Particle* pool, const unsigned int* deadList, unsigned int deadListCount,
+	const ParticleSort* drawList, unsigned int drawListCount, const unsigned int* drawArgs,
+	const unsigned int* aliveIndices, unsigned int aliveCount)
+{
+	memcpy(particlePool.data(), pool, sizeof(Particle) * maxParticles);
+	memcpy(this->deadList.data(), deadList, sizeof(unsigned int) * maxParticles);
+	memcpy(this->drawList.data(), drawList, sizeof(ParticleSort) * maxParticles);
+	memcpy(this->drawArgs, drawArgs, sizeof(this->drawArgs));
+
+	deadListCounter = deadListCount;
+	drawListCounter = drawListCount;
+	culledCount = 0;
+
+	if (updateMode == ParticleUpdateAliveList && aliveIndices != nullptr)
+		aliveList.Assign(aliveIndices, aliveCount);
+	else
+		SetUpdateMode(updateMode);
+}
+
+ParticleKernelLevel CPUParticleSystem::GetKernelLevel() const
+{
+	return kernelLevel;
+}
+
+void CPUParticleSystem::SetKernelLevel(ParticleKernelLevel level)
+{
+	kernelLevel = level;
+}
+
+const CurlVolume* CPUParticleSystem::GetCurlVolume() const
+{
+	return curlVolume;
+}
+
+void CPUParticleSystem::SetCurlVolume(const CurlVolume* volume)
+{
+	curlVolume = volume;
+}
+
+const ParticleNoiseLod* CPUParticleSystem::GetNoiseLod() const
+{
+	return noiseLod;
+}
+
+void CPUParticleSystem::SetNoiseLod(const ParticleNoiseLod* lod)
+{
+	noiseLod = lod;
+}
+
+ParticleTimeSlicer* CPUParticleSystem::GetTimeSlicer() const
+{
+	return timeSlicer;
+}
+
+void CPUParticleSystem::SetTimeSlicer(ParticleTimeSlicer* slicer)
+{
+	timeSlicer = slicer;
+}
+
+ParticleUpdateMode CPUParticleSystem::GetUpdateMode() const
+{
+	return updateMode;
+}
+
+void CPUParticleSystem::SetUpdateMode(ParticleUpdateMode mode)
+{
+	if (mode == ParticleUpdateBallistic)
+		SetTimeMode(ParticleTimeBirth);
+
+	updateMode = mode;
+
+	aliveList.Clear();
+
+	if (UsesRing())
+		RebuildRing();
+
+	if (mode != ParticleUpdateAliveList)
+		return;
+
+	for (unsigned int id = 0; id < (unsigned int)maxParticles; ++id)
+	{
+		if (particlePool[id].Alive != 0.0f)
+			aliveList.Append(id);
+	}
+}
+
+const AliveList& CPUParticleSystem::GetAliveList() const
+{
+	return aliveList;
+}
+
+ParticleTimeMode CPUParticleSystem::GetTimeMode() const
+{
+	return timeMode;
+}
+
+void CPUParticleSystem::SetTimeMode(ParticleTimeMode mode)
+{
+	if (updateMode == ParticleUpdateBallistic)
+		return;
+
+	if (mode != timeMode)
+		ConvertAges();
+
+	timeMode = mode;
+}
+
+float CPUParticleSystem::GetParticleAge(const Particle& particle) const
+{
+	return timeMode == ParticleTimeBirth ? clockTime - particle.Age : particle.Age;
+}
+
+double CPUParticleSystem::GetClockTime() const
+{
+	return clockOrigin + clockTime;
+}
+
+void CPUParticleSystem::SetTimeRebasePeriod(float seconds)
+{
+	rebasePeriod = seconds;
+}
+
+unsigned int CPUParticleSystem::GetTimeRebaseCount() const
+{
+	return rebaseCount;
+}
+
+float CPUParticleSystem::GetPoolClock() const
+{
+	return clockTime;
+}
+
+void CPUParticleSystem::RestoreClock(ParticleTimeMode poolMode, float poolClock)
+{
+	clockTime = poolClock;
+	clockOrigin = 0.0;
+
+	if (poolMode != timeMode)
+		ConvertAges();
+}
+
+int CPUParticleSystem::GetThreadCount() const
+{
+	return scheduler != nullptr ? scheduler->GetThreadCount() : 1;
+}
+
+unsigned long long CPUParticleSystem::GetStealCount() const
+{
+	return scheduler != nullptr ? scheduler->GetStealCount() : 0;
+}
+
+void CPUParticleSystem::SetThreadCount(int threadCount, unsigned int chunkSize)
+{
+	this->chunkSize = chunkSize;
+
+	scheduler.reset(new WorkStealingScheduler(threadCount));
+
+	// one thread is just the sequential path
+	if (scheduler->GetThreadCount() == 1)
+	{
+		scheduler.reset();
+		return;
+	}
+
+	// a chunk never writes more indices than it has particles, so the slices can share the pool's index space
+	chunkDeadList.resize(maxParticles);
+	chunkDrawList.resize(maxParticles);
+}
+
+bool CPUParticleSystem::GetDeterministicOrder() const
+{
+	return deterministicOrder;
+}
+
+void CPUParticleSystem::SetDeterministicOrder(bool value)
+{
+	deterministicOrder = value;
+}
+
+int CPUParticleSystem::GetMaxParticles() const
+{
+	return maxParticles;
+}
+
+unsigned int CPUParticleSystem::GetDeadListCount() const
+{
+	return UsesRing() ? (unsigned int)maxParticles - ringCount : deadListCounter;
+}
+
+unsigned int CPUParticleSystem::GetDrawListCount() const
+{
+	return drawListCounter;
+}
+
+const Particle* CPUParticleSystem::GetParticlePool() const
+{
+	return particlePool.data();
+}
+
+const unsigned int* CPUParticleSystem::GetDeadList() const
+{
+	return deadList.data();
+}
+
+const ParticleSort* CPUParticleSystem::GetDrawList() const
+{
+	return drawList.data();
+}
+
+const unsigned int* CPUParticleSystem::GetDrawArgs() const
+{
+	return drawArgs;
+}
+
+unsigned int CPUParticleSystem::GetCulledCount() const
+{
+	return culledCount;
+}
+
+unsigned int CPUParticleSystem::GetRingTail() const
+{
+	return ringTail;
+}
+
+unsigned int CPUParticleSystem::GetRingCount() const
+{
+	return ringCount;
+}
+
+unsigned int CPUParticleSystem::GetRingHoleCount() const
+{
+	return ringHoles;
+}
+
+unsigned int CPUParticleSystem::GetIntegratedCount() const
+{
+	return integratedCount;
+}
+
+unsigned long long CPUParticleSystem::GetEmitUnderflowCount() const
+{
+	return emitUnderflowCount;
+}
+
+const ParticleStageStats& CPUParticleSystem::GetStageStats(ParticleStage stage) const
+{
+	return stageStats[stage];
+}
+
+void CPUParticleSystem::ResetStageStats()
+{
+	for (int i = 0; i < ParticleStageCount; ++i)
+		stageStats[i] = ParticleStageStats();
+}
+
+void CPUParticleSystem::UpdateParallel(float deltaTime, float lifeTime, const float* emitterLifeTimes, unsigned int first, unsigned int count,
+	const unsigned int* indices)
+{
+	unsigned int chunkCount = (count + chunkSize - 1) / chunkSize;
+
+	chunkDeadCounts.resize(chunkCount);
+	chunkDrawCounts.resize(chunkCount);
+	chunkDeadOffsets.resize(chunkCount);
+	chunkDrawOffsets.resize(chunkCount);
+
+	std::atomic<unsigned int> deadCursor(deadListCounter);
+	std::atomic<unsigned int> drawCursor(drawListCounter);
+	std::atomic<unsigned int> integrated(0);
+
+	scheduler->ParallelFor(chunkCount, [&](unsigned int chunk, int threadIndex)
+	{
+		unsigned int begin = chunk * chunkSize;
+		unsigned int end = min(begin + chunkSize, count);
+
+		ParticleUpdateOutput output;
+		output.DeadList = chunkDeadList.data() + begin;
+		output.DrawList = chunkDrawList.data() + begin;
+
+		if (indices != nullptr)
+			UpdateIndexedRange(deltaTime, lifeTime, emitterLifeTimes, indices + begin, end - begin, output);
+		else
+			UpdateRange(deltaTime, lifeTime, emitterLifeTimes, first + begin, first + end, output);
+
+		integrated.fetch_add(output.IntegratedCount);
+
+		if (deterministicOrder)
+		{
+			chunkDeadCounts[chunk] = output.DeadCount;
+			chunkDrawCounts[chunk] = output.DrawCount;
+		}
+		else
+		{
+			// one atomic per chunk instead of one per particle
+			unsigned int deadOffset = deadCursor.fetch_add(output.DeadCount);
+			unsigned int drawOffset = drawCursor.fetch_add(output.DrawCount);
+
+			memcpy(deadList.data() + deadOffset, output.DeadList, sizeof(unsigned int) * output.DeadCount);
+			memcpy(drawList.data() + drawOffset, output.DrawList, sizeof(ParticleSort) * output.DrawCount);
+		}
+	});
+
+	integratedCount += integrated;
+
+	if (!deterministicOrder)
+	{
+		deadListCounter = deadCursor;
+		drawListCounter = drawCursor;
+		return;
+	}
+
+	// exclusive prefix sum over the chunk counts, in chunk order so the lists match the sequential update
+	for (unsigned int chunk = 0; chunk < chunkCount; ++chunk)
+	{
+		chunkDeadOffsets[chunk] = deadListCounter;
+		chunkDrawOffsets[chunk] = drawListCounter;
+		deadListCounter += chunkDeadCounts[chunk];
+		drawListCounter += chunkDrawCounts[chunk];
+	}
+
+	scheduler->ParallelFor(chunkCount, [&](unsigned int chunk, int threadIndex)
+	{
+		unsigned int begin = chunk * chunkSize;
+
+		memcpy(deadList.data() + chunkDeadOffsets[chunk], chunkDeadList.data() + begin, sizeof(unsigned int) * chunkDeadCounts[chunk]);
+		memcpy(drawList.data() + chunkDrawOffsets[chunk], chunkDrawList.data() + begin, sizeof(ParticleSort) * chunkDrawCounts[chunk]);
+	});
+}
+
+void CPUParticleSystem::RebaseClock()
+{
+	// dead slots get a new birth time when they are emitted, so only the live ones move
+	// once a rebase period this is a pass over the pool, in age mode there is nothing to move
+	if (timeMode == ParticleTimeBirth)
+	{
+		for (unsigned int id = 0; id < (unsigned int)maxParticles; ++id)
+		{
+			if (particlePool[id].Alive != 0.0f)
+				particlePool[id].Age -= clockTime;
+		}
+	}
+
+	clockOrigin += clockTime;
+	clockTime = 0.0f;
+	rebaseCount++;
+}
+
+void CPUParticleSystem::ConvertAges()
+{
+	// birth = clock - age and age = clock - birth, the same conversion both ways
+	for (unsigned int id = 0; id < (unsigned int)maxParticles; ++id)
+	{
+		if (particlePool[id].Alive != 0.0f)
+			particlePool[id].Age = clockTime - particlePool[id].Age;
+	}
+}
+
+bool CPUParticleSystem::UsesRing() const
+{
+	return updateMode == ParticleUpdateRing || updateMode == ParticleUpdateBallistic;
+}
+
+void CPUParticleSystem::RebuildRing()
+{
+	unsigned int poolSize = (unsigned int)maxParticles;
+	unsigned int aliveCount = 0;
+	unsigned int firstAlive = poolSize;
+
+	for (unsigned int id = 0; id < poolSize; ++id)
+	{
+		if (particlePool[id].Alive == 0.0f)
+			continue;
+
+		if (firstAlive == poolSize)
+			firstAlive = id;
+		aliveCount++;
+	}
+
+	ringTail = 0;
+	ringCount = aliveCount == 0 ? 0 : poolSize;
+	ringHoles = 0;
+
+	if (aliveCount == 0 || aliveCount == poolSize)
+		return;
+
+	// the ring starts behind the longest run of dead slots, anything dead between its ends becomes a hole
+	// the scan goes once around from one live slot back to it, so the run across the end of the pool is whole
+	unsigned int longestRun = 0;
+	unsigned int run = 0;
+
+	for (unsigned int i = 1; i <= poolSize; ++i)
+	{
+		unsigned int id = (firstAlive + i) % poolSize;
+
+		if (particlePool[id].Alive == 0.0f)
+		{
+			run++;
+			continue;
+		}
+
+		if (run > longestRun)
+		{
+			longestRun = run;
+			ringTail = id;
+		}
+		run = 0;
+	}
+
+	ringCount = poolSize - longestRun;
+	ringHoles = ringCount - aliveCount;
+}
+
+bool CPUParticleSystem::PushRing(unsigned int& index)
+{
+	if (ringCount == (unsigned int)maxParticles)
+		return false;
+
+	index = (ringTail + ringCount++) % (unsigned int)maxParticles;
+	return true;
+}
+
+bool CPUParticleSystem::ConsumeDeadList(unsigned int& index)
+{
+	if (deadListCounter == 0)
+		return false;
+
+	index = deadList[--deadListCounter];
+	return true;
+}
+
+void CPUParticleSystem::AppendDeadList(unsigned int index)
+{
+	deadList[deadListCounter++] = index;
+}
+
+unsigned int CPUParticleSystem::IncrementDrawListCounter()
+{
+	return drawListCounter++;
+}
@@ -0,0 +1,319 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "AliveList.h"
+#include "Emitter.h"
+#include "FrameResource.h"
+#include "ParticleDepthSort.h"
+#include "ParticleFrustumCull.h"
+#include "ParticleUpdateKernel.h"
+#include "WorkStealingScheduler.h"
+
+enum ParticleStage
+{
+	ParticleStageDeadListInit,
+	ParticleStageEmit,
+	ParticleStageUpdate,
+	ParticleStageCull,
+	ParticleStageDepthSort,
+	ParticleStageCopyDrawCount,
+	ParticleStageEvaluate,
+	ParticleStageCount
+};
+
+enum ParticleUpdateMode
+{
+	// one update thread per pool slot, the way Game::Draw dispatches UpdateComputeShader
+	ParticleUpdatePool,
+
+	// only the particles on the compacted alive list, so the cost follows the live count
+	ParticleUpdateAliveList,
+
+	// FIFO ring instead of the dead list, for emitters whose particles die in the order they were born
+	// Emit writes at the head, expiry moves the tail past the oldest particles, and the update only covers
+	// the live span, one or two contiguous ranges of the pool
+	ParticleUpdateRing,
+
+	// for emitters without noise forces, the ring holds spawn records only, position, velocity and birth time,
+	// nothing is integrated and the update just moves the tail past the expired ones,
+	// EvaluateBallistic finds each particle in closed form at draw time, so a frame only touches the live span
+	ParticleUpdateBallistic
+};
+
+// VS_OUTPUT of ParticleVertexShader
+struct ParticleVertex
+{
+	DirectX::XMFLOAT3 Position;
+	float Size;
+	DirectX::XMFLOAT4 Color;
+};
+
+enum ParticleTimeMode
+{
+	// Age holds the age and the update adds the step to it, like UpdateComputeShader
+	ParticleTimeAge,
+
+	// Age holds the birth time on the system clock, the update derives the age from it and only stores
+	// Position and Velocity, plus Alive for the particles that die
+	ParticleTimeBirth
+};
+
+// accumulated cost of one of the mirrored compute passes
+struct ParticleStageStats
+{
+	unsigned long long Dispatches = 0;
+	unsigned long long Particles = 0;
+	double Seconds = 0.0;
+
+	double ParticlesPerSecond() const
+	{
+		return Seconds > 0.0 ? (double)Particles / Seconds : 0.0;
+	}
+};
+
+// headless CPU version of the particle pipeline recorded in Game::Draw
+// the buffers match the UAVs created in Game::BuildUAVs and every pass follows its compute shader,
+// so a frame can be simulated and profiled on machines without a GPU
+class CPUParticleSystem
+{
+public:
+	CPUParticleSystem(int maxParticles);
+	~CPUParticleSystem();
+
+	// DeadListInitComputeShader: every pool index starts on the dead list, in ring mode it only empties the ring
+	void DeadListInit(const ParticleConstants& particleConstants);
+
+	// EmitComputeShader: consume EmitCount indices and place them on the grid, or anywhere in shape
+	// the particles carry emitterIndex when several emitters share the pool
+	// with EmitSpacing set particle i spawned EmitNewestAge + (EmitCount - 1 - i) * EmitSpacing before the end of the step,
+	// the emit runs at its start, so the particle starts that minus DeltaTime old, negative when it is due later
+	// in the step, and unless the update is ballistic it is moved along the field for that long, backwards if negative,
+	// the update of the step then brings it to its age at the end of the step
+	void Emit(const TimeConstants& timeConstants, const ParticleConstants& particleConstants, unsigned int emitterIndex = 0,
+		const EmissionShape* shape = nullptr);
+
+	// the CopyResource from DrawListUploadBuffer which clears the draw list counter each frame
+	void ResetDrawList();
+
+	// UpdateComputeShader: age, integrate and append to either the dead list or the draw list
+	void Update(const TimeConstants& timeConstants, const ParticleConstants& particleConstants);
+
+	// Update for a pool shared by several emitters, each particle expires after the lifetime of its emitter
+	void UpdateEmitters(const TimeConstants& timeConstants, const float* emitterLifeTimes);
+
+	// optional pass after Update, drops draw list entries whose sphere lies outside the camera frustum
+	// and shortens the list to the visible ones, CopyDrawCount then draws only those
+	void CullDrawList(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection);
+
+	// optional pass between Update and CopyDrawCount for alpha-blended drawing, orders the draw list back to front
+	void SortDrawList(const DirectX::XMFLOAT4X4& view);
+
+	// CopyDrawCountComputeShader: fill the 9 uint indirect draw arguments
+	// in ballistic mode one vertex per ring slot, the draw list stays empty so there is nothing to cull or sort
+	void CopyDrawCount();
+
+	// ParticleUpdateBallistic: the vertices of the ring span in ring order, GetDrawArgs()[0] of them, at the time
+	// between the last step and the next one, position = p0 + v * age + acceleration * age^2 / 2 and the color
+	// goes from startColor to endColor over the lifetime, a particle that died before an older one gets Size 0
+	// emitters sharing the pool share the acceleration and colors of particleConstants, with emitterLifeTimes set
+	// the lifetimes come from there, returns the number of live particles
+	unsigned int EvaluateBallistic(const TimeConstants& timeConstants, const ParticleConstants& particleConstants,
+		const float* emitterLifeTimes, ParticleVertex* vertices);
+
+	// CopyDrawCount for a shared pool, groups the draw list by emitter without changing the order inside a group
+	// and writes one 9 uint record per emitter that draws its group, GetDrawArgs gets the total
+	void CopyEmitterDrawCounts(int emitterCount);
+	const unsigned int* GetEmitterDrawArgs() const;
+
+	// overwrites the whole state with buffers of GetMaxParticles() entries, e.g. from a ParticleCheckpoint
+	// without aliveIndices the alive list is rebuilt from the pool in index order
+	void RestoreState(const Particle* pool, const unsigned int* deadList, unsigned int deadListCount,
+		const ParticleSort* drawList, unsigned int drawListCount, const unsigned int* drawArgs,
+		const unsigned int* aliveIndices = nullptr, unsigned int aliveCount = 0);
+
+	// the update kernel defaults to the widest one the CPU supports
+	ParticleKernelLevel GetKernelLevel() const;
+	void SetKernelLevel(ParticleKernelLevel level);
+
+	// with a baked volume, or the volume of a CurlFieldCache, the update samples the curl from it instead of evaluating the noise,
+	// the volume is not owned and has to outlive its use, nullptr goes back to the noise
+	const CurlVolume* GetCurlVolume() const;
+	void SetCurlVolume(const CurlVolume* volume);
+
+	// with a level of detail the update picks the curl source per distance band, its volume bands use the curl volume,
+	// the owner calls ParticleNoiseLod::BeginFrame with the camera position before each update,
+	// not owned either, nullptr evaluates the curl for every particle
+	const ParticleNoiseLod* GetNoiseLod() const;
+	void SetNoiseLod(const ParticleNoiseLod* lod);
+
+	// with a time slicer the update only integrates the buckets due on the frame and ages the rest,
+	// the owner calls ParticleTimeSlicer::BeginFrame with the camera and the step before each update,
+	// it has to cover GetMaxParticles() slots, is not owned and nullptr integrates every particle
+	// ignored in ballistic mode, which integrates nothing
+	ParticleTimeSlicer* GetTimeSlicer() const;
+	void SetTimeSlicer(ParticleTimeSlicer* slicer);
+
+	// switching to the alive list builds it from the pool, in that mode the draw list holds the live set
+	// in alive list order instead of pool order and CopyDrawCount takes its count from the alive list
+	// switching to the ring places it after the longest run of dead slots
+	// ballistic mode works on birth times and switches the time mode with it, live particles keep their
+	// current position and velocity as spawn data
+	ParticleUpdateMode GetUpdateMode() const;
+	void SetUpdateMode(ParticleUpdateMode mode);
+	const AliveList& GetAliveList() const;
+
+	// switching converts the Age of the live particles, ignored in ballistic mode
+	ParticleTimeMode GetTimeMode() const;
+	void SetTimeMode(ParticleTimeMode mode);
+
+	// the age of a pool particle in either mode
+	float GetParticleAge(const Particle& particle) const;
+
+	// seconds of simulation, the float clock restarts at zero once it passes the rebase period and in birth mode
+	// the births move back with it, so the precision of an age doesn't depend on how long the session ran
+	double GetClockTime() const;
+	void SetTimeRebasePeriod(float seconds);
+	unsigned int GetTimeRebaseCount() const;
+
+	// the float clock the birth times are on, seconds since the last rebase
+	float GetPoolClock() const;
+
+	// after RestoreState, the pool held Age in poolMode on a clock at poolClock, converted if the mode differs
+	void RestoreClock(ParticleTimeMode poolMode, float poolClock);
+
+	// with more than one thread the update splits the pool into chunks that the threads steal from each other,
+	// every chunk fills its own slice of dead and drawn indices and a prefix sum over the chunk counts
+	// places the slices in the dead list and the draw list
+	int GetThreadCount() const;
+	void SetThreadCount(int threadCount, unsigned int chunkSize = 4096);
+
+	// chunk ranges taken from another thread since the thread count was set
+	unsigned long long GetStealCount() const;
+
+	// deterministic order gives exactly the lists a sequential update writes,
+	// otherwise each chunk claims its place in the lists as soon as it finishes
+	bool GetDeterministicOrder() const;
+	void SetDeterministicOrder(bool value);
+
+	int GetMaxParticles() const;
+
+	// in ring mode the free slots outside the ring
+	unsigned int GetDeadListCount() const;
+	unsigned int GetDrawListCount() const;
+
+	const Particle* GetParticlePool() const;
+	const unsigned int* GetDeadList() const;
+	const ParticleSort* GetDrawList() const;
+	const unsigned int* GetDrawArgs() const;
+
+	// draw list entries removed by the last CullDrawList since the draw list was reset
+	unsigned int GetCulledCount() const;
+
+	// the ring covers GetRingCount slots from GetRingTail on, wrapping at the end of the pool
+	// holes are particles inside the ring that died before an older one, only possible when lifetimes differ,
+	// their slots come back once the tail passes them
+	unsigned int GetRingTail() const;
+	unsigned int GetRingCount() const;
+	unsigned int GetRingHoleCount() const;
+
+	// particles the last Update integrated, against GetMaxParticles() for a pool the shader would integrate in full
+	unsigned int GetIntegratedCount() const;
+
+	// Emit calls that asked for more particles than the dead list held
+	unsigned long long GetEmitUnderflowCount() const;
+
+	const ParticleStageStats& GetStageStats(ParticleStage stage) const;
+	void ResetStageStats();
+
+private:
+	int maxParticles;
+	ParticleKernelLevel kernelLevel;
+	const CurlVolume* curlVolume;
+	const ParticleNoiseLod* noiseLod;
+	ParticleTimeSlicer* timeSlicer;
+	unsigned int integratedCount;
+	ParticleUpdateMode updateMode;
+	AliveList aliveList;
+
+	// ParticleTimeBirth, clockTime counts from clockOrigin
+	ParticleTimeMode timeMode;
+	float clockTime;
+	double clockOrigin;
+	float rebasePeriod;
+	unsigned int rebaseCount;
+
+	// RWParticlePool
+	std::vector<Particle> particlePool;
+
+	// ACDeadList and its hidden UAV counter
+	std::vector<unsigned int> deadList;
+	unsigned int deadListCounter;
+
+	// RWDrawList and its hidden UAV counter
+	std::vector<ParticleSort> drawList;
+	unsigned int drawListCounter;
+
+	// RWDrawArgs
+	unsigned int drawArgs[9];
+
+	// ParticleUpdateRing and ParticleUpdateBallistic
+	unsigned int ringTail;
+	unsigned int ringCount;
+	unsigned int ringHoles;
+
+	// one RWDrawArgs record per emitter and the draw list grouped by emitter
+	std::vector<unsigned int> emitterDrawArgs;
+	std::vector<ParticleSort> emitterDrawList;
+	std::vector<unsigned int> emitterOffsets;
+
+	ParticleStageStats stageStats[ParticleStageCount];
+	unsigned long long emitUnderflowCount;
+
+	// the slots Emit filled and how long before the start of the step each particle spawned, for the pre-integration
+	std::vector<unsigned int> spawnIndices;
+	std::vector<float> spawnOffsets;
+
+	ParticleFrustumCuller frustumCuller;
+	unsigned int culledCount;
+
+	// created on the first SortDrawList
+	std::unique_ptr<ParticleDepthSort> depthSort;
+
+	// parallel update
+	std::unique_ptr<WorkStealingScheduler> scheduler;
+	unsigned int chunkSize;
+	bool deterministicOrder;
+
+	std::vector<unsigned int> chunkDeadList;
+	std::vector<ParticleSort> chunkDrawList;
+	std::vector<unsigned int> chunkDeadCounts;
+	std::vector<unsigned int> chunkDrawCounts;
+	std::vector<unsigned int> chunkDeadOffsets;
+	std::vector<unsigned int> chunkDrawOffsets;
+
+	void UpdatePass(float deltaTime, float lifeTime, const float* emitterLifeTimes, unsigned int poolCount);
+
+	// with indices set the tasks cover alive list slots instead of pool slots,
+	// with emitterLifeTimes set lifeTime is ignored
+	// without indices the tasks cover the pool slots [first, first + count)
+	void UpdateParallel(float deltaTime, float lifeTime, const float* emitterLifeTimes, unsigned int first, unsigned int count,
+		const unsigned int* indices);
+	void UpdateRing(float deltaTime, float lifeTime, const float* emitterLifeTimes);
+	unsigned int ExpireRing(float lifeTime, const float* emitterLifeTimes);
+
+	void UpdateRange(float deltaTime, float lifeTime, const float* emitterLifeTimes, unsigned int begin, unsigned int end,
+		ParticleUpdateOutput& output);
+	void UpdateIndexedRange(float deltaTime, float lifeTime, const float* emitterLifeTimes, const unsigned int* indices,
+		unsigned int count, ParticleUpdateOutput& output);
+
+	void RebaseClock();
+	void ConvertAges();
+
+	bool UsesRing() const;
+	void RebuildRing();
+	bool PushRing(unsigned int& index);
+
+	bool ConsumeDeadList(unsigned int& index);
+	void AppendDeadList(unsigned int index);
+	unsigned int IncrementDrawListCounter();
+};
@@ -15,6 +15,7 @@ public:
 
 	XMFLOAT4X4 GetViewMatrix();
 	XMFLOAT4X4 GetProjectionMatrix();
+	XMFLOAT3 GetPosition();
 
 	void SetXRotation(float amount);
 	void SetYRotation(float amount);
@@ -0,0 +1,182 @@
+#include "FloatContraction.h"
+#include "CurlFieldCache.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace DirectX;
+
+CurlFieldCache::CurlFieldCache()
+{
+	level = SimplexNoiseScalar;
+	refreshGroup = 0;
+	evaluationCount = 0;
+}
+
+bool CurlFieldCache::Initialize(const CurlFieldCacheDesc& cacheDesc, float totalTime, float deltaTime, WorkStealingScheduler* scheduler)
+{
+	if (!volume.Allocate(cacheDesc.Volume))
+		return false;
+
+	desc = cacheDesc;
+	desc.RefreshFrames = (std::min)((std::max)(desc.RefreshFrames, 1u), desc.Volume.Depth);
+	level = SimplexNoise::DetectLevel();
+
+	unsigned int texelCount = volume.GetTexelCount();
+	for (int component = 0; component < 3; ++component)
+	{
+		previous[component].assign(texelCount, 0.0f);
+		next[component].assign(texelCount, 0.0f);
+	}
+
+	float period = deltaTime * desc.RefreshFrames;
+	refreshTimes.assign(desc.RefreshFrames, totalTime);
+	refreshPeriods.assign(desc.RefreshFrames, period);
+	refreshGroup = 0;
+	evaluationCount = 0;
+
+	auto evaluate = [&](unsigned int z, int threadIndex)
+	{
+		EvaluateSlice(z, totalTime, previous);
+		EvaluateSlice(z, totalTime + period, next);
+		BlendSlice(z, totalTime);
+	};
+
+	if (scheduler != nullptr)
+	{
+		scheduler->ParallelFor(desc.Volume.Depth, evaluate);
+	}
+	else
+	{
+		for (unsigned int z = 0; z < desc.Volume.Depth; ++z)
+			evaluate(z, 0);
+	}
+
+	evaluationCount = 2ull * texelCount;
+	return true;
+}
+
+void CurlFieldCache::Update(float totalTime, float deltaTime, WorkStealingScheduler* scheduler)
+{
+	if (!volume.IsBaked())
+		return;
+
+	unsigned int depth = desc.Volume.Depth;
+	unsigned int group = refreshGroup;
+	float period = deltaTime * desc.RefreshFrames;
+
+	// the group's slices start their new blend from where the old one has got to
+	unsigned int groupSlices = (depth - group + desc.RefreshFrames - 1) / desc.RefreshFrames;
+	auto refresh = [&](unsigned int slice, int threadIndex)
+	{
+		unsigned int z = group + slice * desc.RefreshFrames;
+		BlendSlice(z, totalTime);
+
+		size_t sliceTexels = (size_t)desc.Volume.Width * desc.Volume.Height;
+		for (int component = 0; component < 3; ++component)
+			memcpy(previous[component].data() + z * sliceTexels, volume.GetPlane(component) + z * sliceTexels, sliceTexels * sizeof(float));
+
+		EvaluateSlice(z, totalTime + period, next);
+	};
+
+	if (scheduler != nullptr)
+	{
+		scheduler->ParallelFor(groupSlices, refresh);
+	}
+	else
+	{
+		for (unsigned int slice = 0; slice < groupSlices; ++slice)
+			refresh(slice, 0);
+	}
+
+	refreshTimes[group] = totalTime;
+	refreshPeriods[group] = period;
+
+	// the other slices only move along their blend
+	auto blend = [&](unsigned int z, int threadIndex)
+	{
+		if (z % desc.RefreshFrames != group)
+			BlendSlice(z, totalTime);
+	};
+
+	if (scheduler != nullptr)
+	{
+		scheduler->ParallelFor(depth, blend);
+	}
+	else
+	{
+		for (unsigned int z = 0; z < depth; ++z)
+			blend(z, 0);
+	}
+
+	evaluationCount += (unsigned long long)groupSlices * desc.Volume.Width * desc.Volume.Height;
+	refreshGroup = (group + 1) % desc.RefreshFrames;
+}
+
+const CurlVolume& CurlFieldCache::GetVolume() const
+{
+	return volume;
+}
+
+const CurlFieldCacheDesc& CurlFieldCache::GetDesc() const
+{
+	return desc;
+}
+
+XMFLOAT3 CurlFieldCache::Evaluate(XMFLOAT3 position, float totalTime) const
+{
+	float frequency = desc.Volume.Frequency;
+	XMFLOAT3 scaled(position.x * frequency, position.y * frequency, position.z * frequency);
+	return SimplexNoise::CurlNoise4D(scaled, totalTime * desc.TimeScale, desc.Volume.Delta);
+}
+
+unsigned long long CurlFieldCache::GetEvaluationCount() const
+{
+	return evaluationCount;
+}
+
+void CurlFieldCache::EvaluateSlice(unsigned int z, float totalTime, std::vector<float>* planes)
+{
+	const CurlVolumeDesc& volumeDesc = desc.Volume;
+	XMFLOAT3 cellSize = volume.GetCellSize();
+	float w = totalTime * desc.TimeScale;
+
+	std::vector<float> rowX(volumeDesc.Width), rowY(volumeDesc.Width), rowZ(volumeDesc.Width);
+
+	float positionZ = (volumeDesc.Min.z + (float)z * cellSize.z) * volumeDesc.Frequency;
+
+	for (unsigned int y = 0; y < volumeDesc.Height; ++y)
+	{
+		float positionY = (volumeDesc.Min.y + (float)y * cellSize.y) * volumeDesc.Frequency;
+
+		for (unsigned int x = 0; x < volumeDesc.Width; ++x)
+		{
+			rowX[x] = (volumeDesc.Min.x + (float)x * cellSize.x) * volumeDesc.Frequency;
+			rowY[x] = positionY;
+			rowZ[x] = positionZ;
+		}
+
+		size_t row = ((size_t)z * volumeDesc.Height + y) * volumeDesc.Width;
+		SimplexNoise::CurlNoise4DPoints(level, rowX.data(), rowY.data(), rowZ.data(), w, volumeDesc.Delta,
+			planes[0].data() + row, planes[1].data() + row, planes[2].data() + row, volumeDesc.Width);
+	}
+}
+
+void CurlFieldCache::BlendSlice(unsigned int z, float totalTime)
+{
+	unsigned int group = z % desc.RefreshFrames;
+	float blend = refreshPeriods[group] > 0.0f ? (totalTime - refreshTimes[group]) / refreshPeriods[group] : 1.0f;
+	blend = (std::min)((std::max)(blend, 0.0f), 1.0f);
+
+	size_t sliceTexels = (size_t)desc.Volume.Width * desc.Volume.Height;
+	size_t begin = z * sliceTexels;
+
+	for (int component = 0; component < 3; ++component)
+	{
+		const float* from = previous[component].data() + begin;
+		const float* to = next[component].data() + begin;
+		float* current = volume.GetPlane(component) + begin;
+
+		for (size_t i = 0; i < sliceTexels; ++i)
+			current[i] = from[i] + (to[i] - from[i]) * blend;
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <vector>
+#include "CurlVolume.h"
+
+// the grid, the refresh rate and the time axis of a CurlFieldCache
+// texel (i, j, k) follows SimplexNoise::CurlNoise4D(position * Volume.Frequency, time * TimeScale, Volume.Delta)
+struct CurlFieldCacheDesc
+{
+	CurlVolumeDesc Volume;
+
+	// every slice is evaluated again once every RefreshFrames calls to Update
+	unsigned int RefreshFrames = 8;
+	float TimeScale = 0.2f;
+};
+
+// a time-varying curl field kept in a CurlVolume, so the update samples a grid instead of evaluating 4D noise per particle
+// the slices z with z % RefreshFrames == n are refreshed on the frames where the frame index % RefreshFrames == n,
+// a refresh evaluates the field one refresh period ahead and the slice blends linearly from its current value
+// towards it, so the grid has no jumps and the noise costs texels / RefreshFrames evaluations a frame
+// whatever the particle count
+class CurlFieldCache
+{
+public:
+	CurlFieldCache();
+
+	// evaluates the whole grid at totalTime and one refresh period of deltaTime steps later
+	// returns false when CurlVolume::Allocate rejects the grid
+	bool Initialize(const CurlFieldCacheDesc& desc, float totalTime, float deltaTime, WorkStealingScheduler* scheduler);
+
+	// blends every slice to totalTime, then refreshes the next group of slices, once per frame before the update
+	void Update(float totalTime, float deltaTime, WorkStealingScheduler* scheduler);
+
+	// the field at the last Update, for CPUParticleSystem::SetCurlVolume
+	const CurlVolume& GetVolume() const;
+	const CurlFieldCacheDesc& GetDesc() const;
+
+	// the field the cache approximates, evaluated directly at a world position
+	DirectX::XMFLOAT3 Evaluate(DirectX::XMFLOAT3 position, float totalTime) const;
+
+	// texels evaluated since Initialize, the initial grid counts twice
+	unsigned long long GetEvaluationCount() const;
+
+private:
+	CurlFieldCacheDesc desc;
+	CurlVolume volume;
+	SimplexNoiseLevel level;
+
+	// the value of each texel at the last refresh of its slice and one period later
+	std::vector<float> previous[3];
+	std::vector<float> next[3];
+
+	// per refresh group, when it was last refreshed and the period its blend spans
+	std::vector<float> refreshTimes;
+	std::vector<float> refreshPeriods;
+	unsigned int refreshGroup;
+	unsigned long long evaluationCount;
+
+	void EvaluateSlice(unsigned int z, float totalTime, std::vector<float>* planes);
+	void BlendSlice(unsigned int z, float totalTime);
+};
@@ -0,0 +1,309 @@
+#include "FloatContraction.h"
+#include "CurlVolume.h"
+#include "ParticlePacking.h"
+#include "SimplexNoise.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+using namespace DirectX;
+
+namespace
+{
+	// the parts of DDS.h a volume texture needs, see DDSTextureLoader.cpp for the full definitions
+#pragma pack(push, 1)
+	struct DDSPixelFormat
+	{
+		unsigned int Size;
+		unsigned int Flags;
+		unsigned int FourCC;
+		unsigned int RGBBitCount;
+		unsigned int BitMasks[4];
+	};
+
+	struct DDSHeader
+	{
+		unsigned int Size;
+		unsigned int Flags;
+		unsigned int Height;
+		unsigned int Width;
+		unsigned int PitchOrLinearSize;
+		unsigned int Depth;
+		unsigned int MipMapCount;
+		unsigned int Reserved1[11];
+		DDSPixelFormat PixelFormat;
+		unsigned int Caps;
+		unsigned int Caps2;
+		unsigned int Caps3;
+		unsigned int Caps4;
+		unsigned int Reserved2;
+	};
+
+	struct DDSHeaderDX10
+	{
+		unsigned int DXGIFormat;
+		unsigned int ResourceDimension;
+		unsigned int MiscFlag;
+		unsigned int ArraySize;
+		unsigned int MiscFlags2;
+	};
+#pragma pack(pop)
+
+	const unsigned int DDSMagic = 0x20534444;          // "DDS "
+	const unsigned int DDSFourCCDX10 = 0x30315844;     // "DX10"
+	const unsigned int DDSFlagsVolume = 0x1 | 0x2 | 0x4 | 0x8 | 0x1000 | 0x800000; // caps, height, width, pitch, pixel format, depth
+	const unsigned int DDSPixelFormatFourCC = 0x4;
+	const unsigned int DDSCapsTexture = 0x1000;
+	const unsigned int DDSCaps2Volume = 0x200000;
+	const unsigned int DXGIFormatR32G32B32A32Float = 2;
+	const unsigned int DXGIFormatR16G16B16A16Float = 10;
+	const unsigned int ResourceDimensionTexture3D = 4;
+}
+
+CurlVolume::CurlVolume()
+{
+	cellSize = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	inverseCellSize = XMFLOAT3(0.0f, 0.0f, 0.0f);
+}
+
+bool CurlVolume::Bake(const CurlVolumeDesc& volumeDesc, WorkStealingScheduler* scheduler)
+{
+	if (!Allocate(volumeDesc))
+		return false;
+
+	SimplexNoiseLevel level = SimplexNoise::DetectLevel();
+
+	if (scheduler != nullptr)
+	{
+		scheduler->ParallelFor(desc.Depth, [&](unsigned int z, int threadIndex) { BakeSlice(level, z); });
+	}
+	else
+	{
+		for (unsigned int z = 0; z < desc.Depth; ++z)
+			BakeSlice(level, z);
+	}
+
+	return true;
+}
+
+bool CurlVolume::Allocate(const CurlVolumeDesc& volumeDesc)
+{
+	if (volumeDesc.Width < 2 || volumeDesc.Height < 2 || volumeDesc.Depth < 2)
+		return false;
+
+	if (!(volumeDesc.Max.x > volumeDesc.Min.x && volumeDesc.Max.y > volumeDesc.Min.y && volumeDesc.Max.z > volumeDesc.Min.z))
+		return false;
+
+	if ((unsigned long long)volumeDesc.Width * volumeDesc.Height * volumeDesc.Depth > MaxTexelCount)
+		return false;
+
+	desc = volumeDesc;
+	cellSize = XMFLOAT3(
+		(desc.Max.x - desc.Min.x) / (float)(desc.Width - 1),
+		(desc.Max.y - desc.Min.y) / (float)(desc.Height - 1),
+		(desc.Max.z - desc.Min.z) / (float)(desc.Depth - 1));
+	inverseCellSize = XMFLOAT3(1.0f / cellSize.x, 1.0f / cellSize.y, 1.0f / cellSize.z);
+
+	for (int component = 0; component < 3; ++component)
+		planes[component].assign(GetTexelCount(), 0.0f);
+
+	return true;
+}
+
+void CurlVolume::BakeSlice(SimplexNoiseLevel level, unsigned int z)
+{
+	std::vector<float> rowX(desc.Width), rowY(desc.Width), rowZ(desc.Width);
+
+	float positionZ = (desc.Min.z + (float)z * cellSize.z) * desc.Frequency;
+
+	for (unsigned int y = 0; y < desc.Height; ++y)
+	{
+		float positionY = (desc.Min.y + (float)y * cellSize.y) * desc.Frequency;
+
+		for (unsigned int x = 0; x < desc.Width; ++x)
+		{
+			rowX[x] = (desc.Min.x + (float)x * cellSize.x) * desc.Frequency;
+			rowY[x] = positionY;
+			rowZ[x] = positionZ;
+		}
+
+		size_t row = ((size_t)z * desc.Height + y) * desc.Width;
+		SimplexNoise::CurlNoise3DPoints(level, rowX.data(), rowY.data(), rowZ.data(), desc.Delta,
+			planes[0].data() + row, planes[1].data() + row, planes[2].data() + row, desc.Width);
+	}
+}
+
+bool CurlVolume::IsBaked() const
+{
+	return !planes[0].empty();
+}
+
+const CurlVolumeDesc& CurlVolume::GetDesc() const
+{
+	return desc;
+}
+
+unsigned int CurlVolume::GetTexelCount() const
+{
+	return desc.Width * desc.Height * desc.Depth;
+}
+
+size_t CurlVolume::GetByteSize() const
+{
+	return planes[0].size() * sizeof(float) * 3;
+}
+
+XMFLOAT3 CurlVolume::GetCellSize() const
+{
+	return cellSize;
+}
+
+XMFLOAT3 CurlVolume::GetTexel(unsigned int x, unsigned int y, unsigned int z) const
+{
+	size_t index = ((size_t)z * desc.Height + y) * desc.Width + x;
+	return XMFLOAT3(planes[0][index], planes[1][index], planes[2][index]);
+}
+
+float* CurlVolume::GetPlane(int component)
+{
+	return planes[component].data();
+}
+
+const float* CurlVolume::GetPlane(int component) const
+{
+	return planes[component].data();
+}
+
+XMFLOAT3 CurlVolume::Sample(XMFLOAT3 position) const
+{
+	const float positions[3] = { position.x, position.y, position.z };
+	const float mins[3] = { desc.Min.x, desc.Min.y, desc.Min.z };
+	const float inverses[3] = { inverseCellSize.x, inverseCellSize.y, inverseCellSize.z };
+	const unsigned int sizes[3] = { desc.Width, desc.Height, desc.Depth };
+
+	float cell[3];
+	float fraction[3];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float u = (positions[axis] - mins[axis]) * inverses[axis];
+		u = (std::min)((std::max)(u, 0.0f), (float)(sizes[axis] - 1));
+		cell[axis] = (std::min)(floorf(u), (float)(sizes[axis] - 2));
+		fraction[axis] = u - cell[axis];
+	}
+
+	const float rowStride = (float)desc.Width;
+	const float sliceStride = (float)desc.Width * desc.Height;
+	float base = cell[0] + cell[1] * rowStride + cell[2] * sliceStride;
+
+	int corners[8];
+	for (int corner = 0; corner < 8; ++corner)
+	{
+		float index = base;
+		if (corner & 1)
+			index = index + 1.0f;
+		if (corner & 2)
+			index = index + rowStride;
+		if (corner & 4)
+			index = index + sliceStride;
+
+		corners[corner] = (int)index;
+	}
+
+	float results[3];
+	for (int component = 0; component < 3; ++component)
+	{
+		const float* plane = planes[component].data();
+
+		float values[8];
+		for (int corner = 0; corner < 8; ++corner)
+			values[corner] = plane[corners[corner]];
+
+		float c00 = values[0] + (values[1] - values[0]) * fraction[0];
+		float c10 = values[2] + (values[3] - values[2]) * fraction[0];
+		float c01 = values[4] + (values[5] - values[4]) * fraction[0];
+		float c11 = values[6] + (values[7] - values[6]) * fraction[0];
+
+		float c0 = c00 + (c10 - c00) * fraction[1];
+		float c1 = c01 + (c11 - c01) * fraction[1];
+
+		results[component] = c0 + (c1 - c0) * fraction[2];
+	}
+
+	return XMFLOAT3(results[0], results[1], results[2]);
+}
+
+unsigned int CurlVolume::GetBytesPerTexel(CurlVolumeFormat format)
+{
+	return format == CurlVolumeFloat16 ? 8 : 16;
+}
+
+void CurlVolume::GetTexturePayload(CurlVolumeFormat format, std::vector<unsigned char>& payload) const
+{
+	unsigned int texelCount = (unsigned int)planes[0].size();
+	payload.resize((size_t)texelCount * GetBytesPerTexel(format));
+
+	if (format == CurlVolumeFloat16)
+	{
+		unsigned short* texels = reinterpret_cast<unsigned short*>(payload.data());
+		for (unsigned int i = 0; i < texelCount; ++i)
+		{
+			texels[i * 4 + 0] = ParticlePacking::FloatToHalf(planes[0][i]);
+			texels[i * 4 + 1] = ParticlePacking::FloatToHalf(planes[1][i]);
+			texels[i * 4 + 2] = ParticlePacking::FloatToHalf(planes[2][i]);
+			texels[i * 4 + 3] = 0;
+		}
+	}
+	else
+	{
+		float* texels = reinterpret_cast<float*>(payload.data());
+		for (unsigned int i = 0; i < texelCount; ++i)
+		{
+			texels[i * 4 + 0] = planes[0][i];
+			texels[i * 4 + 1] = planes[1][i];
+			texels[i * 4 + 2] = planes[2][i];
+			texels[i * 4 + 3] = 0.0f;
+		}
+	}
+}
+
+bool CurlVolume::SaveDDS(const std::string& fileName, CurlVolumeFormat format) const
+{
+	if (!IsBaked())
+		return false;
+
+	std::vector<unsigned char> payload;
+	GetTexturePayload(format, payload);
+
+	DDSHeader header;
+	memset(&header, 0, sizeof(header));
+	header.Size = sizeof(DDSHeader);
+	header.Flags = DDSFlagsVolume;
+	header.Height = desc.Height;
+	header.Width = desc.Width;
+	header.PitchOrLinearSize = desc.Width * GetBytesPerTexel(format);
+	header.Depth = desc.Depth;
+	header.MipMapCount = 1;
+	header.PixelFormat.Size = sizeof(DDSPixelFormat);
+	header.PixelFormat.Flags = DDSPixelFormatFourCC;
+	header.PixelFormat.FourCC = DDSFourCCDX10;
+	header.Caps = DDSCapsTexture;
+	header.Caps2 = DDSCaps2Volume;
+
+	DDSHeaderDX10 headerDX10;
+	memset(&headerDX10, 0, sizeof(headerDX10));
+	headerDX10.DXGIFormat = format == CurlVolumeFloat16 ? DXGIFormatR16G16B16A16Float : DXGIFormatR32G32B32A32Float;
+	headerDX10.ResourceDimension = ResourceDimensionTexture3D;
+	headerDX10.ArraySize = 1;
+
+	std::ofstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	file.write(reinterpret_cast<const char*>(&DDSMagic), sizeof(DDSMagic));
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(&headerDX10), sizeof(headerDX10));
+	file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+
+	return file.good();
+}
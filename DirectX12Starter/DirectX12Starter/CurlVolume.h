@@ -0,0 +1,156 @@
+#pragma once
+#include <DirectXMath.h>
+#include <string>
+#include <vector>
+#include "SimdMath.h"
+#include "SimplexNoise.h"
+#include "WorkStealingScheduler.h"
+
+// texel formats of the exported 3D texture, the curl in rgb and 0 in a
+enum CurlVolumeFormat
+{
+	CurlVolumeFloat32, // DXGI_FORMAT_R32G32B32A32_FLOAT
+	CurlVolumeFloat16  // DXGI_FORMAT_R16G16B16A16_FLOAT
+};
+
+// the region and resolution of a bake and the curl field sampled in it
+// texel (i, j, k) holds SimplexNoise::CurlNoise3D(position * Frequency, Delta) at Min + (i, j, k) * cell size,
+// the first and last texels of every axis lie on Min and Max
+struct CurlVolumeDesc
+{
+	DirectX::XMFLOAT3 Min = DirectX::XMFLOAT3(-10.0f, -10.0f, 0.0f);
+	DirectX::XMFLOAT3 Max = DirectX::XMFLOAT3(10.0f, 10.0f, 30.0f);
+	unsigned int Width = 64;
+	unsigned int Height = 64;
+	unsigned int Depth = 64;
+
+	// the same scale and step UpdateComputeShader uses
+	float Frequency = 0.1f;
+	float Delta = 1.0f;
+};
+
+// curl noise baked into a 3D grid so the update trilinearly interpolates 8 texels instead of evaluating the noise
+// each component is a separate plane so the SIMD sampler gathers one component of Width particles at a time,
+// positions outside the bounds read the border texels like a clamp sampler
+class CurlVolume
+{
+public:
+	// 256^3 texels, texel indices are computed in float and stay exact below 2^24
+	static const unsigned int MaxTexelCount = 1 << 24;
+
+	CurlVolume();
+
+	// evaluates every texel, a slice per task on scheduler or on the calling thread when it is nullptr,
+	// the batch noise gives the scalar bits so the volume is the same for any thread count or kernel level
+	// returns false when an axis has fewer than 2 texels, the bounds are empty or there are more than MaxTexelCount texels
+	bool Bake(const CurlVolumeDesc& desc, WorkStealingScheduler* scheduler);
+
+	// sizes the grid for desc with every texel zero, for a field the caller fills through GetPlane,
+	// the same checks as Bake
+	bool Allocate(const CurlVolumeDesc& desc);
+
+	bool IsBaked() const;
+	const CurlVolumeDesc& GetDesc() const;
+	unsigned int GetTexelCount() const;
+	size_t GetByteSize() const;
+
+	// the distance between neighbouring texels along each axis
+	DirectX::XMFLOAT3 GetCellSize() const;
+
+	DirectX::XMFLOAT3 GetTexel(unsigned int x, unsigned int y, unsigned int z) const;
+
+	// one curl component of every texel, x fastest, then y, then z
+	float* GetPlane(int component);
+	const float* GetPlane(int component) const;
+
+	// trilinear interpolation of the texels around position
+	DirectX::XMFLOAT3 Sample(DirectX::XMFLOAT3 position) const;
+
+	// Sample for Simd::Width positions, same operations in the same order
+	template<typename Simd>
+	void SampleBatch(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z,
+		typename Simd::Float& curlX, typename Simd::Float& curlY, typename Simd::Float& curlZ) const;
+
+	// the texels as the initial data of a Width x Height x Depth texture, rows tightly packed so
+	// RowPitch = Width * GetBytesPerTexel(format) and SlicePitch = RowPitch * Height
+	// sampled on the GPU with uvw = (position - Min) / (Max - Min) * (size - 1) / size + 0.5 / size
+	void GetTexturePayload(CurlVolumeFormat format, std::vector<unsigned char>& payload) const;
+	static unsigned int GetBytesPerTexel(CurlVolumeFormat format);
+
+	// the payload as a DX10 volume DDS that DDSTextureLoader reads back as a Texture3D
+	bool SaveDDS(const std::string& fileName, CurlVolumeFormat format) const;
+
+private:
+	CurlVolumeDesc desc;
+	DirectX::XMFLOAT3 cellSize;
+	DirectX::XMFLOAT3 inverseCellSize;
+	std::vector<float> planes[3];
+
+	void BakeSlice(SimplexNoiseLevel level, unsigned int z);
+};
+
+template<typename Simd>
+void CurlVolume::SampleBatch(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z,
+	typename Simd::Float& curlX, typename Simd::Float& curlY, typename Simd::Float& curlZ) const
+{
+	typedef typename Simd::Float Float;
+
+	const Float zero = Simd::Zero();
+	const Float one = Simd::Set1(1.0f);
+
+	// texel coordinates clamped to the grid, the last cell also takes the far border
+	Float position[3] = { x, y, z };
+	const float mins[3] = { desc.Min.x, desc.Min.y, desc.Min.z };
+	const float inverses[3] = { inverseCellSize.x, inverseCellSize.y, inverseCellSize.z };
+	const unsigned int sizes[3] = { desc.Width, desc.Height, desc.Depth };
+
+	Float cell[3];
+	Float fraction[3];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		Float u = Simd::Mul(Simd::Sub(position[axis], Simd::Set1(mins[axis])), Simd::Set1(inverses[axis]));
+		u = Simd::Min(Simd::Max(u, zero), Simd::Set1((float)(sizes[axis] - 1)));
+		cell[axis] = Simd::Min(Simd::Floor(u), Simd::Set1((float)(sizes[axis] - 2)));
+		fraction[axis] = Simd::Sub(u, cell[axis]);
+	}
+
+	const Float rowStride = Simd::Set1((float)desc.Width);
+	const Float sliceStride = Simd::Set1((float)desc.Width * desc.Height);
+	Float base = Simd::Add(Simd::Add(cell[0], Simd::Mul(cell[1], rowStride)), Simd::Mul(cell[2], sliceStride));
+
+	// the 8 corners in x, y, z order
+	int corners[8][Simd::Width];
+	for (int corner = 0; corner < 8; ++corner)
+	{
+		Float index = base;
+		if (corner & 1)
+			index = Simd::Add(index, one);
+		if (corner & 2)
+			index = Simd::Add(index, rowStride);
+		if (corner & 4)
+			index = Simd::Add(index, sliceStride);
+
+		Simd::StoreInt(corners[corner], index);
+	}
+
+	Float* results[3] = { &curlX, &curlY, &curlZ };
+	for (int component = 0; component < 3; ++component)
+	{
+		const float* plane = planes[component].data();
+
+		Float values[8];
+		for (int corner = 0; corner < 8; ++corner)
+			values[corner] = Simd::Gather(plane, corners[corner]);
+
+		// along x, then y, then z
+		Float c00 = Simd::Add(values[0], Simd::Mul(Simd::Sub(values[1], values[0]), fraction[0]));
+		Float c10 = Simd::Add(values[2], Simd::Mul(Simd::Sub(values[3], values[2]), fraction[0]));
+		Float c01 = Simd::Add(values[4], Simd::Mul(Simd::Sub(values[5], values[4]), fraction[0]));
+		Float c11 = Simd::Add(values[6], Simd::Mul(Simd::Sub(values[7], values[6]), fraction[0]));
+
+		Float c0 = Simd::Add(c00, Simd::Mul(Simd::Sub(c10, c00), fraction[1]));
+		Float c1 = Simd::Add(c01, Simd::Mul(Simd::Sub(c11, c01), fraction[1]));
+
+		*results[component] = Simd::Add(c0, Simd::Mul(Simd::Sub(c1, c0), fraction[2]));
+	}
+}
@@ -0,0 +1,134 @@
+#include "DeadListStack.h"
+
+DeadListStack::DeadListStack(unsigned int capacity) :
+	capacity(capacity),
+	next(new std::atomic<unsigned int>[capacity])
+{
+	head = PackHead(EndIndex, 0);
+	count = 0;
+	underflowCount = 0;
+	retryCount = 0;
+}
+
+DeadListStack::~DeadListStack()
+{
+
+}
+
+void DeadListStack::Reset(unsigned int count)
+{
+	if (count > capacity)
+		count = capacity;
+
+	for (unsigned int i = 0; i < count; ++i)
+		next[i].store(i == 0 ? EndIndex : i - 1, std::memory_order_relaxed);
+
+	head = PackHead(count > 0 ? count - 1 : EndIndex, HeadVersion(head) + 1);
+	this->count = (int)count;
+}
+
+void DeadListStack::Append(unsigned int index)
+{
+	Push(index, index, 1);
+}
+
+bool DeadListStack::Consume(unsigned int& index)
+{
+	return ConsumeN(&index, 1) == 1;
+}
+
+void DeadListStack::AppendN(const unsigned int* indices, unsigned int count)
+{
+	if (count == 0)
+		return;
+
+	// link the batch top down, the bottom entry gets linked to the old head inside Push
+	for (unsigned int i = count - 1; i > 0; --i)
+		next[indices[i]].store(indices[i - 1], std::memory_order_relaxed);
+
+	Push(indices[count - 1], indices[0], count);
+}
+
+unsigned int DeadListStack::ConsumeN(unsigned int* indices, unsigned int count)
+{
+	if (count == 0)
+		return 0;
+
+	unsigned long long retries = 0;
+	unsigned long long current = head.load(std::memory_order_acquire);
+	unsigned int taken;
+
+	while (true)
+	{
+		// walk the batch, the links may be stale if another thread got in first but then the compare-exchange fails
+		unsigned int index = HeadIndex(current);
+		taken = 0;
+
+		while (taken < count && index != EndIndex)
+		{
+			indices[taken++] = index;
+			index = next[index].load(std::memory_order_relaxed);
+		}
+
+		if (taken == 0)
+			break;
+
+		if (head.compare_exchange_weak(current, PackHead(index, HeadVersion(current) + 1), std::memory_order_acq_rel, std::memory_order_acquire))
+			break;
+
+		retries++;
+	}
+
+	if (taken > 0)
+		this->count.fetch_sub((int)taken, std::memory_order_relaxed);
+
+	if (taken < count)
+		underflowCount.fetch_add(1, std::memory_order_relaxed);
+
+	if (retries > 0)
+		retryCount.fetch_add(retries, std::memory_order_relaxed);
+
+	return taken;
+}
+
+unsigned int DeadListStack::GetCapacity() const
+{
+	return capacity;
+}
+
+unsigned int DeadListStack::GetCount() const
+{
+	int value = count.load(std::memory_order_relaxed);
+	return value > 0 ? (unsigned int)value : 0;
+}
+
+unsigned long long DeadListStack::GetUnderflowCount() const
+{
+	return underflowCount;
+}
+
+unsigned long long DeadListStack::GetRetryCount() const
+{
+	return retryCount;
+}
+
+void DeadListStack::Push(unsigned int first, unsigned int last, unsigned int count)
+{
+	unsigned long long retries = 0;
+	unsigned long long current = head.load(std::memory_order_relaxed);
+
+	while (true)
+	{
+		next[last].store(HeadIndex(current), std::memory_order_relaxed);
+
+		if (head.compare_exchange_weak(current, PackHead(first, HeadVersion(current) + 1), std::memory_order_release, std::memory_order_relaxed))
+			break;
+
+		retries++;
+	}
+
+	this->count.fetch_add((int)count, std::memory_order_relaxed);
+
+	if (retries > 0)
+		retryCount.fetch_add(retries, std::memory_order_relaxed);
+}
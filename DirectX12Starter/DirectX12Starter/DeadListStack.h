@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <memory>
+
+// lock-free LIFO of free particle indices, the CPU side counterpart of ACDeadList
+// the stack is a linked list threaded through a next index per particle, the head packs the top index
+// with a version that every successful operation bumps, so a stale head can never pass the compare-exchange (ABA)
+// consuming or appending a whole batch walks or links the batch first and then publishes it with a single
+// compare-exchange, so an emit batch of N particles costs one atomic operation instead of N
+class DeadListStack
+{
+public:
+	static const unsigned int EndIndex = 0xffffffff;
+
+	DeadListStack(unsigned int capacity);
+	DeadListStack(const DeadListStack& rhs) = delete;
+	DeadListStack& operator=(const DeadListStack& rhs) = delete;
+	~DeadListStack();
+
+	// DeadListInitComputeShader: push 0..count-1 so count-1 ends up on top, not thread safe
+	void Reset(unsigned int count);
+
+	void Append(unsigned int index);
+	bool Consume(unsigned int& index);
+
+	// indices[count-1] ends up on top, the same order as appending them one at a time
+	void AppendN(const unsigned int* indices, unsigned int count);
+
+	// pops up to count indices, top first, and returns how many were taken
+	// asking for more than are free takes every free index and records an underflow
+	unsigned int ConsumeN(unsigned int* indices, unsigned int count);
+
+	unsigned int GetCapacity() const;
+
+	// exact while no other thread is appending or consuming
+	unsigned int GetCount() const;
+
+	unsigned long long GetUnderflowCount() const;
+
+	// failed compare-exchanges, a measure of contention
+	unsigned long long GetRetryCount() const;
+
+private:
+	unsigned int capacity;
+	std::unique_ptr<std::atomic<unsigned int>[]> next;
+
+	// keep the contended words away from each other
+	alignas(64) std::atomic<unsigned long long> head;
+	// signed because a consumer can subtract before the matching append has added
+	alignas(64) std::atomic<int> count;
+	alignas(64) std::atomic<unsigned long long> underflowCount;
+	std::atomic<unsigned long long> retryCount;
+
+	static unsigned long long PackHead(unsigned int index, unsigned int version)
+	{
+		return ((unsigned long long)version << 32) | index;
+	}
+
+	static unsigned int HeadIndex(unsigned long long packed)
+	{
+		return (unsigned int)packed;
+	}
+
+	static unsigned int HeadVersion(unsigned long long packed)
+	{
+		return (unsigned int)(packed >> 32);
+	}
+
+	void Push(unsigned int first, unsigned int last, unsigned int count);
+};
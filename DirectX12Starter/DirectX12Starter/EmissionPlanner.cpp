@@ -0,0 +1,57 @@
+#include "EmissionPlanner.h"
+#include <algorithm>
+#include <cmath>
+
+// std::min takes it by reference, so it needs a definition
+const unsigned int EmissionPlanner::MaxEmitCount;
+
+EmissionPlanner::EmissionPlanner()
+{
+	ResetCounters();
+}
+
+EmissionBatch EmissionPlanner::Plan(Emitter& emitter, unsigned int freeCount)
+{
+	// the rate itself instead of the rounded 1 / rate, in double so a million spawns a second don't lose any,
+	// the fraction of a spawn that is left goes back into the counter
+	double rate = emitter.GetEmissionRate();
+	double due = (double)emitter.GetEmitTimeCounter() * rate;
+	double requested = floor(due);
+
+	emitter.SetEmitTimeCounter((float)((due - requested) / rate));
+
+	unsigned int emitCount = (unsigned int)(std::min)(requested, (double)(std::min)(freeCount, MaxEmitCount));
+
+	requestedCount += (unsigned long long)requested;
+	emittedCount += emitCount;
+	droppedCount += (unsigned long long)requested - emitCount;
+
+	emitter.SetEmitCount((int)emitCount);
+
+	EmissionBatch batch;
+	batch.EmitCount = emitCount;
+	batch.GroupCount = (emitCount + ThreadGroupSize - 1) / ThreadGroupSize;
+	return batch;
+}
+
+unsigned long long EmissionPlanner::GetRequestedCount() const
+{
+	return requestedCount;
+}
+
+unsigned long long EmissionPlanner::GetEmittedCount() const
+{
+	return emittedCount;
+}
+
+unsigned long long EmissionPlanner::GetDroppedCount() const
+{
+	return droppedCount;
+}
+
+void EmissionPlanner::ResetCounters()
+{
+	requestedCount = 0;
+	emittedCount = 0;
+	droppedCount = 0;
+}
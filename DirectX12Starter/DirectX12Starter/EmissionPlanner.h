@@ -0,0 +1,44 @@
+#pragma once
+#include "Emitter.h"
+
+// one emit dispatch, EmitCount particles in GroupCount groups of EmissionPlanner::ThreadGroupSize threads
+struct EmissionBatch
+{
+	unsigned int EmitCount = 0;
+	unsigned int GroupCount = 0;
+};
+
+// turns the time an emitter has accumulated into the single emit batch of a simulation step
+// the count is exact over any number of steps, it is capped by the free slots of the dead list and by what one
+// dispatch can address, spawns over the cap are dropped rather than carried so a full pool doesn't build up debt
+class EmissionPlanner
+{
+public:
+	// numthreads of EmitComputeShader
+	static const unsigned int ThreadGroupSize = 32;
+
+	// D3D12_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION
+	static const unsigned int MaxGroupCount = 65535;
+	static const unsigned int MaxEmitCount = MaxGroupCount * ThreadGroupSize;
+
+	EmissionPlanner();
+
+	// consumes the emitter's accumulated time and sets its EmitCount to the planned count,
+	// freeCount is the number of indices on the dead list, or a lower bound of it
+	// the time left in the emitter is how long ago the newest spawn was due, the others are due
+	// GetTimeBetweenEmit apart before it, which the constants pass on as EmitNewestAge and EmitSpacing
+	// so the emit can spread the spawns over the step, the cap keeps the newest spawns
+	EmissionBatch Plan(Emitter& emitter, unsigned int freeCount);
+
+	// spawns the emitters asked for, the ones planned and the ones the caps dropped, requested = emitted + dropped
+	unsigned long long GetRequestedCount() const;
+	unsigned long long GetEmittedCount() const;
+	unsigned long long GetDroppedCount() const;
+
+	void ResetCounters();
+
+private:
+	unsigned long long requestedCount;
+	unsigned long long emittedCount;
+	unsigned long long droppedCount;
+};
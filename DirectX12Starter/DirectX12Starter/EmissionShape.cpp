@@ -0,0 +1,216 @@
+#include "EmissionShape.h"
+#include "SystemData.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+MeshSurfaceSampler::MeshSurfaceSampler()
+{
+	surfaceArea = 0.0f;
+}
+
+void MeshSurfaceSampler::Build(const XMFLOAT3* positions, unsigned int vertexCount)
+{
+	unsigned int triangleCount = vertexCount / 3;
+
+	vertices.assign(positions, positions + triangleCount * 3);
+	areas.resize(triangleCount);
+	probabilities.resize(triangleCount);
+	aliases.resize(triangleCount);
+
+	// half the length of the cross product of two edges, summed in double so large meshes keep their small triangles
+	double total = 0.0;
+	for (unsigned int i = 0; i < triangleCount; ++i)
+	{
+		const XMFLOAT3& a = vertices[i * 3 + 0];
+		const XMFLOAT3& b = vertices[i * 3 + 1];
+		const XMFLOAT3& c = vertices[i * 3 + 2];
+
+		XMFLOAT3 ab(b.x - a.x, b.y - a.y, b.z - a.z);
+		XMFLOAT3 ac(c.x - a.x, c.y - a.y, c.z - a.z);
+		XMFLOAT3 cross(ab.y * ac.z - ab.z * ac.y, ab.z * ac.x - ab.x * ac.z, ab.x * ac.y - ab.y * ac.x);
+
+		areas[i] = 0.5f * sqrtf(cross.x * cross.x + cross.y * cross.y + cross.z * cross.z);
+		total += areas[i];
+	}
+
+	surfaceArea = (float)total;
+	if (triangleCount == 0 || total <= 0.0)
+		return;
+
+	// Vose's construction: scale every probability by the triangle count, then repeatedly fill the rest of an
+	// underfull slot with a piece of an overfull one until every slot holds exactly one unit
+	std::vector<double> scaled(triangleCount);
+	std::vector<unsigned int> small;
+	std::vector<unsigned int> large;
+
+	for (unsigned int i = 0; i < triangleCount; ++i)
+	{
+		scaled[i] = areas[i] * triangleCount / total;
+		aliases[i] = i;
+
+		if (scaled[i] < 1.0)
+			small.push_back(i);
+		else
+			large.push_back(i);
+	}
+
+	while (!small.empty() && !large.empty())
+	{
+		unsigned int less = small.back();
+		small.pop_back();
+		unsigned int more = large.back();
+
+		probabilities[less] = (float)scaled[less];
+		aliases[less] = more;
+
+		scaled[more] -= 1.0 - scaled[less];
+		if (scaled[more] < 1.0)
+		{
+			large.pop_back();
+			small.push_back(more);
+		}
+	}
+
+	// whatever is left is within rounding of one unit
+	for (unsigned int i : large)
+		probabilities[i] = 1.0f;
+	for (unsigned int i : small)
+		probabilities[i] = 1.0f;
+}
+
+bool MeshSurfaceSampler::Build(SystemData& systemData, char* subSystemName)
+{
+	SubSystem subSystem = systemData.GetSubSystem(subSystemName);
+	Build(systemData.GetPositions() + subSystem.baseLocation, subSystem.count);
+
+	return surfaceArea > 0.0f;
+}
+
+unsigned int MeshSurfaceSampler::GetTriangleCount() const
+{
+	return (unsigned int)areas.size();
+}
+
+float MeshSurfaceSampler::GetSurfaceArea() const
+{
+	return surfaceArea;
+}
+
+float MeshSurfaceSampler::GetTriangleArea(unsigned int triangle) const
+{
+	return areas[triangle];
+}
+
+unsigned int MeshSurfaceSampler::SampleTriangle(float column, float coin) const
+{
+	unsigned int slotCount = (unsigned int)probabilities.size();
+	unsigned int slot = (std::min)((unsigned int)(column * slotCount), slotCount - 1);
+
+	return coin < probabilities[slot] ? slot : aliases[slot];
+}
+
+XMFLOAT3 MeshSurfaceSampler::Sample(float column, float coin, float u, float v) const
+{
+	unsigned int triangle = SampleTriangle(column, coin);
+	const XMFLOAT3& a = vertices[triangle * 3 + 0];
+	const XMFLOAT3& b = vertices[triangle * 3 + 1];
+	const XMFLOAT3& c = vertices[triangle * 3 + 2];
+
+	// the square root keeps the density uniform instead of bunching up at a
+	float s = sqrtf(u);
+	float weightA = 1.0f - s;
+	float weightB = s * (1.0f - v);
+	float weightC = s * v;
+
+	return XMFLOAT3(
+		a.x * weightA + b.x * weightB + c.x * weightC,
+		a.y * weightA + b.y * weightB + c.y * weightC,
+		a.z * weightA + b.z * weightB + c.z * weightC);
+}
+
+XMFLOAT3 EmissionShape::Sample(const float u[4]) const
+{
+	XMFLOAT3 offset(0.0f, 0.0f, 0.0f);
+
+	switch (Type)
+	{
+	case EmissionShapeSphere:
+	{
+		// the cube root spreads the radius so every shell gets particles in proportion to its volume
+		float radius = Radius * cbrtf(u[0]);
+		float cosTheta = 1.0f - 2.0f * u[1];
+		float sinTheta = sqrtf((std::max)(0.0f, 1.0f - cosTheta * cosTheta));
+		float phi = XM_2PI * u[2];
+
+		offset = XMFLOAT3(radius * sinTheta * cosf(phi), radius * cosTheta, radius * sinTheta * sinf(phi));
+		break;
+	}
+	case EmissionShapeBox:
+		offset = XMFLOAT3(
+			(2.0f * u[0] - 1.0f) * Extents.x,
+			(2.0f * u[1] - 1.0f) * Extents.y,
+			(2.0f * u[2] - 1.0f) * Extents.z);
+		break;
+	case EmissionShapeDisc:
+	{
+		float radius = Radius * sqrtf(u[0]);
+		float phi = XM_2PI * u[1];
+
+		offset = XMFLOAT3(radius * cosf(phi), 0.0f, radius * sinf(phi));
+		break;
+	}
+	case EmissionShapeCone:
+	{
+		// the cross section grows with the square of the height, so the height goes through a cube root
+		float height = Height * cbrtf(u[0]);
+		float radius = Radius * (height / Height) * sqrtf(u[1]);
+		float phi = XM_2PI * u[2];
+
+		offset = XMFLOAT3(radius * cosf(phi), height, radius * sinf(phi));
+		break;
+	}
+	case EmissionShapeMesh:
+		if (Mesh != nullptr && Mesh->GetTriangleCount() > 0)
+			offset = Mesh->Sample(u[0], u[3], u[1], u[2]);
+		break;
+	default:
+		break;
+	}
+
+	return XMFLOAT3(Center.x + offset.x, Center.y + offset.y, Center.z + offset.z);
+}
+
+const char* EmissionShape::GetTypeName(EmissionShapeType type)
+{
+	switch (type)
+	{
+	case EmissionShapeSphere:
+		return "sphere";
+	case EmissionShapeBox:
+		return "box";
+	case EmissionShapeDisc:
+		return "disc";
+	case EmissionShapeCone:
+		return "cone";
+	case EmissionShapeMesh:
+		return "mesh";
+	default:
+		return "grid";
+	}
+}
+
+unsigned int EmissionShape::Hash(unsigned int value)
+{
+	// PCG output permutation, cheap enough to run per spawn on the GPU as well
+	unsigned int state = value * 747796405u + 2891336453u;
+	unsigned int word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+void EmissionShape::Random(unsigned int spawn, float u[4])
+{
+	for (unsigned int i = 0; i < 4; ++i)
+		u[i] = (float)(Hash(spawn * 4 + i) >> 8) * (1.0f / 16777216.0f);
+}
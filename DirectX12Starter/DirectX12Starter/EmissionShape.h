@@ -0,0 +1,80 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+
+class SystemData;
+
+enum EmissionShapeType
+{
+	// the gridSize lattice of EmitComputeShader, placed by pool index
+	EmissionShapeGrid,
+	EmissionShapeSphere,
+	EmissionShapeBox,
+	EmissionShapeDisc,
+	EmissionShapeCone,
+	EmissionShapeMesh,
+	EmissionShapeTypeCount
+};
+
+// area weighted triangle picking for mesh surface emitters
+// a Walker alias table built once per mesh turns one uniform number into a triangle index with a single
+// compare, so a spawn costs the same for a quad and for a mesh with millions of triangles
+class MeshSurfaceSampler
+{
+public:
+	MeshSurfaceSampler();
+
+	// triangles are consecutive position triples, the way SystemData::LoadOBJFile stores a sub system
+	void Build(const DirectX::XMFLOAT3* positions, unsigned int vertexCount);
+
+	// returns false when the sub system holds no triangle with an area
+	bool Build(SystemData& systemData, char* subSystemName);
+
+	unsigned int GetTriangleCount() const;
+	float GetSurfaceArea() const;
+	float GetTriangleArea(unsigned int triangle) const;
+
+	// column picks a slot of the table and coin decides between the slot and its alias, both in [0, 1)
+	unsigned int SampleTriangle(float column, float coin) const;
+
+	// uniform point on the surface, u and v pick the point inside the triangle
+	DirectX::XMFLOAT3 Sample(float column, float coin, float u, float v) const;
+
+private:
+	std::vector<DirectX::XMFLOAT3> vertices;
+	std::vector<float> areas;
+	float surfaceArea;
+
+	// slot i returns i with probability probabilities[i] and aliases[i] otherwise
+	std::vector<float> probabilities;
+	std::vector<unsigned int> aliases;
+};
+
+// where an emitter places new particles, every shape maps four uniform numbers to a point
+// with uniform density over its volume (sphere, box, cone), its area (disc) or the mesh surface
+struct EmissionShape
+{
+	EmissionShapeType Type = EmissionShapeGrid;
+	DirectX::XMFLOAT3 Center = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+	// sphere radius, disc radius and the radius of the cone base
+	float Radius = 1.0f;
+
+	// half size of the box
+	DirectX::XMFLOAT3 Extents = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f);
+
+	// the cone opens upwards from its apex at Center, the disc lies in the xz plane
+	float Height = 1.0f;
+
+	// not owned, has to outlive the shape
+	const MeshSurfaceSampler* Mesh = nullptr;
+
+	// u holds four numbers in [0, 1), the grid is placed by pool index and ignores it
+	DirectX::XMFLOAT3 Sample(const float u[4]) const;
+
+	static const char* GetTypeName(EmissionShapeType type);
+
+	// stateless hash of a spawn number, so the numbers of a spawn don't depend on the order of the others
+	static unsigned int Hash(unsigned int value);
+	static void Random(unsigned int spawn, float u[4]);
+};
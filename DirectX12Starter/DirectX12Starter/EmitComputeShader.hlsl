@@ -26,6 +26,8 @@ cbuffer particleData : register(b2)
 	int emitCount;
 	int maxParticles;
 	int gridSize;
+	float emitNewestAge;
+	float emitSpacing;
 }
 
 RWStructuredBuffer<Particle> ParticlePool		: register(u0);
@@ -57,6 +59,18 @@ void main(uint id : SV_DispatchThreadID )
 	emitParticle.Velocity = float3(0, 0.0f, 0.0f);
 	emitParticle.Color = float4(gridPosition / gridSize, 1);
 	emitParticle.Age = 0.0f;
+
+	// the spawns of a step are spread over it, this one is due offset before the end of the step, the emit runs
+	// at its start and the update adds the step, so it starts offset - deltaTime old and moved along the curl
+	// for that long, backwards when it is due after the emit
+	if (emitSpacing > 0.0f)
+	{
+		float offset = emitNewestAge + (emitCount - 1 - (int)id.x) * emitSpacing - deltaTime;
+
+		emitParticle.Velocity = curlNoise3D(emitParticle.Position * 0.1f, 1.0f) * 2;
+		emitParticle.Position += emitParticle.Velocity * offset;
+		emitParticle.Age = offset;
+	}
 	emitParticle.Size = 0.5f;
 	emitParticle.Alive = 1.0f;
 
@@ -17,6 +17,7 @@ Emitter::Emitter(int maxParticles,
 	startColor(startColor),
 	endColor(endColor)
 {
+	emitCount = 0;
 	emitTimeCounter = 0.0f;
 	timeBetweenEmit = 1.0f / emissionRate;
 }
@@ -56,6 +57,11 @@ float Emitter::GetEmitTimeCounter()
 	return emitTimeCounter;
 }
 
+float Emitter::GetEmissionRate()
+{
+	return emissionRate;
+}
+
 float Emitter::GetTimeBetweenEmit()
 {
 	return timeBetweenEmit;
@@ -91,6 +97,16 @@ void Emitter::SetEmitTimeCounter(float value)
 	emitTimeCounter = value;
 }
 	
+const EmissionShape& Emitter::GetShape()
+{
+	return shape;
+}
+
+void Emitter::SetShape(const EmissionShape& value)
+{
+	shape = value;
+}
+
 void Emitter::Update(float TotalTime, float deltaTime)
 {
 	emitTimeCounter += deltaTime;
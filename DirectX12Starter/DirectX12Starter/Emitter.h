@@ -2,6 +2,7 @@
 #include <d3d12.h>
 #include <DirectXMath.h>
 #include "Camera.h"
+#include "EmissionShape.h"
 
 struct Particle
 {
@@ -11,7 +12,8 @@ struct Particle
 	DirectX::XMFLOAT3 Velocity;
 	float Size;
 	float Alive;
-	DirectX::XMFLOAT3 Padding;
+	unsigned int EmitterIndex;
+	DirectX::XMFLOAT2 Padding;
 };
 
 struct ParticleSort
@@ -37,6 +39,7 @@ public:
 	int GetGridSize();
 	int GetVerticesPerParticle();
 	float GetLifeTime();
+	float GetEmissionRate();
 	float GetEmitTimeCounter();
 	float GetTimeBetweenEmit();
 	DirectX::XMFLOAT3 GetVelocity();
@@ -47,6 +50,10 @@ public:
 	void SetEmitCount(int value);
 	void SetEmitTimeCounter(float value);
 
+	// the grid unless set otherwise
+	const EmissionShape& GetShape();
+	void SetShape(const EmissionShape& value);
+
 	void Update(float TotalTime, float deltaTime);
 	
 private:
@@ -62,6 +69,7 @@ private:
 	DirectX::XMFLOAT3 acceleration;
 	DirectX::XMFLOAT4 startColor;
 	DirectX::XMFLOAT4 endColor;
+	EmissionShape shape;
 };
 
 	
\ No newline at end of file
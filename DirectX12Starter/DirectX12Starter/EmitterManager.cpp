@@ -0,0 +1,102 @@
+#include "EmitterManager.h"
+
+using namespace DirectX;
+
+EmitterManager::EmitterManager(int maxParticles) :
+	maxParticles(maxParticles)
+{
+
+}
+
+EmitterManager::~EmitterManager()
+{
+	for (Emitter* emitter : emitters)
+		delete emitter;
+}
+
+int EmitterManager::AddEmitter(int gridSize,
+	float emissionRate,
+	float lifeTime,
+	XMFLOAT3 velocity,
+	XMFLOAT3 acceleration,
+	XMFLOAT4 startColor,
+	XMFLOAT4 endColor)
+{
+	// every emitter can fill the whole pool, the dead list decides who gets the slots
+	emitters.push_back(new Emitter(
+		maxParticles,
+		gridSize,
+		emissionRate,
+		lifeTime,
+		velocity,
+		acceleration,
+		startColor,
+		endColor
+	));
+
+	constants.push_back(ParticleConstants());
+	lifeTimes.push_back(lifeTime);
+
+	int index = (int)emitters.size() - 1;
+	UpdateConstants();
+
+	return index;
+}
+
+int EmitterManager::GetEmitterCount() const
+{
+	return (int)emitters.size();
+}
+
+int EmitterManager::GetMaxParticles() const
+{
+	return maxParticles;
+}
+
+Emitter* EmitterManager::GetEmitter(int index) const
+{
+	return emitters[index];
+}
+
+void EmitterManager::Update(float totalTime, float deltaTime)
+{
+	for (Emitter* emitter : emitters)
+		emitter->Update(totalTime, deltaTime);
+}
+
+void EmitterManager::UpdateConstants()
+{
+	for (size_t i = 0; i < emitters.size(); ++i)
+	{
+		Emitter* emitter = emitters[i];
+		ParticleConstants& slice = constants[i];
+
+		slice.EmitCount = emitter->GetEmitCount();
+		slice.EmitNewestAge = emitter->GetEmitTimeCounter();
+		slice.EmitSpacing = emitter->GetTimeBetweenEmit();
+		slice.MaxParticles = emitter->GetMaxParticles();
+		slice.GridSize = emitter->GetGridSize();
+		slice.LifeTime = emitter->GetLifeTime();
+		slice.velocity = emitter->GetVelocity();
+		slice.acceleration = emitter->GetAcceleration();
+		slice.startColor = emitter->GetStartColor();
+		slice.endColor = emitter->GetEndColor();
+
+		lifeTimes[i] = slice.LifeTime;
+	}
+}
+
+ParticleConstants& EmitterManager::GetConstants(int index)
+{
+	return constants[index];
+}
+
+const ParticleConstants* EmitterManager::GetConstants() const
+{
+	return constants.data();
+}
+
+const float* EmitterManager::GetLifeTimes() const
+{
+	return lifeTimes.data();
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include "Emitter.h"
+#include "FrameResource.h"
+
+// many emitters sharing one particle pool and dead list
+// every emitter keeps its own ParticleConstants slice and stamps its index into the particles it emits,
+// so one update pass over the pool can look up the parameters of each particle and CopyDrawCount can
+// write one indirect draw record per emitter
+class EmitterManager
+{
+public:
+	EmitterManager(int maxParticles);
+	~EmitterManager();
+
+	// returns the index the new emitter's particles carry in Particle::EmitterIndex
+	int AddEmitter(int gridSize,
+		float emissionRate,
+		float lifeTime,
+		DirectX::XMFLOAT3 velocity,
+		DirectX::XMFLOAT3 acceleration,
+		DirectX::XMFLOAT4 startColor,
+		DirectX::XMFLOAT4 endColor);
+
+	int GetEmitterCount() const;
+	int GetMaxParticles() const;
+	Emitter* GetEmitter(int index) const;
+
+	// advances the emit timers of every emitter
+	void Update(float totalTime, float deltaTime);
+
+	// copies the emitter settings into the constants slices, the same fields Game::UpdateMainPassCB sets
+	void UpdateConstants();
+	ParticleConstants& GetConstants(int index);
+
+	// one slice per emitter in emitter order, ready to upload as a structured buffer
+	const ParticleConstants* GetConstants() const;
+
+	// the lifetime of every emitter in emitter order, what the shared update looks particles up in
+	const float* GetLifeTimes() const;
+
+private:
+	int maxParticles;
+
+	std::vector<Emitter*> emitters;
+	std::vector<ParticleConstants> constants;
+	std::vector<float> lifeTimes;
+};
@@ -0,0 +1,65 @@
+#include "FixedTimestep.h"
+
+FixedTimestep::FixedTimestep(float stepSize, int maxSubsteps) :
+	stepSize(stepSize),
+	maxSubsteps(maxSubsteps)
+{
+	Reset();
+}
+
+void FixedTimestep::Reset()
+{
+	accumulator = 0.0;
+	droppedTime = 0.0;
+	stepCount = 0;
+}
+
+int FixedTimestep::Advance(float frameTime)
+{
+	if (frameTime > 0.0f)
+		accumulator += frameTime;
+
+	int steps = (int)(accumulator / stepSize);
+	if (steps > maxSubsteps)
+	{
+		double dropped = (steps - maxSubsteps) * (double)stepSize;
+		droppedTime += dropped;
+		accumulator -= dropped;
+		steps = maxSubsteps;
+	}
+
+	accumulator -= steps * (double)stepSize;
+	stepCount += steps;
+
+	return steps;
+}
+
+float FixedTimestep::GetStepSize() const
+{
+	return stepSize;
+}
+
+int FixedTimestep::GetMaxSubsteps() const
+{
+	return maxSubsteps;
+}
+
+unsigned long long FixedTimestep::GetStepCount() const
+{
+	return stepCount;
+}
+
+float FixedTimestep::GetStepTime(unsigned long long step) const
+{
+	return (float)(step * (double)stepSize);
+}
+
+float FixedTimestep::GetAlpha() const
+{
+	return (float)(accumulator / stepSize);
+}
+
+double FixedTimestep::GetDroppedTime() const
+{
+	return droppedTime;
+}
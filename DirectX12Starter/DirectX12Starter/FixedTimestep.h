@@ -0,0 +1,40 @@
+#pragma once
+
+// turns variable frame times into a whole number of fixed simulation steps
+// frame time goes into an accumulator and every full step is taken out again, so the simulation only ever sees
+// the same dt and runs with the same step count are bit-identical no matter how the frames were paced
+// the time that is left over is returned as an interpolation alpha in [0, 1) for drawing between steps
+class FixedTimestep
+{
+public:
+	FixedTimestep(float stepSize = 1.0f / 60.0f, int maxSubsteps = 4);
+
+	void Reset();
+
+	// adds one frame's time and returns how many steps to run, at most maxSubsteps
+	// time beyond the cap is dropped so a long stall doesn't make the next frames even slower
+	int Advance(float frameTime);
+
+	float GetStepSize() const;
+	int GetMaxSubsteps() const;
+
+	// steps handed out by Advance so far
+	unsigned long long GetStepCount() const;
+
+	// simulation time at the start of a step, computed from the step index so it never drifts
+	float GetStepTime(unsigned long long step) const;
+
+	// how far the accumulator is into the next step
+	float GetAlpha() const;
+
+	// total time thrown away by the substep cap
+	double GetDroppedTime() const;
+
+private:
+	float stepSize;
+	int maxSubsteps;
+
+	double accumulator;
+	double droppedTime;
+	unsigned long long stepCount;
+};
@@ -0,0 +1,12 @@
+#pragma once
+
+// the SIMD paths repeat the scalar operations in the same order and match them bit for bit only while no multiply
+// and add are contracted into a fused multiply-add, included first by the files that hold a scalar reference
+// it turns contraction off for the rest of the file, the templates of the headers it includes after it as well
+#if defined(_MSC_VER) && !defined(__clang__)
+#pragma fp_contract(off)
+#elif defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
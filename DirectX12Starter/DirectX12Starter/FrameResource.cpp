@@ -9,6 +9,14 @@ FrameResource::FrameResource(ID3D12Device* device, UINT objectCount, UINT timeCo
 	ObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, true);
 	TimeCB = std::make_unique<UploadBuffer<TimeConstants>>(device, timeCount, true);
 	ParticleCB = std::make_unique<UploadBuffer<ParticleConstants>>(device, particleCount, true);
+
+	ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(sizeof(UINT)),
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(&DeadListCountReadback)));
 }
 
 FrameResource::~FrameResource()
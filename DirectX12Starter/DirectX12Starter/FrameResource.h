@@ -16,6 +16,9 @@ struct TimeConstants
 {
 	float DeltaTime = 0.0f;
 	float TotalTime = 0.0f;
+
+	// fraction of a fixed step between the last simulated step and the frame being drawn
+	float InterpolationAlpha = 0.0f;
 };
 
 struct ParticleConstants
@@ -29,6 +32,11 @@ struct ParticleConstants
 	int EmitCount = 0;
 	int MaxParticles = 0;
 	int GridSize = 0;
+
+	// the emitted particles spawned over the step, EmitNewestAge before the end of the step for the last of them
+	// and EmitSpacing apart, a spacing of 0 spawns them all at the emit
+	float EmitNewestAge = 0.0f;
+	float EmitSpacing = 0.0f;
 };
 
 // stores the resources needed for the CPU to build the command lists for a frame 
@@ -50,6 +58,10 @@ public:
 	std::unique_ptr<UploadBuffer<TimeConstants>> TimeCB = nullptr;
 	std::unique_ptr<UploadBuffer<ParticleConstants>> ParticleCB = nullptr;
 
+	// the dead list counter as it was after the frame's steps, and how many particles had been emitted by then
+	Microsoft::WRL::ComPtr<ID3D12Resource> DeadListCountReadback;
+	unsigned long long EmittedAtReadback = 0;
+
 	// fence value to mark commands up to this fence point 
 	// this lets us check if these frame resources are still in use by the GPU.
 	UINT64 Fence = 0;
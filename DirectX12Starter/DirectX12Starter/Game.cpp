@@ -45,6 +45,9 @@ bool Game::Initialize()
 		XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f)
 	);
 
+	// DeadListInitComputeShader appends every index
+	deadListCountAtReadback = emitter->GetMaxParticles();
+
 	BuildUAVs();
 	BuildRootSignature();
 	BuildShadersAndInputLayout();
@@ -68,7 +71,7 @@ bool Game::Initialize()
 	currentFrameResourceIndex = (currentFrameResourceIndex + 1) % gNumberFrameResources;
 	currentFrameResource = FrameResources[currentFrameResourceIndex].get();
 
-	UpdateMainPassCB(timer);
+	UpdateMainPassCB(0, 0.0f, 0.0f);
 
 	ID3D12DescriptorHeap* descriptorHeaps[] = { UAVHeap.Get() };
 	CommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
@@ -124,9 +127,21 @@ void Game::Update(const Timer &timer)
 		WaitForSingleObject(eventHandle, INFINITE);
 		CloseHandle(eventHandle);
 	}
+
+	// the frame resource is done, so its copy of the dead list counter is the latest one
+	if (currentFrameResource->Fence != 0)
+	{
+		UINT* deadListCount = nullptr;
+		CD3DX12_RANGE readRange(0, sizeof(UINT));
+		ThrowIfFailed(currentFrameResource->DeadListCountReadback->Map(0, &readRange, reinterpret_cast<void**>(&deadListCount)));
+		deadListCountAtReadback = *deadListCount;
+		currentFrameResource->DeadListCountReadback->Unmap(0, &CD3DX12_RANGE(0, 0));
+
+		emittedAtReadback = currentFrameResource->EmittedAtReadback;
+	}
 	
-	emitter->Update(timer.GetTotalTime(), timer.GetTotalTime());
-	UpdateMainPassCB(timer);
+	// the frame time only decides how many fixed steps run, the steps themselves never see it
+	stepsThisFrame = fixedTimestep.Advance(timer.GetDeltaTime());
 }
 
 void Game::Draw(const Timer &timer)
@@ -149,45 +164,83 @@ void Game::Draw(const Timer &timer)
 	CommandList->SetComputeRootConstantBufferView(0, objectCB->GetGPUVirtualAddress());
 
 	auto timeCB = currentFrameResource->TimeCB->Resource();
-	CommandList->SetComputeRootConstantBufferView(1, timeCB->GetGPUVirtualAddress());
-
 	auto particleCB = currentFrameResource->ParticleCB->Resource();
-	CommandList->SetComputeRootConstantBufferView(2, particleCB->GetGPUVirtualAddress());
+
+	UINT timeCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(TimeConstants));
+	UINT particleCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ParticleConstants));
 
 	CommandList->SetComputeRootDescriptorTable(3, ParticlePoolGPUUAV);
 	CommandList->SetComputeRootDescriptorTable(4, ACDeadListGPUUAV);
 	CommandList->SetComputeRootDescriptorTable(5, DrawListGPUUAV);
 	CommandList->SetComputeRootDescriptorTable(6, DrawArgsGPUUAV);
 
-	while (emitter->GetEmitTimeCounter() >= emitter->GetTimeBetweenEmit())
+	// every step gets its own constants so all steps recorded this frame can sit in one command list
+	unsigned long long firstStep = fixedTimestep.GetStepCount() - stepsThisFrame;
+	float stepSize = fixedTimestep.GetStepSize();
+
+	for (int step = 0; step < stepsThisFrame; ++step)
 	{
-		emitter->SetEmitCount((int)(emitter->GetEmitTimeCounter() / emitter->GetTimeBetweenEmit()));
+		float stepTime = fixedTimestep.GetStepTime(firstStep + step + 1);
+
+		emitter->Update(stepTime, stepSize);
+
+		// the plan sets EmitCount, so the constants are written once it is known
+		EmissionBatch batch = emissionPlanner.Plan(*emitter, GetDeadListFreeCount());
+		UpdateMainPassCB(step, stepSize, stepTime);
+
+		CommandList->SetComputeRootConstantBufferView(1, timeCB->GetGPUVirtualAddress() + step * timeCBByteSize);
+		CommandList->SetComputeRootConstantBufferView(2, particleCB->GetGPUVirtualAddress() + step * particleCBByteSize);
+
+		if (batch.GroupCount > 0)
+		{
+			CommandList->SetPipelineState(PSOs["particleEmit"].Get());
+			CommandList->Dispatch(batch.GroupCount, 1, 1);
+		}
+
+		CommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::UAV(RWParticlePool.Get()));
+
+		CommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(RWDrawList.Get(),
+			D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_DEST));
+
+		CommandList->CopyResource(RWDrawList.Get(), DrawListUploadBuffer.Get());
 
-		emitter->SetEmitCount(min(emitter->GetEmitCount(), 65535));
-		emitter->SetEmitTimeCounter(fmod(emitter->GetEmitTimeCounter(), emitter->GetTimeBetweenEmit()));
-		
-		UpdateMainPassCB(timer);
+		CommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(RWDrawList.Get(),
+			D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
 
-		CommandList->Dispatch(emitter->GetEmitCount(), 1, 1);
+		CommandList->SetPipelineState(PSOs["particleUpdate"].Get());
+		CommandList->SetComputeRootSignature(particleRootSignature.Get());
+		CommandList->Dispatch(emitter->GetMaxParticles(), 1, 1);
+
+		CommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::UAV(RWParticlePool.Get()));
+		CommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::UAV(RWDrawList.Get()));
 	}
 
-	CommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(RWDrawList.Get(),
-		D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_DEST));
+	// read back the dead list counter, which sits behind the indices in ACDeadList, every frame
+	// so the copy in this frame resource always matches EmittedAtReadback
+	CommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(ACDeadList.Get(),
+		D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE));
 
-	CommandList->CopyResource(RWDrawList.Get(), DrawListUploadBuffer.Get());
+	CommandList->CopyBufferRegion(currentFrameResource->DeadListCountReadback.Get(), 0, ACDeadList.Get(), deadListCounterOffset, sizeof(UINT));
 
-	CommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(RWDrawList.Get(),
-		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
-	
-	CommandList->SetPipelineState(PSOs["particleUpdate"].Get());
-	CommandList->SetComputeRootSignature(particleRootSignature.Get());
-	CommandList->Dispatch(emitter->GetMaxParticles(), 1, 1);
+	CommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(ACDeadList.Get(),
+		D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+	currentFrameResource->EmittedAtReadback = emissionPlanner.GetEmittedCount();
 
-	CommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::UAV(RWDrawList.Get()));
+	// the draw reads the constants of the last step, a frame without steps redraws the last step's list
+	// with the constants rewritten for the new interpolation alpha
+	int lastStep = stepsThisFrame > 0 ? stepsThisFrame - 1 : 0;
+	if (stepsThisFrame == 0)
+		UpdateMainPassCB(0, stepSize, fixedTimestep.GetStepTime(fixedTimestep.GetStepCount()));
 
-	CommandList->SetPipelineState(PSOs["particleDraw"].Get());
-	CommandList->SetComputeRootSignature(particleRootSignature.Get());
-	CommandList->Dispatch(1, 1, 1);
+	CommandList->SetComputeRootConstantBufferView(1, timeCB->GetGPUVirtualAddress() + lastStep * timeCBByteSize);
+	CommandList->SetComputeRootConstantBufferView(2, particleCB->GetGPUVirtualAddress() + lastStep * particleCBByteSize);
+
+	if (stepsThisFrame > 0)
+	{
+		CommandList->SetPipelineState(PSOs["particleDraw"].Get());
+		CommandList->SetComputeRootSignature(particleRootSignature.Get());
+		CommandList->Dispatch(1, 1, 1);
+	}
 
 	CommandList->RSSetViewports(1, &ScreenViewPort);
 	CommandList->RSSetScissorRects(1, &ScissorRect);
@@ -210,8 +263,8 @@ void Game::Draw(const Timer &timer)
 	CommandList->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
 
 	CommandList->SetGraphicsRootConstantBufferView(0, objectCB->GetGPUVirtualAddress());
-	CommandList->SetGraphicsRootConstantBufferView(1, timeCB->GetGPUVirtualAddress());
-	CommandList->SetGraphicsRootConstantBufferView(2, particleCB->GetGPUVirtualAddress());
+	CommandList->SetGraphicsRootConstantBufferView(1, timeCB->GetGPUVirtualAddress() + lastStep * timeCBByteSize);
+	CommandList->SetGraphicsRootConstantBufferView(2, particleCB->GetGPUVirtualAddress() + lastStep * particleCBByteSize);
 
 	CommandList->SetGraphicsRootDescriptorTable(3, ParticlePoolGPUSRV);
 	CommandList->SetGraphicsRootDescriptorTable(4, DrawListGPUSRV);
@@ -254,7 +307,13 @@ void Game::Draw(const Timer &timer)
 	CommandQueue->Signal(Fence.Get(), currentFence);
 }
 
-void Game::UpdateMainPassCB(const Timer &timer)
+unsigned int Game::GetDeadListFreeCount() const
+{
+	unsigned long long emittedSince = emissionPlanner.GetEmittedCount() - emittedAtReadback;
+	return emittedSince < deadListCountAtReadback ? (unsigned int)(deadListCountAtReadback - emittedSince) : 0;
+}
+
+void Game::UpdateMainPassCB(int stepIndex, float deltaTime, float totalTime)
 {
 	XMMATRIX world = XMMatrixIdentity();
 	XMMATRIX view = XMLoadFloat4x4(&mainCamera.GetViewMatrix());
@@ -269,13 +328,16 @@ void Game::UpdateMainPassCB(const Timer &timer)
 	auto currentObjectCB = currentFrameResource->ObjectCB.get();
 	currentObjectCB->CopyData(0, objConstants);
 
-	MainTimeCB.DeltaTime = timer.GetDeltaTime();
-	MainTimeCB.TotalTime = timer.GetTotalTime();
+	MainTimeCB.DeltaTime = deltaTime;
+	MainTimeCB.TotalTime = totalTime;
+	MainTimeCB.InterpolationAlpha = fixedTimestep.GetAlpha();
 
 	auto currentTimeCB = currentFrameResource->TimeCB.get();
-	currentTimeCB->CopyData(0, MainTimeCB);
+	currentTimeCB->CopyData(stepIndex, MainTimeCB);
 
 	MainParticleCB.EmitCount = emitter->GetEmitCount();
+	MainParticleCB.EmitNewestAge = emitter->GetEmitTimeCounter();
+	MainParticleCB.EmitSpacing = emitter->GetTimeBetweenEmit();
 	MainParticleCB.MaxParticles = emitter->GetMaxParticles();
 	MainParticleCB.GridSize = emitter->GetGridSize();
 	MainParticleCB.LifeTime = emitter->GetLifeTime();
@@ -283,7 +345,7 @@ void Game::UpdateMainPassCB(const Timer &timer)
 	MainParticleCB.acceleration = emitter->GetAcceleration();
 
 	auto currentParticleCB = currentFrameResource->ParticleCB.get();
-	currentParticleCB->CopyData(0, MainParticleCB);
+	currentParticleCB->CopyData(stepIndex, MainParticleCB);
 }
 
 void Game::BuildUAVs()
@@ -336,6 +398,7 @@ void Game::BuildUAVs()
 	{
 		UINT64 deadListByteSize = sizeof(unsigned int) * emitter->GetMaxParticles();
 		UINT64 countBufferOffset = AlignForUavCounter(deadListByteSize);
+		deadListCounterOffset = countBufferOffset;
 
 		ThrowIfFailed(Device->CreateCommittedResource(
 			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
@@ -655,7 +718,7 @@ void Game::BuildFrameResources()
 	for (int i = 0; i < gNumberFrameResources; ++i)
 	{
 		FrameResources.push_back(std::make_unique<FrameResource>(Device.Get(),
-			1, 1, 1));
+			1, fixedTimestep.GetMaxSubsteps(), fixedTimestep.GetMaxSubsteps()));
 	}
 }
 
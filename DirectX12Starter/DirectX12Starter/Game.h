@@ -8,6 +8,8 @@
 #include "SystemData.h"
 #include "DDSTextureLoader.h"
 #include "Emitter.h"
+#include "EmissionPlanner.h"
+#include "FixedTimestep.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
@@ -77,11 +79,26 @@ private:
 
 	Emitter *emitter;
 
+	// the particle passes run in fixed steps, Update decides how many this frame and Draw records them
+	FixedTimestep fixedTimestep;
+	int stepsThisFrame = 0;
+
+	// one emit batch per step, capped by what is known to be on the dead list
+	// the counter comes back gNumberFrameResources frames late, everything emitted since is taken off it,
+	// particles that died since only add to the real count so the cap never hands out more than is there
+	EmissionPlanner emissionPlanner;
+	UINT64 deadListCounterOffset = 0;
+	unsigned long long deadListCountAtReadback = 0;
+	unsigned long long emittedAtReadback = 0;
+
+	unsigned int GetDeadListFreeCount() const;
+
 	virtual void Resize()override;
 	virtual void Update(const Timer& timer)override;
 	virtual void Draw(const Timer& timer)override;
 
-	void UpdateMainPassCB(const Timer& timer);
+	// writes the constants for one simulation step into element stepIndex of the frame's constant buffers
+	void UpdateMainPassCB(int stepIndex, float deltaTime, float totalTime);
 
 	void BuildUAVs();
 	void BuildRootSignature();
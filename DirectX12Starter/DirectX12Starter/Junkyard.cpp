@@ -2,6 +2,7 @@
 #include <crtdbg.h>
 #include "d3dUtil.h"
 #include "Game.h"
+#include "ParticleBenchmark.h"
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
 	PSTR cmdLine, int showCmd)
@@ -11,6 +12,10 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif
 
+	// run the CPU particle pipeline without creating a window or a device
+	if (cmdLine != nullptr && strstr(cmdLine, "-headless") != nullptr)
+		return ParticleBenchmark::RunHeadless(cmdLine, "benchmark_results.txt");
+
 	try
 	{
 		Game Game(hInstance);
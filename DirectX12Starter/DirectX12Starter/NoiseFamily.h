@@ -0,0 +1,525 @@
+#pragma once
+#include "SimdMath.h"
+#include "SimplexNoise.h"
+
+// noise bases chosen at compile time, each evaluates Simd::Width 2D or 3D points with the Simd wrappers only,
+// so SimdScalar instantiates the scalar reference and every wider instantiation gives its bits
+// the lattice hash is the permute polynomial of SimplexNoise.hlsl, which keeps every basis portable to HLSL
+namespace NoiseFamilyDetail
+{
+	template<typename Simd>
+	typename Simd::Float Mod289(typename Simd::Float x)
+	{
+		return Simd::Sub(x, Simd::Mul(Simd::Floor(Simd::Mul(x, Simd::Set1(1.0f / 289.0f))), Simd::Set1(289.0f)));
+	}
+
+	template<typename Simd>
+	typename Simd::Float Permute(typename Simd::Float x)
+	{
+		return Mod289<Simd>(Simd::Mul(Simd::Add(Simd::Mul(x, Simd::Set1(34.0f)), Simd::Set1(1.0f)), x));
+	}
+
+	// a value in [0, 289) for a lattice point, the coordinates already reduced by Mod289
+	template<typename Simd>
+	typename Simd::Float Hash(typename Simd::Float i, typename Simd::Float j)
+	{
+		return Permute<Simd>(Simd::Add(Permute<Simd>(j), i));
+	}
+
+	template<typename Simd>
+	typename Simd::Float Hash(typename Simd::Float i, typename Simd::Float j, typename Simd::Float k)
+	{
+		return Permute<Simd>(Simd::Add(Permute<Simd>(Simd::Add(Permute<Simd>(k), j)), i));
+	}
+
+	// 6t^5 - 15t^4 + 10t^3
+	template<typename Simd>
+	typename Simd::Float Fade(typename Simd::Float t)
+	{
+		typename Simd::Float polynomial = Simd::Add(Simd::Mul(t, Simd::Sub(Simd::Mul(t, Simd::Set1(6.0f)), Simd::Set1(15.0f))), Simd::Set1(10.0f));
+		return Simd::Mul(Simd::Mul(Simd::Mul(t, t), t), polynomial);
+	}
+
+	template<typename Simd>
+	typename Simd::Float Lerp(typename Simd::Float a, typename Simd::Float b, typename Simd::Float t)
+	{
+		return Simd::Add(a, Simd::Mul(Simd::Sub(b, a), t));
+	}
+
+	// a value in [-1, 1) from a hash, 41 levels like the gradients of snoise(float2)
+	template<typename Simd>
+	typename Simd::Float HashValue(typename Simd::Float hash)
+	{
+		typename Simd::Float scaled = Simd::Mul(hash, Simd::Set1(1.0f / 41.0f));
+		return Simd::Sub(Simd::Mul(Simd::Set1(2.0f), Simd::Sub(scaled, Simd::Floor(scaled))), Simd::Set1(1.0f));
+	}
+
+	// the gradient of snoise(float2), 41 points on a line mapped onto a diamond and normalized
+	template<typename Simd>
+	void Gradient2(typename Simd::Float hash, typename Simd::Float& gx, typename Simd::Float& gy)
+	{
+		const typename Simd::Float half = Simd::Set1(0.5f);
+
+		typename Simd::Float x = HashValue<Simd>(hash);
+		typename Simd::Float h = Simd::Sub(Simd::Abs(x), half);
+		typename Simd::Float a0 = Simd::Sub(x, Simd::Floor(Simd::Add(x, half)));
+		typename Simd::Float norm = Simd::Sub(Simd::Set1(1.79284291400159f),
+			Simd::Mul(Simd::Set1(0.85373472095314f), Simd::Add(Simd::Mul(a0, a0), Simd::Mul(h, h))));
+
+		gx = Simd::Mul(a0, norm);
+		gy = Simd::Mul(h, norm);
+	}
+
+	// the gradient of snoise(float3), 7x7 points over a square mapped onto an octahedron and normalized
+	template<typename Simd>
+	void Gradient3(typename Simd::Float hash, typename Simd::Float& gx, typename Simd::Float& gy, typename Simd::Float& gz)
+	{
+		typedef typename Simd::Float Float;
+
+		const Float nsx = Simd::Set1(0.142857142857f * 2.0f);
+		const Float nsy = Simd::Set1(0.142857142857f * 0.5f - 1.0f);
+		const Float nsz = Simd::Set1(0.142857142857f);
+		const Float one = Simd::Set1(1.0f);
+
+		Float j = Simd::Sub(hash, Simd::Mul(Simd::Set1(49.0f), Simd::Floor(Simd::Mul(Simd::Mul(hash, nsz), nsz))));
+		Float x_ = Simd::Floor(Simd::Mul(j, nsz));
+		Float y_ = Simd::Floor(Simd::Sub(j, Simd::Mul(Simd::Set1(7.0f), x_)));
+
+		Float x = Simd::Add(Simd::Mul(x_, nsx), nsy);
+		Float y = Simd::Add(Simd::Mul(y_, nsx), nsy);
+		Float h = Simd::Sub(Simd::Sub(one, Simd::Abs(x)), Simd::Abs(y));
+
+		// sh = -step(h, 0)
+		Float sh = Simd::Select(Simd::CmpGt(h, Simd::Zero()), Simd::Zero(), Simd::Set1(-1.0f));
+		Float two = Simd::Set1(2.0f);
+		gx = Simd::Add(x, Simd::Mul(Simd::Add(Simd::Mul(Simd::Floor(x), two), one), sh));
+		gy = Simd::Add(y, Simd::Mul(Simd::Add(Simd::Mul(Simd::Floor(y), two), one), sh));
+		gz = h;
+
+		Float norm = Simd::Sub(Simd::Set1(1.79284291400159f), Simd::Mul(Simd::Set1(0.85373472095314f),
+			Simd::Add(Simd::Add(Simd::Mul(gx, gx), Simd::Mul(gy, gy)), Simd::Mul(gz, gz))));
+		gx = Simd::Mul(gx, norm);
+		gy = Simd::Mul(gy, norm);
+		gz = Simd::Mul(gz, norm);
+	}
+}
+
+// random values on the integer lattice blended with the quintic fade, the cheapest basis, blocky at low octaves
+struct NoiseBasisValue
+{
+	static const char* Name() { return "value"; }
+
+	template<typename Simd>
+	static typename Simd::Float Evaluate(typename Simd::Float x, typename Simd::Float y)
+	{
+		using namespace NoiseFamilyDetail;
+		typedef typename Simd::Float Float;
+
+		const Float one = Simd::Set1(1.0f);
+
+		Float ix = Simd::Floor(x);
+		Float iy = Simd::Floor(y);
+		Float u = Fade<Simd>(Simd::Sub(x, ix));
+		Float v = Fade<Simd>(Simd::Sub(y, iy));
+
+		ix = Mod289<Simd>(ix);
+		iy = Mod289<Simd>(iy);
+		Float ix1 = Simd::Add(ix, one);
+		Float iy1 = Simd::Add(iy, one);
+
+		Float v00 = HashValue<Simd>(Hash<Simd>(ix, iy));
+		Float v10 = HashValue<Simd>(Hash<Simd>(ix1, iy));
+		Float v01 = HashValue<Simd>(Hash<Simd>(ix, iy1));
+		Float v11 = HashValue<Simd>(Hash<Simd>(ix1, iy1));
+
+		return Lerp<Simd>(Lerp<Simd>(v00, v10, u), Lerp<Simd>(v01, v11, u), v);
+	}
+
+	template<typename Simd>
+	static typename Simd::Float Evaluate(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z)
+	{
+		using namespace NoiseFamilyDetail;
+		typedef typename Simd::Float Float;
+
+		const Float one = Simd::Set1(1.0f);
+
+		Float ix = Simd::Floor(x);
+		Float iy = Simd::Floor(y);
+		Float iz = Simd::Floor(z);
+		Float u = Fade<Simd>(Simd::Sub(x, ix));
+		Float v = Fade<Simd>(Simd::Sub(y, iy));
+		Float w = Fade<Simd>(Simd::Sub(z, iz));
+
+		ix = Mod289<Simd>(ix);
+		iy = Mod289<Simd>(iy);
+		iz = Mod289<Simd>(iz);
+
+		// corners in x, y, z order, each pair along x blended first
+		Float edges[4];
+		for (int corner = 0; corner < 4; ++corner)
+		{
+			Float j = (corner & 1) ? Simd::Add(iy, one) : iy;
+			Float k = (corner & 2) ? Simd::Add(iz, one) : iz;
+			Float v0 = HashValue<Simd>(Hash<Simd>(ix, j, k));
+			Float v1 = HashValue<Simd>(Hash<Simd>(Simd::Add(ix, one), j, k));
+			edges[corner] = Lerp<Simd>(v0, v1, u);
+		}
+
+		return Lerp<Simd>(Lerp<Simd>(edges[0], edges[1], v), Lerp<Simd>(edges[2], edges[3], v), w);
+	}
+};
+
+// Perlin's gradient noise with the gradient sets of snoise, smoother than value noise at about twice the cost
+struct NoiseBasisGradient
+{
+	static const char* Name() { return "gradient"; }
+
+	template<typename Simd>
+	static typename Simd::Float Evaluate(typename Simd::Float x, typename Simd::Float y)
+	{
+		using namespace NoiseFamilyDetail;
+		typedef typename Simd::Float Float;
+
+		const Float one = Simd::Set1(1.0f);
+
+		Float ix = Simd::Floor(x);
+		Float iy = Simd::Floor(y);
+		Float fx = Simd::Sub(x, ix);
+		Float fy = Simd::Sub(y, iy);
+		Float u = Fade<Simd>(fx);
+		Float v = Fade<Simd>(fy);
+
+		ix = Mod289<Simd>(ix);
+		iy = Mod289<Simd>(iy);
+
+		Float dots[4];
+		for (int corner = 0; corner < 4; ++corner)
+		{
+			Float i = (corner & 1) ? Simd::Add(ix, one) : ix;
+			Float j = (corner & 2) ? Simd::Add(iy, one) : iy;
+			Float dx = (corner & 1) ? Simd::Sub(fx, one) : fx;
+			Float dy = (corner & 2) ? Simd::Sub(fy, one) : fy;
+
+			Float gx, gy;
+			Gradient2<Simd>(Hash<Simd>(i, j), gx, gy);
+			dots[corner] = Simd::Add(Simd::Mul(gx, dx), Simd::Mul(gy, dy));
+		}
+
+		Float noise = Lerp<Simd>(Lerp<Simd>(dots[0], dots[1], u), Lerp<Simd>(dots[2], dots[3], u), v);
+		return Simd::Mul(Simd::Set1(2.3f), noise);
+	}
+
+	template<typename Simd>
+	static typename Simd::Float Evaluate(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z)
+	{
+		using namespace NoiseFamilyDetail;
+		typedef typename Simd::Float Float;
+
+		const Float one = Simd::Set1(1.0f);
+
+		Float ix = Simd::Floor(x);
+		Float iy = Simd::Floor(y);
+		Float iz = Simd::Floor(z);
+		Float fx = Simd::Sub(x, ix);
+		Float fy = Simd::Sub(y, iy);
+		Float fz = Simd::Sub(z, iz);
+		Float u = Fade<Simd>(fx);
+		Float v = Fade<Simd>(fy);
+		Float w = Fade<Simd>(fz);
+
+		ix = Mod289<Simd>(ix);
+		iy = Mod289<Simd>(iy);
+		iz = Mod289<Simd>(iz);
+
+		Float dots[8];
+		for (int corner = 0; corner < 8; ++corner)
+		{
+			Float i = (corner & 1) ? Simd::Add(ix, one) : ix;
+			Float j = (corner & 2) ? Simd::Add(iy, one) : iy;
+			Float k = (corner & 4) ? Simd::Add(iz, one) : iz;
+			Float dx = (corner & 1) ? Simd::Sub(fx, one) : fx;
+			Float dy = (corner & 2) ? Simd::Sub(fy, one) : fy;
+			Float dz = (corner & 4) ? Simd::Sub(fz, one) : fz;
+
+			Float gx, gy, gz;
+			Gradient3<Simd>(Hash<Simd>(i, j, k), gx, gy, gz);
+			dots[corner] = Simd::Add(Simd::Add(Simd::Mul(gx, dx), Simd::Mul(gy, dy)), Simd::Mul(gz, dz));
+		}
+
+		Float c00 = Lerp<Simd>(dots[0], dots[1], u);
+		Float c10 = Lerp<Simd>(dots[2], dots[3], u);
+		Float c01 = Lerp<Simd>(dots[4], dots[5], u);
+		Float c11 = Lerp<Simd>(dots[6], dots[7], u);
+		Float noise = Lerp<Simd>(Lerp<Simd>(c00, c10, v), Lerp<Simd>(c01, c11, v), w);
+		return Simd::Mul(Simd::Set1(2.2f), noise);
+	}
+};
+
+// snoise(float2) and snoise(float3) of SimplexNoise.hlsl
+struct NoiseBasisSimplex
+{
+	static const char* Name() { return "simplex"; }
+
+	template<typename Simd>
+	static typename Simd::Float Evaluate(typename Simd::Float x, typename Simd::Float y)
+	{
+		return SimplexNoise::SNoiseBatch<Simd>(x, y);
+	}
+
+	template<typename Simd>
+	static typename Simd::Float Evaluate(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z)
+	{
+		return SimplexNoise::SNoiseBatch<Simd>(x, y, z);
+	}
+};
+
+// cellular noise, the distance to the nearest of one jittered feature point per cell (F1),
+// 0 on a point and rarely above 1, searches the 9 or 27 cells around the point so it is the most expensive basis
+struct NoiseBasisWorley
+{
+	static const char* Name() { return "worley"; }
+
+	template<typename Simd>
+	static typename Simd::Float Evaluate(typename Simd::Float x, typename Simd::Float y)
+	{
+		using namespace NoiseFamilyDetail;
+		typedef typename Simd::Float Float;
+
+		const Float jitter = Simd::Set1(1.0f / 289.0f);
+
+		Float ix = Simd::Floor(x);
+		Float iy = Simd::Floor(y);
+		Float fx = Simd::Sub(x, ix);
+		Float fy = Simd::Sub(y, iy);
+
+		ix = Mod289<Simd>(ix);
+		iy = Mod289<Simd>(iy);
+
+		Float nearest = Simd::Set1(8.0f);
+		for (int j = -1; j <= 1; ++j)
+		{
+			for (int i = -1; i <= 1; ++i)
+			{
+				Float offsetX = Simd::Set1((float)i);
+				Float offsetY = Simd::Set1((float)j);
+
+				// the feature point of the cell at its hash and the hash of the hash
+				Float hash = Hash<Simd>(Simd::Add(ix, offsetX), Simd::Add(iy, offsetY));
+				Float dx = Simd::Sub(Simd::Add(offsetX, Simd::Mul(hash, jitter)), fx);
+				Float dy = Simd::Sub(Simd::Add(offsetY, Simd::Mul(Permute<Simd>(hash), jitter)), fy);
+
+				nearest = Simd::Min(nearest, Simd::Add(Simd::Mul(dx, dx), Simd::Mul(dy, dy)));
+			}
+		}
+
+		return Simd::Sqrt(nearest);
+	}
+
+	template<typename Simd>
+	static typename Simd::Float Evaluate(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z)
+	{
+		using namespace NoiseFamilyDetail;
+		typedef typename Simd::Float Float;
+
+		const Float jitter = Simd::Set1(1.0f / 289.0f);
+
+		Float ix = Simd::Floor(x);
+		Float iy = Simd::Floor(y);
+		Float iz = Simd::Floor(z);
+		Float fx = Simd::Sub(x, ix);
+		Float fy = Simd::Sub(y, iy);
+		Float fz = Simd::Sub(z, iz);
+
+		ix = Mod289<Simd>(ix);
+		iy = Mod289<Simd>(iy);
+		iz = Mod289<Simd>(iz);
+
+		Float nearest = Simd::Set1(12.0f);
+		for (int k = -1; k <= 1; ++k)
+		{
+			for (int j = -1; j <= 1; ++j)
+			{
+				for (int i = -1; i <= 1; ++i)
+				{
+					Float offsetX = Simd::Set1((float)i);
+					Float offsetY = Simd::Set1((float)j);
+					Float offsetZ = Simd::Set1((float)k);
+
+					Float hash = Hash<Simd>(Simd::Add(ix, offsetX), Simd::Add(iy, offsetY), Simd::Add(iz, offsetZ));
+					Float hash2 = Permute<Simd>(hash);
+					Float dx = Simd::Sub(Simd::Add(offsetX, Simd::Mul(hash, jitter)), fx);
+					Float dy = Simd::Sub(Simd::Add(offsetY, Simd::Mul(hash2, jitter)), fy);
+					Float dz = Simd::Sub(Simd::Add(offsetZ, Simd::Mul(Permute<Simd>(hash2), jitter)), fz);
+
+					nearest = Simd::Min(nearest, Simd::Add(Simd::Add(Simd::Mul(dx, dx), Simd::Mul(dy, dy)), Simd::Mul(dz, dz)));
+				}
+			}
+		}
+
+		return Simd::Sqrt(nearest);
+	}
+};
+
+// (1 - |n|)^2 of a signed basis, sharp crests where the basis crosses zero, NoiseFbm over it is ridged fBm
+template<typename Basis>
+struct NoiseRidge
+{
+	static const char* Name() { return "ridged"; }
+
+	template<typename Simd>
+	static typename Simd::Float Evaluate(typename Simd::Float x, typename Simd::Float y)
+	{
+		typename Simd::Float ridge = Simd::Sub(Simd::Set1(1.0f), Simd::Abs(Basis::template Evaluate<Simd>(x, y)));
+		return Simd::Mul(ridge, ridge);
+	}
+
+	template<typename Simd>
+	static typename Simd::Float Evaluate(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z)
+	{
+		typename Simd::Float ridge = Simd::Sub(Simd::Set1(1.0f), Simd::Abs(Basis::template Evaluate<Simd>(x, y, z)));
+		return Simd::Mul(ridge, ridge);
+	}
+};
+
+// octaves Octave to Octaves - 1 of NoiseFbm, one template per octave so the sum has no loop left to unroll
+template<typename Basis, int Octave, int Octaves>
+struct NoiseOctaves
+{
+	template<typename Simd>
+	static typename Simd::Float Sum(typename Simd::Float x, typename Simd::Float y, float amplitude)
+	{
+		const typename Simd::Float two = Simd::Set1(2.0f);
+		typename Simd::Float octave = Simd::Mul(Basis::template Evaluate<Simd>(x, y), Simd::Set1(amplitude));
+		return Simd::Add(octave, NoiseOctaves<Basis, Octave + 1, Octaves>::template Sum<Simd>(Simd::Mul(x, two), Simd::Mul(y, two), amplitude * 0.5f));
+	}
+
+	template<typename Simd>
+	static typename Simd::Float Sum(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z, float amplitude)
+	{
+		const typename Simd::Float two = Simd::Set1(2.0f);
+		typename Simd::Float octave = Simd::Mul(Basis::template Evaluate<Simd>(x, y, z), Simd::Set1(amplitude));
+		return Simd::Add(octave, NoiseOctaves<Basis, Octave + 1, Octaves>::template Sum<Simd>(Simd::Mul(x, two), Simd::Mul(y, two),
+			Simd::Mul(z, two), amplitude * 0.5f));
+	}
+};
+
+template<typename Basis, int Octaves>
+struct NoiseOctaves<Basis, Octaves, Octaves>
+{
+	template<typename Simd>
+	static typename Simd::Float Sum(typename Simd::Float x, typename Simd::Float y, float amplitude)
+	{
+		return Simd::Zero();
+	}
+
+	template<typename Simd>
+	static typename Simd::Float Sum(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z, float amplitude)
+	{
+		return Simd::Zero();
+	}
+};
+
+// Octaves octaves of Basis, each at twice the frequency and half the amplitude of the one before,
+// like CalcNoiseWithOctaves with persistence 0.5, divided by the sum of the amplitudes so it keeps the basis range
+template<typename Basis, int Octaves>
+struct NoiseFbm
+{
+	static_assert(Octaves >= 1, "NoiseFbm needs at least one octave");
+
+	static const int OctaveCount = Octaves;
+
+	static const char* Name() { return Basis::Name(); }
+
+	static float Normalization()
+	{
+		float amplitudes = 0.0f;
+		float amplitude = 1.0f;
+		for (int octave = 0; octave < Octaves; ++octave)
+		{
+			amplitudes += amplitude;
+			amplitude *= 0.5f;
+		}
+		return 1.0f / amplitudes;
+	}
+
+	template<typename Simd>
+	static typename Simd::Float Evaluate(typename Simd::Float x, typename Simd::Float y)
+	{
+		return Simd::Mul(NoiseOctaves<Basis, 0, Octaves>::template Sum<Simd>(x, y, 1.0f), Simd::Set1(Normalization()));
+	}
+
+	template<typename Simd>
+	static typename Simd::Float Evaluate(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z)
+	{
+		return Simd::Mul(NoiseOctaves<Basis, 0, Octaves>::template Sum<Simd>(x, y, z, 1.0f), Simd::Set1(Normalization()));
+	}
+};
+
+// any of the noises above over count points in separate coordinate arrays, Simd::Width points at a time and
+// SimdScalar for the remainder, so every level writes the scalar bits
+class NoiseFamily
+{
+public:
+	template<typename Noise>
+	static void Points(SimplexNoiseLevel level, const float* x, const float* y, float* noise, unsigned int count)
+	{
+		switch (level)
+		{
+		case SimplexNoiseAVX512:
+			Run<Noise, SimdAVX512>(x, y, noise, count);
+			break;
+		case SimplexNoiseAVX2:
+			Run<Noise, SimdAVX2>(x, y, noise, count);
+			break;
+		case SimplexNoiseSSE4:
+			Run<Noise, SimdSSE4>(x, y, noise, count);
+			break;
+		default:
+			Run<Noise, SimdScalar>(x, y, noise, count);
+			break;
+		}
+	}
+
+	template<typename Noise>
+	static void Points(SimplexNoiseLevel level, const float* x, const float* y, const float* z, float* noise, unsigned int count)
+	{
+		switch (level)
+		{
+		case SimplexNoiseAVX512:
+			Run<Noise, SimdAVX512>(x, y, z, noise, count);
+			break;
+		case SimplexNoiseAVX2:
+			Run<Noise, SimdAVX2>(x, y, z, noise, count);
+			break;
+		case SimplexNoiseSSE4:
+			Run<Noise, SimdSSE4>(x, y, z, noise, count);
+			break;
+		default:
+			Run<Noise, SimdScalar>(x, y, z, noise, count);
+			break;
+		}
+	}
+
+private:
+	template<typename Noise, typename Simd>
+	static void Run(const float* x, const float* y, float* noise, unsigned int count)
+	{
+		unsigned int i = 0;
+		for (; i + Simd::Width <= count; i += Simd::Width)
+			Simd::Store(noise + i, Noise::template Evaluate<Simd>(Simd::Load(x + i), Simd::Load(y + i)));
+
+		for (; i < count; ++i)
+			noise[i] = Noise::template Evaluate<SimdScalar>(x[i], y[i]);
+	}
+
+	template<typename Noise, typename Simd>
+	static void Run(const float* x, const float* y, const float* z, float* noise, unsigned int count)
+	{
+		unsigned int i = 0;
+		for (; i + Simd::Width <= count; i += Simd::Width)
+			Simd::Store(noise + i, Noise::template Evaluate<Simd>(Simd::Load(x + i), Simd::Load(y + i), Simd::Load(z + i)));
+
+		for (; i < count; ++i)
+			noise[i] = Noise::template Evaluate<SimdScalar>(x[i], y[i], z[i]);
+	}
+};
@@ -0,0 +1,508 @@
+#include "ParticleBenchmark.h"
+#include "Camera.h"
+#include "FixedTimestep.h"
+#include "ParticleCheckpoint.h"
+#include "ParticleSelfChecks.h"
+#include "SystemData.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+
+using namespace DirectX;
+
+namespace
+{
+	const unsigned long long HashOffsetBasis = 14695981039346656037ull;
+
+	// the path after a "-name=" switch, up to the next space
+	std::string ReadPath(const char* value)
+	{
+		const char* end = strchr(value, ' ');
+		return end != nullptr ? std::string(value, end) : std::string(value);
+	}
+
+	unsigned long long HashBytes(unsigned long long hash, const void* data, size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+}
+
+void ParticleBenchmarkSettings::ParseCommandLine(const char* cmdLine)
+{
+	if (cmdLine == nullptr)
+		return;
+
+	const char* value;
+
+	if ((value = strstr(cmdLine, "-particles=")) != nullptr)
+		MaxParticles = atoi(value + strlen("-particles="));
+
+	if ((value = strstr(cmdLine, "-frames=")) != nullptr)
+		FrameCount = atoi(value + strlen("-frames="));
+
+	if ((value = strstr(cmdLine, "-lifetime=")) != nullptr)
+		LifeTime = (float)atof(value + strlen("-lifetime="));
+
+	if ((value = strstr(cmdLine, "-rate=")) != nullptr)
+		EmissionRate = (float)atof(value + strlen("-rate="));
+
+	if ((value = strstr(cmdLine, "-dt=")) != nullptr)
+		DeltaTime = (float)atof(value + strlen("-dt="));
+
+	if ((value = strstr(cmdLine, "-threads=")) != nullptr)
+		ThreadCount = atoi(value + strlen("-threads="));
+
+	if ((value = strstr(cmdLine, "-emitters=")) != nullptr)
+		EmitterCount = (std::max)(atoi(value + strlen("-emitters=")), 1);
+
+	if ((value = strstr(cmdLine, "-shape=")) != nullptr)
+	{
+		std::string name = ReadPath(value + strlen("-shape="));
+		for (int i = 0; i < EmissionShapeTypeCount; ++i)
+		{
+			if (name == EmissionShape::GetTypeName((EmissionShapeType)i))
+				Shape = (EmissionShapeType)i;
+		}
+	}
+
+	if (strstr(cmdLine, "-alivelist") != nullptr)
+		UpdateMode = ParticleUpdateAliveList;
+
+	if (strstr(cmdLine, "-ring") != nullptr)
+		UpdateMode = ParticleUpdateRing;
+
+	if (strstr(cmdLine, "-ballistic") != nullptr)
+		UpdateMode = ParticleUpdateBallistic;
+
+	if (strstr(cmdLine, "-birthtime") != nullptr)
+		TimeMode = ParticleTimeBirth;
+
+	if (strstr(cmdLine, "-depthsort") != nullptr)
+		DepthSort = true;
+
+	if (strstr(cmdLine, "-cull") != nullptr)
+		FrustumCull = true;
+
+	if ((value = strstr(cmdLine, "-restore=")) != nullptr)
+		RestoreFile = ReadPath(value + strlen("-restore="));
+
+	if ((value = strstr(cmdLine, "-checkpoint=")) != nullptr)
+		CheckpointFile = ReadPath(value + strlen("-checkpoint="));
+}
+
+EmissionShape ParticleBenchmark::MakeShape(EmissionShapeType type, float gridSize, const MeshSurfaceSampler* mesh)
+{
+	EmissionShape shape;
+	shape.Type = type;
+	shape.Center = XMFLOAT3(0.0f, 0.0f, gridSize / 10.0f);
+	shape.Radius = gridSize / 20.0f;
+	shape.Extents = XMFLOAT3(gridSize / 20.0f, gridSize / 20.0f, gridSize / 20.0f);
+	shape.Height = gridSize / 10.0f;
+	shape.Mesh = mesh;
+	return shape;
+}
+
+bool ParticleBenchmark::LoadMesh(MeshSurfaceSampler& sampler)
+{
+	// SystemData keys sub systems by pointer, so the same name has to be passed to both calls
+	char fileName[] = "Resources/Models/cylinder.obj";
+	char subSystemName[] = "cylinder";
+
+	SystemData systemData;
+	systemData.LoadOBJFile(fileName, nullptr, subSystemName);
+	return sampler.Build(systemData, subSystemName);
+}
+
+ParticleBenchmark::ParticleBenchmark(const ParticleBenchmarkSettings& settings) :
+	settings(settings)
+{
+	framesRun = 0;
+	invariantFailures = 0;
+	visibleTotal = 0;
+	culledTotal = 0;
+	totalSeconds = 0.0;
+	restoreSeconds = 0.0;
+	restored = false;
+	constantsHash = HashOffsetBasis;
+
+	// without the model the mesh emitters fall back to the grid
+	meshLoaded = settings.Shape == EmissionShapeMesh && LoadMesh(meshSampler);
+	EmissionShapeType shapeType = settings.Shape != EmissionShapeMesh || meshLoaded ? settings.Shape : EmissionShapeGrid;
+
+	emitters = new EmitterManager(settings.MaxParticles);
+	for (int i = 0; i < settings.EmitterCount; ++i)
+	{
+		emitters->AddEmitter(
+			settings.GridSize,
+			settings.EmissionRate / settings.EmitterCount,
+			settings.LifeTime * (i + 1) / settings.EmitterCount,
+			XMFLOAT3(0.0f, 0.0f, 0.0f),
+			XMFLOAT3(0.0f, 0.0f, 0.0f),
+			XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f),
+			XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f)
+		);
+		emitters->GetEmitter(i)->SetShape(MakeShape(shapeType, (float)settings.GridSize, &meshSampler));
+	}
+	emitter = emitters->GetEmitter(0);
+
+	particleSystem = new CPUParticleSystem(settings.MaxParticles);
+	particleSystem->SetThreadCount(settings.ThreadCount);
+	particleSystem->SetUpdateMode(settings.UpdateMode);
+	particleSystem->SetTimeMode(settings.TimeMode);
+
+	if (settings.UpdateMode == ParticleUpdateBallistic)
+		ballisticVertices.resize(settings.MaxParticles);
+
+	// the camera Game::Initialize starts with
+	Camera camera(1280, 720);
+	view = camera.GetViewMatrix();
+	projection = camera.GetProjectionMatrix();
+}
+
+ParticleBenchmark::~ParticleBenchmark()
+{
+	delete particleSystem;
+	delete emitters;
+}
+
+void ParticleBenchmark::Run()
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	UpdateConstants(0.0f, 0.0f);
+
+	float totalTime = 0.0f;
+	if (!settings.RestoreFile.empty())
+	{
+		ParticleCheckpoint checkpoint;
+		restored = checkpoint.Open(settings.RestoreFile) &&
+			checkpoint.Restore(*particleSystem, *emitter, timeConstants, particleConstants);
+
+		restoreSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		totalTime = timeConstants.TotalTime;
+	}
+
+	if (!restored)
+		particleSystem->DeadListInit(particleConstants);
+
+	for (int i = 0; i < settings.FrameCount; ++i)
+	{
+		totalTime += settings.DeltaTime;
+		SimulateFrame(settings.DeltaTime, totalTime);
+		framesRun++;
+	}
+
+	totalSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void ParticleBenchmark::RunFixedSteps(unsigned long long stepCount, unsigned int seed)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	Start();
+
+	FixedTimestep timestep(settings.DeltaTime);
+	unsigned int random = seed;
+
+	while (timestep.GetStepCount() < stepCount)
+	{
+		random = random * 1664525u + 1013904223u;
+		float frameTime = settings.DeltaTime * (0.25f + 2.25f * (float)(random >> 8) / 16777216.0f);
+
+		unsigned long long firstStep = timestep.GetStepCount();
+		int steps = timestep.Advance(frameTime);
+
+		// the last frame may hand out more steps than are left
+		for (int step = 0; step < steps && firstStep + step < stepCount; ++step)
+			SimulateFrame(timestep.GetStepSize(), timestep.GetStepTime(firstStep + step + 1));
+
+		framesRun++;
+	}
+
+	totalSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void ParticleBenchmark::Start()
+{
+	UpdateConstants(0.0f, 0.0f);
+	particleSystem->DeadListInit(particleConstants);
+}
+
+bool ParticleBenchmark::WriteCheckpointReport(std::ostream& out, const std::string& fileName)
+{
+	const int continueFrames = 10;
+
+	out << std::endl << "checkpoint " << fileName << std::endl;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	bool saved = ParticleCheckpoint::Save(fileName, *particleSystem, *emitter, timeConstants, particleConstants);
+	double saveSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	if (!saved)
+	{
+		out << "save FAILED" << std::endl;
+		return false;
+	}
+
+	ParticleBenchmarkSettings restoreSettings = settings;
+	restoreSettings.RestoreFile = fileName;
+	restoreSettings.FrameCount = 0;
+
+	ParticleBenchmark restoredBenchmark(restoreSettings);
+	restoredBenchmark.Run();
+
+	bool identical = restoredBenchmark.restored && restoredBenchmark.GetStateHash() == GetStateHash();
+
+	// both copies have to keep simulating the same way, emitter state and constants included
+	float totalTime = timeConstants.TotalTime;
+	for (int i = 0; i < continueFrames; ++i)
+	{
+		totalTime += settings.DeltaTime;
+		SimulateFrame(settings.DeltaTime, totalTime);
+		restoredBenchmark.SimulateFrame(settings.DeltaTime, totalTime);
+	}
+
+	bool continued = identical && restoredBenchmark.GetStateHash() == GetStateHash();
+
+	ParticleCheckpoint checkpoint;
+	double megabytes = checkpoint.Open(fileName) ? checkpoint.GetHeader().FileSize / (1024.0 * 1024.0) : 0.0;
+
+	out << "size: " << megabytes << " MB  save: " << saveSeconds * 1000.0 << " ms  restore: "
+		<< restoredBenchmark.restoreSeconds * 1000.0 << " ms" << std::endl;
+	out << "restored state: " << (identical ? "identical" : "DIFFERENT")
+		<< "  after " << continueFrames << " more frames: " << (continued ? "identical" : "DIFFERENT") << std::endl;
+
+	return continued;
+}
+
+unsigned long long ParticleBenchmark::GetStateHash() const
+{
+	unsigned long long hash = HashOffsetBasis;
+	hash = HashBytes(hash, particleSystem->GetParticlePool(), sizeof(Particle) * particleSystem->GetMaxParticles());
+	hash = HashBytes(hash, particleSystem->GetDeadList(), sizeof(unsigned int) * particleSystem->GetDeadListCount());
+	hash = HashBytes(hash, particleSystem->GetDrawList(), sizeof(ParticleSort) * particleSystem->GetDrawArgs()[0]);
+	hash = HashBytes(hash, particleSystem->GetDrawArgs(), sizeof(unsigned int) * 9);
+	return hash;
+}
+
+unsigned long long ParticleBenchmark::GetConstantsHash() const
+{
+	return constantsHash;
+}
+
+void ParticleBenchmark::WriteReport(std::ostream& out)
+{
+	const char* stageNames[ParticleStageCount] = { "DeadListInit", "Emit", "Update", "Cull", "DepthSort", "CopyDrawCount", "Evaluate" };
+
+	const char* modeNames[] = { " pool", " alive list", " ring", " ballistic" };
+
+	out << "CPU particle pipeline (" << ParticleUpdateKernel::GetLevelName(particleSystem->GetKernelLevel())
+		<< modeNames[particleSystem->GetUpdateMode()]
+		<< (particleSystem->GetTimeMode() == ParticleTimeBirth ? " birth time" : "")
+		<< " update, " << particleSystem->GetThreadCount() << " threads)" << std::endl;
+	out << "max particles: " << settings.MaxParticles
+		<< "  frames: " << framesRun
+		<< "  dt: " << settings.DeltaTime
+		<< "  emission rate: " << settings.EmissionRate
+		<< "  lifetime: " << settings.LifeTime << std::endl;
+	if (settings.Shape != EmissionShapeGrid)
+	{
+		out << "emission shape: " << EmissionShape::GetTypeName(settings.Shape);
+		if (settings.Shape == EmissionShapeMesh)
+		{
+			if (meshLoaded)
+				out << " (" << meshSampler.GetTriangleCount() << " triangles, area " << meshSampler.GetSurfaceArea() << ")";
+			else
+				out << " (cylinder.obj FAILED to load, grid used)";
+		}
+		out << std::endl;
+	}
+	out << "alive: " << particleSystem->GetDrawArgs()[0]
+		<< "  dead: " << particleSystem->GetDeadListCount()
+		<< "  emit underflows: " << particleSystem->GetEmitUnderflowCount()
+		<< "  invariant failures: " << invariantFailures << std::endl;
+	out << "spawns requested: " << planner.GetRequestedCount()
+		<< "  emitted: " << planner.GetEmittedCount()
+		<< "  dropped: " << planner.GetDroppedCount() << std::endl;
+	if (settings.FrustumCull && framesRun > 0)
+	{
+		out << "per frame visible: " << (double)visibleTotal / framesRun
+			<< "  culled: " << (double)culledTotal / framesRun
+			<< " (" << 100.0 * culledTotal / (std::max)(visibleTotal + culledTotal, 1ull) << "% of the draw list)" << std::endl;
+	}
+	if (emitters->GetEmitterCount() > 1 && framesRun > 0 && settings.UpdateMode != ParticleUpdateBallistic)
+	{
+		out << "drawn per emitter:";
+		for (int i = 0; i < emitters->GetEmitterCount(); ++i)
+			out << " " << particleSystem->GetEmitterDrawArgs()[9 * i];
+		out << std::endl;
+	}
+	out << "wall time: " << totalSeconds << " s" << std::endl;
+	if (!settings.RestoreFile.empty())
+	{
+		out << "restore from " << settings.RestoreFile << ": "
+			<< (restored ? "ok" : "FAILED, started empty") << " in " << restoreSeconds * 1000.0 << " ms" << std::endl;
+	}
+	out << std::endl;
+
+	out << std::left << std::setw(16) << "stage"
+		<< std::setw(12) << "dispatches"
+		<< std::setw(16) << "particles"
+		<< std::setw(14) << "seconds"
+		<< "particles/s" << std::endl;
+
+	for (int i = 0; i < ParticleStageCount; ++i)
+	{
+		const ParticleStageStats& stats = particleSystem->GetStageStats((ParticleStage)i);
+
+		out << std::left << std::setw(16) << stageNames[i]
+			<< std::setw(12) << stats.Dispatches
+			<< std::setw(16) << stats.Particles
+			<< std::setw(14) << stats.Seconds
+			<< stats.ParticlesPerSecond() << std::endl;
+	}
+}
+
+int ParticleBenchmark::RunHeadless(const char* cmdLine, const std::string& reportFile)
+{
+	ParticleBenchmarkSettings settings;
+	settings.ParseCommandLine(cmdLine);
+
+	ParticleBenchmark benchmark(settings);
+	benchmark.Run();
+
+	std::ofstream report(reportFile);
+	if (!report.is_open())
+		return 1;
+
+	benchmark.WriteReport(report);
+
+	bool checkpointPassed = true;
+	if (!settings.CheckpointFile.empty())
+		checkpointPassed = benchmark.WriteCheckpointReport(report, settings.CheckpointFile);
+
+	bool checksPassed = ParticleSelfChecks::Run(report, cmdLine, settings, reportFile);
+
+	return (benchmark.invariantFailures == 0 && checkpointPassed && checksPassed) ? 0 : 1;
+}
+
+void ParticleBenchmark::UpdateConstants(float deltaTime, float totalTime)
+{
+	// same fields as Game::UpdateMainPassCB
+	timeConstants.DeltaTime = deltaTime;
+	timeConstants.TotalTime = totalTime;
+
+	particleConstants.EmitCount = emitter->GetEmitCount();
+	particleConstants.EmitNewestAge = emitter->GetEmitTimeCounter();
+	particleConstants.EmitSpacing = emitter->GetTimeBetweenEmit();
+	particleConstants.MaxParticles = emitter->GetMaxParticles();
+	particleConstants.GridSize = emitter->GetGridSize();
+	particleConstants.LifeTime = emitter->GetLifeTime();
+	particleConstants.velocity = emitter->GetVelocity();
+	particleConstants.acceleration = emitter->GetAcceleration();
+
+	// only the fields set above, the rest of ParticleConstants is never initialized
+	constantsHash = HashBytes(constantsHash, &timeConstants, sizeof(TimeConstants));
+	constantsHash = HashBytes(constantsHash, &particleConstants.EmitCount, sizeof(int) * 3);
+	constantsHash = HashBytes(constantsHash, &particleConstants.LifeTime, sizeof(float));
+	constantsHash = HashBytes(constantsHash, &particleConstants.velocity, sizeof(XMFLOAT3));
+	constantsHash = HashBytes(constantsHash, &particleConstants.acceleration, sizeof(XMFLOAT3));
+	constantsHash = HashBytes(constantsHash, &particleConstants.EmitNewestAge, sizeof(float) * 2);
+}
+
+void ParticleBenchmark::SimulateFrame(float deltaTime, float totalTime)
+{
+	emitters->Update(totalTime, deltaTime);
+	UpdateConstants(deltaTime, totalTime);
+
+	// same emission plan as Game::Draw, once per emitter, here the dead list count is known exactly
+	unsigned long long underflows = particleSystem->GetEmitUnderflowCount();
+	for (int i = 0; i < emitters->GetEmitterCount(); ++i)
+	{
+		Emitter* current = emitters->GetEmitter(i);
+
+		EmissionBatch batch = planner.Plan(*current, particleSystem->GetDeadListCount());
+		if (batch.EmitCount > 0)
+		{
+			UpdateConstants(deltaTime, totalTime);
+			emitters->UpdateConstants();
+
+			particleSystem->Emit(timeConstants, emitters->GetConstants(i), i, &current->GetShape());
+		}
+	}
+
+	// the plan never asks for more than the dead list holds
+	if (particleSystem->GetEmitUnderflowCount() != underflows)
+		invariantFailures++;
+
+	bool shared = emitters->GetEmitterCount() > 1;
+
+	// the ballistic span is drawn with one record whatever emitted it
+	bool ballistic = settings.UpdateMode == ParticleUpdateBallistic;
+
+	particleSystem->ResetDrawList();
+	if (shared)
+		particleSystem->UpdateEmitters(timeConstants, emitters->GetLifeTimes());
+	else
+		particleSystem->Update(timeConstants, particleConstants);
+	if (settings.FrustumCull)
+		particleSystem->CullDrawList(view, projection);
+	if (settings.DepthSort)
+		particleSystem->SortDrawList(view);
+	if (shared && !ballistic)
+		particleSystem->CopyEmitterDrawCounts(emitters->GetEmitterCount());
+	else
+		particleSystem->CopyDrawCount();
+
+	if (ballistic)
+		particleSystem->EvaluateBallistic(timeConstants, particleConstants, shared ? emitters->GetLifeTimes() : nullptr,
+			ballisticVertices.data());
+
+	visibleTotal += particleSystem->GetDrawArgs()[0];
+	culledTotal += particleSystem->GetCulledCount();
+
+	// every pool slot is either on the dead list, culled, a hole in the ring or was drawn this frame
+	if (particleSystem->GetDrawArgs()[0] + particleSystem->GetCulledCount() + particleSystem->GetDeadListCount() +
+		particleSystem->GetRingHoleCount() != (unsigned int)settings.MaxParticles)
+		invariantFailures++;
+
+	// the emitter records tile the draw list and each one only draws its own particles
+	if (shared && !ballistic)
+	{
+		const unsigned int* records = particleSystem->GetEmitterDrawArgs();
+		const ParticleSort* drawList = particleSystem->GetDrawList();
+		const Particle* pool = particleSystem->GetParticlePool();
+
+		unsigned int offset = 0;
+		for (int i = 0; i < emitters->GetEmitterCount(); ++i)
+		{
+			const unsigned int* record = records + 9 * i;
+			if (record[2] != offset)
+				invariantFailures++;
+
+			for (unsigned int v = record[2]; v < record[2] + record[0]; ++v)
+			{
+				const Particle& particle = pool[drawList[v].index];
+				if (particle.EmitterIndex != (unsigned int)i || particleSystem->GetParticleAge(particle) >= emitters->GetLifeTimes()[i])
+				{
+					invariantFailures++;
+					break;
+				}
+			}
+
+			offset += record[0];
+		}
+
+		if (offset != particleSystem->GetDrawArgs()[0])
+			invariantFailures++;
+	}
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include <ostream>
+#include <string>
+#include "CPUParticleSystem.h"
+#include "EmissionPlanner.h"
+#include "EmitterManager.h"
+
+struct ParticleBenchmarkSettings
+{
+	// same emitter as Game::Initialize
+	int MaxParticles = 1000000;
+	int GridSize = 100;
+	float EmissionRate = 1000000.0f;
+	float LifeTime = 1000.0f;
+
+	float DeltaTime = 1.0f / 60.0f;
+	int FrameCount = 600;
+
+	// update threads, 0 uses every hardware thread
+	int ThreadCount = 0;
+
+	// "-alivelist" only updates the compacted live set, "-ring" allocates from a FIFO ring instead of the dead list,
+	// "-ballistic" keeps spawn records in the ring and evaluates them in closed form every frame
+	ParticleUpdateMode UpdateMode = ParticleUpdatePool;
+
+	// "-birthtime" keeps birth times instead of ages in the pool
+	ParticleTimeMode TimeMode = ParticleTimeAge;
+
+	// "-depthsort" orders the draw list back to front every frame, seen from the Game camera
+	bool DepthSort = false;
+
+	// "-cull" drops draw list entries outside the Game camera frustum every frame
+	bool FrustumCull = false;
+
+	// "-emitters=N" splits the emission rate over N emitters sharing the pool, emitter i lives (i + 1) / N
+	// of LifeTime, the update runs once over the pool and CopyDrawCount writes a draw record per emitter
+	// checkpoints only hold the first emitter
+	int EmitterCount = 1;
+
+	// "-shape=sphere|box|disc|cone|mesh" spawns every emitter in that shape instead of the grid,
+	// the mesh is the surface of Resources/Models/cylinder.obj
+	EmissionShapeType Shape = EmissionShapeGrid;
+
+	// "-restore=file" starts from a ParticleCheckpoint, "-checkpoint=file" saves one after the run
+	std::string RestoreFile;
+	std::string CheckpointFile;
+
+	// reads "-particles=N -frames=N -lifetime=S -rate=N -dt=S -threads=N -emitters=N -shape=name" style overrides
+	void ParseCommandLine(const char* cmdLine);
+};
+
+// drives CPUParticleSystem the same way Game::Update/Game::Draw drive the GPU and reports
+// particles per second for every stage, used for soak tests on machines without a GPU
+class ParticleBenchmark
+{
+public:
+	ParticleBenchmark(const ParticleBenchmarkSettings& settings);
+	~ParticleBenchmark();
+
+	void Run();
+	void WriteReport(std::ostream& out);
+
+	// runs exactly stepCount fixed steps of settings.DeltaTime through a FixedTimestep, fed with frame times
+	// between a quarter and two and a half steps drawn from seed, the pacing changes with the seed but the steps don't
+	void RunFixedSteps(unsigned long long stepCount, unsigned int seed);
+
+	// saves a checkpoint of the current state, restores it into a second benchmark and checks that both
+	// continue identically for a few frames, returns false on any difference
+	bool WriteCheckpointReport(std::ostream& out, const std::string& fileName);
+
+	// FNV-1a over the pool, the dead list, the draw list and the draw arguments
+	unsigned long long GetStateHash() const;
+
+	// FNV-1a over every set of constants the benchmark "uploaded", in upload order
+	unsigned long long GetConstantsHash() const;
+
+	// sets the constants of time 0 and fills the dead list, Run and RunFixedSteps start with it and a caller that
+	// drives SimulateFrame itself calls it once first
+	void Start();
+
+	// one frame of Game::Update and Game::Draw, the emitters, the constants upload and the CPU pipeline
+	void SimulateFrame(float deltaTime, float totalTime);
+
+	const CPUParticleSystem& GetParticleSystem() const { return *particleSystem; }
+	const EmissionPlanner& GetPlanner() const { return planner; }
+	int GetFramesRun() const { return framesRun; }
+	int GetInvariantFailures() const { return invariantFailures; }
+
+	// the shapes cover about the space of the grid emitter, in front of the Game camera
+	static EmissionShape MakeShape(EmissionShapeType type, float gridSize, const MeshSurfaceSampler* mesh);
+
+	// the surface of Resources/Models/cylinder.obj
+	static bool LoadMesh(MeshSurfaceSampler& sampler);
+
+	// entry point for "-headless", writes the report next to the executable, then the checkpoint round trip
+	// with "-checkpoint=file" and the ParticleSelfChecks named on the command line
+	static int RunHeadless(const char* cmdLine, const std::string& reportFile);
+
+private:
+	ParticleBenchmarkSettings settings;
+
+	int framesRun;
+	int invariantFailures;
+	unsigned long long visibleTotal;
+	unsigned long long culledTotal;
+	double totalSeconds;
+	double restoreSeconds;
+	bool restored;
+	unsigned long long constantsHash;
+
+	EmitterManager* emitters;
+
+	// the first emitter, the one Game::Initialize creates
+	Emitter* emitter;
+
+	// shared by every emitter with the mesh shape
+	MeshSurfaceSampler meshSampler;
+	bool meshLoaded;
+
+	// plans every emitter's batch against the live dead list count
+	EmissionPlanner planner;
+	CPUParticleSystem* particleSystem;
+
+	// what EvaluateBallistic hands the vertex shader in ballistic mode
+	std::vector<ParticleVertex> ballisticVertices;
+
+	TimeConstants timeConstants;
+	ParticleConstants particleConstants;
+	DirectX::XMFLOAT4X4 view;
+	DirectX::XMFLOAT4X4 projection;
+
+	void UpdateConstants(float deltaTime, float totalTime);
+};
@@ -0,0 +1,222 @@
+#include "ParticleCheckpoint.h"
+#include <cstring>
+#include <vector>
+
+ParticleCheckpoint::ParticleCheckpoint()
+{
+	file = INVALID_HANDLE_VALUE;
+	mapping = nullptr;
+	view = nullptr;
+	header = nullptr;
+}
+
+ParticleCheckpoint::~ParticleCheckpoint()
+{
+	Close();
+}
+
+bool ParticleCheckpoint::Save(const std::string& fileName, const CPUParticleSystem& particleSystem, Emitter& emitter,
+	const TimeConstants& timeConstants, const ParticleConstants& particleConstants)
+{
+	int maxParticles = particleSystem.GetMaxParticles();
+
+	ParticleCheckpointHeader fileHeader = {};
+
+	fileHeader.Magic = ParticleCheckpointHeader::MagicValue;
+	fileHeader.Version = ParticleCheckpointHeader::CurrentVersion;
+	fileHeader.HeaderSize = sizeof(ParticleCheckpointHeader);
+	fileHeader.ParticleSize = sizeof(Particle);
+
+	fileHeader.MaxParticles = maxParticles;
+	fileHeader.DeadListCounter = particleSystem.GetDeadListCount();
+	fileHeader.DrawListCounter = particleSystem.GetDrawListCount();
+
+	// the alive list order decides the draw list order of the next update, so it is kept as well
+	const AliveList& aliveList = particleSystem.GetAliveList();
+	if (particleSystem.GetUpdateMode() == ParticleUpdateAliveList)
+		fileHeader.AliveListCount = aliveList.GetCount();
+
+	fileHeader.EmitCount = emitter.GetEmitCount();
+	fileHeader.GridSize = emitter.GetGridSize();
+	fileHeader.LifeTime = emitter.GetLifeTime();
+	fileHeader.TimeBetweenEmit = emitter.GetTimeBetweenEmit();
+	fileHeader.EmitTimeCounter = emitter.GetEmitTimeCounter();
+
+	fileHeader.TimeMode = particleSystem.GetTimeMode();
+	fileHeader.ClockTime = particleSystem.GetPoolClock();
+
+	fileHeader.Time = timeConstants;
+	fileHeader.Particles = particleConstants;
+
+	// the lists are stored whole, like the GPU buffers, so a restore is a straight copy
+	fileHeader.ParticlePoolOffset = AlignSection(sizeof(ParticleCheckpointHeader));
+	fileHeader.DeadListOffset = AlignSection(fileHeader.ParticlePoolOffset + sizeof(Particle) * (unsigned long long)maxParticles);
+	fileHeader.DrawListOffset = AlignSection(fileHeader.DeadListOffset + sizeof(unsigned int) * (unsigned long long)maxParticles);
+	fileHeader.DrawArgsOffset = AlignSection(fileHeader.DrawListOffset + sizeof(ParticleSort) * (unsigned long long)maxParticles);
+	fileHeader.AliveListOffset = AlignSection(fileHeader.DrawArgsOffset + sizeof(unsigned int) * 9);
+	fileHeader.FileSize = fileHeader.AliveListOffset + sizeof(unsigned int) * (unsigned long long)fileHeader.AliveListCount;
+
+	// build the whole file in memory so it goes out in one sequential write
+	std::vector<unsigned char> buffer((size_t)fileHeader.FileSize, 0);
+	memcpy(buffer.data(), &fileHeader, sizeof(fileHeader));
+	memcpy(buffer.data() + fileHeader.ParticlePoolOffset, particleSystem.GetParticlePool(), sizeof(Particle) * maxParticles);
+	memcpy(buffer.data() + fileHeader.DeadListOffset, particleSystem.GetDeadList(), sizeof(unsigned int) * maxParticles);
+	memcpy(buffer.data() + fileHeader.DrawListOffset, particleSystem.GetDrawList(), sizeof(ParticleSort) * maxParticles);
+	memcpy(buffer.data() + fileHeader.DrawArgsOffset, particleSystem.GetDrawArgs(), sizeof(unsigned int) * 9);
+	memcpy(buffer.data() + fileHeader.AliveListOffset, aliveList.GetIndices(), sizeof(unsigned int) * fileHeader.AliveListCount);
+
+	HANDLE output = CreateFileA(fileName.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (output == INVALID_HANDLE_VALUE)
+		return false;
+
+	// WriteFile takes a 32-bit size, anything past 4 GB still goes out in order
+	bool written = true;
+	unsigned long long offset = 0;
+	while (written && offset < fileHeader.FileSize)
+	{
+		DWORD chunk = (DWORD)min(fileHeader.FileSize - offset, 1ull << 30);
+		DWORD chunkWritten = 0;
+		written = WriteFile(output, buffer.data() + offset, chunk, &chunkWritten, nullptr) && chunkWritten == chunk;
+		offset += chunk;
+	}
+
+	CloseHandle(output);
+	return written;
+}
+
+bool ParticleCheckpoint::Open(const std::string& fileName)
+{
+	Close();
+
+	file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || (unsigned long long)fileSize.QuadPart < sizeof(ParticleCheckpointHeader))
+	{
+		Close();
+		return false;
+	}
+
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	view = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (view == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	header = reinterpret_cast<const ParticleCheckpointHeader*>(view);
+
+	// a checkpoint from another build of the structs is refused rather than misread,
+	// CopyDrawCount leaves the draw list counter one past a full pool
+	if (header->Magic != ParticleCheckpointHeader::MagicValue ||
+		header->Version != ParticleCheckpointHeader::CurrentVersion ||
+		header->HeaderSize != sizeof(ParticleCheckpointHeader) ||
+		header->ParticleSize != sizeof(Particle) ||
+		header->FileSize > (unsigned long long)fileSize.QuadPart ||
+		header->MaxParticles <= 0 ||
+		header->TimeMode > ParticleTimeBirth ||
+		header->DeadListCounter > (unsigned int)header->MaxParticles ||
+		header->DrawListCounter > (unsigned int)header->MaxParticles + 1 ||
+		header->AliveListCount > (unsigned int)header->MaxParticles)
+	{
+		Close();
+		return false;
+	}
+
+	// the accessors point straight into the view, so every section has to lie inside the file
+	unsigned long long maxParticles = (unsigned long long)header->MaxParticles;
+	if (!SectionFits(header->ParticlePoolOffset, sizeof(Particle) * maxParticles, header->FileSize) ||
+		!SectionFits(header->DeadListOffset, sizeof(unsigned int) * maxParticles, header->FileSize) ||
+		!SectionFits(header->DrawListOffset, sizeof(ParticleSort) * maxParticles, header->FileSize) ||
+		!SectionFits(header->DrawArgsOffset, sizeof(unsigned int) * 9, header->FileSize) ||
+		!SectionFits(header->AliveListOffset, sizeof(unsigned int) * (unsigned long long)header->AliveListCount, header->FileSize))
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void ParticleCheckpoint::Close()
+{
+	if (view != nullptr)
+		UnmapViewOfFile(view);
+
+	if (mapping != nullptr)
+		CloseHandle(mapping);
+
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+
+	file = INVALID_HANDLE_VALUE;
+	mapping = nullptr;
+	view = nullptr;
+	header = nullptr;
+}
+
+bool ParticleCheckpoint::IsOpen() const
+{
+	return header != nullptr;
+}
+
+const ParticleCheckpointHeader& ParticleCheckpoint::GetHeader() const
+{
+	return *header;
+}
+
+const Particle* ParticleCheckpoint::GetParticlePool() const
+{
+	return reinterpret_cast<const Particle*>(view + header->ParticlePoolOffset);
+}
+
+const unsigned int* ParticleCheckpoint::GetDeadList() const
+{
+	return reinterpret_cast<const unsigned int*>(view + header->DeadListOffset);
+}
+
+const ParticleSort* ParticleCheckpoint::GetDrawList() const
+{
+	return reinterpret_cast<const ParticleSort*>(view + header->DrawListOffset);
+}
+
+const unsigned int* ParticleCheckpoint::GetDrawArgs() const
+{
+	return reinterpret_cast<const unsigned int*>(view + header->DrawArgsOffset);
+}
+
+const unsigned int* ParticleCheckpoint::GetAliveList() const
+{
+	return reinterpret_cast<const unsigned int*>(view + header->AliveListOffset);
+}
+
+bool ParticleCheckpoint::Restore(CPUParticleSystem& particleSystem, Emitter& emitter,
+	TimeConstants& timeConstants, ParticleConstants& particleConstants) const
+{
+	if (!IsOpen() || header->MaxParticles != particleSystem.GetMaxParticles() || header->MaxParticles != emitter.GetMaxParticles())
+		return false;
+
+	particleSystem.RestoreState(GetParticlePool(), GetDeadList(), header->DeadListCounter,
+		GetDrawList(), header->DrawListCounter, GetDrawArgs(),
+		header->AliveListCount > 0 ? GetAliveList() : nullptr, header->AliveListCount);
+	particleSystem.RestoreClock((ParticleTimeMode)header->TimeMode, header->ClockTime);
+
+	emitter.SetEmitCount(header->EmitCount);
+	emitter.SetEmitTimeCounter(header->EmitTimeCounter);
+
+	timeConstants = header->Time;
+	particleConstants = header->Particles;
+
+	return true;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <Windows.h>
+#include <string>
+#include "CPUParticleSystem.h"
+#include "Emitter.h"
+#include "FrameResource.h"
+
+// everything after the header is stored exactly as it sits in memory, so a mapped checkpoint needs no parsing
+// every section starts on a SectionAlignment boundary and its offset is recorded in the header
+struct ParticleCheckpointHeader
+{
+	static const unsigned int MagicValue = 0x504b4350; // "PCKP"
+	// 2 keeps the time mode and clock in what was padding, 3 adds EmitNewestAge and EmitSpacing to ParticleConstants
+	static const unsigned int CurrentVersion = 3;
+
+	unsigned int Magic;
+	unsigned int Version;
+	unsigned int HeaderSize;
+	unsigned int ParticleSize;
+
+	// CPUParticleSystem
+	int MaxParticles;
+	unsigned int DeadListCounter;
+	unsigned int DrawListCounter;
+	unsigned int AliveListCount;
+
+	// Emitter
+	int EmitCount;
+	int GridSize;
+	float LifeTime;
+	float TimeBetweenEmit;
+	float EmitTimeCounter;
+
+	// CPUParticleSystem clock, with ParticleTimeBirth the pool holds birth times on it
+	unsigned int TimeMode;
+	float ClockTime;
+	unsigned int Padding1;
+
+	TimeConstants Time;
+	ParticleConstants Particles;
+
+	unsigned long long ParticlePoolOffset;
+	unsigned long long DeadListOffset;
+	unsigned long long DrawListOffset;
+	unsigned long long DrawArgsOffset;
+	unsigned long long AliveListOffset;
+	unsigned long long FileSize;
+};
+
+// versioned binary snapshot of the particle pipeline, written with one sequential write and read back
+// through a read-only file mapping, the pool, lists and draw arguments can be used straight from the mapping
+class ParticleCheckpoint
+{
+public:
+	static const unsigned long long SectionAlignment = 64;
+
+	ParticleCheckpoint();
+	ParticleCheckpoint(const ParticleCheckpoint& rhs) = delete;
+	ParticleCheckpoint& operator=(const ParticleCheckpoint& rhs) = delete;
+	~ParticleCheckpoint();
+
+	static bool Save(const std::string& fileName, const CPUParticleSystem& particleSystem, Emitter& emitter,
+		const TimeConstants& timeConstants, const ParticleConstants& particleConstants);
+
+	// maps the file and checks the header, fails on a different version, a truncated file
+	// or a section that doesn't lie within the file
+	bool Open(const std::string& fileName);
+	void Close();
+	bool IsOpen() const;
+
+	const ParticleCheckpointHeader& GetHeader() const;
+	const Particle* GetParticlePool() const;
+	const unsigned int* GetDeadList() const;
+	const ParticleSort* GetDrawList() const;
+	const unsigned int* GetDrawArgs() const;
+
+	// only saved from a particle system in ParticleUpdateAliveList mode, AliveListCount is 0 otherwise
+	const unsigned int* GetAliveList() const;
+
+	// copies the mapped state into a particle system and emitter of the same size
+	bool Restore(CPUParticleSystem& particleSystem, Emitter& emitter,
+		TimeConstants& timeConstants, ParticleConstants& particleConstants) const;
+
+private:
+	HANDLE file;
+	HANDLE mapping;
+	const unsigned char* view;
+	const ParticleCheckpointHeader* header;
+
+	static unsigned long long AlignSection(unsigned long long offset)
+	{
+		return (offset + SectionAlignment - 1) & ~(SectionAlignment - 1);
+	}
+
+	// an aligned section after the header whose size bytes end within fileSize
+	static bool SectionFits(unsigned long long offset, unsigned long long size, unsigned long long fileSize)
+	{
+		return offset >= sizeof(ParticleCheckpointHeader) && offset % SectionAlignment == 0 &&
+			offset <= fileSize && size <= fileSize - offset;
+	}
+};
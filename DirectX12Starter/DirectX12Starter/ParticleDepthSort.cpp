@@ -0,0 +1,155 @@
+#include "ParticleDepthSort.h"
+#include <cstring>
+#include <functional>
+
+using namespace DirectX;
+
+namespace
+{
+	const int RadixBits = 8;
+	const int RadixSize = 1 << RadixBits;
+	const int RadixPasses = 32 / RadixBits;
+
+	void ForEachChunk(WorkStealingScheduler* scheduler, unsigned int chunkCount, const std::function<void(unsigned int)>& task)
+	{
+		if (scheduler != nullptr)
+		{
+			scheduler->ParallelFor(chunkCount, [&](unsigned int chunk, int threadIndex) { task(chunk); });
+			return;
+		}
+
+		for (unsigned int chunk = 0; chunk < chunkCount; ++chunk)
+			task(chunk);
+	}
+}
+
+ParticleDepthSort::ParticleDepthSort(int maxParticles)
+{
+	for (int i = 0; i < 2; ++i)
+	{
+		keys[i].resize(maxParticles);
+		indices[i].resize(maxParticles);
+	}
+
+	skippedPasses = 0;
+}
+
+void ParticleDepthSort::Sort(const Particle* particlePool, ParticleSort* drawList, unsigned int count,
+	const XMFLOAT4X4& view, WorkStealingScheduler* scheduler)
+{
+	skippedPasses = 0;
+
+	if (count < 2)
+		return;
+
+	unsigned int chunkCount = (count + ChunkSize - 1) / ChunkSize;
+	chunkCounts.resize(chunkCount * RadixSize);
+	chunkOffsets.resize(chunkCount * RadixSize);
+
+	int current = 0;
+
+	ForEachChunk(scheduler, chunkCount, [&](unsigned int chunk)
+	{
+		unsigned int begin = chunk * ChunkSize;
+		unsigned int end = min(begin + ChunkSize, count);
+
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			unsigned int index = drawList[i].index;
+			keys[0][i] = DepthKey(ViewDepth(particlePool[index].Position, view));
+			indices[0][i] = index;
+		}
+	});
+
+	for (int pass = 0; pass < RadixPasses; ++pass)
+	{
+		int shift = pass * RadixBits;
+		const unsigned int* sourceKeys = keys[current].data();
+		const unsigned int* sourceIndices = indices[current].data();
+
+		ForEachChunk(scheduler, chunkCount, [&](unsigned int chunk)
+		{
+			unsigned int begin = chunk * ChunkSize;
+			unsigned int end = min(begin + ChunkSize, count);
+			unsigned int* counts = chunkCounts.data() + chunk * RadixSize;
+
+			memset(counts, 0, sizeof(unsigned int) * RadixSize);
+			for (unsigned int i = begin; i < end; ++i)
+				counts[(sourceKeys[i] >> shift) & (RadixSize - 1)]++;
+		});
+
+		// digit major, chunk minor, so every chunk scatters its share of a digit after the chunks before it
+		unsigned int offset = 0;
+		bool trivial = false;
+		for (int digit = 0; digit < RadixSize; ++digit)
+		{
+			unsigned int digitCount = 0;
+			for (unsigned int chunk = 0; chunk < chunkCount; ++chunk)
+			{
+				chunkOffsets[chunk * RadixSize + digit] = offset;
+				offset += chunkCounts[chunk * RadixSize + digit];
+				digitCount += chunkCounts[chunk * RadixSize + digit];
+			}
+
+			if (digitCount == count)
+				trivial = true;
+		}
+
+		// all keys share this digit, e.g. the sign and exponent byte of nearby depths
+		if (trivial)
+		{
+			skippedPasses++;
+			continue;
+		}
+
+		unsigned int* destinationKeys = keys[1 - current].data();
+		unsigned int* destinationIndices = indices[1 - current].data();
+
+		ForEachChunk(scheduler, chunkCount, [&](unsigned int chunk)
+		{
+			unsigned int begin = chunk * ChunkSize;
+			unsigned int end = min(begin + ChunkSize, count);
+			unsigned int* offsets = chunkOffsets.data() + chunk * RadixSize;
+
+			for (unsigned int i = begin; i < end; ++i)
+			{
+				unsigned int destination = offsets[(sourceKeys[i] >> shift) & (RadixSize - 1)]++;
+				destinationKeys[destination] = sourceKeys[i];
+				destinationIndices[destination] = sourceIndices[i];
+			}
+		});
+
+		current = 1 - current;
+	}
+
+	const unsigned int* sorted = indices[current].data();
+	ForEachChunk(scheduler, chunkCount, [&](unsigned int chunk)
+	{
+		unsigned int begin = chunk * ChunkSize;
+		unsigned int end = min(begin + ChunkSize, count);
+
+		for (unsigned int i = begin; i < end; ++i)
+			drawList[i].index = sorted[i];
+	});
+}
+
+int ParticleDepthSort::GetSkippedPasses() const
+{
+	return skippedPasses;
+}
+
+float ParticleDepthSort::ViewDepth(const XMFLOAT3& position, const XMFLOAT4X4& view)
+{
+	return position.x * view._13 + position.y * view._23 + position.z * view._33 + view._43;
+}
+
+unsigned int ParticleDepthSort::DepthKey(float depth)
+{
+	unsigned int bits;
+	memcpy(&bits, &depth, sizeof(float));
+
+	// flip negatives entirely and positives' sign bit so unsigned order matches float order,
+	// then invert so the largest depth comes first
+	unsigned int ascending = (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+	return ~ascending;
+}
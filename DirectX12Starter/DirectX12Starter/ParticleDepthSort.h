@@ -0,0 +1,40 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "Emitter.h"
+#include "WorkStealingScheduler.h"
+
+// back-to-front ordering of a draw list for alpha blending
+// every drawn particle gets its view space depth turned into a 32-bit key whose unsigned order is far to near,
+// then an LSD radix sort over 8-bit digits orders the keys, each pass builds one histogram per chunk and scatters
+// the chunks in parallel to offsets from a prefix sum, so the sort is stable and needs no comparisons
+class ParticleDepthSort
+{
+public:
+	static const unsigned int ChunkSize = 65536;
+
+	ParticleDepthSort(int maxParticles);
+
+	// reorders drawList[0, count) back to front for the given view matrix, equal depths keep their order
+	// without a scheduler the chunks run on the calling thread
+	void Sort(const Particle* particlePool, ParticleSort* drawList, unsigned int count,
+		const DirectX::XMFLOAT4X4& view, WorkStealingScheduler* scheduler);
+
+	// radix passes skipped on the last sort because every key had the same digit
+	int GetSkippedPasses() const;
+
+	// z of the particle position in view space, the view matrices are left-handed row-vector matrices
+	static float ViewDepth(const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT4X4& view);
+
+	// unsigned key that sorts the deepest particle first
+	static unsigned int DepthKey(float depth);
+
+private:
+	std::vector<unsigned int> keys[2];
+	std::vector<unsigned int> indices[2];
+
+	std::vector<unsigned int> chunkCounts;
+	std::vector<unsigned int> chunkOffsets;
+
+	int skippedPasses;
+};
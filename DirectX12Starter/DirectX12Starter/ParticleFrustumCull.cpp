@@ -0,0 +1,153 @@
+#include "FloatContraction.h"
+#include "ParticleFrustumCull.h"
+#include "SimdMath.h"
+#include <cmath>
+
+using namespace DirectX;
+
+ParticleFrustumCuller::ParticleFrustumCuller()
+{
+	// until SetMatrices is called every plane keeps everything
+	for (int i = 0; i < PlaneCount; ++i)
+		planes[i] = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+void ParticleFrustumCuller::SetMatrices(const XMFLOAT4X4& view, const XMFLOAT4X4& projection)
+{
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&projection)));
+
+	// with row vectors clip = p * m, so each clip coordinate is a column of m, and D3D clips to
+	// -w <= x <= w, -w <= y <= w, 0 <= z <= w
+	planes[PlaneLeft] = XMFLOAT4(m._14 + m._11, m._24 + m._21, m._34 + m._31, m._44 + m._41);
+	planes[PlaneRight] = XMFLOAT4(m._14 - m._11, m._24 - m._21, m._34 - m._31, m._44 - m._41);
+	planes[PlaneBottom] = XMFLOAT4(m._14 + m._12, m._24 + m._22, m._34 + m._32, m._44 + m._42);
+	planes[PlaneTop] = XMFLOAT4(m._14 - m._12, m._24 - m._22, m._34 - m._32, m._44 - m._42);
+	planes[PlaneNear] = XMFLOAT4(m._13, m._23, m._33, m._43);
+	planes[PlaneFar] = XMFLOAT4(m._14 - m._13, m._24 - m._23, m._34 - m._33, m._44 - m._43);
+
+	for (int i = 0; i < PlaneCount; ++i)
+	{
+		XMFLOAT4& plane = planes[i];
+		float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		plane = XMFLOAT4(plane.x / length, plane.y / length, plane.z / length, plane.w / length);
+	}
+}
+
+const XMFLOAT4& ParticleFrustumCuller::GetPlane(Plane plane) const
+{
+	return planes[plane];
+}
+
+unsigned int ParticleFrustumCuller::Cull(ParticleKernelLevel level, const Particle* particlePool, const ParticleSort* drawList, unsigned int count,
+	ParticleSort* visibleList) const
+{
+	switch (level)
+	{
+	case ParticleKernelAVX2:
+		return CullAVX2(particlePool, drawList, count, visibleList);
+	case ParticleKernelSSE4:
+		return CullSSE4(particlePool, drawList, count, visibleList);
+	default:
+		return CullScalar(particlePool, drawList, count, visibleList);
+	}
+}
+
+unsigned int ParticleFrustumCuller::CullScalar(const Particle* particlePool, const ParticleSort* drawList, unsigned int count,
+	ParticleSort* visibleList) const
+{
+	unsigned int visible = 0;
+
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		unsigned int index = drawList[i].index;
+		if (IsVisible(particlePool[index]))
+			visibleList[visible++].index = index;
+	}
+
+	return visible;
+}
+
+unsigned int ParticleFrustumCuller::CullSSE4(const Particle* particlePool, const ParticleSort* drawList, unsigned int count,
+	ParticleSort* visibleList) const
+{
+	return CullBatches<SimdSSE4>(particlePool, drawList, count, visibleList);
+}
+
+unsigned int ParticleFrustumCuller::CullAVX2(const Particle* particlePool, const ParticleSort* drawList, unsigned int count,
+	ParticleSort* visibleList) const
+{
+	return CullBatches<SimdAVX2>(particlePool, drawList, count, visibleList);
+}
+
+bool ParticleFrustumCuller::IsVisible(const Particle& particle) const
+{
+	for (int i = 0; i < PlaneCount; ++i)
+	{
+		const XMFLOAT4& plane = planes[i];
+		float distance = plane.x * particle.Position.x + plane.y * particle.Position.y + plane.z * particle.Position.z + plane.w;
+
+		// completely behind this plane
+		if (distance + particle.Size < 0.0f)
+			return false;
+	}
+
+	return true;
+}
+
+template<typename Simd>
+unsigned int ParticleFrustumCuller::CullBatches(const Particle* particlePool, const ParticleSort* drawList, unsigned int count,
+	ParticleSort* visibleList) const
+{
+	typedef typename Simd::Float Float;
+	const int Width = Simd::Width;
+
+	const Float zero = Simd::Zero();
+	unsigned int visible = 0;
+
+	unsigned int i = 0;
+	for (; i + Width <= count; i += Width)
+	{
+		unsigned int indices[Width];
+		float x[Width], y[Width], z[Width], radius[Width];
+
+		// the batch is read before any of it is written, so culling in place is safe
+		for (int k = 0; k < Width; ++k)
+		{
+			indices[k] = drawList[i + k].index;
+			const Particle& particle = particlePool[indices[k]];
+			x[k] = particle.Position.x;
+			y[k] = particle.Position.y;
+			z[k] = particle.Position.z;
+			radius[k] = particle.Size;
+		}
+
+		Float positionX = Simd::Load(x);
+		Float positionY = Simd::Load(y);
+		Float positionZ = Simd::Load(z);
+		Float size = Simd::Load(radius);
+
+		// same operation order as IsVisible
+		Float outside = zero;
+		for (int p = 0; p < PlaneCount; ++p)
+		{
+			Float distance = Simd::Add(Simd::Add(Simd::Add(
+				Simd::Mul(Simd::Set1(planes[p].x), positionX),
+				Simd::Mul(Simd::Set1(planes[p].y), positionY)),
+				Simd::Mul(Simd::Set1(planes[p].z), positionZ)),
+				Simd::Set1(planes[p].w));
+
+			outside = Simd::Or(outside, Simd::CmpLt(Simd::Add(distance, size), zero));
+		}
+
+		int outsideMask = Simd::MoveMask(outside);
+		for (int k = 0; k < Width; ++k)
+		{
+			if ((outsideMask & (1 << k)) == 0)
+				visibleList[visible++].index = indices[k];
+		}
+	}
+
+	// visibleList can't overtake drawList, the tail still reads entries at or after the ones it writes
+	return visible + CullScalar(particlePool, drawList + i, count - i, visibleList + visible);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <DirectXMath.h>
+#include "Emitter.h"
+#include "ParticleUpdateKernel.h"
+
+// draw list culling against the six planes of the camera frustum
+// a particle is a sphere at Position with Size as its radius and is kept unless it lies entirely outside one plane,
+// the SIMD kernels test 4 or 8 particles against all planes at once and keep the surviving indices in order
+class ParticleFrustumCuller
+{
+public:
+	enum Plane
+	{
+		PlaneLeft,
+		PlaneRight,
+		PlaneBottom,
+		PlaneTop,
+		PlaneNear,
+		PlaneFar,
+		PlaneCount
+	};
+
+	ParticleFrustumCuller();
+
+	// planes of view * projection with normals pointing inwards and unit length, so a plane equation is a distance
+	void SetMatrices(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection);
+	const DirectX::XMFLOAT4& GetPlane(Plane plane) const;
+
+	// copies the visible entries of drawList[0, count) to visibleList and returns how many there are,
+	// visibleList may be drawList itself
+	unsigned int Cull(ParticleKernelLevel level, const Particle* particlePool, const ParticleSort* drawList, unsigned int count,
+		ParticleSort* visibleList) const;
+
+	unsigned int CullScalar(const Particle* particlePool, const ParticleSort* drawList, unsigned int count,
+		ParticleSort* visibleList) const;
+	unsigned int CullSSE4(const Particle* particlePool, const ParticleSort* drawList, unsigned int count,
+		ParticleSort* visibleList) const;
+	unsigned int CullAVX2(const Particle* particlePool, const ParticleSort* drawList, unsigned int count,
+		ParticleSort* visibleList) const;
+
+	bool IsVisible(const Particle& particle) const;
+
+private:
+	DirectX::XMFLOAT4 planes[PlaneCount];
+
+	template<typename Simd>
+	unsigned int CullBatches(const Particle* particlePool, const ParticleSort* drawList, unsigned int count,
+		ParticleSort* visibleList) const;
+};
@@ -7,7 +7,8 @@ struct Particle
 	float3 Velocity;
 	float Size;
 	float Alive;
-	float3 Padding;
+	uint EmitterIndex;
+	float2 Padding;
 };
 
 struct ParticleDraw
@@ -0,0 +1,84 @@
+#include "ParticleNoiseLod.h"
+
+using namespace DirectX;
+
+ParticleNoiseLod::ParticleNoiseLod()
+{
+	bandCount = 1;
+	maxDistancesSquared[0] = FLT_MAX;
+	eye = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	frame = 0;
+}
+
+bool ParticleNoiseLod::SetBands(const ParticleNoiseLodBand* newBands, int count)
+{
+	if (count < 1 || count > MaxBands)
+		return false;
+
+	for (int band = 0; band < count; ++band)
+	{
+		if (newBands[band].RefreshFrames == 0 || !(newBands[band].MaxDistance > 0.0f))
+			return false;
+
+		if (band > 0 && !(newBands[band].MaxDistance > newBands[band - 1].MaxDistance))
+			return false;
+	}
+
+	for (int band = 0; band < count; ++band)
+	{
+		bands[band] = newBands[band];
+
+		// the square of a large distance would overflow to infinity, which still compares correctly
+		float distance = bands[band].MaxDistance;
+		maxDistancesSquared[band] = distance * distance;
+	}
+
+	bandCount = count;
+	return true;
+}
+
+int ParticleNoiseLod::GetBandCount() const
+{
+	return bandCount;
+}
+
+const ParticleNoiseLodBand& ParticleNoiseLod::GetBand(int band) const
+{
+	return bands[band];
+}
+
+void ParticleNoiseLod::BeginFrame(XMFLOAT3 frameEye)
+{
+	eye = frameEye;
+	frame++;
+}
+
+XMFLOAT3 ParticleNoiseLod::GetEye() const
+{
+	return eye;
+}
+
+unsigned int ParticleNoiseLod::GetFrame() const
+{
+	return frame;
+}
+
+int ParticleNoiseLod::FindBand(XMFLOAT3 position) const
+{
+	float dx = position.x - eye.x;
+	float dy = position.y - eye.y;
+	float dz = position.z - eye.z;
+	float distanceSquared = dx * dx + dy * dy + dz * dz;
+
+	int band = 0;
+	while (band < bandCount - 1 && !(distanceSquared < maxDistancesSquared[band]))
+		band++;
+
+	return band;
+}
+
+bool ParticleNoiseLod::Refreshes(int band, unsigned int id) const
+{
+	unsigned int refreshFrames = bands[band].RefreshFrames;
+	return refreshFrames == 1 || (id / BlockSize + frame) % refreshFrames == 0;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cfloat>
+
+// where the particles of a band take their curl velocity from
+enum ParticleNoiseLodSource
+{
+	// curlNoise3D like UpdateComputeShader
+	ParticleNoiseLodNoise,
+
+	// the CurlVolume set on the system, the noise when there is none
+	ParticleNoiseLodVolume
+};
+
+// the particles from the end of the band before out to MaxDistance from the camera
+struct ParticleNoiseLodBand
+{
+	float MaxDistance = FLT_MAX;
+	ParticleNoiseLodSource Source = ParticleNoiseLodNoise;
+
+	// the curl is taken on one frame in RefreshFrames, in between the particle keeps the velocity it has
+	unsigned int RefreshFrames = 1;
+};
+
+// noise level of detail for the particle update, keyed on the distance from the camera
+// particles are refreshed in blocks of BlockSize consecutive pool slots, block b on the frames where
+// (b + frame) % RefreshFrames == 0, so a SIMD batch nearly always refreshes or holds as a whole
+// and the band costs 1 / RefreshFrames of its evaluations on every frame instead of all of them every few frames
+class ParticleNoiseLod
+{
+public:
+	static const int MaxBands = 4;
+	static const unsigned int BlockSize = 16;
+
+	// one band with the noise on every frame, the same update as without level of detail
+	ParticleNoiseLod();
+
+	// bands in increasing distance, particles past the last band use the last band
+	// returns false and keeps the current bands when count is out of range, the distances don't increase
+	// or a band refreshes every 0 frames
+	bool SetBands(const ParticleNoiseLodBand* bands, int count);
+	int GetBandCount() const;
+	const ParticleNoiseLodBand& GetBand(int band) const;
+
+	// once per frame before the update, the camera position of the frame and the next step of the refresh cycle
+	void BeginFrame(DirectX::XMFLOAT3 eye);
+	DirectX::XMFLOAT3 GetEye() const;
+	unsigned int GetFrame() const;
+
+	// the band of a particle at position, from the squared distance so no square root per particle
+	int FindBand(DirectX::XMFLOAT3 position) const;
+
+	// whether the particle in pool slot id takes the curl on this frame in band
+	bool Refreshes(int band, unsigned int id) const;
+
+private:
+	ParticleNoiseLodBand bands[MaxBands];
+	float maxDistancesSquared[MaxBands];
+	int bandCount;
+
+	DirectX::XMFLOAT3 eye;
+	unsigned int frame;
+};
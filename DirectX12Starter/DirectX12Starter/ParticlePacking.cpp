@@ -0,0 +1,276 @@
+#include "ParticlePacking.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <immintrin.h>
+#include <intrin.h>
+
+using namespace DirectX;
+
+static_assert(sizeof(PackedParticle) == 32, "PackedParticle must stay half the size of Particle");
+static_assert(offsetof(PackedParticle, Size) == offsetof(PackedParticle, Velocity) + 6, "Velocity and Size are converted as one row");
+
+namespace
+{
+	const size_t ColorRow = offsetof(Particle, Color) / sizeof(float);
+	const size_t VelocityRow = offsetof(Particle, Velocity) / sizeof(float);
+
+	// cpuid is slow enough, especially under a hypervisor, to show up when Update asks per batch
+	bool UseF16C(ParticleKernelLevel level)
+	{
+		static const bool hasF16C = ParticlePacking::HasF16C();
+		return level == ParticleKernelAVX2 && hasF16C;
+	}
+
+	unsigned int PackColor(const XMFLOAT4& color)
+	{
+		const float* channels = &color.x;
+		unsigned int packed = 0;
+
+		for (int i = 0; i < 4; ++i)
+		{
+			float channel = (std::min)((std::max)(channels[i], 0.0f), 1.0f);
+			packed |= (unsigned int)(channel * 255.0f + 0.5f) << (i * 8);
+		}
+
+		return packed;
+	}
+
+	XMFLOAT4 UnpackColor(unsigned int color)
+	{
+		return XMFLOAT4(
+			(float)(color & 0xff) / 255.0f,
+			(float)((color >> 8) & 0xff) / 255.0f,
+			(float)((color >> 16) & 0xff) / 255.0f,
+			(float)(color >> 24) / 255.0f);
+	}
+}
+
+bool ParticlePacking::HasF16C()
+{
+	int info[4];
+	__cpuid(info, 1);
+	return (info[2] & (1 << 29)) != 0;
+}
+
+unsigned short ParticlePacking::FloatToHalf(float value)
+{
+	unsigned int bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	unsigned int sign = (bits >> 16) & 0x8000;
+	unsigned int magnitude = bits & 0x7fffffff;
+
+	// infinity and NaN, NaNs stay quiet
+	if (magnitude >= 0x7f800000)
+		return (unsigned short)(sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 | ((magnitude >> 13) & 0x3ff) : 0));
+
+	// 65520 and up rounds to infinity
+	if (magnitude >= 0x477ff000)
+		return (unsigned short)(sign | 0x7c00);
+
+	unsigned int half;
+	unsigned int remainder;
+	unsigned int halfway;
+
+	if (magnitude < 0x38800000)
+	{
+		// below 2^-25 everything rounds to zero
+		if (magnitude < 0x33000000)
+			return (unsigned short)sign;
+
+		// subnormal, the mantissa with its implicit bit in units of 2^-24
+		unsigned int mantissa = (magnitude & 0x7fffff) | 0x800000;
+		unsigned int shift = 126 - (magnitude >> 23);
+
+		half = mantissa >> shift;
+		remainder = mantissa & ((1u << shift) - 1);
+		halfway = 1u << (shift - 1);
+	}
+	else
+	{
+		// rebias the exponent and drop 13 mantissa bits, a carry out of the mantissa bumps the exponent
+		half = (magnitude - 0x38000000) >> 13;
+		remainder = magnitude & 0x1fff;
+		halfway = 0x1000;
+	}
+
+	if (remainder > halfway || (remainder == halfway && (half & 1)))
+		half++;
+
+	return (unsigned short)(sign | half);
+}
+
+float ParticlePacking::HalfToFloat(unsigned short value)
+{
+	unsigned int sign = (unsigned int)(value & 0x8000) << 16;
+	unsigned int exponent = (value >> 10) & 0x1f;
+	unsigned int mantissa = value & 0x3ff;
+	unsigned int bits;
+
+	if (exponent == 0)
+	{
+		// zero and subnormals are exact in fp32
+		float magnitude = (float)mantissa * (1.0f / 16777216.0f);
+		return sign ? -magnitude : magnitude;
+	}
+
+	// infinity and NaN, like the hardware a signalling NaN comes back quiet
+	if (exponent == 31)
+		bits = sign | 0x7f800000 | (mantissa << 13) | (mantissa != 0 ? 0x400000 : 0);
+	else
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+unsigned short ParticlePacking::FloatToHalfF16C(float value)
+{
+	return _cvtss_sh(value, _MM_FROUND_TO_NEAREST_INT);
+}
+
+float ParticlePacking::HalfToFloatF16C(unsigned short value)
+{
+	return _cvtsh_ss(value);
+}
+
+void ParticlePacking::Pack(ParticleKernelLevel level, const Particle* particles, PackedParticle* records, unsigned int count)
+{
+	if (UseF16C(level))
+		PackF16C(particles, records, count);
+	else
+		PackScalar(particles, records, count);
+}
+
+void ParticlePacking::Unpack(ParticleKernelLevel level, const PackedParticle* records, Particle* particles, unsigned int count)
+{
+	if (UseF16C(level))
+		UnpackF16C(records, particles, count);
+	else
+		UnpackScalar(records, particles, count);
+}
+
+void ParticlePacking::PackScalar(const Particle* particles, PackedParticle* records, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		const Particle& particle = particles[i];
+		PackedParticle& record = records[i];
+
+		record.Position = particle.Position;
+		record.Color = PackColor(particle.Color);
+		record.Velocity[0] = FloatToHalf(particle.Velocity.x);
+		record.Velocity[1] = FloatToHalf(particle.Velocity.y);
+		record.Velocity[2] = FloatToHalf(particle.Velocity.z);
+		record.Size = FloatToHalf(particle.Size);
+		record.Age = FloatToHalf(particle.Age);
+		record.AgeResidual = FloatToHalf(particle.Age - HalfToFloat(record.Age));
+		record.Flags = (particle.Alive != 0.0f ? PackedParticleAlive : 0) | (particle.EmitterIndex << PackedParticleEmitterShift);
+	}
+}
+
+void ParticlePacking::UnpackScalar(const PackedParticle* records, Particle* particles, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		const PackedParticle& record = records[i];
+		Particle& particle = particles[i];
+
+		particle.Color = UnpackColor(record.Color);
+		particle.Position = record.Position;
+		particle.Age = HalfToFloat(record.Age) + HalfToFloat(record.AgeResidual);
+		particle.Velocity = XMFLOAT3(HalfToFloat(record.Velocity[0]), HalfToFloat(record.Velocity[1]), HalfToFloat(record.Velocity[2]));
+		particle.Size = HalfToFloat(record.Size);
+		particle.Alive = (record.Flags & PackedParticleAlive) ? 1.0f : 0.0f;
+		particle.EmitterIndex = record.Flags >> PackedParticleEmitterShift;
+		particle.Padding = XMFLOAT2(0.0f, 0.0f);
+	}
+}
+
+void ParticlePacking::PackF16C(const Particle* particles, PackedParticle* records, unsigned int count)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 scale = _mm_set1_ps(255.0f);
+	const __m128 round = _mm_set1_ps(0.5f);
+
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		const Particle& particle = particles[i];
+		PackedParticle& record = records[i];
+		const float* rows = reinterpret_cast<const float*>(&particle);
+
+		record.Position = particle.Position;
+
+		// same clamp, scale and truncation as PackColor, then 32 to 8 bits with saturation
+		__m128 color = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(rows + ColorRow), zero), one);
+		__m128i bytes = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(color, scale), round));
+		bytes = _mm_packus_epi16(_mm_packus_epi32(bytes, bytes), bytes);
+		record.Color = (unsigned int)_mm_cvtsi128_si32(bytes);
+
+		// Velocity.xyz and Size in one conversion
+		__m128i velocitySize = _mm_cvtps_ph(_mm_loadu_ps(rows + VelocityRow), _MM_FROUND_TO_NEAREST_INT);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(record.Velocity), velocitySize);
+
+		record.Age = _cvtss_sh(particle.Age, _MM_FROUND_TO_NEAREST_INT);
+		record.AgeResidual = _cvtss_sh(particle.Age - _cvtsh_ss(record.Age), _MM_FROUND_TO_NEAREST_INT);
+		record.Flags = (particle.Alive != 0.0f ? PackedParticleAlive : 0) | (particle.EmitterIndex << PackedParticleEmitterShift);
+	}
+}
+
+void ParticlePacking::UnpackF16C(const PackedParticle* records, Particle* particles, unsigned int count)
+{
+	const __m128 scale = _mm_set1_ps(255.0f);
+
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		const PackedParticle& record = records[i];
+		Particle& particle = particles[i];
+		float* rows = reinterpret_cast<float*>(&particle);
+
+		__m128i bytes = _mm_cvtepu8_epi32(_mm_cvtsi32_si128((int)record.Color));
+		_mm_storeu_ps(rows + ColorRow, _mm_div_ps(_mm_cvtepi32_ps(bytes), scale));
+
+		particle.Position = record.Position;
+		particle.Age = _cvtsh_ss(record.Age) + _cvtsh_ss(record.AgeResidual);
+
+		__m128i velocitySize = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(record.Velocity));
+		_mm_storeu_ps(rows + VelocityRow, _mm_cvtph_ps(velocitySize));
+
+		particle.Alive = (record.Flags & PackedParticleAlive) ? 1.0f : 0.0f;
+		particle.EmitterIndex = record.Flags >> PackedParticleEmitterShift;
+		particle.Padding = XMFLOAT2(0.0f, 0.0f);
+	}
+}
+
+void ParticlePacking::Update(ParticleKernelLevel level, PackedParticle* records, unsigned int begin, unsigned int end,
+	float deltaTime, float lifeTime, ParticleUpdateOutput& output)
+{
+	const unsigned int BatchSize = 64;
+
+	Particle batch[BatchSize];
+	unsigned int batchDeadList[BatchSize];
+	ParticleSort batchDrawList[BatchSize];
+
+	for (unsigned int first = begin; first < end; first += BatchSize)
+	{
+		unsigned int count = (std::min)(BatchSize, end - first);
+
+		ParticleUpdateOutput batchOutput;
+		batchOutput.DeadList = batchDeadList;
+		batchOutput.DrawList = batchDrawList;
+
+		Unpack(level, records + first, batch, count);
+		ParticleUpdateKernel::Update(level, batch, 0, count, deltaTime, lifeTime, batchOutput);
+		Pack(level, batch, records + first, count);
+
+		// batch indices back to pool indices, the lists stay in index order
+		for (unsigned int i = 0; i < batchOutput.DeadCount; ++i)
+			output.DeadList[output.DeadCount++] = first + batchDeadList[i];
+
+		for (unsigned int i = 0; i < batchOutput.DrawCount; ++i)
+			output.DrawList[output.DrawCount++].index = first + batchDrawList[i].index;
+	}
+}
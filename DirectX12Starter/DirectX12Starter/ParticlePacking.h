@@ -0,0 +1,58 @@
+#pragma once
+#include "Emitter.h"
+#include "ParticleUpdateKernel.h"
+
+enum PackedParticleFlags
+{
+	PackedParticleAlive = 1 << 0,
+
+	// EmitterIndex lives in the bits from here up
+	PackedParticleEmitterShift = 8
+};
+
+// 32-byte form of Particle for storage and upload, half the traffic of the 64-byte record
+// Position stays fp32 because it accumulates every step, Velocity and Size are the Velocity/Size row of Particle
+// converted to fp16 in place, Color is RGBA8 unorm with R in the low byte,
+// Alive is a bit of Flags and EmitterIndex its upper 24 bits
+// fp16 can't accumulate Age, above 64 s a 1/60 s step is below half an fp16 ulp and the age stops,
+// so AgeResidual keeps the part of the fp32 age that Age could not hold and the pair expires on time
+struct PackedParticle
+{
+	DirectX::XMFLOAT3 Position;
+	unsigned int Color;
+	unsigned short Velocity[3];
+	unsigned short Size;
+	unsigned short Age;
+	unsigned short AgeResidual;
+	unsigned int Flags;
+};
+
+// conversion between Particle and PackedParticle and the update on packed records
+// the F16C paths convert four fp16 fields with one instruction and give the same bits as the scalar conversions
+class ParticlePacking
+{
+public:
+	// F16C is VEX encoded, so it is only used together with the AVX2 kernel level
+	static bool HasF16C();
+
+	// round to nearest even, like _mm_cvtps_ph with _MM_FROUND_TO_NEAREST_INT
+	static unsigned short FloatToHalf(float value);
+	static float HalfToFloat(unsigned short value);
+
+	// single values through the F16C instructions, only valid when HasF16C
+	static unsigned short FloatToHalfF16C(float value);
+	static float HalfToFloatF16C(unsigned short value);
+
+	static void Pack(ParticleKernelLevel level, const Particle* particles, PackedParticle* records, unsigned int count);
+	static void Unpack(ParticleKernelLevel level, const PackedParticle* records, Particle* particles, unsigned int count);
+
+	static void PackScalar(const Particle* particles, PackedParticle* records, unsigned int count);
+	static void UnpackScalar(const PackedParticle* records, Particle* particles, unsigned int count);
+	static void PackF16C(const Particle* particles, PackedParticle* records, unsigned int count);
+	static void UnpackF16C(const PackedParticle* records, Particle* particles, unsigned int count);
+
+	// ParticleUpdateKernel::Update on records [begin, end), a batch at a time is unpacked into a stack buffer,
+	// updated in fp32 and packed again, so only the packed records travel through memory
+	static void Update(ParticleKernelLevel level, PackedParticle* records, unsigned int begin, unsigned int end,
+		float deltaTime, float lifeTime, ParticleUpdateOutput& output);
+};
@@ -0,0 +1,580 @@
+#pragma once
+#include <cfloat>
+#include <cstring>
+#include <vector>
+#include <xmmintrin.h>
+#include "Emitter.h"
+
+// the live fields of Particle in GPU order, the pools hold a single emitter so EmitterIndex is never stored
+enum ParticleStream
+{
+	ParticleStreamColorR,
+	ParticleStreamColorG,
+	ParticleStreamColorB,
+	ParticleStreamColorA,
+	ParticleStreamPositionX,
+	ParticleStreamPositionY,
+	ParticleStreamPositionZ,
+	ParticleStreamAge,
+	ParticleStreamVelocityX,
+	ParticleStreamVelocityY,
+	ParticleStreamVelocityZ,
+	ParticleStreamSize,
+	ParticleStreamAlive,
+	ParticleStreamCount
+};
+
+// tags selecting the storage policy of ParticlePool
+struct ParticleLayoutAoS {};
+struct ParticleLayoutSoA {};
+template<int LaneWidth> struct ParticleLayoutAoSoA {};
+
+// the streams of Layout with the Age stream holding the birth time instead, for SoA and AoSoA
+template<typename Layout> struct ParticleLayoutBirthTime {};
+
+// CPU side particle storage, the layout is a template parameter so the simulation can pick the one
+// that moves the fewest bytes while Pack/Unpack still produce the 64-byte Particle the shaders read
+template<typename Layout> class ParticlePool;
+
+namespace ParticlePoolDetail
+{
+	// the per-particle work of UpdateComputeShader that the layout affects, with the curl term
+	// replaced by the constant acceleration so the cost is dominated by memory traffic
+	inline void IntegrateStreams(float* const* streams, int count, float deltaTime, float lifeTime, DirectX::XMFLOAT3 acceleration)
+	{
+		float* age = streams[ParticleStreamAge];
+		float* alive = streams[ParticleStreamAlive];
+		float* positionX = streams[ParticleStreamPositionX];
+		float* positionY = streams[ParticleStreamPositionY];
+		float* positionZ = streams[ParticleStreamPositionZ];
+		float* velocityX = streams[ParticleStreamVelocityX];
+		float* velocityY = streams[ParticleStreamVelocityY];
+		float* velocityZ = streams[ParticleStreamVelocityZ];
+
+		for (int i = 0; i < count; ++i)
+		{
+			// dead particles step by zero, which keeps the loop free of branches
+			float step = alive[i] != 0.0f ? deltaTime : 0.0f;
+
+			age[i] += step;
+			alive[i] = (alive[i] != 0.0f && age[i] < lifeTime) ? 1.0f : 0.0f;
+
+			positionX[i] += velocityX[i] * step;
+			positionY[i] += velocityY[i] * step;
+			positionZ[i] += velocityZ[i] * step;
+
+			velocityX[i] += acceleration.x * step;
+			velocityY[i] += acceleration.y * step;
+			velocityZ[i] += acceleration.z * step;
+		}
+	}
+
+	// IntegrateStreams for a birth time stream, age and liveness follow from the pool clock now,
+	// so Age and Alive are never written and a particle is alive while it is younger than lifeTime
+	inline void IntegrateBirthStreams(float* const* streams, int count, float now, float deltaTime, float lifeTime,
+		DirectX::XMFLOAT3 acceleration)
+	{
+		const float* birth = streams[ParticleStreamAge];
+		float* positionX = streams[ParticleStreamPositionX];
+		float* positionY = streams[ParticleStreamPositionY];
+		float* positionZ = streams[ParticleStreamPositionZ];
+		float* velocityX = streams[ParticleStreamVelocityX];
+		float* velocityY = streams[ParticleStreamVelocityY];
+		float* velocityZ = streams[ParticleStreamVelocityZ];
+
+		for (int i = 0; i < count; ++i)
+		{
+			// alive before the step, the same test the Alive stream holds in the other layouts
+			float step = now - birth[i] < lifeTime ? deltaTime : 0.0f;
+
+			positionX[i] += velocityX[i] * step;
+			positionY[i] += velocityY[i] * step;
+			positionZ[i] += velocityZ[i] * step;
+
+			velocityX[i] += acceleration.x * step;
+			velocityY[i] += acceleration.y * step;
+			velocityZ[i] += acceleration.z * step;
+		}
+	}
+
+	inline void IntegrateParticle(Particle& particle, float deltaTime, float lifeTime, DirectX::XMFLOAT3 acceleration)
+	{
+		float step = particle.Alive != 0.0f ? deltaTime : 0.0f;
+
+		particle.Age += step;
+		particle.Alive = (particle.Alive != 0.0f && particle.Age < lifeTime) ? 1.0f : 0.0f;
+
+		particle.Position.x += particle.Velocity.x * step;
+		particle.Position.y += particle.Velocity.y * step;
+		particle.Position.z += particle.Velocity.z * step;
+
+		particle.Velocity.x += acceleration.x * step;
+		particle.Velocity.y += acceleration.y * step;
+		particle.Velocity.z += acceleration.z * step;
+	}
+
+	// Particle is exactly four float4 rows: Color, Position/Age, Velocity/Size and Alive/EmitterIndex/Padding,
+	// so four particles are four 4x4 transposes of the matching streams
+	inline void PackQuad(const float* const* lanes, Particle* destination)
+	{
+		float* rows = reinterpret_cast<float*>(destination);
+
+		for (int row = 0; row < 3; ++row)
+		{
+			__m128 r0 = _mm_loadu_ps(lanes[row * 4 + 0]);
+			__m128 r1 = _mm_loadu_ps(lanes[row * 4 + 1]);
+			__m128 r2 = _mm_loadu_ps(lanes[row * 4 + 2]);
+			__m128 r3 = _mm_loadu_ps(lanes[row * 4 + 3]);
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			_mm_storeu_ps(rows + 0 * 16 + row * 4, r0);
+			_mm_storeu_ps(rows + 1 * 16 + row * 4, r1);
+			_mm_storeu_ps(rows + 2 * 16 + row * 4, r2);
+			_mm_storeu_ps(rows + 3 * 16 + row * 4, r3);
+		}
+
+		__m128 a0 = _mm_loadu_ps(lanes[ParticleStreamAlive]);
+		__m128 a1 = _mm_setzero_ps();
+		__m128 a2 = _mm_setzero_ps();
+		__m128 a3 = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+		_mm_storeu_ps(rows + 0 * 16 + 12, a0);
+		_mm_storeu_ps(rows + 1 * 16 + 12, a1);
+		_mm_storeu_ps(rows + 2 * 16 + 12, a2);
+		_mm_storeu_ps(rows + 3 * 16 + 12, a3);
+	}
+
+	inline void UnpackQuad(const Particle* source, float* const* lanes)
+	{
+		const float* rows = reinterpret_cast<const float*>(source);
+
+		for (int row = 0; row < 4; ++row)
+		{
+			__m128 r0 = _mm_loadu_ps(rows + 0 * 16 + row * 4);
+			__m128 r1 = _mm_loadu_ps(rows + 1 * 16 + row * 4);
+			__m128 r2 = _mm_loadu_ps(rows + 2 * 16 + row * 4);
+			__m128 r3 = _mm_loadu_ps(rows + 3 * 16 + row * 4);
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+			if (row < 3)
+			{
+				_mm_storeu_ps(lanes[row * 4 + 0], r0);
+				_mm_storeu_ps(lanes[row * 4 + 1], r1);
+				_mm_storeu_ps(lanes[row * 4 + 2], r2);
+				_mm_storeu_ps(lanes[row * 4 + 3], r3);
+			}
+			else
+			{
+				_mm_storeu_ps(lanes[ParticleStreamAlive], r0);
+			}
+		}
+	}
+
+	inline void ParticleToFields(const Particle& particle, float* fields)
+	{
+		// the first 13 floats of Particle are the streams in order
+		memcpy(fields, &particle, sizeof(float) * ParticleStreamCount);
+	}
+
+	inline void FieldsToParticle(const float* fields, Particle& particle)
+	{
+		memcpy(&particle, fields, sizeof(float) * ParticleStreamCount);
+		particle.EmitterIndex = 0;
+		particle.Padding = DirectX::XMFLOAT2(0.0f, 0.0f);
+	}
+}
+
+// array of structures, identical to RWParticlePool so packing is a copy
+template<>
+class ParticlePool<ParticleLayoutAoS>
+{
+public:
+	// bytes read plus written by Integrate for one particle
+	static const int UpdateBytesPerParticle = sizeof(Particle) * 2;
+	static const int StoreBytesPerParticle = sizeof(Particle);
+	static const int ResidentBytesPerParticle = sizeof(Particle);
+
+	ParticlePool(int maxParticles) :
+		maxParticles(maxParticles),
+		particles(maxParticles)
+	{
+		memset(particles.data(), 0, sizeof(Particle) * maxParticles);
+	}
+
+	int GetMaxParticles() const
+	{
+		return maxParticles;
+	}
+
+	Particle Load(int index) const
+	{
+		return particles[index];
+	}
+
+	void Store(int index, const Particle& particle)
+	{
+		particles[index] = particle;
+	}
+
+	void Integrate(float deltaTime, float lifeTime, DirectX::XMFLOAT3 acceleration)
+	{
+		for (int i = 0; i < maxParticles; ++i)
+			ParticlePoolDetail::IntegrateParticle(particles[i], deltaTime, lifeTime, acceleration);
+	}
+
+	void Pack(Particle* destination) const
+	{
+		memcpy(destination, particles.data(), sizeof(Particle) * maxParticles);
+	}
+
+	void Unpack(const Particle* source)
+	{
+		memcpy(particles.data(), source, sizeof(Particle) * maxParticles);
+	}
+
+private:
+	int maxParticles;
+	std::vector<Particle> particles;
+};
+
+// structure of arrays, one float stream per field
+template<>
+class ParticlePool<ParticleLayoutSoA>
+{
+public:
+	// Alive, Age, Position and Velocity are read and written, Color and Size are never touched
+	static const int UpdateBytesPerParticle = sizeof(float) * 8 * 2;
+	static const int StoreBytesPerParticle = sizeof(float) * 8;
+	static const int ResidentBytesPerParticle = sizeof(float) * ParticleStreamCount;
+
+	ParticlePool(int maxParticles) :
+		maxParticles(maxParticles)
+	{
+		for (int s = 0; s < ParticleStreamCount; ++s)
+			streams[s].assign(maxParticles, 0.0f);
+	}
+
+	int GetMaxParticles() const
+	{
+		return maxParticles;
+	}
+
+	Particle Load(int index) const
+	{
+		float fields[ParticleStreamCount];
+		for (int s = 0; s < ParticleStreamCount; ++s)
+			fields[s] = streams[s][index];
+
+		Particle particle;
+		ParticlePoolDetail::FieldsToParticle(fields, particle);
+		return particle;
+	}
+
+	void Store(int index, const Particle& particle)
+	{
+		float fields[ParticleStreamCount];
+		ParticlePoolDetail::ParticleToFields(particle, fields);
+
+		for (int s = 0; s < ParticleStreamCount; ++s)
+			streams[s][index] = fields[s];
+	}
+
+	void Integrate(float deltaTime, float lifeTime, DirectX::XMFLOAT3 acceleration)
+	{
+		ForEachBlock([&](float* const* pointers, int count)
+		{
+			ParticlePoolDetail::IntegrateStreams(pointers, count, deltaTime, lifeTime, acceleration);
+		});
+	}
+
+	// calls function(streams, count) for every run of particles that shares one set of stream pointers
+	template<typename Function>
+	void ForEachBlock(Function function)
+	{
+		float* pointers[ParticleStreamCount];
+		for (int s = 0; s < ParticleStreamCount; ++s)
+			pointers[s] = streams[s].data();
+
+		function(pointers, maxParticles);
+	}
+
+	void Pack(Particle* destination) const
+	{
+		const float* lanes[ParticleStreamCount];
+
+		int i = 0;
+		for (; i + 4 <= maxParticles; i += 4)
+		{
+			for (int s = 0; s < ParticleStreamCount; ++s)
+				lanes[s] = streams[s].data() + i;
+
+			ParticlePoolDetail::PackQuad(lanes, destination + i);
+		}
+
+		for (; i < maxParticles; ++i)
+			destination[i] = Load(i);
+	}
+
+	void Unpack(const Particle* source)
+	{
+		float* lanes[ParticleStreamCount];
+
+		int i = 0;
+		for (; i + 4 <= maxParticles; i += 4)
+		{
+			for (int s = 0; s < ParticleStreamCount; ++s)
+				lanes[s] = streams[s].data() + i;
+
+			ParticlePoolDetail::UnpackQuad(source + i, lanes);
+		}
+
+		for (; i < maxParticles; ++i)
+			Store(i, source[i]);
+	}
+
+private:
+	int maxParticles;
+	std::vector<float> streams[ParticleStreamCount];
+};
+
+// array of structures of arrays, LaneWidth particles per block with one lane array per field
+template<int LaneWidth>
+class ParticlePool<ParticleLayoutAoSoA<LaneWidth>>
+{
+	static_assert(LaneWidth > 0 && LaneWidth % 4 == 0, "AoSoA lane width must be a multiple of 4");
+
+public:
+	static const int UpdateBytesPerParticle = sizeof(float) * 8 * 2;
+	static const int StoreBytesPerParticle = sizeof(float) * 8;
+	static const int ResidentBytesPerParticle = sizeof(float) * ParticleStreamCount;
+
+	ParticlePool(int maxParticles) :
+		maxParticles(maxParticles),
+		blocks((maxParticles + LaneWidth - 1) / LaneWidth)
+	{
+		memset(blocks.data(), 0, sizeof(Block) * blocks.size());
+	}
+
+	int GetMaxParticles() const
+	{
+		return maxParticles;
+	}
+
+	Particle Load(int index) const
+	{
+		const Block& block = blocks[index / LaneWidth];
+
+		float fields[ParticleStreamCount];
+		for (int s = 0; s < ParticleStreamCount; ++s)
+			fields[s] = block.Lanes[s][index % LaneWidth];
+
+		Particle particle;
+		ParticlePoolDetail::FieldsToParticle(fields, particle);
+		return particle;
+	}
+
+	void Store(int index, const Particle& particle)
+	{
+		Block& block = blocks[index / LaneWidth];
+
+		float fields[ParticleStreamCount];
+		ParticlePoolDetail::ParticleToFields(particle, fields);
+
+		for (int s = 0; s < ParticleStreamCount; ++s)
+			block.Lanes[s][index % LaneWidth] = fields[s];
+	}
+
+	void Integrate(float deltaTime, float lifeTime, DirectX::XMFLOAT3 acceleration)
+	{
+		ForEachBlock([&](float* const* pointers, int count)
+		{
+			ParticlePoolDetail::IntegrateStreams(pointers, count, deltaTime, lifeTime, acceleration);
+		});
+	}
+
+	// the tail of the last block is zeroed and never alive, so whole blocks are safe to integrate
+	template<typename Function>
+	void ForEachBlock(Function function)
+	{
+		float* pointers[ParticleStreamCount];
+
+		for (size_t b = 0; b < blocks.size(); ++b)
+		{
+			for (int s = 0; s < ParticleStreamCount; ++s)
+				pointers[s] = blocks[b].Lanes[s];
+
+			function(pointers, LaneWidth);
+		}
+	}
+
+	void Pack(Particle* destination) const
+	{
+		const float* lanes[ParticleStreamCount];
+
+		int i = 0;
+		for (; i + 4 <= maxParticles; i += 4)
+		{
+			const Block& block = blocks[i / LaneWidth];
+			for (int s = 0; s < ParticleStreamCount; ++s)
+				lanes[s] = block.Lanes[s] + i % LaneWidth;
+
+			ParticlePoolDetail::PackQuad(lanes, destination + i);
+		}
+
+		for (; i < maxParticles; ++i)
+			destination[i] = Load(i);
+	}
+
+	void Unpack(const Particle* source)
+	{
+		float* lanes[ParticleStreamCount];
+
+		int i = 0;
+		for (; i + 4 <= maxParticles; i += 4)
+		{
+			Block& block = blocks[i / LaneWidth];
+			for (int s = 0; s < ParticleStreamCount; ++s)
+				lanes[s] = block.Lanes[s] + i % LaneWidth;
+
+			ParticlePoolDetail::UnpackQuad(source + i, lanes);
+		}
+
+		for (; i < maxParticles; ++i)
+			Store(i, source[i]);
+	}
+
+private:
+	struct Block
+	{
+		float Lanes[ParticleStreamCount][LaneWidth];
+	};
+
+	int maxParticles;
+	std::vector<Block> blocks;
+};
+
+// Layout with the birth time in place of the age, the update reads the birth time and never stores it,
+// so Age and Alive drop out of the written bytes and Position and Velocity are the only stores
+// the clock counts from an origin that moves forward every RebasePeriod seconds, a float clock that ran for a day
+// would be 86400 s with an ulp of 8 ms, half a 60 Hz step, so rebasing keeps now - birth as exact as a fresh start
+// Load and Pack give the age and the alive flag the AoS layout holds, except that a dead particle's age keeps growing
+template<typename Layout>
+class ParticlePool<ParticleLayoutBirthTime<Layout>>
+{
+public:
+	// Birth, Position and Velocity are read, Position and Velocity written
+	static const int UpdateBytesPerParticle = sizeof(float) * (7 + 6);
+	static const int StoreBytesPerParticle = sizeof(float) * 6;
+	static const int ResidentBytesPerParticle = ParticlePool<Layout>::ResidentBytesPerParticle;
+
+	// an ulp of 1024 s is 0.12 ms
+	static const int RebasePeriod = 1024;
+
+	ParticlePool(int maxParticles) :
+		pool(maxParticles),
+		now(0.0f),
+		lifeTime(FLT_MAX),
+		origin(0.0),
+		rebaseCount(0)
+	{
+		// nothing has been born yet
+		pool.ForEachBlock([](float* const* streams, int count)
+		{
+			for (int i = 0; i < count; ++i)
+				streams[ParticleStreamAge][i] = -FLT_MAX;
+		});
+	}
+
+	int GetMaxParticles() const
+	{
+		return pool.GetMaxParticles();
+	}
+
+	// seconds since the pool was created, in double so the origin is never rounded
+	double GetTime() const
+	{
+		return origin + now;
+	}
+
+	int GetRebaseCount() const
+	{
+		return rebaseCount;
+	}
+
+	Particle Load(int index) const
+	{
+		Particle particle = pool.Load(index);
+		BirthToAge(particle);
+		return particle;
+	}
+
+	void Store(int index, const Particle& particle)
+	{
+		Particle birth = particle;
+		birth.Age = particle.Alive != 0.0f ? now - particle.Age : -FLT_MAX;
+		pool.Store(index, birth);
+	}
+
+	void Integrate(float deltaTime, float lifeTime, DirectX::XMFLOAT3 acceleration)
+	{
+		float start = now;
+		pool.ForEachBlock([&](float* const* streams, int count)
+		{
+			ParticlePoolDetail::IntegrateBirthStreams(streams, count, start, deltaTime, lifeTime, acceleration);
+		});
+
+		this->lifeTime = lifeTime;
+		now += deltaTime;
+
+		if (now >= (float)RebasePeriod)
+			Rebase();
+	}
+
+	void Pack(Particle* destination) const
+	{
+		pool.Pack(destination);
+
+		for (int i = 0; i < pool.GetMaxParticles(); ++i)
+			BirthToAge(destination[i]);
+	}
+
+	void Unpack(const Particle* source)
+	{
+		pool.Unpack(source);
+
+		pool.ForEachBlock([&](float* const* streams, int count)
+		{
+			for (int i = 0; i < count; ++i)
+				streams[ParticleStreamAge][i] = streams[ParticleStreamAlive][i] != 0.0f ? now - streams[ParticleStreamAge][i] : -FLT_MAX;
+		});
+	}
+
+private:
+	// ages never saw the rebase, the births all move back by the same amount as the clock,
+	// once every RebasePeriod seconds it costs one pass over a single stream
+	void Rebase()
+	{
+		float shift = now;
+		pool.ForEachBlock([&](float* const* streams, int count)
+		{
+			for (int i = 0; i < count; ++i)
+				streams[ParticleStreamAge][i] -= shift;
+		});
+
+		origin += shift;
+		now = 0.0f;
+		rebaseCount++;
+	}
+
+	void BirthToAge(Particle& particle) const
+	{
+		float age = now - particle.Age;
+		particle.Age = age;
+		particle.Alive = age < lifeTime ? 1.0f : 0.0f;
+	}
+
+	ParticlePool<Layout> pool;
+	float now;
+	float lifeTime;
+	double origin;
+	int rebaseCount;
+};
@@ -0,0 +1,3144 @@
+#include "FloatContraction.h"
+#include "ParticleSelfChecks.h"
+#include "Camera.h"
+#include "CurlFieldCache.h"
+#include "CurlVolume.h"
+#include "DeadListStack.h"
+#include "MathHelper.h"
+#include "NoiseFamily.h"
+#include "ParticleNoiseLod.h"
+#include "ParticlePacking.h"
+#include "ParticlePool.h"
+#include "ParticleTimeSlicer.h"
+#include "SimplexNoise.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <thread>
+
+using namespace DirectX;
+
+namespace
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	double SecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	// a live white particle at position, everything else zero
+	Particle MakeParticle(const XMFLOAT3& position)
+	{
+		Particle particle;
+		memset(&particle, 0, sizeof(Particle));
+		particle.Color = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+		particle.Position = position;
+		particle.Size = 0.5f;
+		particle.Alive = 1.0f;
+		return particle;
+	}
+
+	// a mix of dead, dying and young particles spread over the emission grid, what the kernels are compared on
+	std::vector<Particle> MakeKernelSeed(int particleCount, float lifeTime)
+	{
+		std::vector<Particle> seed(particleCount);
+		for (int i = 0; i < particleCount; ++i)
+		{
+			Particle& particle = seed[i];
+			particle = MakeParticle(XMFLOAT3(MathHelper::RandF(-5.0f, 5.0f), MathHelper::RandF(-5.0f, 5.0f), MathHelper::RandF(10.0f, 20.0f)));
+			particle.Velocity = XMFLOAT3(MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f));
+			particle.Age = MathHelper::RandF(0.0f, lifeTime);
+			particle.Alive = (i % 7 == 0) ? 0.0f : 1.0f;
+		}
+		return seed;
+	}
+
+	// largest distance in units in the last place over every float of two pools of the same size
+	unsigned int MaxUlpDistance(const std::vector<Particle>& particles, const std::vector<Particle>& reference)
+	{
+		unsigned int maxUlp = 0;
+		for (size_t i = 0; i < particles.size(); ++i)
+		{
+			const float* a = reinterpret_cast<const float*>(&particles[i]);
+			const float* b = reinterpret_cast<const float*>(&reference[i]);
+			for (int f = 0; f < (int)(sizeof(Particle) / sizeof(float)); ++f)
+				maxUlp = (std::max)(maxUlp, ParticleUpdateKernel::UlpDistance(a[f], b[f]));
+		}
+		return maxUlp;
+	}
+
+	// the constants of a pool driven without an emitter, steps of 1/60 s from time 0 on the Game grid
+	TimeConstants MakeTimeConstants()
+	{
+		TimeConstants time;
+		time.DeltaTime = 1.0f / 60.0f;
+		return time;
+	}
+
+	ParticleConstants MakeParticleConstants(int maxParticles, int emitCount, float lifeTime)
+	{
+		ParticleConstants constants;
+		constants.MaxParticles = maxParticles;
+		constants.EmitCount = emitCount;
+		constants.GridSize = 100;
+		constants.LifeTime = lifeTime;
+		return constants;
+	}
+
+	// the CPU pipeline of one Game::Draw frame on a pool driven without an emitter, the emit only when emit is set
+	void SimulatePoolFrame(CPUParticleSystem& particleSystem, const TimeConstants& time, const ParticleConstants& constants, bool emit)
+	{
+		if (emit)
+			particleSystem.Emit(time, constants);
+		particleSystem.ResetDrawList();
+		particleSystem.Update(time, constants);
+		particleSystem.CopyDrawCount();
+	}
+
+	// a flag of the command line and the check it runs, with the report directory for the files a check writes
+	struct SelfCheck
+	{
+		const char* Flag;
+		bool (*Run)(std::ostream& out, const ParticleBenchmarkSettings& settings, const std::string& directory);
+	};
+
+	// triangles of random size and orientation, for spawn cost against triangle count
+	void BuildRandomMesh(MeshSurfaceSampler& sampler, unsigned int triangleCount)
+	{
+		std::vector<XMFLOAT3> positions(triangleCount * 3);
+		for (unsigned int i = 0; i < triangleCount * 3; ++i)
+		{
+			float u[4];
+			EmissionShape::Random(i, u);
+			positions[i] = XMFLOAT3(u[0] * 10.0f, u[1] * 10.0f, u[2] * 10.0f);
+		}
+
+		sampler.Build(positions.data(), triangleCount * 3);
+	}
+
+	// every function of SimplexNoise.hlsl, SNoise3D, the curls and the 2D gradient fill three outputs and the rest one
+	enum NoiseFunction
+	{
+		NoiseSNoise2,
+		NoiseSNoise3,
+		NoiseSNoise4,
+		NoiseSNoise3D,
+		NoiseCurl3D,
+		NoiseSNoiseGrad2,
+		NoiseCurlGrad3D,
+		NoiseCurl4D,
+		NoiseOctaves,
+		NoiseFunctionCount
+	};
+
+	const char* const NoiseFunctionNames[NoiseFunctionCount] = { "snoise2", "snoise3", "snoise4", "snoise3D", "curlNoise3D",
+		"snoise_grad2", "curlNoise3DGrad", "curlNoise4D", "octaves x5" };
+	const int NoiseFunctionOutputs[NoiseFunctionCount] = { 1, 1, 1, 3, 3, 3, 3, 3, 1 };
+
+	void EvaluateNoise(NoiseFunction function, SimplexNoiseLevel level, const std::vector<float>* coordinates,
+		std::vector<float>* results, unsigned int count)
+	{
+		const float* x = coordinates[0].data();
+		const float* y = coordinates[1].data();
+		const float* z = coordinates[2].data();
+		const float* w = coordinates[3].data();
+
+		switch (function)
+		{
+		case NoiseSNoise2:
+			SimplexNoise::SNoisePoints(level, x, y, results[0].data(), count);
+			break;
+		case NoiseSNoise3:
+			SimplexNoise::SNoisePoints(level, x, y, z, results[0].data(), count);
+			break;
+		case NoiseSNoise4:
+			SimplexNoise::SNoisePoints(level, x, y, z, w, results[0].data(), count);
+			break;
+		case NoiseSNoise3D:
+			SimplexNoise::SNoise3DPoints(level, x, y, z, results[0].data(), results[1].data(), results[2].data(), count);
+			break;
+		case NoiseCurl3D:
+			SimplexNoise::CurlNoise3DPoints(level, x, y, z, 1.0f, results[0].data(), results[1].data(), results[2].data(), count);
+			break;
+		case NoiseSNoiseGrad2:
+			SimplexNoise::SNoiseGradPoints(level, x, y, results[0].data(), results[1].data(), results[2].data(), count);
+			break;
+		case NoiseCurlGrad3D:
+			SimplexNoise::CurlNoise3DGradPoints(level, x, y, z, results[0].data(), results[1].data(), results[2].data(), count);
+			break;
+		case NoiseCurl4D:
+			SimplexNoise::CurlNoise4DPoints(level, x, y, z, 12.5f, 0.1f, results[0].data(), results[1].data(), results[2].data(), count);
+			break;
+		default:
+			SimplexNoise::CalcNoiseWithOctavesPoints(level, x, y, 0.05f, 3.0f, 0.5f, 5, results[0].data(), count);
+			break;
+		}
+	}
+
+	// lanes of CurlVolume::SampleBatch that differ by a bit from CurlVolume::Sample, full batches only
+	template<typename Simd>
+	unsigned int CountSampleMismatches(const CurlVolume& volume, const std::vector<float>* positions, unsigned int count)
+	{
+		unsigned int mismatches = 0;
+		for (unsigned int i = 0; i + Simd::Width <= count; i += Simd::Width)
+		{
+			typename Simd::Float curlX, curlY, curlZ;
+			volume.SampleBatch<Simd>(Simd::Load(&positions[0][i]), Simd::Load(&positions[1][i]), Simd::Load(&positions[2][i]),
+				curlX, curlY, curlZ);
+
+			float results[3][Simd::Width];
+			Simd::Store(results[0], curlX);
+			Simd::Store(results[1], curlY);
+			Simd::Store(results[2], curlZ);
+
+			for (unsigned int lane = 0; lane < Simd::Width; ++lane)
+			{
+				XMFLOAT3 reference = volume.Sample(XMFLOAT3(positions[0][i + lane], positions[1][i + lane], positions[2][i + lane]));
+				if (memcmp(&results[0][lane], &reference.x, sizeof(float)) != 0 ||
+					memcmp(&results[1][lane], &reference.y, sizeof(float)) != 0 ||
+					memcmp(&results[2][lane], &reference.z, sizeof(float)) != 0)
+					mismatches++;
+			}
+		}
+		return mismatches;
+	}
+
+	// one row of the noise family table, a NoiseFamily::Points instantiation behind a plain function pointer
+	struct NoiseFamilyCase
+	{
+		const char* Name;
+		int Dimensions;
+		int Octaves;
+		void (*Evaluate)(SimplexNoiseLevel level, const std::vector<float>* coordinates, float* noise, unsigned int count);
+	};
+
+	template<typename Noise, int Dimensions>
+	void EvaluateNoiseFamily(SimplexNoiseLevel level, const std::vector<float>* coordinates, float* noise, unsigned int count)
+	{
+		if (Dimensions == 2)
+			NoiseFamily::Points<Noise>(level, coordinates[0].data(), coordinates[1].data(), noise, count);
+		else
+			NoiseFamily::Points<Noise>(level, coordinates[0].data(), coordinates[1].data(), coordinates[2].data(), noise, count);
+	}
+
+	// a basis in 2D and 3D at 1, 4 and 8 octaves
+	template<typename Basis>
+	void AddNoiseFamilyCases(std::vector<NoiseFamilyCase>& cases, const char* name)
+	{
+		NoiseFamilyCase basisCases[] =
+		{
+			{ name, 2, 1, &EvaluateNoiseFamily<NoiseFbm<Basis, 1>, 2> },
+			{ name, 2, 4, &EvaluateNoiseFamily<NoiseFbm<Basis, 4>, 2> },
+			{ name, 2, 8, &EvaluateNoiseFamily<NoiseFbm<Basis, 8>, 2> },
+			{ name, 3, 1, &EvaluateNoiseFamily<NoiseFbm<Basis, 1>, 3> },
+			{ name, 3, 4, &EvaluateNoiseFamily<NoiseFbm<Basis, 4>, 3> },
+			{ name, 3, 8, &EvaluateNoiseFamily<NoiseFbm<Basis, 8>, 3> }
+		};
+		cases.insert(cases.end(), std::begin(basisCases), std::end(basisCases));
+	}
+
+	template<typename Layout>
+	void BenchmarkLayout(std::ostream& out, const char* name, const std::vector<Particle>& seed, std::vector<Particle>& upload, int frameCount)
+	{
+		int particleCount = (int)seed.size();
+
+		ParticlePool<Layout> pool(particleCount);
+		pool.Unpack(seed.data());
+
+		auto start = Clock::now();
+		for (int frame = 0; frame < frameCount; ++frame)
+			pool.Integrate(1.0f / 60.0f, 1000.0f, XMFLOAT3(0.0f, -9.8f, 0.0f));
+		double updateSeconds = SecondsSince(start) / frameCount;
+
+		start = Clock::now();
+		for (int frame = 0; frame < frameCount; ++frame)
+			pool.Pack(upload.data());
+		double packSeconds = SecondsSince(start) / frameCount;
+
+		// packing reads the resident layout and writes the 64-byte GPU records
+		int updateBytes = ParticlePool<Layout>::UpdateBytesPerParticle;
+		int storeBytes = ParticlePool<Layout>::StoreBytesPerParticle;
+		int packBytes = ParticlePool<Layout>::ResidentBytesPerParticle + (int)sizeof(Particle);
+
+		out << std::left << std::setw(18) << name
+			<< std::setw(12) << particleCount
+			<< std::setw(14) << updateBytes
+			<< std::setw(12) << storeBytes
+			<< std::setw(14) << updateSeconds * 1000.0
+			<< std::setw(14) << (double)updateBytes * particleCount / updateSeconds / 1e9
+			<< std::setw(14) << packBytes
+			<< std::setw(14) << packSeconds * 1000.0
+			<< (double)packBytes * particleCount / packSeconds / 1e9 << std::endl;
+	}
+}
+
+bool ParticleSelfChecks::Run(std::ostream& out, const char* cmdLine, const ParticleBenchmarkSettings& settings, const std::string& reportFile)
+{
+	static const SelfCheck checks[] =
+	{
+		{ "-layouts", [](std::ostream& out, const ParticleBenchmarkSettings&, const std::string&)
+			{
+				WriteLayoutReport(out, 1000000, 60);
+				WriteLayoutReport(out, 10000000, 10);
+				return true;
+			} },
+		{ "-kernels", [](std::ostream& out, const ParticleBenchmarkSettings& settings, const std::string&)
+			{ return WriteKernelReport(out, settings.MaxParticles, 10); } },
+		{ "-scaling", [](std::ostream& out, const ParticleBenchmarkSettings& settings, const std::string&)
+			{ return WriteScalingReport(out, settings.MaxParticles, 20, settings.ThreadCount); } },
+		{ "-sortcheck", [](std::ostream& out, const ParticleBenchmarkSettings& settings, const std::string&)
+			{ return WriteDepthSortReport(out, settings.MaxParticles, settings.ThreadCount); } },
+		{ "-camerapath", [](std::ostream& out, const ParticleBenchmarkSettings& settings, const std::string&)
+			{ return WriteCullReport(out, settings.MaxParticles, 24); } },
+		{ "-packcheck", [](std::ostream& out, const ParticleBenchmarkSettings&, const std::string&)
+			{ return WritePackedReport(out, 4096, 10000); } },
+		{ "-emittercheck", [](std::ostream& out, const ParticleBenchmarkSettings& settings, const std::string&)
+			{ return WriteEmitterReport(out, settings.MaxParticles, 60); } },
+		{ "-emitplan", [](std::ostream& out, const ParticleBenchmarkSettings&, const std::string&)
+			{ return WritePlannerReport(out); } },
+		{ "-shapecheck", [](std::ostream& out, const ParticleBenchmarkSettings&, const std::string&)
+			{ return WriteShapeReport(out, 1000000); } },
+		{ "-determinism", [](std::ostream& out, const ParticleBenchmarkSettings& settings, const std::string&)
+			{ return WriteDeterminismReport(out, settings, 600); } },
+		{ "-fifocheck", [](std::ostream& out, const ParticleBenchmarkSettings& settings, const std::string&)
+			{ return WriteRingReport(out, settings.MaxParticles, 90); } },
+		{ "-occupancy", [](std::ostream& out, const ParticleBenchmarkSettings& settings, const std::string&)
+			{ return WriteOccupancyReport(out, settings.MaxParticles, 10); } },
+		{ "-deadlist", [](std::ostream& out, const ParticleBenchmarkSettings& settings, const std::string&)
+			{ return WriteDeadListReport(out, settings.MaxParticles); } },
+		{ "-birthcheck", [](std::ostream& out, const ParticleBenchmarkSettings& settings, const std::string&)
+			{ return WriteBirthReport(out, settings.MaxParticles, 120); } },
+		{ "-closedform", [](std::ostream& out, const ParticleBenchmarkSettings& settings, const std::string&)
+			{ return WriteBallisticReport(out, settings.MaxParticles, 180); } },
+		{ "-noisecheck", [](std::ostream& out, const ParticleBenchmarkSettings&, const std::string&)
+			{ return WriteNoiseReport(out, 1000000); } },
+		{ "-noisegrad", [](std::ostream& out, const ParticleBenchmarkSettings&, const std::string&)
+			{ return WriteNoiseGradientReport(out, 1000000); } },
+		{ "-curlvolume", [](std::ostream& out, const ParticleBenchmarkSettings&, const std::string& directory)
+			{ return WriteCurlVolumeReport(out, 1000000, directory + "CurlVolume.dds"); } },
+		{ "-curlcache", [](std::ostream& out, const ParticleBenchmarkSettings&, const std::string&)
+			{ return WriteCurlCacheReport(out, 1000000, 120); } },
+		{ "-noisefamily", [](std::ostream& out, const ParticleBenchmarkSettings&, const std::string&)
+			{ return WriteNoiseFamilyReport(out, 200000); } },
+		{ "-noiselod", [](std::ostream& out, const ParticleBenchmarkSettings&, const std::string&)
+			{ return WriteNoiseLodReport(out, 500000, 32); } },
+		{ "-timeslice", [](std::ostream& out, const ParticleBenchmarkSettings&, const std::string&)
+			{ return WriteTimeSliceReport(out, 500000, 64); } },
+		{ "-spawnoffsets", [](std::ostream& out, const ParticleBenchmarkSettings&, const std::string&)
+			{ return WriteSpawnOffsetReport(out, 30); } }
+	};
+
+	std::string directory = reportFile.substr(0, reportFile.find_last_of("\\/") + 1);
+
+	bool passed = true;
+	for (const SelfCheck& check : checks)
+	{
+		if (strstr(cmdLine, check.Flag) != nullptr && !check.Run(out, settings, directory))
+			passed = false;
+	}
+
+	return passed;
+}
+
+void ParticleSelfChecks::WriteLayoutReport(std::ostream& out, int particleCount, int frameCount)
+{
+	std::vector<Particle> seed(particleCount);
+	std::vector<Particle> upload(particleCount);
+
+	for (int i = 0; i < particleCount; ++i)
+	{
+		seed[i] = MakeParticle(XMFLOAT3((float)(i % 100), (float)(i / 100 % 100), (float)(i / 10000)));
+		seed[i].Velocity = XMFLOAT3(0.0f, 1.0f, 0.0f);
+	}
+
+	out << std::endl << "particle pool layouts" << std::endl;
+	out << std::left << std::setw(18) << "layout"
+		<< std::setw(12) << "particles"
+		<< std::setw(14) << "update B/p"
+		<< std::setw(12) << "store B/p"
+		<< std::setw(14) << "update ms"
+		<< std::setw(14) << "update GB/s"
+		<< std::setw(14) << "pack B/p"
+		<< std::setw(14) << "pack ms"
+		<< "pack GB/s" << std::endl;
+
+	BenchmarkLayout<ParticleLayoutAoS>(out, "AoS", seed, upload, frameCount);
+	BenchmarkLayout<ParticleLayoutSoA>(out, "SoA", seed, upload, frameCount);
+	BenchmarkLayout<ParticleLayoutAoSoA<8>>(out, "AoSoA<8>", seed, upload, frameCount);
+	BenchmarkLayout<ParticleLayoutAoSoA<16>>(out, "AoSoA<16>", seed, upload, frameCount);
+	BenchmarkLayout<ParticleLayoutBirthTime<ParticleLayoutSoA>>(out, "SoA birth", seed, upload, frameCount);
+	BenchmarkLayout<ParticleLayoutBirthTime<ParticleLayoutAoSoA<8>>>(out, "AoSoA<8> birth", seed, upload, frameCount);
+	BenchmarkLayout<ParticleLayoutBirthTime<ParticleLayoutAoSoA<16>>>(out, "AoSoA<16> birth", seed, upload, frameCount);
+}
+
+bool ParticleSelfChecks::WriteKernelReport(std::ostream& out, int particleCount, int frameCount)
+{
+	const float deltaTime = 1.0f / 60.0f;
+	const float lifeTime = 10.0f;
+
+	std::vector<Particle> seed = MakeKernelSeed(particleCount, lifeTime);
+
+	std::vector<unsigned int> referenceDead(particleCount), dead(particleCount);
+	std::vector<ParticleSort> referenceDraw(particleCount), draw(particleCount);
+
+	std::vector<Particle> reference = seed;
+	ParticleUpdateOutput referenceOutput;
+	referenceOutput.DeadList = referenceDead.data();
+	referenceOutput.DrawList = referenceDraw.data();
+	ParticleUpdateKernel::UpdateScalar(reference.data(), 0, particleCount, deltaTime, lifeTime, referenceOutput);
+
+	out << std::endl << "update kernels (max ulp allowed: " << ParticleUpdateKernel::MaxUlpError << ")" << std::endl;
+	out << std::left << std::setw(10) << "kernel"
+		<< std::setw(12) << "particles"
+		<< std::setw(10) << "max ulp"
+		<< std::setw(10) << "lists"
+		<< std::setw(14) << "ms/frame"
+		<< std::setw(16) << "particles/s"
+		<< "speedup" << std::endl;
+
+	bool passed = true;
+	double scalarSeconds = 0.0;
+	ParticleKernelLevel supported = ParticleUpdateKernel::DetectLevel();
+
+	for (int level = ParticleKernelScalar; level <= supported; ++level)
+	{
+		// one step from the seed for accuracy
+		std::vector<Particle> particles = seed;
+		ParticleUpdateOutput output;
+		output.DeadList = dead.data();
+		output.DrawList = draw.data();
+		ParticleUpdateKernel::Update((ParticleKernelLevel)level, particles.data(), 0, particleCount, deltaTime, lifeTime, output);
+
+		unsigned int maxUlp = MaxUlpDistance(particles, reference);
+
+		bool listsMatch = output.DeadCount == referenceOutput.DeadCount &&
+			output.DrawCount == referenceOutput.DrawCount &&
+			memcmp(dead.data(), referenceDead.data(), sizeof(unsigned int) * output.DeadCount) == 0 &&
+			memcmp(draw.data(), referenceDraw.data(), sizeof(ParticleSort) * output.DrawCount) == 0;
+
+		if (maxUlp > (unsigned int)ParticleUpdateKernel::MaxUlpError || !listsMatch)
+			passed = false;
+
+		// then a timed run, particles that die stay dead so later frames get cheaper just like the GPU
+		particles = seed;
+		auto start = Clock::now();
+		for (int frame = 0; frame < frameCount; ++frame)
+		{
+			output.DeadCount = 0;
+			output.DrawCount = 0;
+			ParticleUpdateKernel::Update((ParticleKernelLevel)level, particles.data(), 0, particleCount, deltaTime, lifeTime, output);
+		}
+		double seconds = SecondsSince(start) / frameCount;
+
+		if (level == ParticleKernelScalar)
+			scalarSeconds = seconds;
+
+		out << std::left << std::setw(10) << ParticleUpdateKernel::GetLevelName((ParticleKernelLevel)level)
+			<< std::setw(12) << particleCount
+			<< std::setw(10) << maxUlp
+			<< std::setw(10) << (listsMatch ? "match" : "DIFFER")
+			<< std::setw(14) << seconds * 1000.0
+			<< std::setw(16) << particleCount / seconds
+			<< scalarSeconds / seconds << std::endl;
+	}
+
+	return passed;
+}
+
+bool ParticleSelfChecks::WriteScalingReport(std::ostream& out, int particleCount, int frameCount, int maxThreads)
+{
+	TimeConstants time = MakeTimeConstants();
+	ParticleConstants constants = MakeParticleConstants(particleCount, particleCount - particleCount / 8, time.DeltaTime * (frameCount / 2));
+
+	// reference lists from the sequential update after one frame
+	CPUParticleSystem reference(particleCount);
+	reference.DeadListInit(constants);
+	SimulatePoolFrame(reference, time, constants, true);
+
+	int hardwareThreads = (int)(std::max)(std::thread::hardware_concurrency(), 1u);
+	if (maxThreads <= 0)
+		maxThreads = hardwareThreads;
+
+	std::vector<int> threadCounts;
+	for (int threads = 1; threads < maxThreads; threads *= 2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(maxThreads);
+
+	out << std::endl << "parallel update scaling (" << hardwareThreads << " hardware threads)" << std::endl;
+	out << std::left << std::setw(10) << "threads"
+		<< std::setw(12) << "particles"
+		<< std::setw(12) << "lists"
+		<< std::setw(12) << "steals"
+		<< std::setw(14) << "ms/frame"
+		<< std::setw(12) << "speedup"
+		<< "efficiency" << std::endl;
+
+	bool passed = true;
+	double sequentialSeconds = 0.0;
+
+	for (int threads : threadCounts)
+	{
+		for (int deterministic = 1; deterministic >= 0; --deterministic)
+		{
+			CPUParticleSystem particleSystem(particleCount);
+			particleSystem.SetThreadCount(threads);
+			particleSystem.SetDeterministicOrder(deterministic != 0);
+
+			particleSystem.DeadListInit(constants);
+			SimulatePoolFrame(particleSystem, time, constants, true);
+
+			bool countsMatch = particleSystem.GetDrawListCount() == reference.GetDrawListCount() &&
+				particleSystem.GetDeadListCount() == reference.GetDeadListCount();
+
+			bool listsMatch = countsMatch;
+			if (countsMatch)
+			{
+				std::vector<unsigned int> draw(particleSystem.GetDrawListCount()), referenceDraw(reference.GetDrawListCount());
+				for (size_t i = 0; i < draw.size(); ++i)
+				{
+					draw[i] = particleSystem.GetDrawList()[i].index;
+					referenceDraw[i] = reference.GetDrawList()[i].index;
+				}
+
+				std::vector<unsigned int> dead(particleSystem.GetDeadList(), particleSystem.GetDeadList() + particleSystem.GetDeadListCount());
+				std::vector<unsigned int> referenceDead(reference.GetDeadList(), reference.GetDeadList() + reference.GetDeadListCount());
+
+				// unordered chunks only have to hold the same indices
+				if (!deterministic)
+				{
+					std::sort(draw.begin(), draw.end());
+					std::sort(referenceDraw.begin(), referenceDraw.end());
+					std::sort(dead.begin(), dead.end());
+					std::sort(referenceDead.begin(), referenceDead.end());
+				}
+
+				listsMatch = draw == referenceDraw && dead == referenceDead;
+			}
+
+			if (!listsMatch)
+				passed = false;
+
+			// later frames age the particles out so the timed run covers the dying half as well
+			particleSystem.ResetStageStats();
+			for (int frame = 1; frame < frameCount; ++frame)
+				SimulatePoolFrame(particleSystem, time, constants, false);
+			double seconds = particleSystem.GetStageStats(ParticleStageUpdate).Seconds / (frameCount - 1);
+
+			if (threads == 1 && deterministic)
+				sequentialSeconds = seconds;
+
+			const char* order = deterministic ? "ordered" : "unordered";
+			out << std::left << std::setw(10) << threads
+				<< std::setw(12) << particleCount
+				<< std::setw(12) << (listsMatch ? order : "DIFFER")
+				<< std::setw(12) << particleSystem.GetStealCount()
+				<< std::setw(14) << seconds * 1000.0
+				<< std::setw(12) << sequentialSeconds / seconds
+				<< sequentialSeconds / seconds / threads << std::endl;
+		}
+	}
+
+	return passed;
+}
+
+bool ParticleSelfChecks::WriteDeterminismReport(std::ostream& out, const ParticleBenchmarkSettings& settings, int stepCount)
+{
+	const unsigned int seeds[] = { 1, 2, 3 };
+	int threadCounts[] = { 1, settings.ThreadCount };
+
+	out << std::endl << "fixed step determinism (" << stepCount << " steps of " << settings.DeltaTime << " s)" << std::endl;
+	out << std::left << std::setw(8) << "seed"
+		<< std::setw(10) << "threads"
+		<< std::setw(10) << "frames"
+		<< std::setw(20) << "state hash"
+		<< std::setw(20) << "constants hash"
+		<< "result" << std::endl;
+
+	bool passed = true;
+	unsigned long long referenceState = 0;
+	unsigned long long referenceConstants = 0;
+	bool first = true;
+
+	for (int threads : threadCounts)
+	{
+		for (unsigned int seed : seeds)
+		{
+			ParticleBenchmarkSettings runSettings = settings;
+			runSettings.ThreadCount = threads;
+
+			ParticleBenchmark benchmark(runSettings);
+			benchmark.RunFixedSteps(stepCount, seed);
+
+			unsigned long long state = benchmark.GetStateHash();
+			unsigned long long constants = benchmark.GetConstantsHash();
+
+			if (first)
+			{
+				referenceState = state;
+				referenceConstants = constants;
+				first = false;
+			}
+
+			bool identical = state == referenceState && constants == referenceConstants;
+			if (!identical)
+				passed = false;
+
+			out << std::left << std::setw(8) << seed
+				<< std::setw(10) << benchmark.GetParticleSystem().GetThreadCount()
+				<< std::setw(10) << benchmark.GetFramesRun()
+				<< std::hex << std::setw(20) << state
+				<< std::setw(20) << constants << std::dec
+				<< (identical ? "identical" : "DIFFERENT") << std::endl;
+		}
+	}
+
+	return passed;
+}
+
+bool ParticleSelfChecks::WriteDepthSortReport(std::ostream& out, int particleCount, int maxThreads)
+{
+	const int repeats = 5;
+
+	std::vector<Particle> pool(particleCount);
+	std::vector<ParticleSort> unsorted(particleCount);
+
+	// a cube of particles in front of the camera in a scrambled draw order
+	unsigned int random = 1;
+	for (int i = 0; i < particleCount; ++i)
+	{
+		memset(&pool[i], 0, sizeof(Particle));
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			random = random * 1664525u + 1013904223u;
+			(&pool[i].Position.x)[axis] = ((float)(random >> 8) / 16777216.0f - 0.5f) * 100.0f;
+		}
+		pool[i].Alive = 1.0f;
+
+		unsorted[i].index = (unsigned int)(((unsigned long long)i * 2654435761u) % particleCount);
+	}
+
+	XMFLOAT4X4 view = Camera(1280, 720).GetViewMatrix();
+
+	// reference order from a comparison sort on the same keys
+	std::vector<std::pair<unsigned int, unsigned int>> reference(particleCount);
+	auto start = Clock::now();
+	for (int repeat = 0; repeat < repeats; ++repeat)
+	{
+		for (int i = 0; i < particleCount; ++i)
+		{
+			unsigned int index = unsorted[i].index;
+			reference[i] = std::make_pair(ParticleDepthSort::DepthKey(ParticleDepthSort::ViewDepth(pool[index].Position, view)), index);
+		}
+
+		std::stable_sort(reference.begin(), reference.end(),
+			[](const std::pair<unsigned int, unsigned int>& a, const std::pair<unsigned int, unsigned int>& b) { return a.first < b.first; });
+	}
+	double comparisonSeconds = SecondsSince(start) / repeats;
+
+	int hardwareThreads = (int)(std::max)(std::thread::hardware_concurrency(), 1u);
+	if (maxThreads <= 0)
+		maxThreads = hardwareThreads;
+
+	std::vector<int> threadCounts;
+	for (int threads = 1; threads < maxThreads; threads *= 2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(maxThreads);
+
+	out << std::endl << "depth sort (" << particleCount << " particles, std::stable_sort "
+		<< comparisonSeconds * 1000.0 << " ms)" << std::endl;
+	out << std::left << std::setw(10) << "threads"
+		<< std::setw(12) << "order"
+		<< std::setw(10) << "skipped"
+		<< std::setw(14) << "radix ms"
+		<< "vs stable_sort" << std::endl;
+
+	bool passed = true;
+	ParticleDepthSort depthSort(particleCount);
+	std::vector<ParticleSort> drawList(particleCount);
+
+	for (int threads : threadCounts)
+	{
+		WorkStealingScheduler scheduler(threads);
+
+		double seconds = 0.0;
+		for (int repeat = 0; repeat < repeats; ++repeat)
+		{
+			drawList = unsorted;
+
+			start = Clock::now();
+			depthSort.Sort(pool.data(), drawList.data(), particleCount, view, threads > 1 ? &scheduler : nullptr);
+			seconds += SecondsSince(start);
+		}
+		seconds /= repeats;
+
+		bool ordered = true;
+		for (int i = 0; i < particleCount && ordered; ++i)
+		{
+			if (drawList[i].index != reference[i].second)
+				ordered = false;
+
+			// back to front
+			if (i > 0 && ParticleDepthSort::ViewDepth(pool[drawList[i].index].Position, view) >
+				ParticleDepthSort::ViewDepth(pool[drawList[i - 1].index].Position, view))
+				ordered = false;
+		}
+
+		if (!ordered)
+			passed = false;
+
+		out << std::left << std::setw(10) << threads
+			<< std::setw(12) << (ordered ? "ok" : "WRONG")
+			<< std::setw(10) << depthSort.GetSkippedPasses()
+			<< std::setw(14) << seconds * 1000.0
+			<< comparisonSeconds / seconds << "x" << std::endl;
+	}
+
+	return passed;
+}
+
+bool ParticleSelfChecks::WriteCullReport(std::ostream& out, int particleCount, int frameCount)
+{
+	std::vector<Particle> pool(particleCount);
+	std::vector<ParticleSort> drawList(particleCount);
+	std::vector<ParticleSort> visibleList(particleCount);
+	std::vector<ParticleSort> reference(particleCount);
+
+	// a cube of particles around the origin with the sizes the geometry shader could be given
+	unsigned int random = 1;
+	for (int i = 0; i < particleCount; ++i)
+	{
+		memset(&pool[i], 0, sizeof(Particle));
+		for (int axis = 0; axis < 4; ++axis)
+		{
+			random = random * 1664525u + 1013904223u;
+			float value = (float)(random >> 8) / 16777216.0f;
+			if (axis < 3)
+				(&pool[i].Position.x)[axis] = (value - 0.5f) * 400.0f;
+			else
+				pool[i].Size = value * 2.0f;
+		}
+		pool[i].Alive = 1.0f;
+
+		drawList[i].index = i;
+	}
+
+	Camera camera(1280, 720);
+	XMFLOAT4X4 startView = camera.GetViewMatrix();
+	XMFLOAT4X4 projection = camera.GetProjectionMatrix();
+	ParticleKernelLevel supported = ParticleUpdateKernel::DetectLevel();
+
+	out << std::endl << "frustum cull camera path (" << particleCount << " particles, one orbit in "
+		<< frameCount << " frames)" << std::endl;
+	out << std::left << std::setw(8) << "frame"
+		<< std::setw(12) << "visible"
+		<< std::setw(12) << "culled"
+		<< std::setw(10) << "culled %";
+	for (int level = 0; level <= supported; ++level)
+		out << std::setw(12) << (std::string(ParticleUpdateKernel::GetLevelName((ParticleKernelLevel)level)) + " ms");
+	out << "lists" << std::endl;
+
+	bool passed = true;
+	unsigned long long visibleTotal = 0;
+	ParticleFrustumCuller culler;
+
+	for (int frame = 0; frame < frameCount; ++frame)
+	{
+		// the camera orbits the origin, the particles stay put
+		XMFLOAT4X4 view;
+		float angle = XM_2PI * frame / frameCount;
+		XMStoreFloat4x4(&view, XMMatrixMultiply(XMMatrixRotationY(angle), XMLoadFloat4x4(&startView)));
+		culler.SetMatrices(view, projection);
+
+		XMFLOAT4X4 viewProjection;
+		XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&projection)));
+
+		unsigned int visible = 0;
+		double seconds[ParticleKernelLevelCount] = {};
+		bool listsMatch = true;
+
+		for (int level = 0; level <= supported; ++level)
+		{
+			auto start = Clock::now();
+			unsigned int count = culler.Cull((ParticleKernelLevel)level, pool.data(), drawList.data(), particleCount, visibleList.data());
+			seconds[level] = SecondsSince(start);
+
+			if (level == ParticleKernelScalar)
+			{
+				visible = count;
+				memcpy(reference.data(), visibleList.data(), sizeof(ParticleSort) * count);
+			}
+			else if (count != visible || memcmp(reference.data(), visibleList.data(), sizeof(ParticleSort) * count) != 0)
+			{
+				listsMatch = false;
+			}
+		}
+
+		// culling is conservative, a particle whose center lands inside the clip volume must have been kept
+		std::vector<unsigned char> kept(particleCount, 0);
+		for (unsigned int i = 0; i < visible; ++i)
+			kept[reference[i].index] = 1;
+
+		for (int i = 0; i < particleCount && listsMatch; ++i)
+		{
+			const XMFLOAT3& p = pool[i].Position;
+			const XMFLOAT4X4& m = viewProjection;
+			float x = p.x * m._11 + p.y * m._21 + p.z * m._31 + m._41;
+			float y = p.x * m._12 + p.y * m._22 + p.z * m._32 + m._42;
+			float z = p.x * m._13 + p.y * m._23 + p.z * m._33 + m._43;
+			float w = p.x * m._14 + p.y * m._24 + p.z * m._34 + m._44;
+
+			// a small margin keeps rounding on the boundary out of it
+			float margin = 0.999f;
+			bool inside = w > 0.0f && fabsf(x) < w * margin && fabsf(y) < w * margin && z > 0.0f && z < w * margin;
+			if (inside && !kept[i])
+				listsMatch = false;
+		}
+
+		if (!listsMatch)
+			passed = false;
+
+		visibleTotal += visible;
+		unsigned int culled = particleCount - visible;
+
+		out << std::left << std::setw(8) << frame
+			<< std::setw(12) << visible
+			<< std::setw(12) << culled
+			<< std::setw(10) << 100.0 * culled / particleCount;
+		for (int level = 0; level <= supported; ++level)
+			out << std::setw(12) << seconds[level] * 1000.0;
+		out << (listsMatch ? "ok" : "WRONG") << std::endl;
+	}
+
+	out << "average visible: " << (double)visibleTotal / frameCount
+		<< "  culled: " << particleCount - (double)visibleTotal / frameCount << std::endl;
+
+	return passed;
+}
+
+bool ParticleSelfChecks::WritePackedReport(std::ostream& out, int particleCount, int stepCount)
+{
+	const float deltaTime = 1.0f / 60.0f;
+	const float lifeTime = 200.0f;
+
+	ParticleKernelLevel level = ParticleUpdateKernel::DetectLevel();
+	bool f16c = level == ParticleKernelAVX2 && ParticlePacking::HasF16C();
+
+	out << std::endl << "32-byte packed particles (" << particleCount << " particles, " << stepCount << " steps, "
+		<< (f16c ? "F16C" : "scalar") << " conversion)" << std::endl;
+
+	// every fp16 value and a sweep over the fp32 range convert exactly like the scalar reference
+	bool conversionsMatch = true;
+	if (f16c)
+	{
+		for (unsigned int half = 0; half < 0x10000 && conversionsMatch; ++half)
+		{
+			float reference = ParticlePacking::HalfToFloat((unsigned short)half);
+			float converted = ParticlePacking::HalfToFloatF16C((unsigned short)half);
+			if (memcmp(&reference, &converted, sizeof(float)) != 0)
+				conversionsMatch = false;
+		}
+
+		for (unsigned long long bits = 0; bits < 0x100000000ull && conversionsMatch; bits += 251)
+		{
+			float value;
+			unsigned int word = (unsigned int)bits;
+			memcpy(&value, &word, sizeof(value));
+
+			if (ParticlePacking::FloatToHalf(value) != ParticlePacking::FloatToHalfF16C(value))
+				conversionsMatch = false;
+		}
+	}
+
+	// a cube of particles with ages spread so the deaths spread over the run
+	std::vector<Particle> particles(particleCount);
+	unsigned int random = 1;
+	auto next = [&random]()
+	{
+		random = random * 1664525u + 1013904223u;
+		return (float)(random >> 8) / 16777216.0f;
+	};
+
+	for (int i = 0; i < particleCount; ++i)
+	{
+		Particle& particle = particles[i];
+		memset(&particle, 0, sizeof(Particle));
+		particle.Color = XMFLOAT4(next(), next(), next(), 1.0f);
+		particle.Position = XMFLOAT3((next() - 0.5f) * 100.0f, (next() - 0.5f) * 100.0f, (next() - 0.5f) * 100.0f);
+		particle.Age = next() * 100.0f;
+		particle.Size = 0.5f + next() * 1.5f;
+		particle.Alive = 1.0f;
+	}
+
+	std::vector<PackedParticle> records(particleCount);
+	std::vector<PackedParticle> scalarRecords(particleCount);
+	ParticlePacking::Pack(level, particles.data(), records.data(), particleCount);
+	ParticlePacking::PackScalar(particles.data(), scalarRecords.data(), particleCount);
+	if (memcmp(records.data(), scalarRecords.data(), sizeof(PackedParticle) * particleCount) != 0)
+		conversionsMatch = false;
+
+	// both runs start from the rounded state, so the errors below come from the steps alone
+	ParticlePacking::Unpack(level, records.data(), particles.data(), particleCount);
+
+	std::vector<unsigned int> deadList(particleCount);
+	std::vector<ParticleSort> drawList(particleCount);
+	std::vector<int> deathStep[2];
+	deathStep[0].assign(particleCount, -1);
+	deathStep[1].assign(particleCount, -1);
+	std::vector<Particle> unpacked(particleCount);
+
+	out << "fp16/fp32 conversions: " << (conversionsMatch ? "match" : "DIFFERENT") << std::endl;
+	out << std::left << std::setw(10) << "step"
+		<< std::setw(10) << "alive"
+		<< std::setw(12) << "mismatched"
+		<< std::setw(16) << "max position"
+		<< std::setw(16) << "mean position"
+		<< std::setw(16) << "max velocity"
+		<< "max age" << std::endl;
+
+	double seconds[2] = {};
+	int reportStep = 1;
+
+	for (int step = 1; step <= stepCount; ++step)
+	{
+		for (int run = 0; run < 2; ++run)
+		{
+			ParticleUpdateOutput output;
+			output.DeadList = deadList.data();
+			output.DrawList = drawList.data();
+
+			auto start = Clock::now();
+			if (run == 0)
+				ParticleUpdateKernel::Update(level, particles.data(), 0, particleCount, deltaTime, lifeTime, output);
+			else
+				ParticlePacking::Update(level, records.data(), 0, particleCount, deltaTime, lifeTime, output);
+			seconds[run] += SecondsSince(start);
+
+			for (unsigned int i = 0; i < output.DeadCount; ++i)
+				deathStep[run][deadList[i]] = step;
+		}
+
+		if (step != reportStep && step != stepCount)
+			continue;
+		reportStep *= 10;
+
+		ParticlePacking::Unpack(level, records.data(), unpacked.data(), particleCount);
+
+		int alive = 0;
+		int mismatched = 0;
+		double maxPosition = 0.0;
+		double sumPosition = 0.0;
+		double maxVelocity = 0.0;
+		double maxAge = 0.0;
+
+		for (int i = 0; i < particleCount; ++i)
+		{
+			const Particle& reference = particles[i];
+			const Particle& packed = unpacked[i];
+
+			if ((reference.Alive != 0.0f) != (packed.Alive != 0.0f))
+			{
+				mismatched++;
+				continue;
+			}
+
+			if (reference.Alive == 0.0f)
+				continue;
+
+			alive++;
+
+			double dx = (double)packed.Position.x - reference.Position.x;
+			double dy = (double)packed.Position.y - reference.Position.y;
+			double dz = (double)packed.Position.z - reference.Position.z;
+			double position = sqrt(dx * dx + dy * dy + dz * dz);
+
+			dx = (double)packed.Velocity.x - reference.Velocity.x;
+			dy = (double)packed.Velocity.y - reference.Velocity.y;
+			dz = (double)packed.Velocity.z - reference.Velocity.z;
+
+			maxPosition = (std::max)(maxPosition, position);
+			sumPosition += position;
+			maxVelocity = (std::max)(maxVelocity, sqrt(dx * dx + dy * dy + dz * dz));
+			maxAge = (std::max)(maxAge, fabs((double)packed.Age - reference.Age));
+		}
+
+		out << std::left << std::setw(10) << step
+			<< std::setw(10) << alive
+			<< std::setw(12) << mismatched
+			<< std::setw(16) << maxPosition
+			<< std::setw(16) << (alive > 0 ? sumPosition / alive : 0.0)
+			<< std::setw(16) << maxVelocity
+			<< maxAge << std::endl;
+	}
+
+	// the compensated age keeps every expiry within a step of the fp32 one,
+	// a particle still alive after the last step counts as expiring on the step after it
+	int maxDeathOffset = 0;
+	for (int i = 0; i < particleCount; ++i)
+	{
+		int reference = deathStep[0][i] < 0 ? stepCount + 1 : deathStep[0][i];
+		int packed = deathStep[1][i] < 0 ? stepCount + 1 : deathStep[1][i];
+		maxDeathOffset = (std::max)(maxDeathOffset, abs(reference - packed));
+	}
+
+	out << "expiry: largest offset " << maxDeathOffset << " steps" << std::endl;
+	out << "update: fp32 " << seconds[0] * 1000.0 / stepCount << " ms/step (" << sizeof(Particle) << " bytes), packed "
+		<< seconds[1] * 1000.0 / stepCount << " ms/step (" << sizeof(PackedParticle) << " bytes)" << std::endl;
+
+	return conversionsMatch && maxDeathOffset <= 1;
+}
+
+bool ParticleSelfChecks::WriteEmitterReport(std::ostream& out, int particleCount, int frameCount)
+{
+	const int emitterCounts[] = { 1, 4, 16, 64 };
+
+	out << std::endl << "shared pool against one pool per emitter (" << particleCount << " particles in total)" << std::endl;
+	out << std::left << std::setw(10) << "emitters"
+		<< std::setw(16) << "dispatches"
+		<< std::setw(12) << "drawn"
+		<< std::setw(14) << "shared ms"
+		<< std::setw(14) << "separate ms"
+		<< "lists" << std::endl;
+
+	bool passed = true;
+
+	for (int emitterCount : emitterCounts)
+	{
+		// the same emitters twice, once sharing a pool and once with a pool each
+		ParticleBenchmarkSettings settings;
+		settings.MaxParticles = particleCount;
+		settings.EmissionRate = (float)particleCount;
+		settings.LifeTime = 0.5f;
+		settings.ThreadCount = 1;
+		settings.EmitterCount = emitterCount;
+
+		ParticleBenchmark shared(settings);
+
+		settings.MaxParticles = particleCount / emitterCount;
+		settings.EmitterCount = 1;
+
+		std::vector<std::unique_ptr<ParticleBenchmark>> separate;
+		for (int i = 0; i < emitterCount; ++i)
+		{
+			settings.EmissionRate = (float)particleCount / emitterCount;
+			settings.LifeTime = 0.5f * (i + 1) / emitterCount;
+			separate.emplace_back(new ParticleBenchmark(settings));
+		}
+
+		shared.Start();
+		for (auto& benchmark : separate)
+		{
+			benchmark->Start();
+		}
+
+		double sharedSeconds = 0.0;
+		double separateSeconds = 0.0;
+		float totalTime = 0.0f;
+
+		for (int frame = 0; frame < frameCount; ++frame)
+		{
+			auto start = Clock::now();
+			shared.SimulateFrame(settings.DeltaTime, totalTime);
+			sharedSeconds += SecondsSince(start);
+
+			start = Clock::now();
+			for (auto& benchmark : separate)
+				benchmark->SimulateFrame(settings.DeltaTime, totalTime);
+			separateSeconds += SecondsSince(start);
+
+			totalTime += settings.DeltaTime;
+		}
+
+		// both setups emit and expire at the same rates, so every emitter has to draw as many particles either way
+		bool listsMatch = shared.GetInvariantFailures() == 0;
+		unsigned int drawn = shared.GetParticleSystem().GetDrawArgs()[0];
+		for (int i = 0; i < emitterCount && listsMatch; ++i)
+		{
+			unsigned int sharedCount = emitterCount > 1 ? shared.GetParticleSystem().GetEmitterDrawArgs()[9 * i] : drawn;
+			if (separate[i]->GetInvariantFailures() != 0 || separate[i]->GetParticleSystem().GetDrawArgs()[0] != sharedCount)
+				listsMatch = false;
+		}
+
+		if (!listsMatch)
+			passed = false;
+
+		// emit, update and copy per chain, the emit dispatches are the same either way
+		int sharedDispatches = 2;
+		int separateDispatches = 2 * emitterCount;
+
+		out << std::left << std::setw(10) << emitterCount
+			<< std::setw(16) << (std::to_string(sharedDispatches) + " / " + std::to_string(separateDispatches))
+			<< std::setw(12) << drawn
+			<< std::setw(14) << sharedSeconds * 1000.0 / frameCount
+			<< std::setw(14) << separateSeconds * 1000.0 / frameCount
+			<< (listsMatch ? "ok" : "WRONG") << std::endl;
+	}
+
+	return passed;
+}
+
+bool ParticleSelfChecks::WritePlannerReport(std::ostream& out)
+{
+	struct Scenario
+	{
+		const char* Name;
+		float Rate;
+		float DeltaTime;
+		int StepCount;
+
+		// free dead list slots per step
+		unsigned int FreeCount;
+	};
+
+	const Scenario scenarios[] =
+	{
+		{ "Game emitter", 1000000.0f, 1.0f / 60.0f, 600, 0xffffffffu },
+		{ "odd rate", 37.3f, 1.0f / 144.0f, 100000, 0xffffffffu },
+		{ "slow rate", 0.7f, 1.0f / 60.0f, 36000, 0xffffffffu },
+		{ "dead list cap", 1000000.0f, 1.0f / 60.0f, 600, 1000 },
+		{ "5 s hitch", 1000000.0f, 5.0f, 1, 0xffffffffu },
+	};
+
+	out << std::endl << "emission planner" << std::endl;
+	out << std::left << std::setw(16) << "scenario"
+		<< std::setw(14) << "expected"
+		<< std::setw(14) << "requested"
+		<< std::setw(14) << "emitted"
+		<< std::setw(14) << "dropped"
+		<< std::setw(14) << "groups"
+		<< std::setw(14) << "old loop"
+		<< std::setw(16) << "old threads"
+		<< "result" << std::endl;
+
+	bool passed = true;
+
+	for (const Scenario& scenario : scenarios)
+	{
+		Emitter emitter(1000000, 100, scenario.Rate, 1.0f, XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f),
+			XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f), XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f));
+		Emitter oldEmitter = emitter;
+
+		EmissionPlanner planner;
+		unsigned long long groups = 0;
+		unsigned long long oldEmitted = 0;
+		unsigned long long oldThreads = 0;
+		bool batchesValid = true;
+
+		for (int step = 0; step < scenario.StepCount; ++step)
+		{
+			emitter.Update(0.0f, scenario.DeltaTime);
+
+			EmissionBatch batch = planner.Plan(emitter, scenario.FreeCount);
+			groups += batch.GroupCount;
+
+			// every planned particle gets a thread and no group is launched without one
+			if (batch.GroupCount > EmissionPlanner::MaxGroupCount || batch.GroupCount * EmissionPlanner::ThreadGroupSize < batch.EmitCount ||
+				(batch.GroupCount > 0 && (batch.GroupCount - 1) * EmissionPlanner::ThreadGroupSize >= batch.EmitCount) ||
+				(unsigned int)emitter.GetEmitCount() != batch.EmitCount)
+			{
+				batchesValid = false;
+			}
+
+			// the loop Game::Draw used to run, its clamp and fmod throw away whatever is past 65535
+			// and it dispatched a group of 32 threads per particle
+			oldEmitter.Update(0.0f, scenario.DeltaTime);
+			while (oldEmitter.GetEmitTimeCounter() >= oldEmitter.GetTimeBetweenEmit())
+			{
+				oldEmitter.SetEmitCount((int)(oldEmitter.GetEmitTimeCounter() / oldEmitter.GetTimeBetweenEmit()));
+
+				oldEmitter.SetEmitCount(min(oldEmitter.GetEmitCount(), 65535));
+				oldEmitter.SetEmitTimeCounter(fmod(oldEmitter.GetEmitTimeCounter(), oldEmitter.GetTimeBetweenEmit()));
+
+				oldEmitted += (std::min)((unsigned int)oldEmitter.GetEmitCount(), scenario.FreeCount);
+				oldThreads += (unsigned long long)oldEmitter.GetEmitCount() * EmissionPlanner::ThreadGroupSize;
+			}
+		}
+
+		// the time fed in is the only input, the planner may be one spawn behind it from float rounding of the steps
+		double expected = floor((double)scenario.Rate * scenario.DeltaTime * scenario.StepCount);
+		double requested = (double)planner.GetRequestedCount();
+		unsigned long long cap = (std::min)((unsigned long long)scenario.FreeCount, (unsigned long long)EmissionPlanner::MaxEmitCount) * scenario.StepCount;
+
+		bool countsMatch = fabs(requested - expected) <= 1.0 &&
+			planner.GetEmittedCount() == (std::min)(planner.GetRequestedCount(), cap) &&
+			planner.GetRequestedCount() == planner.GetEmittedCount() + planner.GetDroppedCount();
+
+		if (!countsMatch || !batchesValid)
+			passed = false;
+
+		out << std::left << std::setw(16) << scenario.Name
+			<< std::setw(14) << (unsigned long long)expected
+			<< std::setw(14) << planner.GetRequestedCount()
+			<< std::setw(14) << planner.GetEmittedCount()
+			<< std::setw(14) << planner.GetDroppedCount()
+			<< std::setw(14) << groups
+			<< std::setw(14) << oldEmitted
+			<< std::setw(16) << oldThreads
+			<< (!batchesValid ? "BAD BATCH" : (countsMatch ? "ok" : "WRONG")) << std::endl;
+	}
+
+	// the whole CPU pipeline, the pool fills exactly and the dead list never runs dry
+	ParticleBenchmarkSettings settings;
+	settings.MaxParticles = 100000;
+	settings.FrameCount = 60;
+	settings.ThreadCount = 1;
+
+	ParticleBenchmark benchmark(settings);
+	benchmark.Run();
+
+	bool filled = benchmark.GetParticleSystem().GetDrawArgs()[0] == (unsigned int)settings.MaxParticles &&
+		benchmark.GetParticleSystem().GetEmitUnderflowCount() == 0 &&
+		benchmark.GetPlanner().GetEmittedCount() == (unsigned long long)settings.MaxParticles &&
+		benchmark.GetInvariantFailures() == 0;
+
+	if (!filled)
+		passed = false;
+
+	out << settings.MaxParticles << " slots over " << settings.FrameCount << " frames: requested " << benchmark.GetPlanner().GetRequestedCount()
+		<< "  emitted " << benchmark.GetPlanner().GetEmittedCount()
+		<< "  dropped " << benchmark.GetPlanner().GetDroppedCount()
+		<< "  underflows " << benchmark.GetParticleSystem().GetEmitUnderflowCount()
+		<< "  " << (filled ? "ok" : "WRONG") << std::endl;
+
+	return passed;
+}
+
+bool ParticleSelfChecks::WriteShapeReport(std::ostream& out, int sampleCount)
+{
+	const float gridSize = 100.0f;
+
+	MeshSurfaceSampler cylinder;
+	bool cylinderLoaded = ParticleBenchmark::LoadMesh(cylinder);
+	if (!cylinderLoaded)
+		BuildRandomMesh(cylinder, 64);
+
+	// the numbers are drawn up front so only the shape is timed
+	std::vector<float> numbers((size_t)sampleCount * 4);
+	for (int i = 0; i < sampleCount; ++i)
+		EmissionShape::Random((unsigned int)i, &numbers[(size_t)i * 4]);
+
+	std::vector<XMFLOAT3> positions(sampleCount);
+
+	out << std::endl << "emission shapes (" << sampleCount << " spawns each";
+	if (cylinderLoaded)
+		out << ", cylinder.obj " << cylinder.GetTriangleCount() << " triangles)" << std::endl;
+	else
+		out << ", cylinder.obj FAILED to load, 64 random triangles instead)" << std::endl;
+
+	out << std::left << std::setw(10) << "shape"
+		<< std::setw(12) << "ns/spawn"
+		<< std::setw(16) << "statistic"
+		<< std::setw(12) << "measured"
+		<< std::setw(12) << "expected"
+		<< "result" << std::endl;
+
+	bool passed = true;
+
+	for (int type = EmissionShapeSphere; type < EmissionShapeTypeCount; ++type)
+	{
+		EmissionShape shape = ParticleBenchmark::MakeShape((EmissionShapeType)type, gridSize, &cylinder);
+
+		auto start = Clock::now();
+		for (int i = 0; i < sampleCount; ++i)
+			positions[i] = shape.Sample(&numbers[(size_t)i * 4]);
+		double seconds = SecondsSince(start);
+
+		// a small slack for the rounding of the trigonometry
+		const float slack = 1e-4f * gridSize;
+
+		const char* statistic = "";
+		double measured = 0.0;
+		double expected = 0.0;
+		double tolerance = 0.01;
+		bool inside = true;
+
+		if (type == EmissionShapeMesh)
+		{
+			// Sample picks its triangle from u[0] and u[3], so the same numbers give the frequencies
+			std::vector<unsigned int> hits(cylinder.GetTriangleCount(), 0);
+			for (int i = 0; i < sampleCount; ++i)
+				hits[cylinder.SampleTriangle(numbers[(size_t)i * 4 + 0], numbers[(size_t)i * 4 + 3])]++;
+
+			double chiSquare = 0.0;
+			unsigned int degreesOfFreedom = 0;
+			for (unsigned int t = 0; t < cylinder.GetTriangleCount(); ++t)
+			{
+				double expectedHits = (double)sampleCount * cylinder.GetTriangleArea(t) / cylinder.GetSurfaceArea();
+
+				// a triangle without area must never be picked
+				if (expectedHits <= 0.0)
+				{
+					if (hits[t] != 0)
+						inside = false;
+					continue;
+				}
+
+				chiSquare += (hits[t] - expectedHits) * (hits[t] - expectedHits) / expectedHits;
+				degreesOfFreedom++;
+			}
+
+			// chi-square over its degrees of freedom is about 1 for a correct table, five sigma above is a failure
+			degreesOfFreedom = (std::max)(degreesOfFreedom - 1, 1u);
+			statistic = "chi2/dof";
+			measured = chiSquare / degreesOfFreedom;
+			expected = 1.0;
+			tolerance = 5.0 * sqrt(2.0 / degreesOfFreedom);
+		}
+		else
+		{
+			double sum = 0.0;
+			for (int i = 0; i < sampleCount; ++i)
+			{
+				XMFLOAT3 d(positions[i].x - shape.Center.x, positions[i].y - shape.Center.y, positions[i].z - shape.Center.z);
+
+				switch (type)
+				{
+				case EmissionShapeSphere:
+				{
+					float radius = sqrtf(d.x * d.x + d.y * d.y + d.z * d.z);
+					inside = inside && radius <= shape.Radius + slack;
+					sum += radius / shape.Radius;
+					break;
+				}
+				case EmissionShapeBox:
+					inside = inside && fabsf(d.x) <= shape.Extents.x + slack && fabsf(d.y) <= shape.Extents.y + slack && fabsf(d.z) <= shape.Extents.z + slack;
+					sum += (fabsf(d.x) / shape.Extents.x + fabsf(d.y) / shape.Extents.y + fabsf(d.z) / shape.Extents.z) / 3.0;
+					break;
+				case EmissionShapeDisc:
+				{
+					float radius = sqrtf(d.x * d.x + d.z * d.z);
+					inside = inside && d.y == 0.0f && radius <= shape.Radius + slack;
+					sum += radius / shape.Radius;
+					break;
+				}
+				case EmissionShapeCone:
+				{
+					float radius = sqrtf(d.x * d.x + d.z * d.z);
+					inside = inside && d.y >= 0.0f && d.y <= shape.Height + slack && radius <= shape.Radius * d.y / shape.Height + slack;
+					sum += d.y / shape.Height;
+					break;
+				}
+				}
+			}
+
+			// uniform density puts the mean distance at 3/4 of a sphere radius, 2/3 of a disc radius,
+			// 3/4 of the cone height from the apex and half the box extents
+			const char* statistics[] = { "", "mean r/R", "mean |d|/E", "mean r/R", "mean h/H" };
+			const double means[] = { 0.0, 0.75, 0.5, 2.0 / 3.0, 0.75 };
+
+			statistic = statistics[type];
+			measured = sum / sampleCount;
+			expected = means[type];
+		}
+
+		bool distributed = fabs(measured - expected) <= tolerance;
+		if (!inside || !distributed)
+			passed = false;
+
+		out << std::left << std::setw(10) << EmissionShape::GetTypeName((EmissionShapeType)type)
+			<< std::setw(12) << seconds * 1e9 / sampleCount
+			<< std::setw(16) << statistic
+			<< std::setw(12) << measured
+			<< std::setw(12) << expected
+			<< (!inside ? "OUTSIDE" : (distributed ? "ok" : "OFF")) << std::endl;
+	}
+
+	// the alias table is one compare per spawn whatever the triangle count, what grows is the cache footprint
+	const unsigned int triangleCounts[] = { 16, 4096, 1 << 20 };
+
+	out << std::endl << "mesh spawn cost against triangle count" << std::endl;
+	out << std::left << std::setw(12) << "triangles"
+		<< std::setw(12) << "build ms"
+		<< std::setw(12) << "ns/spawn"
+		<< "against 16" << std::endl;
+
+	double smallest = 0.0;
+	for (unsigned int triangleCount : triangleCounts)
+	{
+		MeshSurfaceSampler mesh;
+
+		auto start = Clock::now();
+		BuildRandomMesh(mesh, triangleCount);
+		double buildSeconds = SecondsSince(start);
+
+		EmissionShape shape = ParticleBenchmark::MakeShape(EmissionShapeMesh, gridSize, &mesh);
+
+		start = Clock::now();
+		for (int i = 0; i < sampleCount; ++i)
+			positions[i] = shape.Sample(&numbers[(size_t)i * 4]);
+		double nanoseconds = SecondsSince(start) * 1e9 / sampleCount;
+
+		if (smallest == 0.0)
+			smallest = nanoseconds;
+
+		out << std::left << std::setw(12) << triangleCount
+			<< std::setw(12) << buildSeconds * 1000.0
+			<< std::setw(12) << nanoseconds
+			<< nanoseconds / smallest << "x" << std::endl;
+	}
+
+	// the whole Emit stage, dead list pops and particle writes included
+	TimeConstants time = MakeTimeConstants();
+	time.TotalTime = 1.0f;
+
+	ParticleConstants constants = MakeParticleConstants(sampleCount, sampleCount, 1000.0f);
+	constants.GridSize = (int)gridSize;
+
+	out << std::endl << "Emit of " << sampleCount << " particles" << std::endl;
+	out << std::left << std::setw(10) << "shape" << "spawns/s" << std::endl;
+
+	for (int type = EmissionShapeGrid; type < EmissionShapeTypeCount; ++type)
+	{
+		EmissionShape shape = ParticleBenchmark::MakeShape((EmissionShapeType)type, gridSize, &cylinder);
+
+		CPUParticleSystem particleSystem(sampleCount);
+		particleSystem.DeadListInit(constants);
+		particleSystem.Emit(time, constants, 0, &shape);
+
+		out << std::left << std::setw(10) << EmissionShape::GetTypeName((EmissionShapeType)type)
+			<< particleSystem.GetStageStats(ParticleStageEmit).ParticlesPerSecond() << std::endl;
+	}
+
+	return passed;
+}
+
+bool ParticleSelfChecks::WriteRingReport(std::ostream& out, int particleCount, int frameCount)
+{
+	// the pool fills in one second, so the lifetime sets the occupancy
+	const float lifeTimes[] = { 0.05f, 0.1f, 0.25f, 0.5f, 1.0f };
+	const ParticleUpdateMode modes[] = { ParticleUpdatePool, ParticleUpdateAliveList, ParticleUpdateRing };
+
+	out << std::endl << "dead list, alive list and FIFO ring (" << particleCount << " pool slots, " << frameCount << " frames)" << std::endl;
+	out << std::left << std::setw(12) << "occupancy"
+		<< std::setw(10) << "drawn"
+		<< std::setw(10) << "init ms"
+		<< std::setw(14) << "emit ms pool"
+		<< std::setw(14) << "emit ms ring"
+		<< std::setw(14) << "pool ms"
+		<< std::setw(14) << "alive ms"
+		<< std::setw(14) << "ring ms"
+		<< "result" << std::endl;
+
+	bool passed = true;
+
+	for (float lifeTime : lifeTimes)
+	{
+		ParticleBenchmarkSettings settings;
+		settings.MaxParticles = particleCount;
+		settings.EmissionRate = (float)particleCount;
+		settings.LifeTime = lifeTime;
+		settings.ThreadCount = 1;
+
+		std::vector<std::unique_ptr<ParticleBenchmark>> benchmarks;
+		for (ParticleUpdateMode mode : modes)
+		{
+			settings.UpdateMode = mode;
+			benchmarks.emplace_back(new ParticleBenchmark(settings));
+
+			ParticleBenchmark& benchmark = *benchmarks.back();
+			benchmark.Start();
+		}
+
+		// the same emission and expiry in every mode, so the counts have to agree every frame
+		bool countsMatch = true;
+		float totalTime = 0.0f;
+		for (int frame = 0; frame < frameCount; ++frame)
+		{
+			totalTime += settings.DeltaTime;
+			for (auto& benchmark : benchmarks)
+				benchmark->SimulateFrame(settings.DeltaTime, totalTime);
+
+			unsigned int drawn = benchmarks[0]->GetParticleSystem().GetDrawArgs()[0];
+			for (auto& benchmark : benchmarks)
+			{
+				if (benchmark->GetParticleSystem().GetDrawArgs()[0] != drawn || benchmark->GetInvariantFailures() != 0)
+					countsMatch = false;
+			}
+		}
+
+		const CPUParticleSystem& ring = benchmarks[2]->GetParticleSystem();
+		if (ring.GetRingHoleCount() != 0 || ring.GetRingCount() != ring.GetDrawArgs()[0])
+			countsMatch = false;
+
+		if (!countsMatch)
+			passed = false;
+
+		double updateMs[3];
+		for (int i = 0; i < 3; ++i)
+			updateMs[i] = benchmarks[i]->GetParticleSystem().GetStageStats(ParticleStageUpdate).Seconds * 1000.0 / frameCount;
+
+		out << std::left << std::setw(12) << (std::to_string((int)(lifeTime * 100.0f + 0.5f)) + "%")
+			<< std::setw(10) << benchmarks[0]->GetParticleSystem().GetDrawArgs()[0]
+			<< std::setw(10) << benchmarks[0]->GetParticleSystem().GetStageStats(ParticleStageDeadListInit).Seconds * 1000.0
+			<< std::setw(14) << benchmarks[0]->GetParticleSystem().GetStageStats(ParticleStageEmit).Seconds * 1000.0 / frameCount
+			<< std::setw(14) << ring.GetStageStats(ParticleStageEmit).Seconds * 1000.0 / frameCount
+			<< std::setw(14) << updateMs[0]
+			<< std::setw(14) << updateMs[1]
+			<< std::setw(14) << updateMs[2]
+			<< (countsMatch ? "ok" : "DIFFER") << std::endl;
+	}
+
+	return passed;
+}
+
+bool ParticleSelfChecks::WriteOccupancyReport(std::ostream& out, int particleCount, int frameCount)
+{
+	const int occupancies[] = { 1, 2, 5, 10, 25, 50, 75, 100 };
+
+	TimeConstants time = MakeTimeConstants();
+	ParticleConstants constants = MakeParticleConstants(particleCount, 0, 1000.0f);
+
+	out << std::endl << "update cost against occupancy (" << particleCount << " pool slots)" << std::endl;
+	out << std::left << std::setw(12) << "occupancy"
+		<< std::setw(12) << "alive"
+		<< std::setw(12) << "lists"
+		<< std::setw(14) << "pool ms"
+		<< std::setw(14) << "alive ms"
+		<< "speedup" << std::endl;
+
+	bool passed = true;
+
+	for (int occupancy : occupancies)
+	{
+		constants.EmitCount = (std::max)(particleCount / 100 * occupancy, 1);
+
+		double seconds[2];
+		std::vector<unsigned int> drawn[2];
+
+		for (int mode = 0; mode < 2; ++mode)
+		{
+			CPUParticleSystem particleSystem(particleCount);
+			particleSystem.SetUpdateMode(mode == 0 ? ParticleUpdatePool : ParticleUpdateAliveList);
+
+			particleSystem.DeadListInit(constants);
+			particleSystem.Emit(time, constants);
+
+			for (int frame = 0; frame < frameCount; ++frame)
+				SimulatePoolFrame(particleSystem, time, constants, false);
+
+			seconds[mode] = particleSystem.GetStageStats(ParticleStageUpdate).Seconds / frameCount;
+
+			drawn[mode].resize(particleSystem.GetDrawArgs()[0]);
+			for (size_t i = 0; i < drawn[mode].size(); ++i)
+				drawn[mode][i] = particleSystem.GetDrawList()[i].index;
+
+			// the alive list draws the same particles in its own order
+			std::sort(drawn[mode].begin(), drawn[mode].end());
+		}
+
+		bool listsMatch = drawn[0] == drawn[1] && drawn[0].size() == (size_t)constants.EmitCount;
+		if (!listsMatch)
+			passed = false;
+
+		out << std::left << std::setw(12) << occupancy
+			<< std::setw(12) << constants.EmitCount
+			<< std::setw(12) << (listsMatch ? "match" : "DIFFER")
+			<< std::setw(14) << seconds[0] * 1000.0
+			<< std::setw(14) << seconds[1] * 1000.0
+			<< seconds[0] / seconds[1] << std::endl;
+	}
+
+	return passed;
+}
+
+bool ParticleSelfChecks::WriteDeadListReport(std::ostream& out, int capacity)
+{
+	const unsigned int batchSizes[] = { 1, 64 };
+	const unsigned int operationsPerThread = 200000;
+
+	bool passed = true;
+
+	// asking for one more than the stack holds takes everything and reports it
+	{
+		DeadListStack stack(capacity);
+		stack.Reset(capacity);
+
+		std::vector<unsigned int> indices(capacity + 1);
+		unsigned int taken = stack.ConsumeN(indices.data(), capacity + 1);
+
+		unsigned int index;
+		bool emptyConsume = stack.Consume(index);
+
+		if (taken != (unsigned int)capacity || emptyConsume || stack.GetUnderflowCount() != 2)
+			passed = false;
+	}
+
+	out << std::endl << "dead list stack contention (" << capacity << " indices)" << std::endl;
+	out << std::left << std::setw(10) << "threads"
+		<< std::setw(8) << "batch"
+		<< std::setw(12) << "indices"
+		<< std::setw(14) << "retries/op"
+		<< std::setw(14) << "Mops/s"
+		<< "Mindices/s" << std::endl;
+
+	for (unsigned int batchSize : batchSizes)
+	{
+		for (int threadCount = 1; threadCount <= 64; threadCount *= 2)
+		{
+			DeadListStack stack(capacity);
+			stack.Reset(capacity);
+
+			std::atomic<int> ready(0);
+			std::atomic<bool> go(false);
+			std::vector<std::thread> threads;
+
+			for (int t = 0; t < threadCount; ++t)
+			{
+				threads.push_back(std::thread([&]
+				{
+					std::vector<unsigned int> indices(batchSize);
+
+					ready++;
+					while (!go)
+						std::this_thread::yield();
+
+					// an emit batch followed by the same particles dying again
+					for (unsigned int i = 0; i < operationsPerThread; ++i)
+					{
+						unsigned int taken = stack.ConsumeN(indices.data(), batchSize);
+						stack.AppendN(indices.data(), taken);
+					}
+				}));
+			}
+
+			while (ready < threadCount)
+				std::this_thread::yield();
+
+			auto start = Clock::now();
+			go = true;
+
+			for (auto& thread : threads)
+				thread.join();
+
+			double seconds = SecondsSince(start);
+
+			// every index has to come back exactly once
+			std::vector<unsigned int> indices(capacity);
+			std::vector<unsigned char> seen(capacity, 0);
+			unsigned int remaining = stack.ConsumeN(indices.data(), capacity);
+
+			bool intact = remaining == (unsigned int)capacity && stack.GetCount() == 0;
+			for (unsigned int i = 0; i < remaining && intact; ++i)
+			{
+				if (indices[i] >= (unsigned int)capacity || seen[indices[i]]++)
+					intact = false;
+			}
+
+			if (!intact)
+				passed = false;
+
+			double operations = 2.0 * operationsPerThread * threadCount;
+
+			out << std::left << std::setw(10) << threadCount
+				<< std::setw(8) << batchSize
+				<< std::setw(12) << (intact ? "intact" : "CORRUPT")
+				<< std::setw(14) << stack.GetRetryCount() / operations
+				<< std::setw(14) << operations / seconds / 1e6
+				<< operations * batchSize / seconds / 1e6 << std::endl;
+		}
+	}
+
+	return passed;
+}
+
+bool ParticleSelfChecks::WriteBirthReport(std::ostream& out, int particleCount, int frameCount)
+{
+	const float lifeTimes[] = { 0.25f, 1.0f, 1000.0f };
+	const float rebasePeriod = 0.5f;
+
+	TimeConstants time = MakeTimeConstants();
+
+	// the pool fills in one second
+	ParticleConstants constants = MakeParticleConstants(particleCount, (std::max)(particleCount / 60, 1), 0.0f);
+
+	out << std::endl << "age against birth time (" << particleCount << " pool slots, " << frameCount << " frames, rebase every "
+		<< rebasePeriod << " s)" << std::endl;
+	out << std::left << std::setw(12) << "lifetime"
+		<< std::setw(14) << "frames differ"
+		<< std::setw(12) << "max diff"
+		<< std::setw(10) << "rebases"
+		<< std::setw(12) << "age ms"
+		<< std::setw(12) << "birth ms"
+		<< "speedup" << std::endl;
+
+	bool passed = true;
+
+	for (float lifeTime : lifeTimes)
+	{
+		constants.LifeTime = lifeTime;
+
+		double seconds[2];
+		std::vector<unsigned int> drawCounts[2];
+		unsigned int rebases = 0;
+
+		for (int mode = 0; mode < 2; ++mode)
+		{
+			CPUParticleSystem particleSystem(particleCount);
+			particleSystem.SetTimeMode(mode == 0 ? ParticleTimeAge : ParticleTimeBirth);
+			particleSystem.SetTimeRebasePeriod(rebasePeriod);
+
+			particleSystem.DeadListInit(constants);
+
+			for (int frame = 0; frame < frameCount; ++frame)
+			{
+				time.TotalTime = (float)(frame * time.DeltaTime);
+
+				SimulatePoolFrame(particleSystem, time, constants, true);
+				drawCounts[mode].push_back(particleSystem.GetDrawArgs()[0]);
+			}
+
+			seconds[mode] = particleSystem.GetStageStats(ParticleStageUpdate).Seconds / frameCount;
+			if (mode == 1)
+				rebases = particleSystem.GetTimeRebaseCount();
+		}
+
+		// the two clocks round differently, a particle may expire a step earlier or later but never a whole cohort more
+		unsigned int framesDiffer = 0;
+		unsigned int maxDifference = 0;
+		for (int frame = 0; frame < frameCount; ++frame)
+		{
+			unsigned int a = drawCounts[0][frame];
+			unsigned int b = drawCounts[1][frame];
+			unsigned int difference = a > b ? a - b : b - a;
+
+			if (difference > 0)
+				framesDiffer++;
+			maxDifference = (std::max)(maxDifference, difference);
+		}
+
+		if (maxDifference > (unsigned int)constants.EmitCount || rebases == 0)
+			passed = false;
+
+		out << std::left << std::setw(12) << lifeTime
+			<< std::setw(14) << framesDiffer
+			<< std::setw(12) << maxDifference
+			<< std::setw(10) << rebases
+			<< std::setw(12) << seconds[0] * 1000.0
+			<< std::setw(12) << seconds[1] * 1000.0
+			<< seconds[0] / seconds[1] << std::endl;
+	}
+
+	// now - birth on a float clock that never restarts against one rebased every 1024 s,
+	// worst error over ages up to 10 s against the exact age
+	const double sessions[] = { 60.0, 3600.0, 86400.0, 604800.0 };
+	const char* sessionNames[] = { "1 minute", "1 hour", "1 day", "1 week" };
+	const double defaultPeriod = 1024.0;
+
+	out << std::endl << "birth time precision over a session" << std::endl;
+	out << std::left << std::setw(12) << "session"
+		<< std::setw(20) << "no rebase err ms"
+		<< "rebased err ms" << std::endl;
+
+	for (int i = 0; i < 4; ++i)
+	{
+		double errors[2] = { 0.0, 0.0 };
+
+		for (int rebased = 0; rebased < 2; ++rebased)
+		{
+			// the clock after the last rebase, a particle born before it was moved back by the same amount
+			double clock = rebased ? fmod(sessions[i], defaultPeriod) : sessions[i];
+
+			for (int step = 1; step <= 600; ++step)
+			{
+				double age = step / 60.0;
+				float now = (float)clock;
+				float birth = (float)(clock - age);
+
+				errors[rebased] = (std::max)(errors[rebased], fabs((double)(now - birth) - age));
+			}
+		}
+
+		// half a 60 Hz step would move an expiry by a frame
+		if (errors[1] * 120.0 >= 1.0)
+			passed = false;
+
+		out << std::left << std::setw(12) << sessionNames[i]
+			<< std::setw(20) << errors[0] * 1000.0
+			<< errors[1] * 1000.0 << std::endl;
+	}
+
+	WriteLayoutReport(out, particleCount, 30);
+
+	return passed;
+}
+
+bool ParticleSelfChecks::WriteBallisticReport(std::ostream& out, int particleCount, int frameCount)
+{
+	TimeConstants time = MakeTimeConstants();
+	time.InterpolationAlpha = 0.5f;
+
+	// a fountain, the pool fills in two seconds and a particle lives one
+	ParticleConstants constants = MakeParticleConstants(particleCount, (std::max)(particleCount / 120, 1), 1.0f);
+	constants.velocity = XMFLOAT3(1.0f, 4.0f, 0.5f);
+	constants.acceleration = XMFLOAT3(0.0f, -9.8f, 0.0f);
+	constants.startColor = XMFLOAT4(1.0f, 0.5f, 0.0f, 1.0f);
+	constants.endColor = XMFLOAT4(0.0f, 0.0f, 1.0f, 0.0f);
+
+	// the same birth times and expiry in both, the ring pays for an update of every live particle
+	CPUParticleSystem ring(particleCount);
+	ring.SetUpdateMode(ParticleUpdateRing);
+	ring.SetTimeMode(ParticleTimeBirth);
+
+	CPUParticleSystem ballistic(particleCount);
+	ballistic.SetUpdateMode(ParticleUpdateBallistic);
+
+	std::vector<ParticleVertex> vertices(particleCount);
+
+	ring.DeadListInit(constants);
+	ballistic.DeadListInit(constants);
+
+	unsigned int countMismatches = 0;
+	unsigned int aliveCount = 0;
+
+	for (int frame = 0; frame < frameCount; ++frame)
+	{
+		time.TotalTime = (float)(frame * time.DeltaTime);
+
+		SimulatePoolFrame(ring, time, constants, true);
+		SimulatePoolFrame(ballistic, time, constants, true);
+		aliveCount = ballistic.EvaluateBallistic(time, constants, nullptr, vertices.data());
+
+		if (aliveCount != ring.GetDrawArgs()[0])
+			countMismatches++;
+	}
+
+	// every vertex against the closed form in double from the same spawn record
+	const Particle* pool = ballistic.GetParticlePool();
+	double drawTime = (double)ballistic.GetPoolClock() + time.InterpolationAlpha * time.DeltaTime;
+	double maxPositionError = 0.0;
+	double maxColorError = 0.0;
+	double maxAge = 0.0;
+	unsigned int drawCount = ballistic.GetDrawArgs()[0];
+
+	for (unsigned int i = 0; i < drawCount; ++i)
+	{
+		const Particle& spawn = pool[(ballistic.GetRingTail() + i) % (unsigned int)particleCount];
+		const ParticleVertex& vertex = vertices[i];
+
+		double age = drawTime - spawn.Age;
+		const float* p0 = &spawn.Position.x;
+		const float* v0 = &spawn.Velocity.x;
+		const float* a = &constants.acceleration.x;
+		const float* position = &vertex.Position.x;
+
+		for (int c = 0; c < 3; ++c)
+		{
+			double exact = p0[c] + v0[c] * age + 0.5 * a[c] * age * age;
+			maxPositionError = (std::max)(maxPositionError, fabs(position[c] - exact));
+		}
+
+		double exactAlpha = constants.startColor.w + (constants.endColor.w - constants.startColor.w) * age / constants.LifeTime;
+		maxColorError = (std::max)(maxColorError, fabs(vertex.Color.w - exactAlpha));
+		maxAge = (std::max)(maxAge, age);
+	}
+
+	// explicit Euler steps, like ParticlePool::Integrate, miss a * age * dt / 2 by the end of the oldest life
+	double accelerationLength = sqrt((double)constants.acceleration.x * constants.acceleration.x +
+		(double)constants.acceleration.y * constants.acceleration.y + (double)constants.acceleration.z * constants.acceleration.z);
+	double eulerError = 0.5 * accelerationLength * maxAge * time.DeltaTime;
+
+	// the whole pool stepped with the same constant acceleration, what the closed form replaces
+	ParticlePool<ParticleLayoutAoS> stepped(particleCount);
+	stepped.Unpack(pool);
+
+	auto start = Clock::now();
+	for (int frame = 0; frame < frameCount; ++frame)
+		stepped.Integrate(time.DeltaTime, 1000.0f, constants.acceleration);
+	double steppedSeconds = SecondsSince(start) / frameCount;
+
+	double ringSeconds = ring.GetStageStats(ParticleStageUpdate).Seconds / frameCount;
+	double expireSeconds = ballistic.GetStageStats(ParticleStageUpdate).Seconds / frameCount;
+	double evaluateSeconds = ballistic.GetStageStats(ParticleStageEvaluate).Seconds / frameCount;
+
+	// the ring reads and writes every live 64-byte record and its draw list entry, the Euler pool every slot,
+	// the closed form reads the Position/Age and Velocity/Size rows of the live span and writes a vertex
+	double ringBytes = (double)drawCount * (sizeof(Particle) * 2 + sizeof(ParticleSort));
+	double steppedBytes = (double)particleCount * sizeof(Particle) * 2;
+	double ballisticBytes = (double)drawCount * (sizeof(float) * 8 + sizeof(ParticleVertex));
+
+	out << std::endl << "closed form ballistic particles (" << particleCount << " pool slots, " << frameCount << " frames, "
+		<< drawCount << " drawn)" << std::endl;
+	out << std::left << std::setw(20) << "mode"
+		<< std::setw(14) << "update ms"
+		<< std::setw(14) << "draw ms"
+		<< "MB/frame" << std::endl;
+	out << std::left << std::setw(20) << "ring, curl update"
+		<< std::setw(14) << ringSeconds * 1000.0
+		<< std::setw(14) << 0.0
+		<< ringBytes / (1024.0 * 1024.0) << std::endl;
+	out << std::left << std::setw(20) << "AoS Euler steps"
+		<< std::setw(14) << steppedSeconds * 1000.0
+		<< std::setw(14) << 0.0
+		<< steppedBytes / (1024.0 * 1024.0) << std::endl;
+	out << std::left << std::setw(20) << "closed form"
+		<< std::setw(14) << expireSeconds * 1000.0
+		<< std::setw(14) << evaluateSeconds * 1000.0
+		<< ballisticBytes / (1024.0 * 1024.0) << std::endl;
+	out << "live counts against the ring: " << (countMismatches == 0 ? "match" : "DIFFER")
+		<< "  max position error: " << maxPositionError
+		<< "  Euler error at that age: " << eulerError
+		<< "  max alpha error: " << maxColorError << std::endl;
+
+	// float evaluation of a few meters over a second stays well under a millimeter
+	return countMismatches == 0 && aliveCount > 0 && maxPositionError < 1e-3 && maxColorError < 1e-4;
+}
+
+bool ParticleSelfChecks::WriteNoiseReport(std::ostream& out, int sampleCount)
+{
+	// half the points near the origin, half out where mod289 wraps the lattice many times over,
+	// the count is not a multiple of any width so every level also runs its scalar tail
+	unsigned int count = (unsigned int)sampleCount | 1;
+	std::vector<float> coordinates[4];
+	for (int axis = 0; axis < 4; ++axis)
+	{
+		coordinates[axis].resize(count);
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			float range = (i & 1) ? 10000.0f : 10.0f;
+			coordinates[axis][i] = MathHelper::RandF(-range, range);
+		}
+	}
+
+	out << std::endl << "simplex noise against the scalar reference (" << count << " points)" << std::endl;
+	out << std::left << std::setw(18) << "function"
+		<< std::setw(10) << "level"
+		<< std::setw(8) << "width"
+		<< std::setw(12) << "mismatches"
+		<< std::setw(10) << "max ulp"
+		<< std::setw(12) << "ns/point"
+		<< "speedup" << std::endl;
+
+	bool passed = true;
+	SimplexNoiseLevel supported = SimplexNoise::DetectLevel();
+	const int widths[SimplexNoiseLevelCount] = { 1, SimdSSE4::Width, SimdAVX2::Width, SimdAVX512::Width };
+
+	for (int function = 0; function < NoiseFunctionCount; ++function)
+	{
+		int outputs = NoiseFunctionOutputs[function];
+
+		std::vector<float> reference[3];
+		for (int output = 0; output < outputs; ++output)
+			reference[output].resize(count);
+
+		double scalarSeconds = 0.0;
+
+		for (int level = SimplexNoiseScalar; level <= supported; ++level)
+		{
+			std::vector<float> results[3];
+			for (int output = 0; output < outputs; ++output)
+				results[output].resize(count);
+
+			// the scalar level calls the reference functions, its run is the reference for the others
+			auto start = Clock::now();
+			EvaluateNoise((NoiseFunction)function, (SimplexNoiseLevel)level, coordinates, results, count);
+			double seconds = SecondsSince(start);
+
+			if (level == SimplexNoiseScalar)
+			{
+				scalarSeconds = seconds;
+				for (int output = 0; output < outputs; ++output)
+					reference[output] = results[output];
+			}
+
+			unsigned int mismatches = 0;
+			unsigned int maxUlp = 0;
+			for (int output = 0; output < outputs; ++output)
+			{
+				for (unsigned int i = 0; i < count; ++i)
+				{
+					if (memcmp(&results[output][i], &reference[output][i], sizeof(float)) != 0)
+					{
+						mismatches++;
+						maxUlp = (std::max)(maxUlp, ParticleUpdateKernel::UlpDistance(results[output][i], reference[output][i]));
+					}
+				}
+			}
+
+			if (mismatches != 0)
+				passed = false;
+
+			out << std::left << std::setw(18) << NoiseFunctionNames[function]
+				<< std::setw(10) << SimplexNoise::GetLevelName((SimplexNoiseLevel)level)
+				<< std::setw(8) << widths[level]
+				<< std::setw(12) << mismatches
+				<< std::setw(10) << maxUlp
+				<< std::setw(12) << seconds * 1e9 / count
+				<< scalarSeconds / seconds << std::endl;
+		}
+	}
+
+	if (supported < SimplexNoiseAVX512)
+		out << "AVX-512 not supported, the 16 wide batch was not run" << std::endl;
+
+	return passed;
+}
+
+bool ParticleSelfChecks::WriteNoiseGradientReport(std::ostream& out, int sampleCount)
+{
+	// central differences with a step well above the float noise of the values and well below a lattice cell
+	const float step = 1e-3f;
+	const float curlStep = 1e-2f;
+	const float maxRelativeError = 1e-2f;
+
+	unsigned int count = (unsigned int)sampleCount | 1;
+	std::vector<float> coordinates[4];
+	for (int axis = 0; axis < 4; ++axis)
+	{
+		coordinates[axis].resize(count);
+		for (unsigned int i = 0; i < count; ++i)
+			coordinates[axis][i] = MathHelper::RandF(-10.0f, 10.0f);
+	}
+
+	out << std::endl << "analytic noise gradients against central differences (" << count << " points)" << std::endl;
+	out << std::left << std::setw(18) << "function"
+		<< std::setw(14) << "value diffs"
+		<< std::setw(14) << "max |grad|"
+		<< std::setw(14) << "max error"
+		<< "rms error" << std::endl;
+
+	bool passed = true;
+
+	// the gradient of snoise2 and snoise3, the values have to be the bits of SNoise
+	for (int dimensions = 2; dimensions <= 3; ++dimensions)
+	{
+		unsigned int valueMismatches = 0;
+		double maxGradient = 0.0;
+		double maxError = 0.0;
+		double squares = 0.0;
+
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			float v[3] = { coordinates[0][i], coordinates[1][i], coordinates[2][i] };
+			float analytic[3] = {};
+			float value, reference;
+
+			if (dimensions == 2)
+			{
+				XMFLOAT2 gradient;
+				value = SimplexNoise::SNoiseGrad(XMFLOAT2(v[0], v[1]), gradient);
+				reference = SimplexNoise::SNoise(XMFLOAT2(v[0], v[1]));
+				analytic[0] = gradient.x;
+				analytic[1] = gradient.y;
+			}
+			else
+			{
+				XMFLOAT3 gradient;
+				value = SimplexNoise::SNoiseGrad(XMFLOAT3(v[0], v[1], v[2]), gradient);
+				reference = SimplexNoise::SNoise(XMFLOAT3(v[0], v[1], v[2]));
+				analytic[0] = gradient.x;
+				analytic[1] = gradient.y;
+				analytic[2] = gradient.z;
+			}
+
+			if (memcmp(&value, &reference, sizeof(float)) != 0)
+				valueMismatches++;
+
+			double squared = 0.0;
+			double gradientSquared = 0.0;
+			for (int axis = 0; axis < dimensions; ++axis)
+			{
+				float above[3] = { v[0], v[1], v[2] };
+				float below[3] = { v[0], v[1], v[2] };
+				above[axis] += step;
+				below[axis] -= step;
+
+				float difference = dimensions == 2 ?
+					SimplexNoise::SNoise(XMFLOAT2(above[0], above[1])) - SimplexNoise::SNoise(XMFLOAT2(below[0], below[1])) :
+					SimplexNoise::SNoise(XMFLOAT3(above[0], above[1], above[2])) - SimplexNoise::SNoise(XMFLOAT3(below[0], below[1], below[2]));
+
+				// the rounded step, not the requested one
+				double numeric = (double)difference / ((double)above[axis] - below[axis]);
+				double error = analytic[axis] - numeric;
+				squared += error * error;
+				gradientSquared += (double)analytic[axis] * analytic[axis];
+			}
+
+			maxGradient = (std::max)(maxGradient, sqrt(gradientSquared));
+			maxError = (std::max)(maxError, sqrt(squared));
+			squares += squared;
+		}
+
+		if (valueMismatches != 0 || maxError > maxRelativeError * maxGradient)
+			passed = false;
+
+		out << std::left << std::setw(18) << (dimensions == 2 ? "snoise_grad2" : "snoise_grad3")
+			<< std::setw(14) << valueMismatches
+			<< std::setw(14) << maxGradient
+			<< std::setw(14) << maxError
+			<< sqrt(squares / count) << std::endl;
+	}
+
+	// the curl against the finite difference curl, which is 4 * d * d times the curl as d goes to 0,
+	// once with a small step and once with the step of the shader
+	const float curlSteps[2] = { curlStep, 1.0f };
+	for (float d : curlSteps)
+	{
+		double maxCurl = 0.0;
+		double maxError = 0.0;
+		double squares = 0.0;
+
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			XMFLOAT3 p(coordinates[0][i], coordinates[1][i], coordinates[2][i]);
+			XMFLOAT3 analytic = SimplexNoise::CurlNoise3DGrad(p);
+			XMFLOAT3 numeric = SimplexNoise::CurlNoise3D(p, d);
+
+			double scale = 1.0 / (4.0 * d * d);
+			double dx = analytic.x - numeric.x * scale;
+			double dy = analytic.y - numeric.y * scale;
+			double dz = analytic.z - numeric.z * scale;
+			double squared = dx * dx + dy * dy + dz * dz;
+
+			maxCurl = (std::max)(maxCurl, sqrt((double)analytic.x * analytic.x + (double)analytic.y * analytic.y + (double)analytic.z * analytic.z));
+			maxError = (std::max)(maxError, sqrt(squared));
+			squares += squared;
+		}
+
+		// the shader's step is a cell wide and only shows how far its field is from the exact curl
+		if (d == curlStep && maxError > maxRelativeError * maxCurl)
+			passed = false;
+
+		out << std::left << std::setw(18) << "curl d=" + std::to_string(d).substr(0, 4)
+			<< std::setw(14) << "-"
+			<< std::setw(14) << maxCurl
+			<< std::setw(14) << maxError
+			<< sqrt(squares / count) << std::endl;
+	}
+
+	// the divergence of the analytic curl by central differences next to the size of its other derivatives
+	double maxDivergence = 0.0;
+	double shearSum = 0.0;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		float p[3] = { coordinates[0][i], coordinates[1][i], coordinates[2][i] };
+
+		double divergence = 0.0;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			float above[3] = { p[0], p[1], p[2] };
+			float below[3] = { p[0], p[1], p[2] };
+			above[axis] += curlStep;
+			below[axis] -= curlStep;
+
+			XMFLOAT3 curlAbove = SimplexNoise::CurlNoise3DGrad(XMFLOAT3(above[0], above[1], above[2]));
+			XMFLOAT3 curlBelow = SimplexNoise::CurlNoise3DGrad(XMFLOAT3(below[0], below[1], below[2]));
+			const float* a = &curlAbove.x;
+			const float* b = &curlBelow.x;
+			double span = (double)above[axis] - below[axis];
+
+			divergence += (a[axis] - b[axis]) / span;
+			shearSum += fabs((a[(axis + 1) % 3] - b[(axis + 1) % 3]) / span);
+		}
+
+		maxDivergence = (std::max)(maxDivergence, fabs(divergence));
+	}
+	double meanShear = shearSum / (3.0 * count);
+
+	if (maxDivergence > 1e-4 * meanShear)
+		passed = false;
+
+	out << "curlNoise3DGrad divergence: max " << maxDivergence << ", mean |d curl_i / d x_j| " << meanShear << std::endl;
+
+	// the finite difference curl of the shader against the analytic one at every batch width
+	out << std::left << std::setw(10) << "level"
+		<< std::setw(16) << "curl ns/point"
+		<< std::setw(16) << "grad ns/point"
+		<< std::setw(12) << "speedup"
+		<< "mismatches" << std::endl;
+
+	std::vector<float> reference[3], results[3];
+	for (int output = 0; output < 3; ++output)
+	{
+		reference[output].resize(count);
+		results[output].resize(count);
+	}
+
+	SimplexNoiseLevel supported = SimplexNoise::DetectLevel();
+	for (int level = SimplexNoiseScalar; level <= supported; ++level)
+	{
+		auto start = Clock::now();
+		EvaluateNoise(NoiseCurl3D, (SimplexNoiseLevel)level, coordinates, results, count);
+		double curlSeconds = SecondsSince(start);
+
+		start = Clock::now();
+		EvaluateNoise(NoiseCurlGrad3D, (SimplexNoiseLevel)level, coordinates, results, count);
+		double gradientSeconds = SecondsSince(start);
+
+		if (level == SimplexNoiseScalar)
+		{
+			for (int output = 0; output < 3; ++output)
+				reference[output] = results[output];
+		}
+
+		unsigned int mismatches = 0;
+		for (int output = 0; output < 3; ++output)
+			mismatches += memcmp(results[output].data(), reference[output].data(), sizeof(float) * count) != 0 ? 1 : 0;
+
+		if (mismatches != 0)
+			passed = false;
+
+		out << std::left << std::setw(10) << SimplexNoise::GetLevelName((SimplexNoiseLevel)level)
+			<< std::setw(16) << curlSeconds * 1e9 / count
+			<< std::setw(16) << gradientSeconds * 1e9 / count
+			<< std::setw(12) << curlSeconds / gradientSeconds
+			<< (mismatches == 0 ? "match" : "DIFFER") << std::endl;
+	}
+
+	return passed;
+}
+
+bool ParticleSelfChecks::WriteCurlVolumeReport(std::ostream& out, int particleCount, const std::string& fileName)
+{
+	const float deltaTime = 1.0f / 60.0f;
+	const float lifeTime = 10.0f;
+	const int frameCount = 10;
+	const unsigned int resolutions[] = { 16, 32, 64, 128 };
+
+	CurlVolumeDesc desc;
+	int hardwareThreads = (int)(std::max)(std::thread::hardware_concurrency(), 1u);
+	WorkStealingScheduler scheduler(hardwareThreads);
+
+	// error points inside the bounds, against the noise the texels were baked from
+	const unsigned int errorCount = 100000;
+	std::vector<XMFLOAT3> errorPoints(errorCount);
+	std::vector<XMFLOAT3> direct(errorCount);
+	double fieldSquares = 0.0;
+	for (unsigned int i = 0; i < errorCount; ++i)
+	{
+		errorPoints[i] = XMFLOAT3(MathHelper::RandF(desc.Min.x, desc.Max.x), MathHelper::RandF(desc.Min.y, desc.Max.y), MathHelper::RandF(desc.Min.z, desc.Max.z));
+		XMFLOAT3 scaled(errorPoints[i].x * desc.Frequency, errorPoints[i].y * desc.Frequency, errorPoints[i].z * desc.Frequency);
+		direct[i] = SimplexNoise::CurlNoise3D(scaled, desc.Delta);
+		fieldSquares += direct[i].x * direct[i].x + direct[i].y * direct[i].y + direct[i].z * direct[i].z;
+	}
+	double fieldRms = sqrt(fieldSquares / errorCount);
+
+	out << std::endl << "baked curl volume against direct curl noise (" << errorCount << " points, field rms " << fieldRms << ")" << std::endl;
+	out << std::left << std::setw(12) << "texels"
+		<< std::setw(10) << "MB"
+		<< std::setw(14) << "bake 1t ms"
+		<< std::setw(14) << "bake " + std::to_string(hardwareThreads) + "t ms"
+		<< std::setw(10) << "bakes"
+		<< std::setw(14) << "max error"
+		<< std::setw(14) << "rms error"
+		<< "rms / field" << std::endl;
+
+	bool passed = true;
+	double previousRms = 0.0;
+	CurlVolume volume;
+
+	for (unsigned int resolution : resolutions)
+	{
+		desc.Width = resolution;
+		desc.Height = resolution;
+		desc.Depth = resolution;
+
+		// the bake is the same on one thread and on all of them
+		CurlVolume sequential;
+		auto start = Clock::now();
+		sequential.Bake(desc, nullptr);
+		double sequentialSeconds = SecondsSince(start);
+
+		start = Clock::now();
+		bool baked = volume.Bake(desc, &scheduler);
+		double parallelSeconds = SecondsSince(start);
+
+		std::vector<unsigned char> sequentialTexels, parallelTexels;
+		sequential.GetTexturePayload(CurlVolumeFloat32, sequentialTexels);
+		volume.GetTexturePayload(CurlVolumeFloat32, parallelTexels);
+		bool bakesMatch = baked && sequentialTexels == parallelTexels;
+
+		double maxError = 0.0;
+		double squares = 0.0;
+		for (unsigned int i = 0; i < errorCount; ++i)
+		{
+			XMFLOAT3 sampled = volume.Sample(errorPoints[i]);
+			double dx = sampled.x - direct[i].x;
+			double dy = sampled.y - direct[i].y;
+			double dz = sampled.z - direct[i].z;
+			double squared = dx * dx + dy * dy + dz * dz;
+			maxError = (std::max)(maxError, sqrt(squared));
+			squares += squared;
+		}
+		double rms = sqrt(squares / errorCount);
+
+		// a finer grid has to follow the field more closely
+		if (!bakesMatch || (previousRms > 0.0 && rms >= previousRms))
+			passed = false;
+		previousRms = rms;
+
+		out << std::left << std::setw(12) << std::to_string(resolution) + "^3"
+			<< std::setw(10) << volume.GetByteSize() / (1024.0 * 1024.0)
+			<< std::setw(14) << sequentialSeconds * 1000.0
+			<< std::setw(14) << parallelSeconds * 1000.0
+			<< std::setw(10) << (bakesMatch ? "match" : "DIFFER")
+			<< std::setw(14) << maxError
+			<< std::setw(14) << rms
+			<< rms / fieldRms << std::endl;
+	}
+
+	// the rest runs on the resolution Game would use
+	desc.Width = 64;
+	desc.Height = 64;
+	desc.Depth = 64;
+	volume.Bake(desc, &scheduler);
+
+	// the batch sampler against the scalar one, a quarter of the points outside the bounds for the clamp
+	const unsigned int sampleCount = 1 << 20;
+	std::vector<float> positions[3];
+	const float mins[3] = { desc.Min.x, desc.Min.y, desc.Min.z };
+	const float maxs[3] = { desc.Max.x, desc.Max.y, desc.Max.z };
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		positions[axis].resize(sampleCount);
+		float margin = (maxs[axis] - mins[axis]) * 0.25f;
+		for (unsigned int i = 0; i < sampleCount; ++i)
+			positions[axis][i] = MathHelper::RandF(mins[axis] - margin, maxs[axis] + margin);
+	}
+
+	out << "trilinear batch against Sample (" << sampleCount << " points at 64^3):";
+	SimplexNoiseLevel supported = SimplexNoise::DetectLevel();
+	for (int level = SimplexNoiseSSE4; level <= supported; ++level)
+	{
+		unsigned int mismatches = 0;
+		if (level == SimplexNoiseSSE4)
+			mismatches = CountSampleMismatches<SimdSSE4>(volume, positions, sampleCount);
+		else if (level == SimplexNoiseAVX2)
+			mismatches = CountSampleMismatches<SimdAVX2>(volume, positions, sampleCount);
+		else
+			mismatches = CountSampleMismatches<SimdAVX512>(volume, positions, sampleCount);
+
+		if (mismatches != 0)
+			passed = false;
+
+		out << " " << SimplexNoise::GetLevelName((SimplexNoiseLevel)level) << " " << mismatches;
+	}
+	out << std::endl;
+
+	// the update with the noise and with the volume, the seed of the kernel report
+	std::vector<Particle> seed = MakeKernelSeed(particleCount, lifeTime);
+
+	std::vector<unsigned int> dead(particleCount);
+	std::vector<ParticleSort> draw(particleCount);
+	ParticleUpdateOutput output;
+	output.DeadList = dead.data();
+	output.DrawList = draw.data();
+
+	// one volume step at the scalar level is the reference for the others
+	std::vector<Particle> reference = seed;
+	ParticleUpdateKernel::Update(ParticleKernelScalar, reference.data(), 0, particleCount, deltaTime, lifeTime, output, &volume);
+
+	out << "update with the volume (" << particleCount << " particles, max ulp allowed: " << ParticleUpdateKernel::MaxUlpError << ")" << std::endl;
+	out << std::left << std::setw(10) << "kernel"
+		<< std::setw(10) << "max ulp"
+		<< std::setw(14) << "noise ms"
+		<< std::setw(14) << "volume ms"
+		<< "speedup" << std::endl;
+
+	ParticleKernelLevel kernelSupported = ParticleUpdateKernel::DetectLevel();
+	for (int level = ParticleKernelScalar; level <= kernelSupported; ++level)
+	{
+		std::vector<Particle> particles = seed;
+		output.DeadCount = 0;
+		output.DrawCount = 0;
+		ParticleUpdateKernel::Update((ParticleKernelLevel)level, particles.data(), 0, particleCount, deltaTime, lifeTime, output, &volume);
+
+		unsigned int maxUlp = MaxUlpDistance(particles, reference);
+
+		if (maxUlp > (unsigned int)ParticleUpdateKernel::MaxUlpError)
+			passed = false;
+
+		double seconds[2];
+		for (int source = 0; source < 2; ++source)
+		{
+			const CurlVolume* curlVolume = source == 0 ? nullptr : &volume;
+
+			particles = seed;
+			auto start = Clock::now();
+			for (int frame = 0; frame < frameCount; ++frame)
+			{
+				output.DeadCount = 0;
+				output.DrawCount = 0;
+				ParticleUpdateKernel::Update((ParticleKernelLevel)level, particles.data(), 0, particleCount, deltaTime, lifeTime, output, curlVolume);
+			}
+			seconds[source] = SecondsSince(start) / frameCount;
+		}
+
+		out << std::left << std::setw(10) << ParticleUpdateKernel::GetLevelName((ParticleKernelLevel)level)
+			<< std::setw(10) << maxUlp
+			<< std::setw(14) << seconds[0] * 1000.0
+			<< std::setw(14) << seconds[1] * 1000.0
+			<< seconds[0] / seconds[1] << std::endl;
+	}
+
+	// the fp16 texture, read back past the magic and both headers
+	bool saved = volume.SaveDDS(fileName, CurlVolumeFloat16);
+
+	std::vector<unsigned char> payload, fileTexels;
+	volume.GetTexturePayload(CurlVolumeFloat16, payload);
+
+	std::ifstream file(fileName, std::ios::binary);
+	const size_t headerSize = 4 + 124 + 20;
+	std::vector<unsigned char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	bool readBack = saved && contents.size() == headerSize + payload.size() &&
+		memcmp(contents.data(), "DDS ", 4) == 0 &&
+		memcmp(contents.data() + headerSize, payload.data(), payload.size()) == 0;
+
+	if (!readBack)
+		passed = false;
+
+	out << "fp16 volume texture " << fileName << ": " << payload.size() / 1024 << " KB, "
+		<< (readBack ? "read back ok" : "FAILED") << std::endl;
+
+	return passed;
+}
+
+bool ParticleSelfChecks::WriteCurlCacheReport(std::ostream& out, int particleCount, int frameCount)
+{
+	const float deltaTime = 1.0f / 60.0f;
+	const unsigned int refreshFrames[] = { 1, 4, 16, 64 };
+	const unsigned int errorCount = 20000;
+
+	CurlFieldCacheDesc desc;
+	const CurlVolumeDesc& bounds = desc.Volume;
+
+	std::vector<XMFLOAT3> errorPoints(errorCount);
+	for (unsigned int i = 0; i < errorCount; ++i)
+		errorPoints[i] = XMFLOAT3(MathHelper::RandF(bounds.Min.x, bounds.Max.x), MathHelper::RandF(bounds.Min.y, bounds.Max.y), MathHelper::RandF(bounds.Min.z, bounds.Max.z));
+
+	unsigned long long texelCount = (unsigned long long)bounds.Width * bounds.Height * bounds.Depth;
+
+	out << std::endl << "cached 4D curl field (" << bounds.Width << "x" << bounds.Height << "x" << bounds.Depth << ", "
+		<< frameCount << " frames, error at " << errorCount << " points every 10th frame)" << std::endl;
+	out << std::left << std::setw(10) << "refresh"
+		<< std::setw(16) << "texels/frame"
+		<< std::setw(12) << "ms/frame"
+		<< std::setw(14) << "max error"
+		<< std::setw(14) << "rms error"
+		<< "rms / field" << std::endl;
+
+	bool passed = true;
+	double cacheSeconds = 0.0;
+
+	for (unsigned int frames : refreshFrames)
+	{
+		desc.RefreshFrames = frames;
+
+		// the same accumulated clock the cache sees, on the calling thread like the direct evaluation below
+		CurlFieldCache cache;
+		float totalTime = 0.0f;
+		cache.Initialize(desc, totalTime, deltaTime, nullptr);
+
+		unsigned long long expectedEvaluations = 2 * texelCount;
+		double seconds = 0.0;
+		double maxError = 0.0;
+		double squares = 0.0;
+		double fieldSquares = 0.0;
+
+		for (int frame = 1; frame <= frameCount; ++frame)
+		{
+			totalTime += deltaTime;
+
+			auto start = Clock::now();
+			cache.Update(totalTime, deltaTime, nullptr);
+			seconds += SecondsSince(start);
+
+			unsigned int group = (frame - 1) % frames;
+			expectedEvaluations += (unsigned long long)((bounds.Depth - group + frames - 1) / frames) * bounds.Width * bounds.Height;
+
+			if (frame % 10 != 0)
+				continue;
+
+			for (unsigned int i = 0; i < errorCount; ++i)
+			{
+				XMFLOAT3 cached = cache.GetVolume().Sample(errorPoints[i]);
+				XMFLOAT3 direct = cache.Evaluate(errorPoints[i], totalTime);
+
+				double dx = cached.x - direct.x;
+				double dy = cached.y - direct.y;
+				double dz = cached.z - direct.z;
+				double squared = dx * dx + dy * dy + dz * dz;
+				maxError = (std::max)(maxError, sqrt(squared));
+				squares += squared;
+				fieldSquares += (double)direct.x * direct.x + (double)direct.y * direct.y + (double)direct.z * direct.z;
+			}
+		}
+
+		seconds /= frameCount;
+		double rms = sqrt(squares / fieldSquares);
+
+		if (cache.GetEvaluationCount() != expectedEvaluations || !(rms < 1.0))
+			passed = false;
+
+		// refreshed every frame the texels are the field at the current time
+		if (frames == 1)
+		{
+			const CurlVolume& volume = cache.GetVolume();
+			XMFLOAT3 cellSize = volume.GetCellSize();
+			double maxTexelError = 0.0;
+			for (unsigned int z = 0; z < bounds.Depth; z += 7)
+			{
+				for (unsigned int y = 0; y < bounds.Height; y += 5)
+				{
+					for (unsigned int x = 0; x < bounds.Width; x += 3)
+					{
+						XMFLOAT3 position(bounds.Min.x + (float)x * cellSize.x, bounds.Min.y + (float)y * cellSize.y, bounds.Min.z + (float)z * cellSize.z);
+						XMFLOAT3 direct = cache.Evaluate(position, totalTime);
+						XMFLOAT3 texel = volume.GetTexel(x, y, z);
+						maxTexelError = (std::max)(maxTexelError, (double)fabsf(texel.x - direct.x));
+						maxTexelError = (std::max)(maxTexelError, (double)fabsf(texel.y - direct.y));
+						maxTexelError = (std::max)(maxTexelError, (double)fabsf(texel.z - direct.z));
+					}
+				}
+			}
+
+			if (maxTexelError > 1e-5)
+				passed = false;
+
+			out << "refreshed every frame, texels against the field at the last frame: max difference " << maxTexelError << std::endl;
+		}
+
+		if (frames == 16)
+			cacheSeconds = seconds;
+
+		out << std::left << std::setw(10) << frames
+			<< std::setw(16) << (double)(cache.GetEvaluationCount() - 2 * texelCount) / frameCount
+			<< std::setw(12) << seconds * 1000.0
+			<< std::setw(14) << maxError
+			<< std::setw(14) << sqrt(squares / (frameCount / 10 * errorCount))
+			<< rms << std::endl;
+	}
+
+	// the cost of evaluating the field at every particle instead, which grows with the particle count
+	out << "direct curlNoise4D per particle against the cache refreshing every 16 frames:";
+	SimplexNoiseLevel level = SimplexNoise::DetectLevel();
+	for (int count = particleCount / 10; count <= particleCount; count *= 10)
+	{
+		std::vector<float> positions[3], curl[3];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			positions[axis].resize(count);
+			curl[axis].resize(count);
+			for (int i = 0; i < count; ++i)
+				positions[axis][i] = MathHelper::RandF(-1.0f, 1.0f);
+		}
+
+		auto start = Clock::now();
+		SimplexNoise::CurlNoise4DPoints(level, positions[0].data(), positions[1].data(), positions[2].data(), 1.0f, bounds.Delta,
+			curl[0].data(), curl[1].data(), curl[2].data(), count);
+		double seconds = SecondsSince(start);
+
+		out << " " << count << " particles " << seconds * 1000.0 << " ms (" << seconds / cacheSeconds << "x)";
+	}
+	out << std::endl;
+
+	return passed;
+}
+
+bool ParticleSelfChecks::WriteNoiseFamilyReport(std::ostream& out, int sampleCount)
+{
+	// the top octave of 8 is 128 times the base frequency, so the points cover many wraps of the mod289 lattice,
+	// the count is not a multiple of any width so every level also runs its scalar tail
+	unsigned int count = (unsigned int)sampleCount | 1;
+	std::vector<float> coordinates[3];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		coordinates[axis].resize(count);
+		for (unsigned int i = 0; i < count; ++i)
+			coordinates[axis][i] = MathHelper::RandF(-100.0f, 100.0f);
+	}
+
+	std::vector<NoiseFamilyCase> cases;
+	AddNoiseFamilyCases<NoiseBasisValue>(cases, "value");
+	AddNoiseFamilyCases<NoiseBasisGradient>(cases, "gradient");
+	AddNoiseFamilyCases<NoiseBasisSimplex>(cases, "simplex");
+	AddNoiseFamilyCases<NoiseBasisWorley>(cases, "worley");
+	AddNoiseFamilyCases<NoiseRidge<NoiseBasisGradient>>(cases, "ridged gradient");
+
+	SimplexNoiseLevel supported = SimplexNoise::DetectLevel();
+
+	out << std::endl << "noise family, ns per sample (" << count << " points)" << std::endl;
+	out << std::left << std::setw(18) << "basis"
+		<< std::setw(6) << "dims"
+		<< std::setw(9) << "octaves";
+	for (int level = SimplexNoiseScalar; level <= supported; ++level)
+		out << std::setw(10) << SimplexNoise::GetLevelName((SimplexNoiseLevel)level);
+	out << std::setw(12) << "mismatches"
+		<< std::setw(14) << "mean"
+		<< "stddev" << std::endl;
+
+	bool passed = true;
+
+	for (const NoiseFamilyCase& noiseCase : cases)
+	{
+		std::vector<float> reference(count);
+		std::vector<float> results(count);
+		unsigned int mismatches = 0;
+
+		out << std::left << std::setw(18) << noiseCase.Name
+			<< std::setw(6) << noiseCase.Dimensions
+			<< std::setw(9) << noiseCase.Octaves;
+
+		// the scalar level is the reference, every wider level has to give its bits
+		for (int level = SimplexNoiseScalar; level <= supported; ++level)
+		{
+			std::vector<float>& target = level == SimplexNoiseScalar ? reference : results;
+
+			auto start = Clock::now();
+			noiseCase.Evaluate((SimplexNoiseLevel)level, coordinates, target.data(), count);
+			double seconds = SecondsSince(start);
+
+			if (level != SimplexNoiseScalar)
+			{
+				for (unsigned int i = 0; i < count; ++i)
+				{
+					if (memcmp(&results[i], &reference[i], sizeof(float)) != 0)
+						mismatches++;
+				}
+			}
+
+			out << std::setw(10) << seconds * 1e9 / count;
+		}
+
+		double sum = 0.0;
+		double squares = 0.0;
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			sum += reference[i];
+			squares += (double)reference[i] * reference[i];
+		}
+		double mean = sum / count;
+
+		if (mismatches != 0)
+			passed = false;
+
+		out << std::setw(12) << mismatches
+			<< std::setw(14) << mean
+			<< sqrt((std::max)(squares / count - mean * mean, 0.0)) << std::endl;
+	}
+
+	if (supported < SimplexNoiseAVX512)
+		out << "AVX-512 not supported, the 16 wide batch was not run" << std::endl;
+
+	return passed;
+}
+
+bool ParticleSelfChecks::WriteNoiseLodReport(std::ostream& out, int particleCount, int frameCount)
+{
+	const float deltaTime = 1.0f / 60.0f;
+	const float lifeTime = 1000.0f;
+	const unsigned int clusterSize = 64;
+
+	// the Game camera, the angle a world offset covers at a distance is turned into pixels of its 720 line projection
+	Camera camera(1280, 720);
+	XMFLOAT3 eye = camera.GetPosition();
+	float pixelsPerRadian = 0.5f * 720.0f * camera.GetProjectionMatrix()._22;
+
+	// clusters of particles from 20 to 600 units in front of the camera, consecutive slots close together
+	// like the particles of one emission
+	std::vector<Particle> seed(particleCount);
+	XMFLOAT3 center(0.0f, 0.0f, 0.0f);
+	for (int i = 0; i < particleCount; ++i)
+	{
+		if (i % clusterSize == 0)
+			center = XMFLOAT3(MathHelper::RandF(-40.0f, 40.0f), MathHelper::RandF(-50.0f, 30.0f), MathHelper::RandF(-130.0f, 450.0f));
+
+		seed[i] = MakeParticle(XMFLOAT3(center.x + MathHelper::RandF(-2.0f, 2.0f), center.y + MathHelper::RandF(-2.0f, 2.0f),
+			center.z + MathHelper::RandF(-2.0f, 2.0f)));
+	}
+
+	// the volume covers every particle with room for the drift
+	CurlVolumeDesc volumeDesc;
+	volumeDesc.Min = XMFLOAT3(-50.0f, -60.0f, -140.0f);
+	volumeDesc.Max = XMFLOAT3(50.0f, 40.0f, 460.0f);
+	volumeDesc.Width = 64;
+	volumeDesc.Height = 64;
+	volumeDesc.Depth = 256;
+
+	int hardwareThreads = (int)(std::max)(std::thread::hardware_concurrency(), 1u);
+	WorkStealingScheduler scheduler(hardwareThreads);
+	CurlVolume volume;
+	volume.Bake(volumeDesc, &scheduler);
+
+	ParticleNoiseLodBand bands[4];
+	bands[0].MaxDistance = 120.0f;
+	bands[1].MaxDistance = 250.0f;
+	bands[1].Source = ParticleNoiseLodVolume;
+	bands[2].MaxDistance = 400.0f;
+	bands[2].RefreshFrames = 4;
+	bands[3].Source = ParticleNoiseLodVolume;
+	bands[3].RefreshFrames = 8;
+
+	// every run steps a copy from here, the eye is set for the bands of the error table
+	ParticleNoiseLod lod;
+	lod.SetBands(bands, 4);
+	lod.BeginFrame(eye);
+
+	std::vector<unsigned int> dead(particleCount);
+	std::vector<ParticleSort> draw(particleCount);
+	ParticleUpdateOutput output;
+	output.DeadList = dead.data();
+	output.DrawList = draw.data();
+
+	// curl sources taken per band, noise, volume and held velocities
+	unsigned long long sources[ParticleNoiseLod::MaxBands][3] = {};
+
+	// frameCount steps of every particle, the curl noise for all of them without noiseLod, with it a copy restarted
+	// so every level sees the same refresh cycle, the sources are only counted when asked, after each step so the band
+	// is the one the kernel saw
+	auto run = [&](ParticleKernelLevel level, ParticleNoiseLod* noiseLod, std::vector<Particle>& particles, bool count)
+	{
+		particles = seed;
+		ParticleNoiseLod frameLod;
+		if (noiseLod != nullptr)
+			frameLod = *noiseLod;
+
+		double seconds = 0.0;
+		for (int frame = 0; frame < frameCount; ++frame)
+		{
+			frameLod.BeginFrame(eye);
+			output.DeadCount = 0;
+			output.DrawCount = 0;
+
+			auto start = Clock::now();
+			if (noiseLod != nullptr)
+				ParticleUpdateKernel::Update(level, particles.data(), 0, particleCount, deltaTime, lifeTime, output, &volume, &frameLod);
+			else
+				ParticleUpdateKernel::Update(level, particles.data(), 0, particleCount, deltaTime, lifeTime, output);
+			seconds += SecondsSince(start);
+
+			for (int i = 0; count && i < particleCount; ++i)
+			{
+				int band = frameLod.FindBand(particles[i].Position);
+				int source = !frameLod.Refreshes(band, i) ? 2 : frameLod.GetBand(band).Source == ParticleNoiseLodVolume ? 1 : 0;
+				sources[band][source]++;
+			}
+		}
+		return seconds / frameCount;
+	};
+
+	out << std::endl << "noise level of detail by camera distance (" << particleCount << " particles, " << frameCount << " frames)" << std::endl;
+	out << std::left << std::setw(10) << "kernel"
+		<< std::setw(14) << "full ms"
+		<< std::setw(14) << "lod ms"
+		<< std::setw(10) << "speedup"
+		<< "lod against scalar lod" << std::endl;
+
+	bool passed = true;
+
+	// the full update at the scalar level is the reference every band is measured against
+	std::vector<Particle> reference, scalarLod, particles;
+	double scalarSeconds = run(ParticleKernelScalar, nullptr, reference, false);
+
+	// one band with the noise on every frame has to be the update without level of detail
+	ParticleNoiseLod single;
+	run(ParticleKernelScalar, &single, particles, false);
+	bool singleMatches = memcmp(particles.data(), reference.data(), particleCount * sizeof(Particle)) == 0;
+	if (!singleMatches)
+		passed = false;
+
+	ParticleKernelLevel supported = ParticleUpdateKernel::DetectLevel();
+	for (int level = ParticleKernelScalar; level <= supported; ++level)
+	{
+		double fullSeconds = level == ParticleKernelScalar ? scalarSeconds : run((ParticleKernelLevel)level, nullptr, particles, false);
+
+		std::vector<Particle>& target = level == ParticleKernelScalar ? scalarLod : particles;
+		double lodSeconds = run((ParticleKernelLevel)level, &lod, target, level == ParticleKernelScalar);
+
+		// the batch kernels take the same source per lane, so they keep the scalar bits
+		bool matches = level == ParticleKernelScalar || memcmp(particles.data(), scalarLod.data(), particleCount * sizeof(Particle)) == 0;
+		if (!matches)
+			passed = false;
+
+		out << std::left << std::setw(10) << ParticleUpdateKernel::GetLevelName((ParticleKernelLevel)level)
+			<< std::setw(14) << fullSeconds * 1000.0
+			<< std::setw(14) << lodSeconds * 1000.0
+			<< std::setw(10) << fullSeconds / lodSeconds
+			<< (level == ParticleKernelScalar ? "-" : matches ? "match" : "DIFFER") << std::endl;
+	}
+
+	// the error of each band against the full update, the pixel error takes the whole offset across the view,
+	// an upper bound of what moves on screen
+	double squares[ParticleNoiseLod::MaxBands] = {};
+	double pixelSquares[ParticleNoiseLod::MaxBands] = {};
+	double maxPixels[ParticleNoiseLod::MaxBands] = {};
+	unsigned int bandParticles[ParticleNoiseLod::MaxBands] = {};
+
+	for (int i = 0; i < particleCount; ++i)
+	{
+		XMFLOAT3 position = reference[i].Position;
+		int band = lod.FindBand(position);
+
+		double dx = scalarLod[i].Position.x - position.x;
+		double dy = scalarLod[i].Position.y - position.y;
+		double dz = scalarLod[i].Position.z - position.z;
+		double error = sqrt(dx * dx + dy * dy + dz * dz);
+
+		double ex = position.x - eye.x;
+		double ey = position.y - eye.y;
+		double ez = position.z - eye.z;
+		double pixels = error / sqrt(ex * ex + ey * ey + ez * ez) * pixelsPerRadian;
+
+		squares[band] += error * error;
+		pixelSquares[band] += pixels * pixels;
+		maxPixels[band] = (std::max)(maxPixels[band], pixels);
+		bandParticles[band]++;
+	}
+
+	out << "per band after " << frameCount << " frames, one band with the noise every frame: " << (singleMatches ? "match" : "DIFFER") << std::endl;
+	out << std::left << std::setw(12) << "distance"
+		<< std::setw(10) << "source"
+		<< std::setw(10) << "refresh"
+		<< std::setw(12) << "particles"
+		<< std::setw(10) << "noise %"
+		<< std::setw(10) << "volume %"
+		<< std::setw(10) << "held %"
+		<< std::setw(14) << "rms error"
+		<< std::setw(10) << "rms px"
+		<< "max px" << std::endl;
+
+	for (int band = 0; band < lod.GetBandCount(); ++band)
+	{
+		const ParticleNoiseLodBand& lodBand = lod.GetBand(band);
+		unsigned long long taken = sources[band][0] + sources[band][1] + sources[band][2];
+		double percent = taken > 0 ? 100.0 / taken : 0.0;
+		double particlesInBand = (std::max)(bandParticles[band], 1u);
+
+		out << std::left << std::setw(12) << (band == lod.GetBandCount() - 1 ? std::string("beyond") : "< " + std::to_string((int)lodBand.MaxDistance))
+			<< std::setw(10) << (lodBand.Source == ParticleNoiseLodVolume ? "volume" : "noise")
+			<< std::setw(10) << lodBand.RefreshFrames
+			<< std::setw(12) << bandParticles[band]
+			<< std::setw(10) << sources[band][0] * percent
+			<< std::setw(10) << sources[band][1] * percent
+			<< std::setw(10) << sources[band][2] * percent
+			<< std::setw(14) << sqrt(squares[band] / particlesInBand)
+			<< std::setw(10) << sqrt(pixelSquares[band] / particlesInBand)
+			<< maxPixels[band] << std::endl;
+	}
+
+	return passed;
+}
+
+bool ParticleSelfChecks::WriteTimeSliceReport(std::ostream& out, int particleCount, int frameCount)
+{
+	const float deltaTime = 1.0f / 60.0f;
+	const float lifeTime = 2.0f;
+	const unsigned int clusterSize = 64;
+
+	Camera camera(1280, 720);
+	XMFLOAT3 eye = camera.GetPosition();
+	XMFLOAT4X4 view = camera.GetViewMatrix();
+	XMFLOAT4X4 projection = camera.GetProjectionMatrix();
+	float pixelsPerRadian = 0.5f * 720.0f * projection._22;
+
+	// clusters from 20 to 600 units in front of the camera and a third of them off to the sides out of view,
+	// the ages spread over the lifetime so particles keep expiring while the buckets wait
+	std::vector<Particle> seed(particleCount);
+	XMFLOAT3 center(0.0f, 0.0f, 0.0f);
+	for (int i = 0; i < particleCount; ++i)
+	{
+		if (i % clusterSize == 0)
+		{
+			float side = (i / clusterSize) % 3 == 0 ? MathHelper::RandF(300.0f, 500.0f) : 0.0f;
+			center = XMFLOAT3(MathHelper::RandF(-40.0f, 40.0f) + side, MathHelper::RandF(-50.0f, 30.0f), MathHelper::RandF(-130.0f, 450.0f));
+		}
+
+		seed[i] = MakeParticle(XMFLOAT3(center.x + MathHelper::RandF(-2.0f, 2.0f), center.y + MathHelper::RandF(-2.0f, 2.0f),
+			center.z + MathHelper::RandF(-2.0f, 2.0f)));
+		seed[i].Age = MathHelper::RandF(0.0f, lifeTime);
+	}
+
+	std::vector<unsigned int> emptyDeadList(particleCount, 0);
+	std::vector<ParticleSort> emptyDrawList(particleCount);
+	unsigned int emptyDrawArgs[9] = {};
+
+	TimeConstants timeConstants = MakeTimeConstants();
+	ParticleConstants particleConstants = MakeParticleConstants(particleCount, 0, lifeTime);
+
+	// the full update and the sliced ones step in lockstep, the live sets have to agree on every frame
+	struct SlicedRun
+	{
+		std::unique_ptr<CPUParticleSystem> System;
+		std::unique_ptr<ParticleTimeSlicer> Slicer;
+		unsigned long long Integrated = 0;
+		unsigned int LiveMismatches = 0;
+	};
+
+	ParticleTimeSliceDesc everyFrame;
+	everyFrame.Distances[0] = 1e30f;
+	everyFrame.Distances[1] = 2e30f;
+	everyFrame.Distances[2] = 3e30f;
+	everyFrame.OffscreenInterval = 1;
+
+	const ParticleTimeSliceDesc descs[2] = { ParticleTimeSliceDesc(), everyFrame };
+
+	CPUParticleSystem full(particleCount);
+	full.RestoreState(seed.data(), emptyDeadList.data(), 0, emptyDrawList.data(), 0, emptyDrawArgs);
+
+	SlicedRun runs[2];
+	for (int run = 0; run < 2; ++run)
+	{
+		runs[run].System.reset(new CPUParticleSystem(particleCount));
+		runs[run].Slicer.reset(new ParticleTimeSlicer(particleCount));
+		runs[run].Slicer->SetDesc(descs[run]);
+		runs[run].System->SetTimeSlicer(runs[run].Slicer.get());
+		runs[run].System->RestoreState(seed.data(), emptyDeadList.data(), 0, emptyDrawList.data(), 0, emptyDrawArgs);
+	}
+
+	unsigned long long fullIntegrated = 0;
+	for (int frame = 0; frame < frameCount; ++frame)
+	{
+		SimulatePoolFrame(full, timeConstants, particleConstants, false);
+		fullIntegrated += full.GetIntegratedCount();
+
+		const Particle* fullPool = full.GetParticlePool();
+
+		for (SlicedRun& run : runs)
+		{
+			run.Slicer->BeginFrame(eye, view, projection, deltaTime);
+			SimulatePoolFrame(*run.System, timeConstants, particleConstants, false);
+			run.Integrated += run.System->GetIntegratedCount();
+
+			// a particle that waits still has to expire on the frame the full update expires it
+			const Particle* pool = run.System->GetParticlePool();
+			for (int i = 0; i < particleCount; ++i)
+			{
+				if (pool[i].Alive != fullPool[i].Alive)
+					run.LiveMismatches++;
+			}
+		}
+	}
+
+	bool passed = true;
+	bool everyFrameMatches = memcmp(runs[1].System->GetParticlePool(), full.GetParticlePool(), sizeof(Particle) * particleCount) == 0;
+	if (!everyFrameMatches || runs[0].LiveMismatches != 0 || runs[1].LiveMismatches != 0)
+		passed = false;
+
+	const ParticleStageStats& fullStats = full.GetStageStats(ParticleStageUpdate);
+	const ParticleStageStats& slicedStats = runs[0].System->GetStageStats(ParticleStageUpdate);
+	double fullMs = fullStats.Seconds * 1000.0 / frameCount;
+	double slicedMs = slicedStats.Seconds * 1000.0 / frameCount;
+
+	out << std::endl << "time-sliced update by visibility and distance (" << particleCount << " particles, " << frameCount << " frames)" << std::endl;
+	out << std::left << std::setw(12) << "update"
+		<< std::setw(16) << "updates/frame"
+		<< std::setw(14) << "of pool"
+		<< std::setw(12) << "ms/frame"
+		<< "live set" << std::endl;
+	out << std::left << std::setw(12) << "full"
+		<< std::setw(16) << fullIntegrated / frameCount
+		<< std::setw(14) << (double)fullIntegrated / frameCount / particleCount
+		<< std::setw(12) << fullMs
+		<< "-" << std::endl;
+	out << std::left << std::setw(12) << "sliced"
+		<< std::setw(16) << runs[0].Integrated / frameCount
+		<< std::setw(14) << (double)runs[0].Integrated / frameCount / particleCount
+		<< std::setw(12) << slicedMs
+		<< (runs[0].LiveMismatches == 0 ? "match" : std::to_string(runs[0].LiveMismatches) + " DIFFER") << std::endl;
+	out << "every bucket on every frame against the full update: " << (everyFrameMatches ? "match" : "DIFFER")
+		<< ", live set " << (runs[1].LiveMismatches == 0 ? "match" : "DIFFER") << std::endl;
+
+	// the error of each bucket against the full update over the particles alive at the end,
+	// the pixel error takes the whole offset across the view, an upper bound of what moves on screen
+	const int bucketCount = 5;
+	const char* bucketNames[bucketCount] = { "every frame", "every 2nd", "every 4th", "every 8th", "off-screen" };
+	double squares[bucketCount] = {};
+	double pixelSquares[bucketCount] = {};
+	double maxPixels[bucketCount] = {};
+	unsigned int bucketParticles[bucketCount] = {};
+
+	const Particle* fullPool = full.GetParticlePool();
+	const Particle* slicedPool = runs[0].System->GetParticlePool();
+	ParticleFrustumCuller frustum;
+	frustum.SetMatrices(view, projection);
+
+	for (int i = 0; i < particleCount; ++i)
+	{
+		if (fullPool[i].Alive == 0.0f)
+			continue;
+
+		XMFLOAT3 position = fullPool[i].Position;
+		unsigned int interval = runs[0].Slicer->GetInterval(fullPool[i]);
+		int bucket = !frustum.IsVisible(fullPool[i]) ? 4 : interval == 1 ? 0 : interval == 2 ? 1 : interval == 4 ? 2 : 3;
+
+		double dx = slicedPool[i].Position.x - position.x;
+		double dy = slicedPool[i].Position.y - position.y;
+		double dz = slicedPool[i].Position.z - position.z;
+		double error = sqrt(dx * dx + dy * dy + dz * dz);
+
+		double ex = position.x - eye.x;
+		double ey = position.y - eye.y;
+		double ez = position.z - eye.z;
+		double pixels = error / sqrt(ex * ex + ey * ey + ez * ez) * pixelsPerRadian;
+
+		squares[bucket] += error * error;
+		pixelSquares[bucket] += pixels * pixels;
+		maxPixels[bucket] = (std::max)(maxPixels[bucket], pixels);
+		bucketParticles[bucket]++;
+	}
+
+	out << std::left << std::setw(14) << "bucket"
+		<< std::setw(12) << "particles"
+		<< std::setw(14) << "rms error"
+		<< std::setw(10) << "rms px"
+		<< "max px" << std::endl;
+
+	for (int bucket = 0; bucket < bucketCount; ++bucket)
+	{
+		double particlesInBucket = (std::max)(bucketParticles[bucket], 1u);
+
+		out << std::left << std::setw(14) << bucketNames[bucket]
+			<< std::setw(12) << bucketParticles[bucket]
+			<< std::setw(14) << sqrt(squares[bucket] / particlesInBucket)
+			<< std::setw(10) << sqrt(pixelSquares[bucket] / particlesInBucket)
+			<< maxPixels[bucket] << std::endl;
+	}
+
+	return passed;
+}
+
+bool ParticleSelfChecks::WriteSpawnOffsetReport(std::ostream& out, int stepCount)
+{
+	const int maxParticles = 1000000;
+	const int gridSize = 100;
+	const float emissionRate = 1000000.0f;
+	const float deltaTime = 1.0f / 60.0f;
+	const float lifeTime = 1000.0f;
+
+	// the Game emitter planned like Game::Draw, once with every spawn at the emit and then spread over the step
+	// at every kernel level, which have to agree bit for bit
+	struct SpawnRun
+	{
+		const char* Name;
+		bool Spread;
+		ParticleKernelLevel Level;
+	};
+
+	const SpawnRun runs[] =
+	{
+		{ "at the emit", false, ParticleUpdateKernel::DetectLevel() },
+		{ "spread", true, ParticleUpdateKernel::DetectLevel() },
+		{ "spread scalar", true, ParticleKernelScalar },
+		{ "spread SSE4", true, ParticleKernelSSE4 },
+	};
+	const int runCount = sizeof(runs) / sizeof(runs[0]);
+
+	out << std::endl << "spawn offsets within the step (" << (int)emissionRate << " particles/s, " << stepCount << " steps)" << std::endl;
+	out << std::left << std::setw(16) << "emit"
+		<< std::setw(12) << "emitted"
+		<< std::setw(12) << "live"
+		<< std::setw(14) << "distinct ages"
+		<< std::setw(16) << "max age gap"
+		<< std::setw(16) << "max age error"
+		<< std::setw(14) << "emit ms/step"
+		<< "result" << std::endl;
+
+	// a spread particle has to be as old as the time since its spawn was due, the float ages of up to half a second
+	// added up over the steps are a few ulp off, a quarter of the spawn spacing, a step too old is 0.0167 s off
+	const float maxAgeError = 0.25f / emissionRate;
+
+	bool passed = true;
+	std::vector<Particle> spreadPool;
+	std::vector<float> ages;
+
+	for (int run = 0; run < runCount; ++run)
+	{
+		Emitter emitter(maxParticles, gridSize, emissionRate, lifeTime, XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f),
+			XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f), XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f));
+		EmissionPlanner planner;
+
+		CPUParticleSystem system(maxParticles);
+		system.SetKernelLevel(runs[run].Level);
+
+		TimeConstants timeConstants = MakeTimeConstants();
+		ParticleConstants particleConstants = MakeParticleConstants(maxParticles, 0, lifeTime);
+		system.DeadListInit(particleConstants);
+
+		for (int step = 0; step < stepCount; ++step)
+		{
+			timeConstants.DeltaTime = deltaTime;
+			timeConstants.TotalTime = (step + 1) * deltaTime;
+
+			emitter.Update(timeConstants.TotalTime, deltaTime);
+			EmissionBatch batch = planner.Plan(emitter, system.GetDeadListCount());
+
+			particleConstants.EmitCount = (int)batch.EmitCount;
+			particleConstants.EmitNewestAge = runs[run].Spread ? emitter.GetEmitTimeCounter() : 0.0f;
+			particleConstants.EmitSpacing = runs[run].Spread ? emitter.GetTimeBetweenEmit() : 0.0f;
+
+			SimulatePoolFrame(system, timeConstants, particleConstants, true);
+		}
+
+		// nothing expires, so every planned spawn is alive and the planner still emits exactly rate * time
+		const Particle* pool = system.GetParticlePool();
+		ages.clear();
+		for (int i = 0; i < maxParticles; ++i)
+		{
+			if (pool[i].Alive != 0.0f)
+				ages.push_back(pool[i].Age);
+		}
+
+		std::sort(ages.begin(), ages.end());
+		unsigned int distinctAges = ages.empty() ? 0 : 1;
+		float maxGap = 0.0f;
+		for (size_t i = 1; i < ages.size(); ++i)
+		{
+			if (ages[i] != ages[i - 1])
+				distinctAges++;
+			maxGap = (std::max)(maxGap, ages[i] - ages[i - 1]);
+		}
+
+		double expected = floor((double)emissionRate * deltaTime * stepCount);
+		bool countsMatch = planner.GetEmittedCount() == ages.size() && fabs((double)planner.GetEmittedCount() - expected) <= 1.0;
+
+		// spread spawns leave no gap near a whole step, all at the emit they come in one age per step
+		bool smooth = runs[run].Spread ? maxGap < 0.01f * deltaTime : distinctAges == (unsigned int)stepCount;
+
+		// spawn j is due j / rate into the run, the youngest particle is the last spawn, so sorted ascending
+		// ages[i] belongs to spawn count - i and has to be the time since it was due, measured at the end of the run
+		double endTime = (double)deltaTime * stepCount;
+		double ageError = 0.0;
+		for (size_t i = 0; i < ages.size(); ++i)
+		{
+			double dueTime = (double)(ages.size() - i) / emissionRate;
+			ageError = (std::max)(ageError, fabs((double)ages[i] - (endTime - dueTime)));
+		}
+
+		bool agesExact = !runs[run].Spread || ageError <= maxAgeError;
+
+		bool levelsMatch = true;
+		if (runs[run].Spread)
+		{
+			if (spreadPool.empty())
+				spreadPool.assign(pool, pool + maxParticles);
+			else
+				levelsMatch = memcmp(spreadPool.data(), pool, sizeof(Particle) * maxParticles) == 0;
+		}
+
+		bool runPassed = countsMatch && smooth && agesExact && levelsMatch;
+		if (!runPassed)
+			passed = false;
+
+		double emitMs = system.GetStageStats(ParticleStageEmit).Seconds * 1000.0 / stepCount;
+
+		out << std::left << std::setw(16) << runs[run].Name
+			<< std::setw(12) << planner.GetEmittedCount()
+			<< std::setw(12) << ages.size()
+			<< std::setw(14) << distinctAges
+			<< std::setw(16) << maxGap
+			<< std::setw(16);
+		if (runs[run].Spread)
+			out << ageError;
+		else
+			out << "-";
+		out << std::setw(14) << emitMs
+			<< (runPassed ? "ok" : !countsMatch ? "COUNT FAIL" : !smooth ? "BANDED FAIL" : !agesExact ? "AGE FAIL" : "DIFFER") << std::endl;
+	}
+
+	return passed;
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include <ostream>
+#include <string>
+#include "ParticleBenchmark.h"
+
+// the checks "-headless" appends to the benchmark report, each compares a fast path against its reference
+// and times both, they build their own particle systems and only share the settings of the command line
+class ParticleSelfChecks
+{
+public:
+	// appends the report of every check whose flag is on the command line, in table order, the files a check
+	// writes go next to reportFile, returns false when any of them fails
+	// "-layouts" the pool layout comparison at 1M and 10M particles
+	// "-kernels" the update kernel comparison
+	// "-scaling" the thread scaling of the parallel update
+	// "-sortcheck" the depth sort comparison
+	// "-camerapath" the frustum culling camera path
+	// "-packcheck" the 32-byte record precision comparison
+	// "-emittercheck" the shared pool against one pool per emitter
+	// "-emitplan" the emission planner counts
+	// "-shapecheck" the emission shape distributions and spawn cost
+	// "-determinism" the fixed step reproducibility check
+	// "-fifocheck" the FIFO ring against the dead list
+	// "-occupancy" the pool against alive list update cost
+	// "-deadlist" the dead list contention benchmark
+	// "-birthcheck" the birth time representation against ages
+	// "-closedform" the ballistic closed form evaluation
+	// "-noisecheck" the batch simplex noise against its scalar reference
+	// "-noisegrad" the analytic noise gradients and curl
+	// "-curlvolume" the baked curl volume against direct curl noise
+	// "-curlcache" the time-varying curl cache against direct evaluation
+	// "-noisefamily" the cost of each noise basis and octave count
+	// "-noiselod" the distance banded noise against the full update
+	// "-timeslice" the time-sliced update against the full update
+	// "-spawnoffsets" the emission with and without the spawns spread over the step
+	static bool Run(std::ostream& out, const char* cmdLine, const ParticleBenchmarkSettings& settings, const std::string& reportFile);
+
+	// bytes moved per particle per frame by each ParticlePool layout, for update and for packing the upload
+	static void WriteLayoutReport(std::ostream& out, int particleCount, int frameCount);
+
+	// throughput of every update kernel the CPU supports and its ULP error against the scalar reference
+	// returns false when a kernel exceeds ParticleUpdateKernel::MaxUlpError or fills different lists
+	static bool WriteKernelReport(std::ostream& out, int particleCount, int frameCount);
+
+	// parallel update time from 1 thread up to maxThreads (0 for every hardware thread), returns false when
+	// a thread count produces different draw or dead lists than the sequential update
+	static bool WriteScalingReport(std::ostream& out, int particleCount, int frameCount, int maxThreads);
+
+	// state and constants hashes after the same number of fixed steps under different frame pacing and thread counts
+	// returns false when any run differs from the first
+	static bool WriteDeterminismReport(std::ostream& out, const ParticleBenchmarkSettings& settings, int stepCount);
+
+	// radix depth sort against std::stable_sort on the same keys, for 1 thread up to maxThreads (0 for every
+	// hardware thread), returns false when the orders differ or the result is not back to front
+	static bool WriteDepthSortReport(std::ostream& out, int particleCount, int maxThreads);
+
+	// visible and culled particles per frame while the Game camera orbits a cube of particles, every kernel
+	// against the scalar planes test, returns false when the kernels disagree or a particle inside the view is culled
+	static bool WriteCullReport(std::ostream& out, int particleCount, int frameCount);
+
+	// fp32 Particle against PackedParticle over stepCount update steps from the same start, position, velocity
+	// and age error at every power of ten steps and the update cost of both, returns false when a conversion
+	// differs from the scalar reference or a packed particle expires more than one step away from its fp32 twin
+	static bool WritePackedReport(std::ostream& out, int particleCount, int stepCount);
+
+	// N emitters sharing one pool against N pools with an emitter each, with the same emission rates and lifetimes
+	// returns false when an emitter draws a different number of particles in the two setups
+	static bool WriteEmitterReport(std::ostream& out, int particleCount, int frameCount);
+
+	// ns per spawn and the distribution of sampleCount spawns for every emission shape, mesh triangle frequencies
+	// against their areas and the cost of a spawn on meshes from 16 to 1M triangles
+	// returns false when a shape places a particle outside itself or its distribution is off
+	static bool WriteShapeReport(std::ostream& out, int sampleCount);
+
+	// EmissionPlanner counts over long runs at awkward rates, under the dead list cap and past the dispatch limit,
+	// next to what the old per iteration loop of Game::Draw emitted, returns false when a count is off
+	static bool WritePlannerReport(std::ostream& out);
+
+	// dead list, alive list and FIFO ring allocation from 5% to 100% occupancy, startup, emit and update cost
+	// returns false when the ring draws a different number of particles than the dead list in any frame
+	static bool WriteRingReport(std::ostream& out, int particleCount, int frameCount);
+
+	// update cost of the whole pool against the alive list from 1% to 100% occupancy
+	// returns false when the two modes draw different particles
+	static bool WriteOccupancyReport(std::ostream& out, int particleCount, int frameCount);
+
+	// append/consume throughput of DeadListStack from 1 to 64 threads, one index and one batch per operation
+	// returns false when an index is lost or duplicated or an underflow goes unreported
+	static bool WriteDeadListReport(std::ostream& out, int capacity);
+
+	// the update with ages against birth times and a short rebase period, then the error of a birth time
+	// after long sessions with and without rebasing and the pool layouts with their store bytes
+	// returns false when the two modes draw more than a frame of emission apart or the rebased error reaches half a step
+	static bool WriteBirthReport(std::ostream& out, int particleCount, int frameCount);
+
+	// the ballistic closed form against a birth time ring that updates every particle and against Euler steps
+	// of the whole pool, cost and bytes per frame, the error of the float evaluation and of the steps
+	// returns false when the live counts differ from the ring or the evaluation is off the double precision closed form
+	static bool WriteBallisticReport(std::ostream& out, int particleCount, int frameCount);
+
+	// every SimplexNoise function at every batch width the CPU supports against the scalar port of the shader,
+	// ns per point and speedup, returns false when any lane differs from the scalar reference by a single bit
+	static bool WriteNoiseReport(std::ostream& out, int sampleCount);
+
+	// snoise_grad against central differences of snoise, curlNoise3DGrad against the finite difference curl and
+	// its divergence, and the cost of both curls at every batch width
+	// returns false when a value differs from SNoise, an error passes 1% of the largest gradient, the divergence
+	// is not negligible or a batch differs from the scalar curl
+	static bool WriteNoiseGradientReport(std::ostream& out, int sampleCount);
+
+	// a CurlVolume at 16^3 to 128^3, bake time on one and on all threads and the error against direct curl noise,
+	// the batch sampler against the scalar one and the update at each kernel level with the noise and with the volume,
+	// the 64^3 volume is saved as an fp16 DDS to fileName and read back
+	// returns false when the bakes or samplers differ, the error doesn't fall with resolution or the texture doesn't read back
+	static bool WriteCurlVolumeReport(std::ostream& out, int particleCount, const std::string& fileName);
+
+	// a CurlFieldCache refreshed every 1 to 64 frames over frameCount frames, texels evaluated and ms per frame and
+	// the error against direct curlNoise4D, then the direct evaluation at a tenth of and at particleCount particles
+	// returns false when the evaluation count is off, the error reaches the field itself or a cache refreshed
+	// every frame differs from the field
+	static bool WriteCurlCacheReport(std::ostream& out, int particleCount, int frameCount);
+
+	// value, gradient, simplex, worley and ridged gradient noise in 2D and 3D at 1, 4 and 8 octaves,
+	// ns per sample at every batch width the CPU supports and the mean and spread of the values
+	// returns false when any lane differs from the SimdScalar instantiation by a single bit
+	static bool WriteNoiseFamilyReport(std::ostream& out, int sampleCount);
+
+	// particles from 20 to 600 units in front of the Game camera updated for frameCount frames with and without
+	// distance bands, ms per frame at each kernel level, then per band the sources taken and the position error
+	// against the full update in world units and in pixels
+	// returns false when a single full band differs from the update without bands or a batch kernel from the scalar one
+	static bool WriteNoiseLodReport(std::ostream& out, int particleCount, int frameCount);
+
+	// particles in and out of view of the Game camera updated for frameCount frames by the full update and with a
+	// ParticleTimeSlicer, integrations per frame against the pool size, ms per frame and the position error per bucket
+	// returns false when a sliced run expires a particle on a different frame or the slicer with every bucket
+	// on every frame differs from the full update
+	static bool WriteTimeSliceReport(std::ostream& out, int particleCount, int frameCount);
+
+	// the Game emitter for stepCount steps with every spawn at the emit and spread over the step, the distinct ages,
+	// the largest gap between them and how far a spread age is from the time since its spawn was due, returns false
+	// when the spread run still bands or is off in age, the emitted count is off or the kernel levels pre-integrate differently
+	static bool WriteSpawnOffsetReport(std::ostream& out, int stepCount);
+};
@@ -0,0 +1,103 @@
+#include "ParticleTimeSlicer.h"
+#include <algorithm>
+
+using namespace DirectX;
+
+ParticleTimeSlicer::ParticleTimeSlicer(int maxParticles) :
+	lastFrames(maxParticles, 0),
+	intervals(maxParticles, 1)
+{
+	for (int bucket = 0; bucket < 3; ++bucket)
+		distancesSquared[bucket] = desc.Distances[bucket] * desc.Distances[bucket];
+
+	eye = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	frame = 0;
+
+	std::fill(std::begin(deltaTimes), std::end(deltaTimes), 0.0f);
+	std::fill(std::begin(elapsed), std::end(elapsed), 0.0f);
+}
+
+bool ParticleTimeSlicer::SetDesc(const ParticleTimeSliceDesc& newDesc)
+{
+	if (!(newDesc.Distances[0] > 0.0f && newDesc.Distances[1] > newDesc.Distances[0] && newDesc.Distances[2] > newDesc.Distances[1]))
+		return false;
+
+	unsigned int offscreen = newDesc.OffscreenInterval;
+	if (offscreen == 0 || offscreen > MaxInterval || (offscreen & (offscreen - 1)) != 0)
+		return false;
+
+	desc = newDesc;
+	for (int bucket = 0; bucket < 3; ++bucket)
+		distancesSquared[bucket] = desc.Distances[bucket] * desc.Distances[bucket];
+
+	return true;
+}
+
+const ParticleTimeSliceDesc& ParticleTimeSlicer::GetDesc() const
+{
+	return desc;
+}
+
+int ParticleTimeSlicer::GetMaxParticles() const
+{
+	return (int)lastFrames.size();
+}
+
+void ParticleTimeSlicer::BeginFrame(XMFLOAT3 frameEye, const XMFLOAT4X4& view, const XMFLOAT4X4& projection, float deltaTime)
+{
+	eye = frameEye;
+	frustum.SetMatrices(view, projection);
+	frame++;
+
+	for (unsigned int k = 2 * MaxInterval - 1; k > 0; --k)
+		deltaTimes[k] = deltaTimes[k - 1];
+	deltaTimes[0] = deltaTime;
+
+	// summed from the newest frame back, so a particle integrated on the last frame steps with exactly deltaTime
+	elapsed[0] = 0.0f;
+	for (unsigned int k = 1; k <= 2 * MaxInterval; ++k)
+		elapsed[k] = elapsed[k - 1] + deltaTimes[k - 1];
+}
+
+unsigned int ParticleTimeSlicer::GetFrame() const
+{
+	return frame;
+}
+
+void ParticleTimeSlicer::Reset()
+{
+	std::fill(lastFrames.begin(), lastFrames.end(), frame);
+	std::fill(intervals.begin(), intervals.end(), 1);
+}
+
+unsigned int ParticleTimeSlicer::GetInterval(const Particle& particle) const
+{
+	if (!frustum.IsVisible(particle))
+		return desc.OffscreenInterval;
+
+	float dx = particle.Position.x - eye.x;
+	float dy = particle.Position.y - eye.y;
+	float dz = particle.Position.z - eye.z;
+	float distanceSquared = dx * dx + dy * dy + dz * dz;
+
+	unsigned int interval = 1;
+	for (int bucket = 0; bucket < 3 && !(distanceSquared < distancesSquared[bucket]); ++bucket)
+		interval *= 2;
+
+	return interval;
+}
+
+bool ParticleTimeSlicer::Step(const Particle& particle, unsigned int id, float age, float& step)
+{
+	if ((id / BlockSize + frame) % intervals[id] != 0)
+		return false;
+
+	// a slot left unintegrated for longer held particles that died since, the one in it now is younger than that
+	unsigned int frames = frame - lastFrames[id];
+	step = frames <= 2 * MaxInterval ? (std::min)(elapsed[frames], age) : age;
+
+	// the bucket is only looked up again on the next integration, a waiting particle costs no frustum test
+	lastFrames[id] = frame;
+	intervals[id] = (unsigned char)GetInterval(particle);
+	return true;
+}
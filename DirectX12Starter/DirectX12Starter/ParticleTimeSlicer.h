@@ -0,0 +1,67 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "Emitter.h"
+#include "ParticleFrustumCull.h"
+
+// the buckets of a ParticleTimeSlicer, visible particles beyond Distances[k] from the camera are integrated
+// every 2^(k + 1) frames and the nearer ones on every frame, particles outside the frustum every OffscreenInterval frames
+struct ParticleTimeSliceDesc
+{
+	float Distances[3] = { 150.0f, 300.0f, 450.0f };
+	unsigned int OffscreenInterval = 8;
+};
+
+// time-sliced integration for the update pass, a particle that waits keeps its position and velocity and
+// the next integration covers every frame since the last one, so a bucket of interval n steps with n * deltaTime
+// the kernel still ages every particle on every frame, so expiry doesn't wait for an integration
+// particles are integrated in blocks of BlockSize consecutive pool slots, block b on the frames where
+// (b + frame) % interval == 0, so every bucket spreads its work evenly over the frames
+// a particle moves to its new bucket when it is integrated, so one that changes buckets waits at most MaxInterval frames
+class ParticleTimeSlicer
+{
+public:
+	static const unsigned int MaxInterval = 8;
+	static const unsigned int BlockSize = 16;
+
+	// remembers the last integration of maxParticles pool slots
+	ParticleTimeSlicer(int maxParticles);
+
+	// returns false and keeps the current buckets when the distances don't increase
+	// or the off-screen interval is not 1, 2, 4 or 8
+	bool SetDesc(const ParticleTimeSliceDesc& desc);
+	const ParticleTimeSliceDesc& GetDesc() const;
+
+	int GetMaxParticles() const;
+
+	// once per frame before the update, the camera of the frame and the deltaTime the update steps with
+	void BeginFrame(DirectX::XMFLOAT3 eye, const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection, float deltaTime);
+	unsigned int GetFrame() const;
+
+	// every slot counts as integrated on the current frame, after the pool was restored or replaced
+	void Reset();
+
+	// how many frames apart the particle is integrated, 1, 2, 4 or 8
+	unsigned int GetInterval(const Particle& particle) const;
+
+	// for the kernel, once per live particle and frame, age is its age after this frame's step
+	// returns false when the particle waits, otherwise the time to integrate it over, the frames since its last
+	// integration but never more than its age, so a particle new in a slot only covers its own life
+	bool Step(const Particle& particle, unsigned int id, float age, float& step);
+
+private:
+	ParticleTimeSliceDesc desc;
+	float distancesSquared[3];
+
+	DirectX::XMFLOAT3 eye;
+	ParticleFrustumCuller frustum;
+	unsigned int frame;
+
+	// elapsed[k] is the time covered by the last k frames, up to 2 * MaxInterval frames back
+	float deltaTimes[2 * MaxInterval];
+	float elapsed[2 * MaxInterval + 1];
+
+	// the frame each slot was last integrated on and the interval it waits for until the next integration
+	std::vector<unsigned int> lastFrames;
+	std::vector<unsigned char> intervals;
+};
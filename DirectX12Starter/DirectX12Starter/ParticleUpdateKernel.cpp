@@ -0,0 +1,869 @@
+#include "FloatContraction.h"
+#include "ParticleUpdateKernel.h"
+#include "CurlVolume.h"
+#include "ParticleNoiseLod.h"
+#include "ParticleTimeSlicer.h"
+#include "SimplexNoise.h"
+#include <cstddef>
+#include <cstring>
+#include <intrin.h>
+
+using namespace DirectX;
+
+namespace
+{
+	// moves between four 16-byte rows of consecutive particles and one register per component
+	template<typename Simd> struct ParticleRows;
+
+	template<>
+	struct ParticleRows<SimdSSE4>
+	{
+		static void Load(const Particle* batch, size_t rowOffset, __m128& x, __m128& y, __m128& z, __m128& w)
+		{
+			x = _mm_loadu_ps(reinterpret_cast<const float*>(batch + 0) + rowOffset);
+			y = _mm_loadu_ps(reinterpret_cast<const float*>(batch + 1) + rowOffset);
+			z = _mm_loadu_ps(reinterpret_cast<const float*>(batch + 2) + rowOffset);
+			w = _mm_loadu_ps(reinterpret_cast<const float*>(batch + 3) + rowOffset);
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+		}
+
+		static void Store(Particle* batch, size_t rowOffset, __m128 x, __m128 y, __m128 z, __m128 w)
+		{
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			_mm_storeu_ps(reinterpret_cast<float*>(batch + 0) + rowOffset, x);
+			_mm_storeu_ps(reinterpret_cast<float*>(batch + 1) + rowOffset, y);
+			_mm_storeu_ps(reinterpret_cast<float*>(batch + 2) + rowOffset, z);
+			_mm_storeu_ps(reinterpret_cast<float*>(batch + 3) + rowOffset, w);
+		}
+	};
+
+	template<>
+	struct ParticleRows<SimdAVX2>
+	{
+		// 4x4 transpose inside each 128-bit half, the low half holds particles 0-3 and the high half 4-7
+		static void Transpose(__m256& r0, __m256& r1, __m256& r2, __m256& r3)
+		{
+			__m256 t0 = _mm256_unpacklo_ps(r0, r1);
+			__m256 t1 = _mm256_unpackhi_ps(r0, r1);
+			__m256 t2 = _mm256_unpacklo_ps(r2, r3);
+			__m256 t3 = _mm256_unpackhi_ps(r2, r3);
+			r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+			r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+			r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+			r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+		}
+
+		static __m256 LoadPair(const Particle* batch, int index, size_t rowOffset)
+		{
+			__m128 low = _mm_loadu_ps(reinterpret_cast<const float*>(batch + index) + rowOffset);
+			__m128 high = _mm_loadu_ps(reinterpret_cast<const float*>(batch + index + 4) + rowOffset);
+			return _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+		}
+
+		static void StorePair(Particle* batch, int index, size_t rowOffset, __m256 value)
+		{
+			_mm_storeu_ps(reinterpret_cast<float*>(batch + index) + rowOffset, _mm256_castps256_ps128(value));
+			_mm_storeu_ps(reinterpret_cast<float*>(batch + index + 4) + rowOffset, _mm256_extractf128_ps(value, 1));
+		}
+
+		static void Load(const Particle* batch, size_t rowOffset, __m256& x, __m256& y, __m256& z, __m256& w)
+		{
+			x = LoadPair(batch, 0, rowOffset);
+			y = LoadPair(batch, 1, rowOffset);
+			z = LoadPair(batch, 2, rowOffset);
+			w = LoadPair(batch, 3, rowOffset);
+			Transpose(x, y, z, w);
+		}
+
+		static void Store(Particle* batch, size_t rowOffset, __m256 x, __m256 y, __m256 z, __m256 w)
+		{
+			Transpose(x, y, z, w);
+			StorePair(batch, 0, rowOffset, x);
+			StorePair(batch, 1, rowOffset, y);
+			StorePair(batch, 2, rowOffset, z);
+			StorePair(batch, 3, rowOffset, w);
+		}
+	};
+
+	const size_t PositionRow = offsetof(Particle, Position) / sizeof(float);
+	const size_t VelocityRow = offsetof(Particle, Velocity) / sizeof(float);
+
+	// where a kernel takes the lifetime of a particle from, one lifetime for the pool
+	struct UniformLifeTime
+	{
+		float LifeTime;
+
+		float operator()(const Particle& particle) const
+		{
+			return LifeTime;
+		}
+
+		template<typename Simd>
+		typename Simd::Float Load(const Particle* batch) const
+		{
+			return Simd::Set1(LifeTime);
+		}
+	};
+
+	// or the lifetime of the emitter that emitted the particle
+	struct EmitterLifeTime
+	{
+		const float* LifeTimes;
+
+		float operator()(const Particle& particle) const
+		{
+			return LifeTimes[particle.EmitterIndex];
+		}
+
+		template<typename Simd>
+		typename Simd::Float Load(const Particle* batch) const
+		{
+			float lanes[Simd::Width];
+			for (int k = 0; k < Simd::Width; ++k)
+				lanes[k] = LifeTimes[batch[k].EmitterIndex];
+
+			return Simd::Load(lanes);
+		}
+	};
+
+	// how a kernel ages a particle, Age holds the age and every step adds deltaTime to it
+	struct StepAge
+	{
+		static const bool StoresAge = true;
+
+		float DeltaTime;
+
+		float operator()(float age) const
+		{
+			return age + DeltaTime;
+		}
+
+		template<typename Simd>
+		typename Simd::Float Age(typename Simd::Float age) const
+		{
+			return Simd::Add(age, Simd::Set1(DeltaTime));
+		}
+	};
+
+	// or Age holds the birth time and the age is the clock after the step minus it, so Age is only read
+	struct BirthAge
+	{
+		static const bool StoresAge = false;
+
+		float Now;
+
+		float operator()(float birth) const
+		{
+			return Now - birth;
+		}
+
+		template<typename Simd>
+		typename Simd::Float Age(typename Simd::Float birth) const
+		{
+			return Simd::Sub(Simd::Set1(Now), birth);
+		}
+	};
+
+	// how far a kernel integrates a particle, every live particle by the step of the frame
+	struct EveryStep
+	{
+		float DeltaTime;
+
+		bool operator()(const Particle& particle, unsigned int id, float age, float& step) const
+		{
+			step = DeltaTime;
+			return true;
+		}
+
+		template<typename Simd>
+		int Load(const Particle* batch, const unsigned int* ids, typename Simd::Float age, int liveMask, typename Simd::Float& step) const
+		{
+			step = Simd::Set1(DeltaTime);
+			return liveMask;
+		}
+	};
+
+	// or by the buckets of a time slicer, the particles that wait on this frame are only aged
+	struct SlicedStep
+	{
+		ParticleTimeSlicer* Slicer;
+
+		bool operator()(const Particle& particle, unsigned int id, float age, float& step) const
+		{
+			return Slicer->Step(particle, id, age, step);
+		}
+
+		template<typename Simd>
+		int Load(const Particle* batch, const unsigned int* ids, typename Simd::Float age, int liveMask, typename Simd::Float& step) const
+		{
+			float ages[Simd::Width];
+			Simd::Store(ages, age);
+
+			float steps[Simd::Width];
+			int integrateMask = 0;
+			for (int k = 0; k < Simd::Width; ++k)
+			{
+				steps[k] = 0.0f;
+				if ((liveMask & (1 << k)) && Slicer->Step(batch[k], ids[k], ages[k], steps[k]))
+					integrateMask |= 1 << k;
+			}
+
+			step = Simd::Load(steps);
+			return integrateMask;
+		}
+	};
+
+	// where a kernel takes the curl velocity from, the noise evaluated at a tenth of the position like the shader
+	// the fields also get the velocity before the step and the pool slot, for the ones that keep the old velocity
+	struct NoiseCurl
+	{
+		XMFLOAT3 operator()(XMFLOAT3 position, XMFLOAT3 velocity, unsigned int id) const
+		{
+			XMFLOAT3 curlPosition(position.x * 0.1f, position.y * 0.1f, position.z * 0.1f);
+			return SimplexNoise::CurlNoise3D(curlPosition, 1.0f);
+		}
+
+		template<typename Simd>
+		void Curl(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z,
+			typename Simd::Float velocityX, typename Simd::Float velocityY, typename Simd::Float velocityZ, const unsigned int* ids,
+			typename Simd::Float& curlX, typename Simd::Float& curlY, typename Simd::Float& curlZ) const
+		{
+			const typename Simd::Float curlScale = Simd::Set1(0.1f);
+			SimplexNoise::CurlNoise3DBatch<Simd>(Simd::Mul(x, curlScale), Simd::Mul(y, curlScale), Simd::Mul(z, curlScale),
+				1.0f, curlX, curlY, curlZ);
+		}
+	};
+
+	// or the field baked into a CurlVolume, the volume applies its own frequency
+	struct BakedCurl
+	{
+		const CurlVolume* Volume;
+
+		XMFLOAT3 operator()(XMFLOAT3 position, XMFLOAT3 velocity, unsigned int id) const
+		{
+			return Volume->Sample(position);
+		}
+
+		template<typename Simd>
+		void Curl(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z,
+			typename Simd::Float velocityX, typename Simd::Float velocityY, typename Simd::Float velocityZ, const unsigned int* ids,
+			typename Simd::Float& curlX, typename Simd::Float& curlY, typename Simd::Float& curlZ) const
+		{
+			Volume->SampleBatch<Simd>(x, y, z, curlX, curlY, curlZ);
+		}
+	};
+
+	// or per distance band, the noise, the volume or, between refreshes, half the old velocity, which the kernel
+	// doubles back to the same bits, a batch only evaluates the sources one of its lanes needs
+	struct LodCurl
+	{
+		const ParticleNoiseLod* Lod;
+		const CurlVolume* Volume;
+
+		ParticleNoiseLodSource Source(XMFLOAT3 position, unsigned int id, bool& refreshes) const
+		{
+			int band = Lod->FindBand(position);
+			refreshes = Lod->Refreshes(band, id);
+			ParticleNoiseLodSource source = Lod->GetBand(band).Source;
+			return source == ParticleNoiseLodVolume && Volume == nullptr ? ParticleNoiseLodNoise : source;
+		}
+
+		XMFLOAT3 operator()(XMFLOAT3 position, XMFLOAT3 velocity, unsigned int id) const
+		{
+			bool refreshes;
+			ParticleNoiseLodSource source = Source(position, id, refreshes);
+
+			if (!refreshes)
+				return XMFLOAT3(velocity.x * 0.5f, velocity.y * 0.5f, velocity.z * 0.5f);
+
+			if (source == ParticleNoiseLodVolume)
+				return Volume->Sample(position);
+
+			return NoiseCurl()(position, velocity, id);
+		}
+
+		template<typename Simd>
+		void Curl(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z,
+			typename Simd::Float velocityX, typename Simd::Float velocityY, typename Simd::Float velocityZ, const unsigned int* ids,
+			typename Simd::Float& curlX, typename Simd::Float& curlY, typename Simd::Float& curlZ) const
+		{
+			typedef typename Simd::Float Float;
+
+			float positions[3][Simd::Width];
+			Simd::Store(positions[0], x);
+			Simd::Store(positions[1], y);
+			Simd::Store(positions[2], z);
+
+			float noiseLanes[Simd::Width];
+			float volumeLanes[Simd::Width];
+			bool anyNoise = false;
+			bool anyVolume = false;
+			for (int k = 0; k < Simd::Width; ++k)
+			{
+				bool refreshes;
+				ParticleNoiseLodSource source = Source(XMFLOAT3(positions[0][k], positions[1][k], positions[2][k]), ids[k], refreshes);
+
+				bool noise = refreshes && source == ParticleNoiseLodNoise;
+				bool volume = refreshes && source == ParticleNoiseLodVolume;
+				noiseLanes[k] = noise ? 1.0f : 0.0f;
+				volumeLanes[k] = volume ? 1.0f : 0.0f;
+				anyNoise |= noise;
+				anyVolume |= volume;
+			}
+
+			const Float half = Simd::Set1(0.5f);
+			curlX = Simd::Mul(velocityX, half);
+			curlY = Simd::Mul(velocityY, half);
+			curlZ = Simd::Mul(velocityZ, half);
+
+			if (anyNoise)
+			{
+				Float noiseX, noiseY, noiseZ;
+				NoiseCurl().Curl<Simd>(x, y, z, velocityX, velocityY, velocityZ, ids, noiseX, noiseY, noiseZ);
+
+				Float mask = Simd::CmpNeq(Simd::Load(noiseLanes), Simd::Zero());
+				curlX = Simd::Select(mask, noiseX, curlX);
+				curlY = Simd::Select(mask, noiseY, curlY);
+				curlZ = Simd::Select(mask, noiseZ, curlZ);
+			}
+
+			if (anyVolume)
+			{
+				Float sampleX, sampleY, sampleZ;
+				Volume->SampleBatch<Simd>(x, y, z, sampleX, sampleY, sampleZ);
+
+				Float mask = Simd::CmpNeq(Simd::Load(volumeLanes), Simd::Zero());
+				curlX = Simd::Select(mask, sampleX, curlX);
+				curlY = Simd::Select(mask, sampleY, curlY);
+				curlZ = Simd::Select(mask, sampleZ, curlZ);
+			}
+		}
+	};
+
+	// the body of UpdateComputeShader main for one live particle
+	// with a birth time only a particle that dies writes Alive, the live ones already hold 1
+	template<typename Steps, typename Ages, typename Field>
+	void UpdateOne(Particle* particles, unsigned int id, const Steps& steps, float lifeTime, const Ages& ages,
+		const Field& field, ParticleUpdateOutput& output)
+	{
+		Particle& particle = particles[id];
+
+		float age = ages(particle.Age);
+		bool alive = age < lifeTime;
+
+		if (Ages::StoresAge)
+		{
+			particle.Age = age;
+			particle.Alive = (float)alive;
+		}
+		else if (!alive)
+		{
+			particle.Alive = 0.0f;
+		}
+
+		float step;
+		if (steps(particle, id, age, step))
+		{
+			particle.Position.x += particle.Velocity.x * step;
+			particle.Position.y += particle.Velocity.y * step;
+			particle.Position.z += particle.Velocity.z * step;
+
+			XMFLOAT3 curlVelocity = field(particle.Position, particle.Velocity, id);
+			particle.Velocity = XMFLOAT3(curlVelocity.x * 2, curlVelocity.y * 2, curlVelocity.z * 2);
+
+			output.IntegratedCount++;
+		}
+
+		// newly dead?
+		if (!alive)
+		{
+			output.DeadList[output.DeadCount++] = id;
+		}
+		else
+		{
+			output.DrawList[output.DrawCount++].index = id;
+		}
+	}
+
+	// one batch of Width consecutive particles from the pool slots in ids, returns the lanes that are still alive
+	// and adds the lanes it integrated to integratedCount, lanes outside liveMask are left exactly as they were
+	template<typename Simd, typename Steps, typename Ages, typename Field>
+	int UpdateBatch(Particle* batch, const unsigned int* ids, int liveMask, const Steps& steps, typename Simd::Float life, const Ages& ages,
+		const Field& field, unsigned int& integratedCount)
+	{
+		typedef typename Simd::Float Float;
+
+		const Float velocityScale = Simd::Set1(2.0f);
+
+		float alive[Simd::Width];
+		for (int k = 0; k < Simd::Width; ++k)
+			alive[k] = (liveMask & (1 << k)) ? 1.0f : 0.0f;
+
+		Float wasAlive = Simd::CmpNeq(Simd::Load(alive), Simd::Zero());
+
+		Float positionX, positionY, positionZ, age;
+		Float velocityX, velocityY, velocityZ, size;
+		ParticleRows<Simd>::Load(batch, PositionRow, positionX, positionY, positionZ, age);
+		ParticleRows<Simd>::Load(batch, VelocityRow, velocityX, velocityY, velocityZ, size);
+
+		Float newAge = ages.template Age<Simd>(age);
+		Float stillAlive = Simd::CmpLt(newAge, life);
+
+		// dead lanes keep their old values, the shader never writes them back, a birth time goes back unchanged
+		if (Ages::StoresAge)
+			age = Simd::Select(wasAlive, newAge, age);
+
+		// so do the lanes that wait for a later frame, when all of them wait there is no curl to evaluate
+		Float step;
+		int integrateMask = steps.template Load<Simd>(batch, ids, newAge, liveMask, step);
+		if (integrateMask != 0)
+		{
+			float integrating[Simd::Width];
+			for (int k = 0; k < Simd::Width; ++k)
+			{
+				integrating[k] = (integrateMask & (1 << k)) ? 1.0f : 0.0f;
+				integratedCount += (integrateMask >> k) & 1;
+			}
+
+			Float integrates = Simd::CmpNeq(Simd::Load(integrating), Simd::Zero());
+
+			Float newPositionX = Simd::Add(positionX, Simd::Mul(velocityX, step));
+			Float newPositionY = Simd::Add(positionY, Simd::Mul(velocityY, step));
+			Float newPositionZ = Simd::Add(positionZ, Simd::Mul(velocityZ, step));
+
+			Float curlX, curlY, curlZ;
+			field.template Curl<Simd>(newPositionX, newPositionY, newPositionZ, velocityX, velocityY, velocityZ, ids, curlX, curlY, curlZ);
+
+			positionX = Simd::Select(integrates, newPositionX, positionX);
+			positionY = Simd::Select(integrates, newPositionY, positionY);
+			positionZ = Simd::Select(integrates, newPositionZ, positionZ);
+			velocityX = Simd::Select(integrates, Simd::Mul(curlX, velocityScale), velocityX);
+			velocityY = Simd::Select(integrates, Simd::Mul(curlY, velocityScale), velocityY);
+			velocityZ = Simd::Select(integrates, Simd::Mul(curlZ, velocityScale), velocityZ);
+		}
+
+		ParticleRows<Simd>::Store(batch, PositionRow, positionX, positionY, positionZ, age);
+		ParticleRows<Simd>::Store(batch, VelocityRow, velocityX, velocityY, velocityZ, size);
+
+		int drawMask = Simd::MoveMask(stillAlive) & liveMask;
+
+		int writeMask = Ages::StoresAge ? liveMask : liveMask & ~drawMask;
+
+		for (int k = 0; k < Simd::Width; ++k)
+		{
+			if (writeMask & (1 << k))
+				batch[k].Alive = (drawMask & (1 << k)) ? 1.0f : 0.0f;
+		}
+
+		return drawMask;
+	}
+
+	template<typename Steps, typename LifeTimes, typename Ages, typename Field>
+	void UpdateRange(Particle* particles, unsigned int begin, unsigned int end,
+		const Steps& steps, const LifeTimes& lifeTimes, const Ages& ages, const Field& field, ParticleUpdateOutput& output)
+	{
+		for (unsigned int id = begin; id < end; ++id)
+		{
+			if (particles[id].Alive == 0.0f)
+				continue;
+
+			UpdateOne(particles, id, steps, lifeTimes(particles[id]), ages, field, output);
+		}
+	}
+
+	template<typename Steps, typename LifeTimes, typename Ages, typename Field>
+	void UpdateIndexedRange(Particle* particles, const unsigned int* indices, unsigned int count,
+		const Steps& steps, const LifeTimes& lifeTimes, const Ages& ages, const Field& field, ParticleUpdateOutput& output)
+	{
+		for (unsigned int i = 0; i < count; ++i)
+			UpdateOne(particles, indices[i], steps, lifeTimes(particles[indices[i]]), ages, field, output);
+	}
+
+	template<typename Simd, typename Steps, typename LifeTimes, typename Ages, typename Field>
+	void UpdateBatches(Particle* particles, unsigned int begin, unsigned int end,
+		const Steps& steps, const LifeTimes& lifeTimes, const Ages& ages, const Field& field, ParticleUpdateOutput& output)
+	{
+		const int Width = Simd::Width;
+
+		unsigned int ids[Width];
+
+		unsigned int id = begin;
+		for (; id + Width <= end; id += Width)
+		{
+			Particle* batch = particles + id;
+
+			int liveMask = 0;
+			for (int k = 0; k < Width; ++k)
+			{
+				if (batch[k].Alive != 0.0f)
+					liveMask |= 1 << k;
+			}
+
+			// the shader returns early for dead particles, skip the batch if none are alive
+			if (liveMask == 0)
+				continue;
+
+			for (int k = 0; k < Width; ++k)
+				ids[k] = id + k;
+
+			int drawMask = UpdateBatch<Simd>(batch, ids, liveMask, steps, lifeTimes.template Load<Simd>(batch), ages, field,
+				output.IntegratedCount);
+
+			for (int k = 0; k < Width; ++k)
+			{
+				if ((liveMask & (1 << k)) == 0)
+					continue;
+
+				if (drawMask & (1 << k))
+					output.DrawList[output.DrawCount++].index = id + k;
+				else
+					output.DeadList[output.DeadCount++] = id + k;
+			}
+		}
+
+		UpdateRange(particles, id, end, steps, lifeTimes, ages, field, output);
+	}
+
+	// same as UpdateBatches for a list of live particle indices, each batch is gathered into
+	// consecutive particles, updated and scattered back
+	template<typename Simd, typename Steps, typename LifeTimes, typename Ages, typename Field>
+	void UpdateIndexedBatches(Particle* particles, const unsigned int* indices, unsigned int count,
+		const Steps& steps, const LifeTimes& lifeTimes, const Ages& ages, const Field& field, ParticleUpdateOutput& output)
+	{
+		const int Width = Simd::Width;
+		const int liveMask = (1 << Width) - 1;
+
+		Particle batch[Width];
+
+		unsigned int i = 0;
+		for (; i + Width <= count; i += Width)
+		{
+			for (int k = 0; k < Width; ++k)
+				batch[k] = particles[indices[i + k]];
+
+			int drawMask = UpdateBatch<Simd>(batch, indices + i, liveMask, steps, lifeTimes.template Load<Simd>(batch), ages, field,
+				output.IntegratedCount);
+
+			for (int k = 0; k < Width; ++k)
+			{
+				unsigned int id = indices[i + k];
+				particles[id] = batch[k];
+
+				if (drawMask & (1 << k))
+					output.DrawList[output.DrawCount++].index = id;
+				else
+					output.DeadList[output.DeadCount++] = id;
+			}
+		}
+
+		UpdateIndexedRange(particles, indices + i, count - i, steps, lifeTimes, ages, field, output);
+	}
+
+	template<typename Steps, typename LifeTimes, typename Ages, typename Field>
+	void UpdateLevel(ParticleKernelLevel level, Particle* particles, unsigned int begin, unsigned int end,
+		const Steps& steps, const LifeTimes& lifeTimes, const Ages& ages, const Field& field, ParticleUpdateOutput& output)
+	{
+		switch (level)
+		{
+		case ParticleKernelAVX2:
+			UpdateBatches<SimdAVX2>(particles, begin, end, steps, lifeTimes, ages, field, output);
+			break;
+		case ParticleKernelSSE4:
+			UpdateBatches<SimdSSE4>(particles, begin, end, steps, lifeTimes, ages, field, output);
+			break;
+		default:
+			UpdateRange(particles, begin, end, steps, lifeTimes, ages, field, output);
+			break;
+		}
+	}
+
+	template<typename Steps, typename LifeTimes, typename Ages, typename Field>
+	void UpdateIndexedLevel(ParticleKernelLevel level, Particle* particles, const unsigned int* indices, unsigned int count,
+		const Steps& steps, const LifeTimes& lifeTimes, const Ages& ages, const Field& field, ParticleUpdateOutput& output)
+	{
+		switch (level)
+		{
+		case ParticleKernelAVX2:
+			UpdateIndexedBatches<SimdAVX2>(particles, indices, count, steps, lifeTimes, ages, field, output);
+			break;
+		case ParticleKernelSSE4:
+			UpdateIndexedBatches<SimdSSE4>(particles, indices, count, steps, lifeTimes, ages, field, output);
+			break;
+		default:
+			UpdateIndexedRange(particles, indices, count, steps, lifeTimes, ages, field, output);
+			break;
+		}
+	}
+
+	// UpdateLevel with the curl noise, the baked field when there is a volume or the bands of noiseLod when there are any
+	template<typename Steps, typename LifeTimes, typename Ages>
+	void UpdateFieldLevel(ParticleKernelLevel level, Particle* particles, unsigned int begin, unsigned int end,
+		const Steps& steps, const LifeTimes& lifeTimes, const Ages& ages, const CurlVolume* curlVolume, const ParticleNoiseLod* noiseLod,
+		ParticleUpdateOutput& output)
+	{
+		if (noiseLod != nullptr)
+			UpdateLevel(level, particles, begin, end, steps, lifeTimes, ages, LodCurl{ noiseLod, curlVolume }, output);
+		else if (curlVolume != nullptr)
+			UpdateLevel(level, particles, begin, end, steps, lifeTimes, ages, BakedCurl{ curlVolume }, output);
+		else
+			UpdateLevel(level, particles, begin, end, steps, lifeTimes, ages, NoiseCurl(), output);
+	}
+
+	template<typename Steps, typename LifeTimes, typename Ages>
+	void UpdateIndexedFieldLevel(ParticleKernelLevel level, Particle* particles, const unsigned int* indices, unsigned int count,
+		const Steps& steps, const LifeTimes& lifeTimes, const Ages& ages, const CurlVolume* curlVolume, const ParticleNoiseLod* noiseLod,
+		ParticleUpdateOutput& output)
+	{
+		if (noiseLod != nullptr)
+			UpdateIndexedLevel(level, particles, indices, count, steps, lifeTimes, ages, LodCurl{ noiseLod, curlVolume }, output);
+		else if (curlVolume != nullptr)
+			UpdateIndexedLevel(level, particles, indices, count, steps, lifeTimes, ages, BakedCurl{ curlVolume }, output);
+		else
+			UpdateIndexedLevel(level, particles, indices, count, steps, lifeTimes, ages, NoiseCurl(), output);
+	}
+
+	// and every particle on every frame, or the buckets of timeSlicer when there is one
+	template<typename LifeTimes, typename Ages>
+	void UpdateCurlLevel(ParticleKernelLevel level, Particle* particles, unsigned int begin, unsigned int end,
+		float deltaTime, const LifeTimes& lifeTimes, const Ages& ages, const CurlVolume* curlVolume, const ParticleNoiseLod* noiseLod,
+		ParticleTimeSlicer* timeSlicer, ParticleUpdateOutput& output)
+	{
+		if (timeSlicer != nullptr)
+			UpdateFieldLevel(level, particles, begin, end, SlicedStep{ timeSlicer }, lifeTimes, ages, curlVolume, noiseLod, output);
+		else
+			UpdateFieldLevel(level, particles, begin, end, EveryStep{ deltaTime }, lifeTimes, ages, curlVolume, noiseLod, output);
+	}
+
+	template<typename LifeTimes, typename Ages>
+	void UpdateIndexedCurlLevel(ParticleKernelLevel level, Particle* particles, const unsigned int* indices, unsigned int count,
+		float deltaTime, const LifeTimes& lifeTimes, const Ages& ages, const CurlVolume* curlVolume, const ParticleNoiseLod* noiseLod,
+		ParticleTimeSlicer* timeSlicer, ParticleUpdateOutput& output)
+	{
+		if (timeSlicer != nullptr)
+			UpdateIndexedFieldLevel(level, particles, indices, count, SlicedStep{ timeSlicer }, lifeTimes, ages, curlVolume, noiseLod, output);
+		else
+			UpdateIndexedFieldLevel(level, particles, indices, count, EveryStep{ deltaTime }, lifeTimes, ages, curlVolume, noiseLod, output);
+	}
+
+	// pre-integration of particles emitted offsets[i] before the emit, or after it when negative, the velocity the update
+	// would give them at the spawn point and the move along it over the offset, so a step's spawns leave the emitter spread out
+	template<typename Field>
+	void AdvanceRange(Particle* particles, const unsigned int* indices, const float* offsets, unsigned int count, const Field& field)
+	{
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			Particle& particle = particles[indices[i]];
+
+			XMFLOAT3 curlVelocity = field(particle.Position, particle.Velocity, indices[i]);
+			particle.Velocity = XMFLOAT3(curlVelocity.x * 2, curlVelocity.y * 2, curlVelocity.z * 2);
+
+			particle.Position.x += particle.Velocity.x * offsets[i];
+			particle.Position.y += particle.Velocity.y * offsets[i];
+			particle.Position.z += particle.Velocity.z * offsets[i];
+		}
+	}
+
+	// AdvanceRange in batches gathered from the emitted slots like UpdateIndexedBatches, bit for bit the same
+	template<typename Simd, typename Field>
+	void AdvanceIndexedBatches(Particle* particles, const unsigned int* indices, const float* offsets, unsigned int count, const Field& field)
+	{
+		typedef typename Simd::Float Float;
+
+		const int Width = Simd::Width;
+		const Float velocityScale = Simd::Set1(2.0f);
+
+		Particle batch[Width];
+
+		unsigned int i = 0;
+		for (; i + Width <= count; i += Width)
+		{
+			for (int k = 0; k < Width; ++k)
+				batch[k] = particles[indices[i + k]];
+
+			Float positionX, positionY, positionZ, age;
+			Float velocityX, velocityY, velocityZ, size;
+			ParticleRows<Simd>::Load(batch, PositionRow, positionX, positionY, positionZ, age);
+			ParticleRows<Simd>::Load(batch, VelocityRow, velocityX, velocityY, velocityZ, size);
+
+			Float curlX, curlY, curlZ;
+			field.template Curl<Simd>(positionX, positionY, positionZ, velocityX, velocityY, velocityZ, indices + i, curlX, curlY, curlZ);
+
+			velocityX = Simd::Mul(curlX, velocityScale);
+			velocityY = Simd::Mul(curlY, velocityScale);
+			velocityZ = Simd::Mul(curlZ, velocityScale);
+
+			Float offset = Simd::Load(offsets + i);
+			positionX = Simd::Add(positionX, Simd::Mul(velocityX, offset));
+			positionY = Simd::Add(positionY, Simd::Mul(velocityY, offset));
+			positionZ = Simd::Add(positionZ, Simd::Mul(velocityZ, offset));
+
+			ParticleRows<Simd>::Store(batch, PositionRow, positionX, positionY, positionZ, age);
+			ParticleRows<Simd>::Store(batch, VelocityRow, velocityX, velocityY, velocityZ, size);
+
+			for (int k = 0; k < Width; ++k)
+				particles[indices[i + k]] = batch[k];
+		}
+
+		AdvanceRange(particles, indices + i, offsets + i, count - i, field);
+	}
+
+	template<typename Field>
+	void AdvanceLevel(ParticleKernelLevel level, Particle* particles, const unsigned int* indices, const float* offsets, unsigned int count,
+		const Field& field)
+	{
+		switch (level)
+		{
+		case ParticleKernelAVX2:
+			AdvanceIndexedBatches<SimdAVX2>(particles, indices, offsets, count, field);
+			break;
+		case ParticleKernelSSE4:
+			AdvanceIndexedBatches<SimdSSE4>(particles, indices, offsets, count, field);
+			break;
+		default:
+			AdvanceRange(particles, indices, offsets, count, field);
+			break;
+		}
+	}
+}
+
+ParticleKernelLevel ParticleUpdateKernel::DetectLevel()
+{
+	int info[4];
+
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+
+	__cpuid(info, 1);
+	bool sse41 = (info[2] & (1 << 19)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+
+	// the OS also has to save the upper halves of the ymm registers
+	if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 0x6) == 0x6)
+	{
+		__cpuidex(info, 7, 0);
+		if (info[1] & (1 << 5))
+			return ParticleKernelAVX2;
+	}
+
+	if (sse41)
+		return ParticleKernelSSE4;
+
+	return ParticleKernelScalar;
+}
+
+const char* ParticleUpdateKernel::GetLevelName(ParticleKernelLevel level)
+{
+	switch (level)
+	{
+	case ParticleKernelSSE4:
+		return "SSE4.1";
+	case ParticleKernelAVX2:
+		return "AVX2";
+	default:
+		return "scalar";
+	}
+}
+
+void ParticleUpdateKernel::Update(ParticleKernelLevel level, Particle* particles, unsigned int begin, unsigned int end,
+	float deltaTime, float lifeTime, ParticleUpdateOutput& output, const CurlVolume* curlVolume,
+	const ParticleNoiseLod* noiseLod, ParticleTimeSlicer* timeSlicer)
+{
+	UpdateCurlLevel(level, particles, begin, end, deltaTime, UniformLifeTime{ lifeTime }, StepAge{ deltaTime }, curlVolume, noiseLod, timeSlicer, output);
+}
+
+void ParticleUpdateKernel::UpdateScalar(Particle* particles, unsigned int begin, unsigned int end,
+	float deltaTime, float lifeTime, ParticleUpdateOutput& output)
+{
+	UpdateRange(particles, begin, end, EveryStep{ deltaTime }, UniformLifeTime{ lifeTime }, StepAge{ deltaTime }, NoiseCurl(), output);
+}
+
+void ParticleUpdateKernel::UpdateIndexed(ParticleKernelLevel level, Particle* particles, const unsigned int* indices, unsigned int count,
+	float deltaTime, float lifeTime, ParticleUpdateOutput& output, const CurlVolume* curlVolume,
+	const ParticleNoiseLod* noiseLod, ParticleTimeSlicer* timeSlicer)
+{
+	UpdateIndexedCurlLevel(level, particles, indices, count, deltaTime, UniformLifeTime{ lifeTime }, StepAge{ deltaTime }, curlVolume, noiseLod, timeSlicer, output);
+}
+
+void ParticleUpdateKernel::UpdateIndexedScalar(Particle* particles, const unsigned int* indices, unsigned int count,
+	float deltaTime, float lifeTime, ParticleUpdateOutput& output)
+{
+	UpdateIndexedRange(particles, indices, count, EveryStep{ deltaTime }, UniformLifeTime{ lifeTime }, StepAge{ deltaTime }, NoiseCurl(), output);
+}
+
+void ParticleUpdateKernel::UpdateEmitters(ParticleKernelLevel level, Particle* particles, unsigned int begin, unsigned int end,
+	float deltaTime, const float* emitterLifeTimes, ParticleUpdateOutput& output, const CurlVolume* curlVolume,
+	const ParticleNoiseLod* noiseLod, ParticleTimeSlicer* timeSlicer)
+{
+	UpdateCurlLevel(level, particles, begin, end, deltaTime, EmitterLifeTime{ emitterLifeTimes }, StepAge{ deltaTime }, curlVolume, noiseLod, timeSlicer, output);
+}
+
+void ParticleUpdateKernel::UpdateIndexedEmitters(ParticleKernelLevel level, Particle* particles, const unsigned int* indices, unsigned int count,
+	float deltaTime, const float* emitterLifeTimes, ParticleUpdateOutput& output, const CurlVolume* curlVolume,
+	const ParticleNoiseLod* noiseLod, ParticleTimeSlicer* timeSlicer)
+{
+	UpdateIndexedCurlLevel(level, particles, indices, count, deltaTime, EmitterLifeTime{ emitterLifeTimes }, StepAge{ deltaTime }, curlVolume, noiseLod, timeSlicer, output);
+}
+
+void ParticleUpdateKernel::UpdateBirth(ParticleKernelLevel level, Particle* particles, unsigned int begin, unsigned int end,
+	float deltaTime, float now, float lifeTime, const float* emitterLifeTimes, ParticleUpdateOutput& output, const CurlVolume* curlVolume,
+	const ParticleNoiseLod* noiseLod, ParticleTimeSlicer* timeSlicer)
+{
+	if (emitterLifeTimes != nullptr)
+		UpdateCurlLevel(level, particles, begin, end, deltaTime, EmitterLifeTime{ emitterLifeTimes }, BirthAge{ now }, curlVolume, noiseLod, timeSlicer, output);
+	else
+		UpdateCurlLevel(level, particles, begin, end, deltaTime, UniformLifeTime{ lifeTime }, BirthAge{ now }, curlVolume, noiseLod, timeSlicer, output);
+}
+
+void ParticleUpdateKernel::UpdateIndexedBirth(ParticleKernelLevel level, Particle* particles, const unsigned int* indices, unsigned int count,
+	float deltaTime, float now, float lifeTime, const float* emitterLifeTimes, ParticleUpdateOutput& output, const CurlVolume* curlVolume,
+	const ParticleNoiseLod* noiseLod, ParticleTimeSlicer* timeSlicer)
+{
+	if (emitterLifeTimes != nullptr)
+		UpdateIndexedCurlLevel(level, particles, indices, count, deltaTime, EmitterLifeTime{ emitterLifeTimes }, BirthAge{ now }, curlVolume, noiseLod, timeSlicer, output);
+	else
+		UpdateIndexedCurlLevel(level, particles, indices, count, deltaTime, UniformLifeTime{ lifeTime }, BirthAge{ now }, curlVolume, noiseLod, timeSlicer, output);
+}
+
+void ParticleUpdateKernel::Advance(ParticleKernelLevel level, Particle* particles, const unsigned int* indices, const float* offsets,
+	unsigned int count, const CurlVolume* curlVolume)
+{
+	if (curlVolume != nullptr)
+		AdvanceLevel(level, particles, indices, offsets, count, BakedCurl{ curlVolume });
+	else
+		AdvanceLevel(level, particles, indices, offsets, count, NoiseCurl());
+}
+
+void ParticleUpdateKernel::UpdateParticle(Particle* particles, unsigned int id,
+	float deltaTime, float lifeTime, ParticleUpdateOutput& output)
+{
+	UpdateOne(particles, id, EveryStep{ deltaTime }, lifeTime, StepAge{ deltaTime }, NoiseCurl(), output);
+}
+
+void ParticleUpdateKernel::UpdateSSE4(Particle* particles, unsigned int begin, unsigned int end,
+	float deltaTime, float lifeTime, ParticleUpdateOutput& output)
+{
+	UpdateBatches<SimdSSE4>(particles, begin, end, EveryStep{ deltaTime }, UniformLifeTime{ lifeTime }, StepAge{ deltaTime }, NoiseCurl(), output);
+}
+
+void ParticleUpdateKernel::UpdateAVX2(Particle* particles, unsigned int begin, unsigned int end,
+	float deltaTime, float lifeTime, ParticleUpdateOutput& output)
+{
+	UpdateBatches<SimdAVX2>(particles, begin, end, EveryStep{ deltaTime }, UniformLifeTime{ lifeTime }, StepAge{ deltaTime }, NoiseCurl(), output);
+}
+
+unsigned int ParticleUpdateKernel::UlpDistance(float a, float b)
+{
+	int ia, ib;
+	memcpy(&ia, &a, sizeof(float));
+	memcpy(&ib, &b, sizeof(float));
+
+	// map the sign-magnitude bit patterns onto a monotonic integer line
+	if (ia < 0)
+		ia = (int)(0x80000000u - (unsigned int)ia);
+	if (ib < 0)
+		ib = (int)(0x80000000u - (unsigned int)ib);
+
+	long long difference = (long long)ia - (long long)ib;
+	return (unsigned int)(difference < 0 ? -difference : difference);
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include "Emitter.h"
+
+class CurlVolume;
+class ParticleNoiseLod;
+class ParticleTimeSlicer;
+
+enum ParticleKernelLevel
+{
+	ParticleKernelScalar,
+	ParticleKernelSSE4,
+	ParticleKernelAVX2,
+	ParticleKernelLevelCount
+};
+
+// where a kernel writes the indices UpdateComputeShader appends to ADeadList and DrawList
+// the pool kernels fill both lists in increasing particle index order
+struct ParticleUpdateOutput
+{
+	unsigned int* DeadList = nullptr;
+	unsigned int DeadCount = 0;
+
+	ParticleSort* DrawList = nullptr;
+	unsigned int DrawCount = 0;
+
+	// live particles that were integrated, all of them unless a time slicer made some wait
+	unsigned int IntegratedCount = 0;
+};
+
+// the per-particle work of UpdateComputeShader main for the CPU particle system
+// the SIMD kernels process 4 (SSE4.1) or 8 (AVX2) particles per iteration and are picked at runtime
+class ParticleUpdateKernel
+{
+public:
+	// largest difference from the scalar reference in units in the last place, for every float of Particle after one step
+	// the SIMD kernels repeat the scalar operations in the same order without FMA and match bit for bit, which needs
+	// the scalar reference compiled without contraction into fused multiply-adds, the files that hold it include
+	// FloatContraction.h first, a contracted reference differs by thousands of ulp on components near zero
+	// so the bound is 0, anything else is a kernel that no longer repeats the scalar order
+	static const int MaxUlpError = 0;
+
+	static ParticleKernelLevel DetectLevel();
+	static const char* GetLevelName(ParticleKernelLevel level);
+
+	// updates particles [begin, end) in place and appends dead and drawn indices to output
+	// the entry points that take a curlVolume sample it for the velocity instead of evaluating the curl noise,
+	// with a noiseLod each particle takes the source of its distance band and keeps its velocity between refreshes,
+	// with a timeSlicer only the particles of the buckets due on this frame are integrated, every live one is aged
+	static void Update(ParticleKernelLevel level, Particle* particles, unsigned int begin, unsigned int end,
+		float deltaTime, float lifeTime, ParticleUpdateOutput& output, const CurlVolume* curlVolume = nullptr,
+		const ParticleNoiseLod* noiseLod = nullptr, ParticleTimeSlicer* timeSlicer = nullptr);
+
+	static void UpdateScalar(Particle* particles, unsigned int begin, unsigned int end,
+		float deltaTime, float lifeTime, ParticleUpdateOutput& output);
+	static void UpdateSSE4(Particle* particles, unsigned int begin, unsigned int end,
+		float deltaTime, float lifeTime, ParticleUpdateOutput& output);
+	static void UpdateAVX2(Particle* particles, unsigned int begin, unsigned int end,
+		float deltaTime, float lifeTime, ParticleUpdateOutput& output);
+
+	// updates the live particles listed in indices and appends them to output in list order,
+	// every listed particle must be alive
+	static void UpdateIndexed(ParticleKernelLevel level, Particle* particles, const unsigned int* indices, unsigned int count,
+		float deltaTime, float lifeTime, ParticleUpdateOutput& output, const CurlVolume* curlVolume = nullptr,
+		const ParticleNoiseLod* noiseLod = nullptr, ParticleTimeSlicer* timeSlicer = nullptr);
+	static void UpdateIndexedScalar(Particle* particles, const unsigned int* indices, unsigned int count,
+		float deltaTime, float lifeTime, ParticleUpdateOutput& output);
+
+	// Update and UpdateIndexed for a pool shared by several emitters, every particle expires after
+	// emitterLifeTimes[particle.EmitterIndex] instead of one lifetime for all
+	static void UpdateEmitters(ParticleKernelLevel level, Particle* particles, unsigned int begin, unsigned int end,
+		float deltaTime, const float* emitterLifeTimes, ParticleUpdateOutput& output, const CurlVolume* curlVolume = nullptr,
+		const ParticleNoiseLod* noiseLod = nullptr, ParticleTimeSlicer* timeSlicer = nullptr);
+	static void UpdateIndexedEmitters(ParticleKernelLevel level, Particle* particles, const unsigned int* indices, unsigned int count,
+		float deltaTime, const float* emitterLifeTimes, ParticleUpdateOutput& output, const CurlVolume* curlVolume = nullptr,
+		const ParticleNoiseLod* noiseLod = nullptr, ParticleTimeSlicer* timeSlicer = nullptr);
+
+	// Update and UpdateIndexed for particles whose Age holds the birth time, now is the clock after the step
+	// and the age is now minus the birth time, so Age is only read, Position and Velocity are written
+	// and Alive only for particles that die, with emitterLifeTimes set lifeTime is ignored
+	static void UpdateBirth(ParticleKernelLevel level, Particle* particles, unsigned int begin, unsigned int end,
+		float deltaTime, float now, float lifeTime, const float* emitterLifeTimes, ParticleUpdateOutput& output,
+		const CurlVolume* curlVolume = nullptr, const ParticleNoiseLod* noiseLod = nullptr, ParticleTimeSlicer* timeSlicer = nullptr);
+	static void UpdateIndexedBirth(ParticleKernelLevel level, Particle* particles, const unsigned int* indices, unsigned int count,
+		float deltaTime, float now, float lifeTime, const float* emitterLifeTimes, ParticleUpdateOutput& output,
+		const CurlVolume* curlVolume = nullptr, const ParticleNoiseLod* noiseLod = nullptr, ParticleTimeSlicer* timeSlicer = nullptr);
+
+	// moves freshly emitted particles to where they are offsets[i] after their spawn, a negative offset moves them
+	// back for a spawn that is due after the emit, the velocity is the field at the spawn point, the one the update
+	// would give them, the age is left to the caller
+	static void Advance(ParticleKernelLevel level, Particle* particles, const unsigned int* indices, const float* offsets,
+		unsigned int count, const CurlVolume* curlVolume = nullptr);
+
+	// the body of UpdateComputeShader main for one live particle
+	static void UpdateParticle(Particle* particles, unsigned int id,
+		float deltaTime, float lifeTime, ParticleUpdateOutput& output);
+
+	// distance between two floats in units in the last place
+	static unsigned int UlpDistance(float a, float b);
+};
@@ -12,6 +12,7 @@ cbuffer timeData : register(b1)
 {
 	float deltaTime;
 	float TotalTime;
+	float interpolationAlpha;
 }
 
 cbuffer particleData : register(b2)
@@ -43,8 +44,9 @@ VS_OUTPUT main(uint id : SV_VertexID)
 	ParticleDraw draw = DrawList.Load(id);
 	Particle particle = ParticlePool.Load(draw.Index);
 
-	// pass through
-	output.Position = particle.Position;
+	// the next update moves the particle by exactly Velocity * deltaTime, so this lands between the
+	// last simulated step and the next one
+	output.Position = particle.Position + particle.Velocity * (interpolationAlpha * deltaTime);
 	output.Size = particle.Size;
 	output.Color = particle.Color;
 
@@ -0,0 +1,156 @@
+#pragma once
+#include <cmath>
+#include <cstring>
+#include <immintrin.h>
+
+// thin wrappers over the SSE4.1, AVX2 and AVX-512F float intrinsics so a kernel can be written once as a template
+// and instantiated for any width, the wrappers never reorder arithmetic so every width rounds the same way
+
+struct SimdSSE4
+{
+	typedef __m128 Float;
+	static const int Width = 4;
+
+	static Float Set1(float value) { return _mm_set1_ps(value); }
+	static Float Zero() { return _mm_setzero_ps(); }
+	static Float Load(const float* source) { return _mm_loadu_ps(source); }
+	static void Store(float* destination, Float value) { _mm_storeu_ps(destination, value); }
+
+	// truncates to int, and loads base[indices[k]] into lane k
+	static void StoreInt(int* destination, Float value) { _mm_storeu_si128(reinterpret_cast<__m128i*>(destination), _mm_cvttps_epi32(value)); }
+	static Float Gather(const float* base, const int* indices) { return _mm_setr_ps(base[indices[0]], base[indices[1]], base[indices[2]], base[indices[3]]); }
+
+	static Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+	static Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+	static Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+	static Float Div(Float a, Float b) { return _mm_div_ps(a, b); }
+	static Float Min(Float a, Float b) { return _mm_min_ps(a, b); }
+	static Float Max(Float a, Float b) { return _mm_max_ps(a, b); }
+	static Float Floor(Float a) { return _mm_floor_ps(a); }
+	static Float Abs(Float a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+	static Float Sqrt(Float a) { return _mm_sqrt_ps(a); }
+
+	// comparisons return all-ones lanes where true
+	static Float CmpGt(Float a, Float b) { return _mm_cmpgt_ps(a, b); }
+	static Float CmpLt(Float a, Float b) { return _mm_cmplt_ps(a, b); }
+	static Float CmpNeq(Float a, Float b) { return _mm_cmpneq_ps(a, b); }
+	static Float And(Float a, Float b) { return _mm_and_ps(a, b); }
+	static Float Or(Float a, Float b) { return _mm_or_ps(a, b); }
+
+	// mask ? a : b
+	static Float Select(Float mask, Float a, Float b) { return _mm_blendv_ps(b, a, mask); }
+	static int MoveMask(Float mask) { return _mm_movemask_ps(mask); }
+};
+
+struct SimdAVX2
+{
+	typedef __m256 Float;
+	static const int Width = 8;
+
+	static Float Set1(float value) { return _mm256_set1_ps(value); }
+	static Float Zero() { return _mm256_setzero_ps(); }
+	static Float Load(const float* source) { return _mm256_loadu_ps(source); }
+	static void Store(float* destination, Float value) { _mm256_storeu_ps(destination, value); }
+
+	static void StoreInt(int* destination, Float value) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), _mm256_cvttps_epi32(value)); }
+	static Float Gather(const float* base, const int* indices)
+	{
+		return _mm256_i32gather_ps(base, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices)), 4);
+	}
+
+	static Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+	static Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+	static Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+	static Float Div(Float a, Float b) { return _mm256_div_ps(a, b); }
+	static Float Min(Float a, Float b) { return _mm256_min_ps(a, b); }
+	static Float Max(Float a, Float b) { return _mm256_max_ps(a, b); }
+	static Float Floor(Float a) { return _mm256_floor_ps(a); }
+	static Float Abs(Float a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+	static Float Sqrt(Float a) { return _mm256_sqrt_ps(a); }
+
+	static Float CmpGt(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	static Float CmpLt(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	static Float CmpNeq(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ); }
+	static Float And(Float a, Float b) { return _mm256_and_ps(a, b); }
+	static Float Or(Float a, Float b) { return _mm256_or_ps(a, b); }
+
+	static Float Select(Float mask, Float a, Float b) { return _mm256_blendv_ps(b, a, mask); }
+	static int MoveMask(Float mask) { return _mm256_movemask_ps(mask); }
+};
+
+// AVX-512F only, so it runs on every AVX-512 CPU, comparisons still hand back all-ones lanes instead of a k mask
+// so templates written for the narrower widths compile unchanged
+struct SimdAVX512
+{
+	typedef __m512 Float;
+	static const int Width = 16;
+
+	static Float Set1(float value) { return _mm512_set1_ps(value); }
+	static Float Zero() { return _mm512_setzero_ps(); }
+	static Float Load(const float* source) { return _mm512_loadu_ps(source); }
+	static void Store(float* destination, Float value) { _mm512_storeu_ps(destination, value); }
+
+	static void StoreInt(int* destination, Float value) { _mm512_storeu_si512(destination, _mm512_cvttps_epi32(value)); }
+	static Float Gather(const float* base, const int* indices) { return _mm512_i32gather_ps(_mm512_loadu_si512(indices), base, 4); }
+
+	static Float Add(Float a, Float b) { return _mm512_add_ps(a, b); }
+	static Float Sub(Float a, Float b) { return _mm512_sub_ps(a, b); }
+	static Float Mul(Float a, Float b) { return _mm512_mul_ps(a, b); }
+	static Float Div(Float a, Float b) { return _mm512_div_ps(a, b); }
+	static Float Min(Float a, Float b) { return _mm512_min_ps(a, b); }
+	static Float Max(Float a, Float b) { return _mm512_max_ps(a, b); }
+	static Float Floor(Float a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+	static Float Abs(Float a) { return And(a, _mm512_castsi512_ps(_mm512_set1_epi32(0x7fffffff))); }
+	static Float Sqrt(Float a) { return _mm512_sqrt_ps(a); }
+
+	static Float CmpGt(Float a, Float b) { return FromMask(_mm512_cmp_ps_mask(a, b, _CMP_GT_OQ)); }
+	static Float CmpLt(Float a, Float b) { return FromMask(_mm512_cmp_ps_mask(a, b, _CMP_LT_OQ)); }
+	static Float CmpNeq(Float a, Float b) { return FromMask(_mm512_cmp_ps_mask(a, b, _CMP_NEQ_UQ)); }
+	static Float And(Float a, Float b) { return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(a), _mm512_castps_si512(b))); }
+	static Float Or(Float a, Float b) { return _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(a), _mm512_castps_si512(b))); }
+
+	// like blendv only the sign bit of a mask lane counts
+	static Float Select(Float mask, Float a, Float b) { return _mm512_mask_blend_ps(ToMask(mask), b, a); }
+	static int MoveMask(Float mask) { return (int)ToMask(mask); }
+
+	static Float FromMask(__mmask16 mask) { return _mm512_castsi512_ps(_mm512_maskz_set1_epi32(mask, -1)); }
+	static __mmask16 ToMask(Float mask) { return _mm512_cmplt_epi32_mask(_mm512_castps_si512(mask), _mm512_setzero_si512()); }
+};
+
+// a single lane in plain float arithmetic with the operand order of minps/maxps and sign bit masks,
+// so a template instantiated for it is the scalar reference that the wider instantiations reproduce bit for bit
+struct SimdScalar
+{
+	typedef float Float;
+	static const int Width = 1;
+
+	static Float Set1(float value) { return value; }
+	static Float Zero() { return 0.0f; }
+	static Float Load(const float* source) { return *source; }
+	static void Store(float* destination, Float value) { *destination = value; }
+
+	static void StoreInt(int* destination, Float value) { *destination = (int)value; }
+	static Float Gather(const float* base, const int* indices) { return base[indices[0]]; }
+
+	static Float Add(Float a, Float b) { return a + b; }
+	static Float Sub(Float a, Float b) { return a - b; }
+	static Float Mul(Float a, Float b) { return a * b; }
+	static Float Div(Float a, Float b) { return a / b; }
+	static Float Min(Float a, Float b) { return a < b ? a : b; }
+	static Float Max(Float a, Float b) { return a > b ? a : b; }
+	static Float Floor(Float a) { return floorf(a); }
+	static Float Abs(Float a) { return fabsf(a); }
+	static Float Sqrt(Float a) { return sqrtf(a); }
+
+	static Float CmpGt(Float a, Float b) { return FromBits(a > b ? 0xffffffffu : 0u); }
+	static Float CmpLt(Float a, Float b) { return FromBits(a < b ? 0xffffffffu : 0u); }
+	static Float CmpNeq(Float a, Float b) { return FromBits(a != b ? 0xffffffffu : 0u); }
+	static Float And(Float a, Float b) { return FromBits(ToBits(a) & ToBits(b)); }
+	static Float Or(Float a, Float b) { return FromBits(ToBits(a) | ToBits(b)); }
+
+	static Float Select(Float mask, Float a, Float b) { return MoveMask(mask) ? a : b; }
+	static int MoveMask(Float mask) { return (int)(ToBits(mask) >> 31); }
+
+	static Float FromBits(unsigned int bits) { float value; memcpy(&value, &bits, sizeof(value)); return value; }
+	static unsigned int ToBits(Float value) { unsigned int bits; memcpy(&bits, &value, sizeof(bits)); return bits; }
+};
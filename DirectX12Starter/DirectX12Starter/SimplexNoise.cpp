@@ -0,0 +1,876 @@
+#include "FloatContraction.h"
+#include "SimplexNoise.h"
+#include "ParticleUpdateKernel.h"
+#include <algorithm>
+#include <cmath>
+#include <intrin.h>
+
+using namespace DirectX;
+
+namespace
+{
+	// one of the *Points loops, Batch evaluates Simd::Width points starting at an index and One a single point
+	template<typename Simd, typename Points>
+	void RunBatches(const Points& points, unsigned int count)
+	{
+		unsigned int i = 0;
+		for (; i + Simd::Width <= count; i += Simd::Width)
+			points.template Batch<Simd>(i);
+
+		for (; i < count; ++i)
+			points.One(i);
+	}
+
+	template<typename Points>
+	void Run(SimplexNoiseLevel level, const Points& points, unsigned int count)
+	{
+		switch (level)
+		{
+		case SimplexNoiseAVX512:
+			RunBatches<SimdAVX512>(points, count);
+			break;
+		case SimplexNoiseAVX2:
+			RunBatches<SimdAVX2>(points, count);
+			break;
+		case SimplexNoiseSSE4:
+			RunBatches<SimdSSE4>(points, count);
+			break;
+		default:
+			for (unsigned int i = 0; i < count; ++i)
+				points.One(i);
+			break;
+		}
+	}
+
+	struct Noise2Points
+	{
+		const float* x;
+		const float* y;
+		float* noise;
+
+		void One(unsigned int i) const
+		{
+			noise[i] = SimplexNoise::SNoise(XMFLOAT2(x[i], y[i]));
+		}
+
+		template<typename Simd>
+		void Batch(unsigned int i) const
+		{
+			Simd::Store(noise + i, SimplexNoise::SNoiseBatch<Simd>(Simd::Load(x + i), Simd::Load(y + i)));
+		}
+	};
+
+	struct Noise3Points
+	{
+		const float* x;
+		const float* y;
+		const float* z;
+		float* noise;
+
+		void One(unsigned int i) const
+		{
+			noise[i] = SimplexNoise::SNoise(XMFLOAT3(x[i], y[i], z[i]));
+		}
+
+		template<typename Simd>
+		void Batch(unsigned int i) const
+		{
+			Simd::Store(noise + i, SimplexNoise::SNoiseBatch<Simd>(Simd::Load(x + i), Simd::Load(y + i), Simd::Load(z + i)));
+		}
+	};
+
+	struct Noise4Points
+	{
+		const float* x;
+		const float* y;
+		const float* z;
+		const float* w;
+		float* noise;
+
+		void One(unsigned int i) const
+		{
+			noise[i] = SimplexNoise::SNoise(XMFLOAT4(x[i], y[i], z[i], w[i]));
+		}
+
+		template<typename Simd>
+		void Batch(unsigned int i) const
+		{
+			Simd::Store(noise + i, SimplexNoise::SNoiseBatch<Simd>(Simd::Load(x + i), Simd::Load(y + i), Simd::Load(z + i),
+				Simd::Load(w + i)));
+		}
+	};
+
+	struct Noise3DPoints
+	{
+		const float* x;
+		const float* y;
+		const float* z;
+		float* noiseX;
+		float* noiseY;
+		float* noiseZ;
+
+		void One(unsigned int i) const
+		{
+			XMFLOAT3 noise = SimplexNoise::SNoise3D(XMFLOAT3(x[i], y[i], z[i]));
+			noiseX[i] = noise.x;
+			noiseY[i] = noise.y;
+			noiseZ[i] = noise.z;
+		}
+
+		template<typename Simd>
+		void Batch(unsigned int i) const
+		{
+			typename Simd::Float nx, ny, nz;
+			SimplexNoise::SNoise3DBatch<Simd>(Simd::Load(x + i), Simd::Load(y + i), Simd::Load(z + i), nx, ny, nz);
+			Simd::Store(noiseX + i, nx);
+			Simd::Store(noiseY + i, ny);
+			Simd::Store(noiseZ + i, nz);
+		}
+	};
+
+	struct CurlPoints
+	{
+		const float* x;
+		const float* y;
+		const float* z;
+		float d;
+		float* curlX;
+		float* curlY;
+		float* curlZ;
+
+		void One(unsigned int i) const
+		{
+			XMFLOAT3 curl = SimplexNoise::CurlNoise3D(XMFLOAT3(x[i], y[i], z[i]), d);
+			curlX[i] = curl.x;
+			curlY[i] = curl.y;
+			curlZ[i] = curl.z;
+		}
+
+		template<typename Simd>
+		void Batch(unsigned int i) const
+		{
+			typename Simd::Float cx, cy, cz;
+			SimplexNoise::CurlNoise3DBatch<Simd>(Simd::Load(x + i), Simd::Load(y + i), Simd::Load(z + i), d, cx, cy, cz);
+			Simd::Store(curlX + i, cx);
+			Simd::Store(curlY + i, cy);
+			Simd::Store(curlZ + i, cz);
+		}
+	};
+
+	struct NoiseGradPoints
+	{
+		const float* x;
+		const float* y;
+		float* noise;
+		float* gradientX;
+		float* gradientY;
+
+		void One(unsigned int i) const
+		{
+			XMFLOAT2 gradient;
+			noise[i] = SimplexNoise::SNoiseGrad(XMFLOAT2(x[i], y[i]), gradient);
+			gradientX[i] = gradient.x;
+			gradientY[i] = gradient.y;
+		}
+
+		template<typename Simd>
+		void Batch(unsigned int i) const
+		{
+			typename Simd::Float gx, gy;
+			Simd::Store(noise + i, SimplexNoise::SNoiseGradBatch<Simd>(Simd::Load(x + i), Simd::Load(y + i), gx, gy));
+			Simd::Store(gradientX + i, gx);
+			Simd::Store(gradientY + i, gy);
+		}
+	};
+
+	struct CurlGradPoints
+	{
+		const float* x;
+		const float* y;
+		const float* z;
+		float* curlX;
+		float* curlY;
+		float* curlZ;
+
+		void One(unsigned int i) const
+		{
+			XMFLOAT3 curl = SimplexNoise::CurlNoise3DGrad(XMFLOAT3(x[i], y[i], z[i]));
+			curlX[i] = curl.x;
+			curlY[i] = curl.y;
+			curlZ[i] = curl.z;
+		}
+
+		template<typename Simd>
+		void Batch(unsigned int i) const
+		{
+			typename Simd::Float cx, cy, cz;
+			SimplexNoise::CurlNoise3DGradBatch<Simd>(Simd::Load(x + i), Simd::Load(y + i), Simd::Load(z + i), cx, cy, cz);
+			Simd::Store(curlX + i, cx);
+			Simd::Store(curlY + i, cy);
+			Simd::Store(curlZ + i, cz);
+		}
+	};
+
+	struct Curl4Points
+	{
+		const float* x;
+		const float* y;
+		const float* z;
+		float w;
+		float d;
+		float* curlX;
+		float* curlY;
+		float* curlZ;
+
+		void One(unsigned int i) const
+		{
+			XMFLOAT3 curl = SimplexNoise::CurlNoise4D(XMFLOAT3(x[i], y[i], z[i]), w, d);
+			curlX[i] = curl.x;
+			curlY[i] = curl.y;
+			curlZ[i] = curl.z;
+		}
+
+		template<typename Simd>
+		void Batch(unsigned int i) const
+		{
+			typename Simd::Float cx, cy, cz;
+			SimplexNoise::CurlNoise4DBatch<Simd>(Simd::Load(x + i), Simd::Load(y + i), Simd::Load(z + i), w, d, cx, cy, cz);
+			Simd::Store(curlX + i, cx);
+			Simd::Store(curlY + i, cy);
+			Simd::Store(curlZ + i, cz);
+		}
+	};
+
+	struct OctavePoints
+	{
+		const float* x;
+		const float* y;
+		float scale;
+		float offset;
+		float persistence;
+		int iterations;
+		float* noise;
+
+		void One(unsigned int i) const
+		{
+			noise[i] = SimplexNoise::CalcNoiseWithOctaves(XMFLOAT3(x[i], y[i], 0.0f), scale, offset, persistence, iterations);
+		}
+
+		template<typename Simd>
+		void Batch(unsigned int i) const
+		{
+			Simd::Store(noise + i, SimplexNoise::CalcNoiseWithOctavesBatch<Simd>(Simd::Load(x + i), Simd::Load(y + i),
+				scale, offset, persistence, iterations));
+		}
+	};
+}
+
+float SimplexNoise::SNoise(XMFLOAT2 v)
+{
+	const float Cx = 0.211324865405187f;  // (3.0-sqrt(3.0))/6.0
+	const float Cy = 0.366025403784439f;  // 0.5*(sqrt(3.0)-1.0)
+	const float Cz = -0.577350269189626f; // -1.0 + 2.0 * C.x
+	const float Cw = 0.024390243902439f;  // 1.0 / 41.0
+
+	// first corner
+	float vDotC = v.x * Cy + v.y * Cy;
+	float ix = floorf(v.x + vDotC);
+	float iy = floorf(v.y + vDotC);
+
+	float iDotC = ix * Cx + iy * Cx;
+	float x0x = v.x - ix + iDotC;
+	float x0y = v.y - iy + iDotC;
+
+	// other corners
+	float i1x = (x0x > x0y) ? 1.0f : 0.0f;
+	float i1y = (x0x > x0y) ? 0.0f : 1.0f;
+
+	float x12x = x0x + Cx - i1x;
+	float x12y = x0y + Cx - i1y;
+	float x12z = x0x + Cz;
+	float x12w = x0y + Cz;
+
+	// permutations
+	ix = Mod289(ix);
+	iy = Mod289(iy);
+	float p[3] =
+	{
+		Permute(Permute(iy + 0.0f) + ix + 0.0f),
+		Permute(Permute(iy + i1y) + ix + i1x),
+		Permute(Permute(iy + 1.0f) + ix + 1.0f)
+	};
+
+	float m[3] =
+	{
+		(std::max)(0.5f - (x0x * x0x + x0y * x0y), 0.0f),
+		(std::max)(0.5f - (x12x * x12x + x12y * x12y), 0.0f),
+		(std::max)(0.5f - (x12z * x12z + x12w * x12w), 0.0f)
+	};
+
+	// gradients: 41 points uniformly over a line, mapped onto a diamond
+	float cornerX[3] = { x0x, x12x, x12z };
+	float cornerY[3] = { x0y, x12y, x12w };
+
+	float noise = 0.0f;
+	for (int i = 0; i < 3; ++i)
+	{
+		m[i] = m[i] * m[i];
+		m[i] = m[i] * m[i];
+
+		float x = 2.0f * Frac(p[i] * Cw) - 1.0f;
+		float h = fabsf(x) - 0.5f;
+		float ox = floorf(x + 0.5f);
+		float a0 = x - ox;
+
+		// normalise gradients implicitly by scaling m
+		m[i] *= 1.79284291400159f - 0.85373472095314f * (a0 * a0 + h * h);
+
+		noise += m[i] * (a0 * cornerX[i] + h * cornerY[i]);
+	}
+
+	return 130.0f * noise;
+}
+
+float SimplexNoise::SNoise(XMFLOAT3 v)
+{
+	const float Cx = 1.0f / 6.0f;
+	const float Cy = 1.0f / 3.0f;
+
+	// first corner
+	float vDotC = v.x * Cy + v.y * Cy + v.z * Cy;
+	float ix = floorf(v.x + vDotC);
+	float iy = floorf(v.y + vDotC);
+	float iz = floorf(v.z + vDotC);
+
+	float iDotC = ix * Cx + iy * Cx + iz * Cx;
+	float x0x = v.x - ix + iDotC;
+	float x0y = v.y - iy + iDotC;
+	float x0z = v.z - iz + iDotC;
+
+	// other corners, g = step(x0.yzx, x0.xyz) and l = 1 - g
+	float gx = (x0x >= x0y) ? 1.0f : 0.0f;
+	float gy = (x0y >= x0z) ? 1.0f : 0.0f;
+	float gz = (x0z >= x0x) ? 1.0f : 0.0f;
+	float lx = 1.0f - gx;
+	float ly = 1.0f - gy;
+	float lz = 1.0f - gz;
+
+	// i1 = min(g.xyz, l.zxy), i2 = max(g.xyz, l.zxy)
+	float i1x = (std::min)(gx, lz);
+	float i1y = (std::min)(gy, lx);
+	float i1z = (std::min)(gz, ly);
+	float i2x = (std::max)(gx, lz);
+	float i2y = (std::max)(gy, lx);
+	float i2z = (std::max)(gz, ly);
+
+	float cornerX[4] = { x0x, x0x - i1x + Cx, x0x - i2x + Cy, x0x - 0.5f };
+	float cornerY[4] = { x0y, x0y - i1y + Cx, x0y - i2y + Cy, x0y - 0.5f };
+	float cornerZ[4] = { x0z, x0z - i1z + Cx, x0z - i2z + Cy, x0z - 0.5f };
+
+	// permutations
+	ix = Mod289(ix);
+	iy = Mod289(iy);
+	iz = Mod289(iz);
+	float offsetX[4] = { 0.0f, i1x, i2x, 1.0f };
+	float offsetY[4] = { 0.0f, i1y, i2y, 1.0f };
+	float offsetZ[4] = { 0.0f, i1z, i2z, 1.0f };
+
+	// gradients: 7x7 points over a square, mapped onto an octahedron, ns = n_ * D.wyz - D.xzx
+	const float n_ = 0.142857142857f;
+	const float nsx = n_ * 2.0f - 0.0f;
+	const float nsy = n_ * 0.5f - 1.0f;
+	const float nsz = n_ * 1.0f - 0.0f;
+
+	float weighted[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		float p = Permute(Permute(Permute(iz + offsetZ[i]) + iy + offsetY[i]) + ix + offsetX[i]);
+
+		// mod(p, 7*7), then mod(j, 7)
+		float j = p - 49.0f * floorf(p * nsz * nsz);
+		float x_ = floorf(j * nsz);
+		float y_ = floorf(j - 7.0f * x_);
+
+		float x = x_ * nsx + nsy;
+		float y = y_ * nsx + nsy;
+		float h = 1.0f - fabsf(x) - fabsf(y);
+
+		// s = floor(b) * 2 + 1, sh = -step(h, 0)
+		float sh = -((h <= 0.0f) ? 1.0f : 0.0f);
+		float gradX = x + (floorf(x) * 2.0f + 1.0f) * sh;
+		float gradY = y + (floorf(y) * 2.0f + 1.0f) * sh;
+		float gradZ = h;
+
+		// normalise gradients
+		float norm = TaylorInvSqrt(gradX * gradX + gradY * gradY + gradZ * gradZ);
+		gradX *= norm;
+		gradY *= norm;
+		gradZ *= norm;
+
+		float m = (std::max)(0.5f - (cornerX[i] * cornerX[i] + cornerY[i] * cornerY[i] + cornerZ[i] * cornerZ[i]), 0.0f);
+		m = m * m;
+		weighted[i] = (m * m) * (gradX * cornerX[i] + gradY * cornerY[i] + gradZ * cornerZ[i]);
+	}
+
+	// mix final noise value
+	return 42.0f * (weighted[0] + weighted[1] + weighted[2] + weighted[3]);
+}
+
+float SimplexNoise::SNoiseGrad(XMFLOAT2 v, XMFLOAT2& gradient)
+{
+	const float Cx = 0.211324865405187f;
+	const float Cy = 0.366025403784439f;
+	const float Cz = -0.577350269189626f;
+	const float Cw = 0.024390243902439f;
+
+	// the corners and gradients of SNoise(XMFLOAT2)
+	float vDotC = v.x * Cy + v.y * Cy;
+	float ix = floorf(v.x + vDotC);
+	float iy = floorf(v.y + vDotC);
+
+	float iDotC = ix * Cx + iy * Cx;
+	float x0x = v.x - ix + iDotC;
+	float x0y = v.y - iy + iDotC;
+
+	float i1x = (x0x > x0y) ? 1.0f : 0.0f;
+	float i1y = (x0x > x0y) ? 0.0f : 1.0f;
+
+	float x12x = x0x + Cx - i1x;
+	float x12y = x0y + Cx - i1y;
+	float x12z = x0x + Cz;
+	float x12w = x0y + Cz;
+
+	ix = Mod289(ix);
+	iy = Mod289(iy);
+	float p[3] =
+	{
+		Permute(Permute(iy + 0.0f) + ix + 0.0f),
+		Permute(Permute(iy + i1y) + ix + i1x),
+		Permute(Permute(iy + 1.0f) + ix + 1.0f)
+	};
+
+	float m[3] =
+	{
+		(std::max)(0.5f - (x0x * x0x + x0y * x0y), 0.0f),
+		(std::max)(0.5f - (x12x * x12x + x12y * x12y), 0.0f),
+		(std::max)(0.5f - (x12z * x12z + x12w * x12w), 0.0f)
+	};
+
+	float cornerX[3] = { x0x, x12x, x12z };
+	float cornerY[3] = { x0y, x12y, x12w };
+
+	// d/dx (m^4 * dot(g, x)) = m^4 * g - 8 * m^3 * dot(g, x) * x, with the norm as a constant factor
+	float noise = 0.0f;
+	float gradX = 0.0f;
+	float gradY = 0.0f;
+	for (int i = 0; i < 3; ++i)
+	{
+		float m2 = m[i] * m[i];
+		float m4 = m2 * m2;
+
+		float x = 2.0f * Frac(p[i] * Cw) - 1.0f;
+		float h = fabsf(x) - 0.5f;
+		float ox = floorf(x + 0.5f);
+		float a0 = x - ox;
+
+		float norm = 1.79284291400159f - 0.85373472095314f * (a0 * a0 + h * h);
+		float weight = m4 * norm;
+		float dot = a0 * cornerX[i] + h * cornerY[i];
+
+		noise += weight * dot;
+
+		float slope = -8.0f * (m2 * m[i]) * norm * dot;
+		gradX += weight * a0 + slope * cornerX[i];
+		gradY += weight * h + slope * cornerY[i];
+	}
+
+	gradient = XMFLOAT2(130.0f * gradX, 130.0f * gradY);
+	return 130.0f * noise;
+}
+
+float SimplexNoise::SNoiseGrad(XMFLOAT3 v, XMFLOAT3& gradient)
+{
+	const float Cx = 1.0f / 6.0f;
+	const float Cy = 1.0f / 3.0f;
+
+	// the corners and gradients of SNoise(XMFLOAT3)
+	float vDotC = v.x * Cy + v.y * Cy + v.z * Cy;
+	float ix = floorf(v.x + vDotC);
+	float iy = floorf(v.y + vDotC);
+	float iz = floorf(v.z + vDotC);
+
+	float iDotC = ix * Cx + iy * Cx + iz * Cx;
+	float x0x = v.x - ix + iDotC;
+	float x0y = v.y - iy + iDotC;
+	float x0z = v.z - iz + iDotC;
+
+	float gx = (x0x >= x0y) ? 1.0f : 0.0f;
+	float gy = (x0y >= x0z) ? 1.0f : 0.0f;
+	float gz = (x0z >= x0x) ? 1.0f : 0.0f;
+	float lx = 1.0f - gx;
+	float ly = 1.0f - gy;
+	float lz = 1.0f - gz;
+
+	float i1x = (std::min)(gx, lz);
+	float i1y = (std::min)(gy, lx);
+	float i1z = (std::min)(gz, ly);
+	float i2x = (std::max)(gx, lz);
+	float i2y = (std::max)(gy, lx);
+	float i2z = (std::max)(gz, ly);
+
+	float cornerX[4] = { x0x, x0x - i1x + Cx, x0x - i2x + Cy, x0x - 0.5f };
+	float cornerY[4] = { x0y, x0y - i1y + Cx, x0y - i2y + Cy, x0y - 0.5f };
+	float cornerZ[4] = { x0z, x0z - i1z + Cx, x0z - i2z + Cy, x0z - 0.5f };
+
+	ix = Mod289(ix);
+	iy = Mod289(iy);
+	iz = Mod289(iz);
+	float offsetX[4] = { 0.0f, i1x, i2x, 1.0f };
+	float offsetY[4] = { 0.0f, i1y, i2y, 1.0f };
+	float offsetZ[4] = { 0.0f, i1z, i2z, 1.0f };
+
+	const float n_ = 0.142857142857f;
+	const float nsx = n_ * 2.0f - 0.0f;
+	const float nsy = n_ * 0.5f - 1.0f;
+	const float nsz = n_ * 1.0f - 0.0f;
+
+	float weighted[4];
+	float gradientX = 0.0f;
+	float gradientY = 0.0f;
+	float gradientZ = 0.0f;
+	for (int i = 0; i < 4; ++i)
+	{
+		float p = Permute(Permute(Permute(iz + offsetZ[i]) + iy + offsetY[i]) + ix + offsetX[i]);
+
+		float j = p - 49.0f * floorf(p * nsz * nsz);
+		float x_ = floorf(j * nsz);
+		float y_ = floorf(j - 7.0f * x_);
+
+		float x = x_ * nsx + nsy;
+		float y = y_ * nsx + nsy;
+		float h = 1.0f - fabsf(x) - fabsf(y);
+
+		float sh = -((h <= 0.0f) ? 1.0f : 0.0f);
+		float gradX = x + (floorf(x) * 2.0f + 1.0f) * sh;
+		float gradY = y + (floorf(y) * 2.0f + 1.0f) * sh;
+		float gradZ = h;
+
+		float norm = TaylorInvSqrt(gradX * gradX + gradY * gradY + gradZ * gradZ);
+		gradX *= norm;
+		gradY *= norm;
+		gradZ *= norm;
+
+		// d/dx (m^4 * dot(g, x)) = m^4 * g - 8 * m^3 * dot(g, x) * x
+		float m = (std::max)(0.5f - (cornerX[i] * cornerX[i] + cornerY[i] * cornerY[i] + cornerZ[i] * cornerZ[i]), 0.0f);
+		float m2 = m * m;
+		float m4 = m2 * m2;
+		float dot = gradX * cornerX[i] + gradY * cornerY[i] + gradZ * cornerZ[i];
+		weighted[i] = m4 * dot;
+
+		float slope = -8.0f * (m2 * m) * dot;
+		gradientX += m4 * gradX + slope * cornerX[i];
+		gradientY += m4 * gradY + slope * cornerY[i];
+		gradientZ += m4 * gradZ + slope * cornerZ[i];
+	}
+
+	gradient = XMFLOAT3(42.0f * gradientX, 42.0f * gradientY, 42.0f * gradientZ);
+	return 42.0f * (weighted[0] + weighted[1] + weighted[2] + weighted[3]);
+}
+
+void SimplexNoise::Grad4(float j, float& x, float& y, float& z, float& w)
+{
+	// ip = float4(1.0 / 294.0, 1.0 / 49.0, 1.0 / 7.0, 0.0)
+	const float ipx = 1.0f / 294.0f;
+	const float ipy = 1.0f / 49.0f;
+	const float ipz = 1.0f / 7.0f;
+
+	x = floorf(Frac(j * ipx) * 7.0f) * ipz - 1.0f;
+	y = floorf(Frac(j * ipy) * 7.0f) * ipz - 1.0f;
+	z = floorf(Frac(j * ipz) * 7.0f) * ipz - 1.0f;
+	w = 1.5f - (fabsf(x) + fabsf(y) + fabsf(z));
+
+	// s = lessThan(p, 0), p.xyz += (s.xyz * 2 - 1) * s.www
+	float sx = (x < 0.0f) ? 1.0f : 0.0f;
+	float sy = (y < 0.0f) ? 1.0f : 0.0f;
+	float sz = (z < 0.0f) ? 1.0f : 0.0f;
+	float sw = (w < 0.0f) ? 1.0f : 0.0f;
+	x = x + (sx * 2.0f - 1.0f) * sw;
+	y = y + (sy * 2.0f - 1.0f) * sw;
+	z = z + (sz * 2.0f - 1.0f) * sw;
+}
+
+float SimplexNoise::SNoise(XMFLOAT4 v)
+{
+	const float F4 = 0.309016994374947451f; // (sqrt(5) - 1)/4
+	const float Cx = 0.138196601125011f;    // (5 - sqrt(5))/20  G4
+	const float Cy = 0.276393202250021f;    // 2 * G4
+	const float Cz = 0.414589803375032f;    // 3 * G4
+	const float Cw = -0.447213595499958f;   // -1 + 4 * G4
+
+	// first corner
+	float vDotF = v.x * F4 + v.y * F4 + v.z * F4 + v.w * F4;
+	float i[4] = { floorf(v.x + vDotF), floorf(v.y + vDotF), floorf(v.z + vDotF), floorf(v.w + vDotF) };
+
+	float iDotC = i[0] * Cx + i[1] * Cx + i[2] * Cx + i[3] * Cx;
+	float x0[4] = { v.x - i[0] + iDotC, v.y - i[1] + iDotC, v.z - i[2] + iDotC, v.w - i[3] + iDotC };
+
+	// other corners, rank sorting originally contributed by Bill Licea-Kane, AMD (formerly ATI)
+	// isX = step(x0.yzw, x0.xxx), isYZ = step(x0.zww, x0.yyz)
+	float isX[3] = { (x0[0] >= x0[1]) ? 1.0f : 0.0f, (x0[0] >= x0[2]) ? 1.0f : 0.0f, (x0[0] >= x0[3]) ? 1.0f : 0.0f };
+	float isYZ[3] = { (x0[1] >= x0[2]) ? 1.0f : 0.0f, (x0[1] >= x0[3]) ? 1.0f : 0.0f, (x0[2] >= x0[3]) ? 1.0f : 0.0f };
+
+	float i0[4];
+	i0[0] = isX[0] + isX[1] + isX[2];
+	i0[1] = 1.0f - isX[0];
+	i0[2] = 1.0f - isX[1];
+	i0[3] = 1.0f - isX[2];
+	i0[1] += isYZ[0] + isYZ[1];
+	i0[2] += 1.0f - isYZ[0];
+	i0[3] += 1.0f - isYZ[1];
+	i0[2] += isYZ[2];
+	i0[3] += 1.0f - isYZ[2];
+
+	// i0 now contains the unique values 0,1,2,3 in each channel, offsets[k] is the k-th corner
+	float offsets[5][4];
+	for (int a = 0; a < 4; ++a)
+	{
+		offsets[0][a] = 0.0f;
+		offsets[1][a] = (std::min)((std::max)(i0[a] - 2.0f, 0.0f), 1.0f);
+		offsets[2][a] = (std::min)((std::max)(i0[a] - 1.0f, 0.0f), 1.0f);
+		offsets[3][a] = (std::min)((std::max)(i0[a], 0.0f), 1.0f);
+		offsets[4][a] = 1.0f;
+	}
+
+	const float cornerOffsets[3] = { Cx, Cy, Cz };
+	float corners[5][4];
+	for (int a = 0; a < 4; ++a)
+	{
+		corners[0][a] = x0[a];
+		for (int k = 1; k < 4; ++k)
+			corners[k][a] = x0[a] - offsets[k][a] + cornerOffsets[k - 1];
+		corners[4][a] = x0[a] + Cw;
+	}
+
+	// permutations
+	for (int a = 0; a < 4; ++a)
+		i[a] = Mod289(i[a]);
+
+	float j[5];
+	j[0] = Permute(Permute(Permute(Permute(i[3]) + i[2]) + i[1]) + i[0]);
+	for (int k = 1; k < 5; ++k)
+	{
+		j[k] = Permute(Permute(Permute(Permute(
+			i[3] + offsets[k][3])
+			+ i[2] + offsets[k][2])
+			+ i[1] + offsets[k][1])
+			+ i[0] + offsets[k][0]);
+	}
+
+	// gradients: 7x7x6 points over a cube, mapped onto a 4-cross polytope, then normalised
+	float weighted[5];
+	for (int k = 0; k < 5; ++k)
+	{
+		float p[4];
+		Grad4(j[k], p[0], p[1], p[2], p[3]);
+
+		float norm = TaylorInvSqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2] + p[3] * p[3]);
+		for (int a = 0; a < 4; ++a)
+			p[a] *= norm;
+
+		const float* x = corners[k];
+		float m = (std::max)(0.5f - (x[0] * x[0] + x[1] * x[1] + x[2] * x[2] + x[3] * x[3]), 0.0f);
+		m = m * m;
+		weighted[k] = (m * m) * (p[0] * x[0] + p[1] * x[1] + p[2] * x[2] + p[3] * x[3]);
+	}
+
+	// mix contributions from the five corners
+	return 49.0f * ((weighted[0] + weighted[1] + weighted[2]) + (weighted[3] + weighted[4]));
+}
+
+XMFLOAT3 SimplexNoise::SNoise3D(XMFLOAT3 v)
+{
+	return XMFLOAT3(
+		SNoise(XMFLOAT2(v.x, v.y)),
+		SNoise(XMFLOAT2(v.y, v.z)),
+		SNoise(XMFLOAT2(v.z, v.x)));
+}
+
+XMFLOAT3 SimplexNoise::CurlNoise3D(XMFLOAT3 p, float d)
+{
+	XMFLOAT3 p_x0 = SNoise3D(XMFLOAT3(p.x - d, p.y, p.z));
+	XMFLOAT3 p_x1 = SNoise3D(XMFLOAT3(p.x + d, p.y, p.z));
+	XMFLOAT3 p_y0 = SNoise3D(XMFLOAT3(p.x, p.y - d, p.z));
+	XMFLOAT3 p_y1 = SNoise3D(XMFLOAT3(p.x, p.y + d, p.z));
+	XMFLOAT3 p_z0 = SNoise3D(XMFLOAT3(p.x, p.y, p.z - d));
+	XMFLOAT3 p_z1 = SNoise3D(XMFLOAT3(p.x, p.y, p.z + d));
+
+	float x = p_y1.z - p_y0.z - p_z1.y + p_z0.y;
+	float y = p_z1.x - p_z0.x - p_x1.z + p_x0.z;
+	float z = p_x1.y - p_x0.y - p_y1.x + p_y0.x;
+
+	// same scale as the shader, which multiplies by 2d instead of dividing
+	return XMFLOAT3(x * (2 * d), y * (2 * d), z * (2 * d));
+}
+
+XMFLOAT3 SimplexNoise::CurlNoise3DGrad(XMFLOAT3 p)
+{
+	// curl (a(x, y), a(y, z), a(z, x)) = (-da/dv(y, z), -da/dv(z, x), -da/dv(x, y)) for a(u, v) = snoise(float2(u, v))
+	XMFLOAT2 gradientYZ, gradientZX, gradientXY;
+	SNoiseGrad(XMFLOAT2(p.y, p.z), gradientYZ);
+	SNoiseGrad(XMFLOAT2(p.z, p.x), gradientZX);
+	SNoiseGrad(XMFLOAT2(p.x, p.y), gradientXY);
+
+	return XMFLOAT3(-gradientYZ.y, -gradientZX.y, -gradientXY.y);
+}
+
+XMFLOAT3 SimplexNoise::CurlNoise4D(XMFLOAT3 p, float w, float d)
+{
+	float inverse = 1.0f / (2.0f * d);
+
+	float x0 = p.x - d, x1 = p.x + d;
+	float y0 = p.y - d, y1 = p.y + d;
+	float z0 = p.z - d, z1 = p.z + d;
+
+	// dc/dy - db/dz, da/dz - dc/dx, db/dx - da/dy
+	float dcdy = Potential4D(2, p.x, y1, p.z, w) - Potential4D(2, p.x, y0, p.z, w);
+	float dbdz = Potential4D(1, p.x, p.y, z1, w) - Potential4D(1, p.x, p.y, z0, w);
+	float dadz = Potential4D(0, p.x, p.y, z1, w) - Potential4D(0, p.x, p.y, z0, w);
+	float dcdx = Potential4D(2, x1, p.y, p.z, w) - Potential4D(2, x0, p.y, p.z, w);
+	float dbdx = Potential4D(1, x1, p.y, p.z, w) - Potential4D(1, x0, p.y, p.z, w);
+	float dady = Potential4D(0, p.x, y1, p.z, w) - Potential4D(0, p.x, y0, p.z, w);
+
+	return XMFLOAT3((dcdy - dbdz) * inverse, (dadz - dcdx) * inverse, (dbdx - dady) * inverse);
+}
+
+float SimplexNoise::Potential4D(int component, float x, float y, float z, float w)
+{
+	switch (component)
+	{
+	case 0:
+		return SNoise(XMFLOAT4(x, y, z, w));
+	case 1:
+		return SNoise(XMFLOAT4(y + 31.341f, z - 17.239f, x + 9.623f, w));
+	default:
+		return SNoise(XMFLOAT4(z - 23.087f, x + 41.711f, y - 5.197f, w));
+	}
+}
+
+float SimplexNoise::CalcNoiseWithOctaves(XMFLOAT3 seed, float scale, float offset, float persistence, int iterations)
+{
+	float maxAmp = 0.0f;
+	float amp = 1.0f;
+	float noise = 0.0f;
+	float freq = scale;
+
+	for (int i = 0; i < iterations; ++i)
+	{
+		XMFLOAT3 itSeed(seed.x * freq, seed.y * freq, offset);
+
+		float adjNoise = SNoise(itSeed) * 0.5f + 0.5f;
+		noise += adjNoise * amp;
+		maxAmp += amp;
+		amp *= persistence;
+		freq *= 2.0f;
+	}
+
+	// the average
+	return noise / maxAmp;
+}
+
+SimplexNoiseLevel SimplexNoise::DetectLevel()
+{
+	switch (ParticleUpdateKernel::DetectLevel())
+	{
+	case ParticleKernelAVX2:
+		break;
+	case ParticleKernelSSE4:
+		return SimplexNoiseSSE4;
+	default:
+		return SimplexNoiseScalar;
+	}
+
+	// on top of the ymm state the OS has to save the opmask registers and all 32 zmm registers
+	int info[4];
+	__cpuidex(info, 7, 0);
+	if ((info[1] & (1 << 16)) && (_xgetbv(0) & 0xe6) == 0xe6)
+		return SimplexNoiseAVX512;
+
+	return SimplexNoiseAVX2;
+}
+
+const char* SimplexNoise::GetLevelName(SimplexNoiseLevel level)
+{
+	switch (level)
+	{
+	case SimplexNoiseSSE4:
+		return "SSE4.1";
+	case SimplexNoiseAVX2:
+		return "AVX2";
+	case SimplexNoiseAVX512:
+		return "AVX-512";
+	default:
+		return "scalar";
+	}
+}
+
+void SimplexNoise::SNoisePoints(SimplexNoiseLevel level, const float* x, const float* y, float* noise, unsigned int count)
+{
+	Noise2Points points = { x, y, noise };
+	Run(level, points, count);
+}
+
+void SimplexNoise::SNoisePoints(SimplexNoiseLevel level, const float* x, const float* y, const float* z, float* noise,
+	unsigned int count)
+{
+	Noise3Points points = { x, y, z, noise };
+	Run(level, points, count);
+}
+
+void SimplexNoise::SNoisePoints(SimplexNoiseLevel level, const float* x, const float* y, const float* z, const float* w,
+	float* noise, unsigned int count)
+{
+	Noise4Points points = { x, y, z, w, noise };
+	Run(level, points, count);
+}
+
+void SimplexNoise::SNoise3DPoints(SimplexNoiseLevel level, const float* x, const float* y, const float* z,
+	float* noiseX, float* noiseY, float* noiseZ, unsigned int count)
+{
+	Noise3DPoints points = { x, y, z, noiseX, noiseY, noiseZ };
+	Run(level, points, count);
+}
+
+void SimplexNoise::CurlNoise3DPoints(SimplexNoiseLevel level, const float* x, const float* y, const float* z, float d,
+	float* curlX, float* curlY, float* curlZ, unsigned int count)
+{
+	CurlPoints points = { x, y, z, d, curlX, curlY, curlZ };
+	Run(level, points, count);
+}
+
+void SimplexNoise::SNoiseGradPoints(SimplexNoiseLevel level, const float* x, const float* y, float* noise,
+	float* gradientX, float* gradientY, unsigned int count)
+{
+	NoiseGradPoints points = { x, y, noise, gradientX, gradientY };
+	Run(level, points, count);
+}
+
+void SimplexNoise::CurlNoise3DGradPoints(SimplexNoiseLevel level, const float* x, const float* y, const float* z,
+	float* curlX, float* curlY, float* curlZ, unsigned int count)
+{
+	CurlGradPoints points = { x, y, z, curlX, curlY, curlZ };
+	Run(level, points, count);
+}
+
+void SimplexNoise::CurlNoise4DPoints(SimplexNoiseLevel level, const float* x, const float* y, const float* z, float w, float d,
+	float* curlX, float* curlY, float* curlZ, unsigned int count)
+{
+	Curl4Points points = { x, y, z, w, d, curlX, curlY, curlZ };
+	Run(level, points, count);
+}
+
+void SimplexNoise::CalcNoiseWithOctavesPoints(SimplexNoiseLevel level, const float* x, const float* y,
+	float scale, float offset, float persistence, int iterations, float* noise, unsigned int count)
+{
+	OctavePoints points = { x, y, scale, offset, persistence, iterations, noise };
+	Run(level, points, count);
+}
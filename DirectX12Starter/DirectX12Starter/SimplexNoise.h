@@ -0,0 +1,683 @@
+#pragma once
+#include <cmath>
+#include <DirectXMath.h>
+#include "SimdMath.h"
+
+// instruction set of the batch noise, unlike the particle kernels the noise also has an AVX-512 width
+enum SimplexNoiseLevel
+{
+	SimplexNoiseScalar,
+	SimplexNoiseSSE4,
+	SimplexNoiseAVX2,
+	SimplexNoiseAVX512,
+	SimplexNoiseLevelCount
+};
+
+// C++ port of SimplexNoise.hlsl
+// the arithmetic follows the shader line by line so the CPU and GPU passes produce the same curl field,
+// the scalar functions are the reference and every batch function gives their bits for each lane
+class SimplexNoise
+{
+public:
+	// snoise(float2), snoise(float3) and snoise(float4)
+	static float SNoise(DirectX::XMFLOAT2 v);
+	static float SNoise(DirectX::XMFLOAT3 v);
+	static float SNoise(DirectX::XMFLOAT4 v);
+
+	static DirectX::XMFLOAT3 SNoise3D(DirectX::XMFLOAT3 v);
+
+	static DirectX::XMFLOAT3 CurlNoise3D(DirectX::XMFLOAT3 p, float d);
+
+	// snoise_grad, the noise and its gradient with respect to v from the same corners in one evaluation,
+	// the noise is the bits of SNoise and the gradient the derivative of its falloff polynomials
+	static float SNoiseGrad(DirectX::XMFLOAT2 v, DirectX::XMFLOAT2& gradient);
+	static float SNoiseGrad(DirectX::XMFLOAT3 v, DirectX::XMFLOAT3& gradient);
+
+	// curlNoise3DGrad, the exact curl of the snoise3D potential from three gradient evaluations instead of
+	// the 18 lookups of CurlNoise3D, which approaches 4 * d * d * CurlNoise3DGrad(p) as d goes to 0
+	// every component depends only on the other two coordinates, so the field is divergence-free
+	static DirectX::XMFLOAT3 CurlNoise3DGrad(DirectX::XMFLOAT3 p);
+
+	// curlNoise4D, the curl of a potential of three 4D noises that drifts with w, e.g. TotalTime as w for a field
+	// that changes over time, central differences of step d divided by 2d, 12 lookups since none of them cancel
+	static DirectX::XMFLOAT3 CurlNoise4D(DirectX::XMFLOAT3 p, float w, float d);
+
+	// like the shader seed.z is replaced by offset in every octave
+	static float CalcNoiseWithOctaves(DirectX::XMFLOAT3 seed, float scale, float offset, float persistence, int iterations);
+
+	// SNoise for Simd::Width points at once, same operations in the same order
+	template<typename Simd>
+	static typename Simd::Float SNoiseBatch(typename Simd::Float x, typename Simd::Float y);
+
+	template<typename Simd>
+	static typename Simd::Float SNoiseBatch(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z);
+
+	template<typename Simd>
+	static typename Simd::Float SNoiseBatch(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z,
+		typename Simd::Float w);
+
+	template<typename Simd>
+	static void SNoise3DBatch(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z,
+		typename Simd::Float& noiseX, typename Simd::Float& noiseY, typename Simd::Float& noiseZ);
+
+	// CurlNoise3D for Simd::Width points at once
+	// snoise3D(v).y does not depend on v.x (and likewise for .z/.y and .x/.z), so 12 of the shader's 18
+	// lookups cancel as a - a == 0 and only the 6 that survive are evaluated, giving the same bits
+	template<typename Simd>
+	static void CurlNoise3DBatch(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z, float d,
+		typename Simd::Float& curlX, typename Simd::Float& curlY, typename Simd::Float& curlZ);
+
+	template<typename Simd>
+	static typename Simd::Float SNoiseGradBatch(typename Simd::Float x, typename Simd::Float y,
+		typename Simd::Float& gradientX, typename Simd::Float& gradientY);
+
+	template<typename Simd>
+	static void CurlNoise3DGradBatch(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z,
+		typename Simd::Float& curlX, typename Simd::Float& curlY, typename Simd::Float& curlZ);
+
+	template<typename Simd>
+	static void CurlNoise4DBatch(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z, float w, float d,
+		typename Simd::Float& curlX, typename Simd::Float& curlY, typename Simd::Float& curlZ);
+
+	// the seed's z is unused, so only x and y are taken
+	template<typename Simd>
+	static typename Simd::Float CalcNoiseWithOctavesBatch(typename Simd::Float x, typename Simd::Float y,
+		float scale, float offset, float persistence, int iterations);
+
+	// ParticleUpdateKernel::DetectLevel plus AVX-512F with the zmm state enabled by the OS
+	static SimplexNoiseLevel DetectLevel();
+	static const char* GetLevelName(SimplexNoiseLevel level);
+
+	// the functions above over count points given as separate coordinate arrays, Simd::Width points at a time
+	// and the scalar reference for the remainder, so every level writes the same values
+	static void SNoisePoints(SimplexNoiseLevel level, const float* x, const float* y, float* noise, unsigned int count);
+	static void SNoisePoints(SimplexNoiseLevel level, const float* x, const float* y, const float* z, float* noise,
+		unsigned int count);
+	static void SNoisePoints(SimplexNoiseLevel level, const float* x, const float* y, const float* z, const float* w,
+		float* noise, unsigned int count);
+	static void SNoise3DPoints(SimplexNoiseLevel level, const float* x, const float* y, const float* z,
+		float* noiseX, float* noiseY, float* noiseZ, unsigned int count);
+	static void CurlNoise3DPoints(SimplexNoiseLevel level, const float* x, const float* y, const float* z, float d,
+		float* curlX, float* curlY, float* curlZ, unsigned int count);
+	static void SNoiseGradPoints(SimplexNoiseLevel level, const float* x, const float* y, float* noise,
+		float* gradientX, float* gradientY, unsigned int count);
+	static void CurlNoise3DGradPoints(SimplexNoiseLevel level, const float* x, const float* y, const float* z,
+		float* curlX, float* curlY, float* curlZ, unsigned int count);
+	static void CurlNoise4DPoints(SimplexNoiseLevel level, const float* x, const float* y, const float* z, float w, float d,
+		float* curlX, float* curlY, float* curlZ, unsigned int count);
+	static void CalcNoiseWithOctavesPoints(SimplexNoiseLevel level, const float* x, const float* y,
+		float scale, float offset, float persistence, int iterations, float* noise, unsigned int count);
+
+	static float Mod289(float x)
+	{
+		return x - floorf(x * (1.0f / 289.0f)) * 289.0f;
+	}
+
+	static float Permute(float x)
+	{
+		return Mod289(((x * 34.0f) + 1.0f) * x);
+	}
+
+	static float Frac(float x)
+	{
+		return x - floorf(x);
+	}
+
+	static float TaylorInvSqrt(float r)
+	{
+		return 1.79284291400159f - 0.85373472095314f * r;
+	}
+
+private:
+	// grad4 of the shader, one of 7x7x6 points on a 4-cross polytope
+	static void Grad4(float j, float& x, float& y, float& z, float& w);
+
+	// component of the curlNoise4D potential, the second and third are the noise swizzled and shifted away from the first
+	static float Potential4D(int component, float x, float y, float z, float w);
+
+	template<typename Simd>
+	static typename Simd::Float Potential4DBatch(int component, typename Simd::Float x, typename Simd::Float y,
+		typename Simd::Float z, typename Simd::Float w)
+	{
+		switch (component)
+		{
+		case 0:
+			return SNoiseBatch<Simd>(x, y, z, w);
+		case 1:
+			return SNoiseBatch<Simd>(Simd::Add(y, Simd::Set1(31.341f)), Simd::Add(z, Simd::Set1(-17.239f)),
+				Simd::Add(x, Simd::Set1(9.623f)), w);
+		default:
+			return SNoiseBatch<Simd>(Simd::Add(z, Simd::Set1(-23.087f)), Simd::Add(x, Simd::Set1(41.711f)),
+				Simd::Add(y, Simd::Set1(-5.197f)), w);
+		}
+	}
+
+	// step(edge, x) == (x >= edge ? 1 : 0)
+	template<typename Simd>
+	static typename Simd::Float StepBatch(typename Simd::Float edge, typename Simd::Float x)
+	{
+		return Simd::Select(Simd::CmpGt(edge, x), Simd::Zero(), Simd::Set1(1.0f));
+	}
+
+	template<typename Simd>
+	static typename Simd::Float TaylorInvSqrtBatch(typename Simd::Float r)
+	{
+		return Simd::Sub(Simd::Set1(1.79284291400159f), Simd::Mul(Simd::Set1(0.85373472095314f), r));
+	}
+
+	template<typename Simd>
+	static void Grad4Batch(typename Simd::Float j, typename Simd::Float& x, typename Simd::Float& y,
+		typename Simd::Float& z, typename Simd::Float& w);
+
+	template<typename Simd>
+	static typename Simd::Float Dot3Batch(typename Simd::Float ax, typename Simd::Float ay, typename Simd::Float az,
+		typename Simd::Float bx, typename Simd::Float by, typename Simd::Float bz)
+	{
+		return Simd::Add(Simd::Add(Simd::Mul(ax, bx), Simd::Mul(ay, by)), Simd::Mul(az, bz));
+	}
+
+	template<typename Simd>
+	static typename Simd::Float Dot4Batch(const typename Simd::Float* a, const typename Simd::Float* b)
+	{
+		return Simd::Add(Simd::Add(Simd::Add(Simd::Mul(a[0], b[0]), Simd::Mul(a[1], b[1])), Simd::Mul(a[2], b[2])),
+			Simd::Mul(a[3], b[3]));
+	}
+
+	template<typename Simd>
+	static typename Simd::Float Mod289Batch(typename Simd::Float x)
+	{
+		return Simd::Sub(x, Simd::Mul(Simd::Floor(Simd::Mul(x, Simd::Set1(1.0f / 289.0f))), Simd::Set1(289.0f)));
+	}
+
+	template<typename Simd>
+	static typename Simd::Float PermuteBatch(typename Simd::Float x)
+	{
+		return Mod289Batch<Simd>(Simd::Mul(Simd::Add(Simd::Mul(x, Simd::Set1(34.0f)), Simd::Set1(1.0f)), x));
+	}
+};
+
+template<typename Simd>
+typename Simd::Float SimplexNoise::SNoiseBatch(typename Simd::Float x, typename Simd::Float y)
+{
+	typedef typename Simd::Float Float;
+
+	const Float Cx = Simd::Set1(0.211324865405187f);
+	const Float Cy = Simd::Set1(0.366025403784439f);
+	const Float Cz = Simd::Set1(-0.577350269189626f);
+	const Float Cw = Simd::Set1(0.024390243902439f);
+	const Float zero = Simd::Zero();
+	const Float one = Simd::Set1(1.0f);
+	const Float half = Simd::Set1(0.5f);
+
+	// first corner
+	Float vDotC = Simd::Add(Simd::Mul(x, Cy), Simd::Mul(y, Cy));
+	Float ix = Simd::Floor(Simd::Add(x, vDotC));
+	Float iy = Simd::Floor(Simd::Add(y, vDotC));
+
+	Float iDotC = Simd::Add(Simd::Mul(ix, Cx), Simd::Mul(iy, Cx));
+	Float x0x = Simd::Add(Simd::Sub(x, ix), iDotC);
+	Float x0y = Simd::Add(Simd::Sub(y, iy), iDotC);
+
+	// other corners
+	Float greater = Simd::CmpGt(x0x, x0y);
+	Float i1x = Simd::Select(greater, one, zero);
+	Float i1y = Simd::Select(greater, zero, one);
+
+	Float x12x = Simd::Sub(Simd::Add(x0x, Cx), i1x);
+	Float x12y = Simd::Sub(Simd::Add(x0y, Cx), i1y);
+	Float x12z = Simd::Add(x0x, Cz);
+	Float x12w = Simd::Add(x0y, Cz);
+
+	// permutations
+	ix = Mod289Batch<Simd>(ix);
+	iy = Mod289Batch<Simd>(iy);
+	Float p[3] =
+	{
+		PermuteBatch<Simd>(Simd::Add(Simd::Add(PermuteBatch<Simd>(Simd::Add(iy, zero)), ix), zero)),
+		PermuteBatch<Simd>(Simd::Add(Simd::Add(PermuteBatch<Simd>(Simd::Add(iy, i1y)), ix), i1x)),
+		PermuteBatch<Simd>(Simd::Add(Simd::Add(PermuteBatch<Simd>(Simd::Add(iy, one)), ix), one))
+	};
+
+	Float m[3] =
+	{
+		Simd::Max(Simd::Sub(half, Simd::Add(Simd::Mul(x0x, x0x), Simd::Mul(x0y, x0y))), zero),
+		Simd::Max(Simd::Sub(half, Simd::Add(Simd::Mul(x12x, x12x), Simd::Mul(x12y, x12y))), zero),
+		Simd::Max(Simd::Sub(half, Simd::Add(Simd::Mul(x12z, x12z), Simd::Mul(x12w, x12w))), zero)
+	};
+
+	Float cornerX[3] = { x0x, x12x, x12z };
+	Float cornerY[3] = { x0y, x12y, x12w };
+
+	Float noise = zero;
+	for (int i = 0; i < 3; ++i)
+	{
+		m[i] = Simd::Mul(m[i], m[i]);
+		m[i] = Simd::Mul(m[i], m[i]);
+
+		Float scaled = Simd::Mul(p[i], Cw);
+		Float gx = Simd::Sub(Simd::Mul(Simd::Set1(2.0f), Simd::Sub(scaled, Simd::Floor(scaled))), one);
+		Float h = Simd::Sub(Simd::Abs(gx), half);
+		Float ox = Simd::Floor(Simd::Add(gx, half));
+		Float a0 = Simd::Sub(gx, ox);
+
+		Float norm = Simd::Sub(Simd::Set1(1.79284291400159f),
+			Simd::Mul(Simd::Set1(0.85373472095314f), Simd::Add(Simd::Mul(a0, a0), Simd::Mul(h, h))));
+		m[i] = Simd::Mul(m[i], norm);
+
+		noise = Simd::Add(noise, Simd::Mul(m[i], Simd::Add(Simd::Mul(a0, cornerX[i]), Simd::Mul(h, cornerY[i]))));
+	}
+
+	return Simd::Mul(Simd::Set1(130.0f), noise);
+}
+
+template<typename Simd>
+typename Simd::Float SimplexNoise::SNoiseBatch(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z)
+{
+	typedef typename Simd::Float Float;
+
+	const Float Cx = Simd::Set1(1.0f / 6.0f);
+	const Float Cy = Simd::Set1(1.0f / 3.0f);
+	const Float zero = Simd::Zero();
+	const Float one = Simd::Set1(1.0f);
+	const Float half = Simd::Set1(0.5f);
+
+	// first corner
+	Float vDotC = Dot3Batch<Simd>(x, y, z, Cy, Cy, Cy);
+	Float ix = Simd::Floor(Simd::Add(x, vDotC));
+	Float iy = Simd::Floor(Simd::Add(y, vDotC));
+	Float iz = Simd::Floor(Simd::Add(z, vDotC));
+
+	Float iDotC = Dot3Batch<Simd>(ix, iy, iz, Cx, Cx, Cx);
+	Float x0x = Simd::Add(Simd::Sub(x, ix), iDotC);
+	Float x0y = Simd::Add(Simd::Sub(y, iy), iDotC);
+	Float x0z = Simd::Add(Simd::Sub(z, iz), iDotC);
+
+	// other corners, g = step(x0.yzx, x0.xyz) and l = 1 - g
+	Float gx = StepBatch<Simd>(x0y, x0x);
+	Float gy = StepBatch<Simd>(x0z, x0y);
+	Float gz = StepBatch<Simd>(x0x, x0z);
+	Float lx = Simd::Sub(one, gx);
+	Float ly = Simd::Sub(one, gy);
+	Float lz = Simd::Sub(one, gz);
+
+	Float i1x = Simd::Min(gx, lz);
+	Float i1y = Simd::Min(gy, lx);
+	Float i1z = Simd::Min(gz, ly);
+	Float i2x = Simd::Max(gx, lz);
+	Float i2y = Simd::Max(gy, lx);
+	Float i2z = Simd::Max(gz, ly);
+
+	Float cornerX[4] = { x0x, Simd::Add(Simd::Sub(x0x, i1x), Cx), Simd::Add(Simd::Sub(x0x, i2x), Cy), Simd::Sub(x0x, half) };
+	Float cornerY[4] = { x0y, Simd::Add(Simd::Sub(x0y, i1y), Cx), Simd::Add(Simd::Sub(x0y, i2y), Cy), Simd::Sub(x0y, half) };
+	Float cornerZ[4] = { x0z, Simd::Add(Simd::Sub(x0z, i1z), Cx), Simd::Add(Simd::Sub(x0z, i2z), Cy), Simd::Sub(x0z, half) };
+
+	// permutations
+	ix = Mod289Batch<Simd>(ix);
+	iy = Mod289Batch<Simd>(iy);
+	iz = Mod289Batch<Simd>(iz);
+	Float offsetX[4] = { zero, i1x, i2x, one };
+	Float offsetY[4] = { zero, i1y, i2y, one };
+	Float offsetZ[4] = { zero, i1z, i2z, one };
+
+	// ns = n_ * D.wyz - D.xzx, folded in scalar exactly like SNoise
+	const float n_ = 0.142857142857f;
+	const Float nsx = Simd::Set1(n_ * 2.0f - 0.0f);
+	const Float nsy = Simd::Set1(n_ * 0.5f - 1.0f);
+	const Float nsz = Simd::Set1(n_ * 1.0f - 0.0f);
+	const Float two = Simd::Set1(2.0f);
+	const Float minusZero = Simd::Set1(-0.0f);
+	const Float minusOne = Simd::Set1(-1.0f);
+
+	Float weighted[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		Float p = PermuteBatch<Simd>(Simd::Add(Simd::Add(PermuteBatch<Simd>(Simd::Add(Simd::Add(
+			PermuteBatch<Simd>(Simd::Add(iz, offsetZ[i])), iy), offsetY[i])), ix), offsetX[i]));
+
+		Float j = Simd::Sub(p, Simd::Mul(Simd::Set1(49.0f), Simd::Floor(Simd::Mul(Simd::Mul(p, nsz), nsz))));
+		Float x_ = Simd::Floor(Simd::Mul(j, nsz));
+		Float y_ = Simd::Floor(Simd::Sub(j, Simd::Mul(Simd::Set1(7.0f), x_)));
+
+		Float gridX = Simd::Add(Simd::Mul(x_, nsx), nsy);
+		Float gridY = Simd::Add(Simd::Mul(y_, nsx), nsy);
+		Float h = Simd::Sub(Simd::Sub(one, Simd::Abs(gridX)), Simd::Abs(gridY));
+
+		// -step(h, 0) is -0 or -1
+		Float sh = Simd::Select(Simd::CmpGt(h, zero), minusZero, minusOne);
+		Float gradX = Simd::Add(gridX, Simd::Mul(Simd::Add(Simd::Mul(Simd::Floor(gridX), two), one), sh));
+		Float gradY = Simd::Add(gridY, Simd::Mul(Simd::Add(Simd::Mul(Simd::Floor(gridY), two), one), sh));
+		Float gradZ = h;
+
+		Float norm = TaylorInvSqrtBatch<Simd>(Dot3Batch<Simd>(gradX, gradY, gradZ, gradX, gradY, gradZ));
+		gradX = Simd::Mul(gradX, norm);
+		gradY = Simd::Mul(gradY, norm);
+		gradZ = Simd::Mul(gradZ, norm);
+
+		Float m = Simd::Max(Simd::Sub(half, Dot3Batch<Simd>(cornerX[i], cornerY[i], cornerZ[i], cornerX[i], cornerY[i], cornerZ[i])), zero);
+		m = Simd::Mul(m, m);
+		weighted[i] = Simd::Mul(Simd::Mul(m, m), Dot3Batch<Simd>(gradX, gradY, gradZ, cornerX[i], cornerY[i], cornerZ[i]));
+	}
+
+	return Simd::Mul(Simd::Set1(42.0f), Simd::Add(Simd::Add(Simd::Add(weighted[0], weighted[1]), weighted[2]), weighted[3]));
+}
+
+template<typename Simd>
+void SimplexNoise::Grad4Batch(typename Simd::Float j, typename Simd::Float& x, typename Simd::Float& y,
+	typename Simd::Float& z, typename Simd::Float& w)
+{
+	typedef typename Simd::Float Float;
+
+	const Float ipx = Simd::Set1(1.0f / 294.0f);
+	const Float ipy = Simd::Set1(1.0f / 49.0f);
+	const Float ipz = Simd::Set1(1.0f / 7.0f);
+	const Float seven = Simd::Set1(7.0f);
+	const Float zero = Simd::Zero();
+	const Float one = Simd::Set1(1.0f);
+	const Float two = Simd::Set1(2.0f);
+
+	Float jx = Simd::Mul(j, ipx);
+	Float jy = Simd::Mul(j, ipy);
+	Float jz = Simd::Mul(j, ipz);
+	x = Simd::Sub(Simd::Mul(Simd::Floor(Simd::Mul(Simd::Sub(jx, Simd::Floor(jx)), seven)), ipz), one);
+	y = Simd::Sub(Simd::Mul(Simd::Floor(Simd::Mul(Simd::Sub(jy, Simd::Floor(jy)), seven)), ipz), one);
+	z = Simd::Sub(Simd::Mul(Simd::Floor(Simd::Mul(Simd::Sub(jz, Simd::Floor(jz)), seven)), ipz), one);
+	w = Simd::Sub(Simd::Set1(1.5f), Simd::Add(Simd::Add(Simd::Abs(x), Simd::Abs(y)), Simd::Abs(z)));
+
+	Float sx = Simd::Select(Simd::CmpLt(x, zero), one, zero);
+	Float sy = Simd::Select(Simd::CmpLt(y, zero), one, zero);
+	Float sz = Simd::Select(Simd::CmpLt(z, zero), one, zero);
+	Float sw = Simd::Select(Simd::CmpLt(w, zero), one, zero);
+	x = Simd::Add(x, Simd::Mul(Simd::Sub(Simd::Mul(sx, two), one), sw));
+	y = Simd::Add(y, Simd::Mul(Simd::Sub(Simd::Mul(sy, two), one), sw));
+	z = Simd::Add(z, Simd::Mul(Simd::Sub(Simd::Mul(sz, two), one), sw));
+}
+
+template<typename Simd>
+typename Simd::Float SimplexNoise::SNoiseBatch(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z,
+	typename Simd::Float w)
+{
+	typedef typename Simd::Float Float;
+
+	const Float F4 = Simd::Set1(0.309016994374947451f);
+	const Float Cx = Simd::Set1(0.138196601125011f);
+	const Float Cw = Simd::Set1(-0.447213595499958f);
+	const Float cornerOffsets[3] = { Cx, Simd::Set1(0.276393202250021f), Simd::Set1(0.414589803375032f) };
+	const Float zero = Simd::Zero();
+	const Float one = Simd::Set1(1.0f);
+	const Float two = Simd::Set1(2.0f);
+	const Float half = Simd::Set1(0.5f);
+
+	// first corner
+	Float v[4] = { x, y, z, w };
+	Float f4[4] = { F4, F4, F4, F4 };
+	Float vDotF = Dot4Batch<Simd>(v, f4);
+
+	Float i[4];
+	for (int a = 0; a < 4; ++a)
+		i[a] = Simd::Floor(Simd::Add(v[a], vDotF));
+
+	Float c4[4] = { Cx, Cx, Cx, Cx };
+	Float iDotC = Dot4Batch<Simd>(i, c4);
+
+	Float x0[4];
+	for (int a = 0; a < 4; ++a)
+		x0[a] = Simd::Add(Simd::Sub(v[a], i[a]), iDotC);
+
+	// other corners, rank sorting
+	Float isX[3] = { StepBatch<Simd>(x0[1], x0[0]), StepBatch<Simd>(x0[2], x0[0]), StepBatch<Simd>(x0[3], x0[0]) };
+	Float isYZ[3] = { StepBatch<Simd>(x0[2], x0[1]), StepBatch<Simd>(x0[3], x0[1]), StepBatch<Simd>(x0[3], x0[2]) };
+
+	Float i0[4];
+	i0[0] = Simd::Add(Simd::Add(isX[0], isX[1]), isX[2]);
+	i0[1] = Simd::Sub(one, isX[0]);
+	i0[2] = Simd::Sub(one, isX[1]);
+	i0[3] = Simd::Sub(one, isX[2]);
+	i0[1] = Simd::Add(i0[1], Simd::Add(isYZ[0], isYZ[1]));
+	i0[2] = Simd::Add(i0[2], Simd::Sub(one, isYZ[0]));
+	i0[3] = Simd::Add(i0[3], Simd::Sub(one, isYZ[1]));
+	i0[2] = Simd::Add(i0[2], isYZ[2]);
+	i0[3] = Simd::Add(i0[3], Simd::Sub(one, isYZ[2]));
+
+	Float offsets[5][4];
+	for (int a = 0; a < 4; ++a)
+	{
+		offsets[0][a] = zero;
+		offsets[1][a] = Simd::Min(Simd::Max(Simd::Sub(i0[a], two), zero), one);
+		offsets[2][a] = Simd::Min(Simd::Max(Simd::Sub(i0[a], one), zero), one);
+		offsets[3][a] = Simd::Min(Simd::Max(i0[a], zero), one);
+		offsets[4][a] = one;
+	}
+
+	Float corners[5][4];
+	for (int a = 0; a < 4; ++a)
+	{
+		corners[0][a] = x0[a];
+		for (int k = 1; k < 4; ++k)
+			corners[k][a] = Simd::Add(Simd::Sub(x0[a], offsets[k][a]), cornerOffsets[k - 1]);
+		corners[4][a] = Simd::Add(x0[a], Cw);
+	}
+
+	// permutations
+	for (int a = 0; a < 4; ++a)
+		i[a] = Mod289Batch<Simd>(i[a]);
+
+	Float j[5];
+	j[0] = PermuteBatch<Simd>(Simd::Add(PermuteBatch<Simd>(Simd::Add(PermuteBatch<Simd>(Simd::Add(
+		PermuteBatch<Simd>(i[3]), i[2])), i[1])), i[0]));
+	for (int k = 1; k < 5; ++k)
+	{
+		Float permuted = PermuteBatch<Simd>(Simd::Add(i[3], offsets[k][3]));
+		for (int a = 2; a >= 0; --a)
+			permuted = PermuteBatch<Simd>(Simd::Add(Simd::Add(permuted, i[a]), offsets[k][a]));
+		j[k] = permuted;
+	}
+
+	Float weighted[5];
+	for (int k = 0; k < 5; ++k)
+	{
+		Float p[4];
+		Grad4Batch<Simd>(j[k], p[0], p[1], p[2], p[3]);
+
+		Float norm = TaylorInvSqrtBatch<Simd>(Dot4Batch<Simd>(p, p));
+		for (int a = 0; a < 4; ++a)
+			p[a] = Simd::Mul(p[a], norm);
+
+		Float m = Simd::Max(Simd::Sub(half, Dot4Batch<Simd>(corners[k], corners[k])), zero);
+		m = Simd::Mul(m, m);
+		weighted[k] = Simd::Mul(Simd::Mul(m, m), Dot4Batch<Simd>(p, corners[k]));
+	}
+
+	return Simd::Mul(Simd::Set1(49.0f), Simd::Add(Simd::Add(Simd::Add(weighted[0], weighted[1]), weighted[2]),
+		Simd::Add(weighted[3], weighted[4])));
+}
+
+template<typename Simd>
+void SimplexNoise::SNoise3DBatch(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z,
+	typename Simd::Float& noiseX, typename Simd::Float& noiseY, typename Simd::Float& noiseZ)
+{
+	noiseX = SNoiseBatch<Simd>(x, y);
+	noiseY = SNoiseBatch<Simd>(y, z);
+	noiseZ = SNoiseBatch<Simd>(z, x);
+}
+
+template<typename Simd>
+void SimplexNoise::CurlNoise3DBatch(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z, float d,
+	typename Simd::Float& curlX, typename Simd::Float& curlY, typename Simd::Float& curlZ)
+{
+	typedef typename Simd::Float Float;
+
+	const Float delta = Simd::Set1(d);
+	const Float scale = Simd::Set1(2 * d);
+
+	// x = p_y1.z - p_y0.z - p_z1.y + p_z0.y, where p_y1.z == p_y0.z
+	Float zy0 = SNoiseBatch<Simd>(y, Simd::Sub(z, delta));
+	Float zy1 = SNoiseBatch<Simd>(y, Simd::Add(z, delta));
+
+	// y = p_z1.x - p_z0.x - p_x1.z + p_x0.z, where p_z1.x == p_z0.x
+	Float xz0 = SNoiseBatch<Simd>(z, Simd::Sub(x, delta));
+	Float xz1 = SNoiseBatch<Simd>(z, Simd::Add(x, delta));
+
+	// z = p_x1.y - p_x0.y - p_y1.x + p_y0.x, where p_x1.y == p_x0.y
+	Float yx0 = SNoiseBatch<Simd>(x, Simd::Sub(y, delta));
+	Float yx1 = SNoiseBatch<Simd>(x, Simd::Add(y, delta));
+
+	curlX = Simd::Mul(Simd::Sub(zy0, zy1), scale);
+	curlY = Simd::Mul(Simd::Sub(xz0, xz1), scale);
+	curlZ = Simd::Mul(Simd::Sub(yx0, yx1), scale);
+}
+
+template<typename Simd>
+typename Simd::Float SimplexNoise::SNoiseGradBatch(typename Simd::Float x, typename Simd::Float y,
+	typename Simd::Float& gradientX, typename Simd::Float& gradientY)
+{
+	typedef typename Simd::Float Float;
+
+	const Float Cx = Simd::Set1(0.211324865405187f);
+	const Float Cy = Simd::Set1(0.366025403784439f);
+	const Float Cz = Simd::Set1(-0.577350269189626f);
+	const Float Cw = Simd::Set1(0.024390243902439f);
+	const Float zero = Simd::Zero();
+	const Float one = Simd::Set1(1.0f);
+	const Float half = Simd::Set1(0.5f);
+
+	Float vDotC = Simd::Add(Simd::Mul(x, Cy), Simd::Mul(y, Cy));
+	Float ix = Simd::Floor(Simd::Add(x, vDotC));
+	Float iy = Simd::Floor(Simd::Add(y, vDotC));
+
+	Float iDotC = Simd::Add(Simd::Mul(ix, Cx), Simd::Mul(iy, Cx));
+	Float x0x = Simd::Add(Simd::Sub(x, ix), iDotC);
+	Float x0y = Simd::Add(Simd::Sub(y, iy), iDotC);
+
+	Float greater = Simd::CmpGt(x0x, x0y);
+	Float i1x = Simd::Select(greater, one, zero);
+	Float i1y = Simd::Select(greater, zero, one);
+
+	Float x12x = Simd::Sub(Simd::Add(x0x, Cx), i1x);
+	Float x12y = Simd::Sub(Simd::Add(x0y, Cx), i1y);
+	Float x12z = Simd::Add(x0x, Cz);
+	Float x12w = Simd::Add(x0y, Cz);
+
+	ix = Mod289Batch<Simd>(ix);
+	iy = Mod289Batch<Simd>(iy);
+	Float p[3] =
+	{
+		PermuteBatch<Simd>(Simd::Add(Simd::Add(PermuteBatch<Simd>(Simd::Add(iy, zero)), ix), zero)),
+		PermuteBatch<Simd>(Simd::Add(Simd::Add(PermuteBatch<Simd>(Simd::Add(iy, i1y)), ix), i1x)),
+		PermuteBatch<Simd>(Simd::Add(Simd::Add(PermuteBatch<Simd>(Simd::Add(iy, one)), ix), one))
+	};
+
+	Float m[3] =
+	{
+		Simd::Max(Simd::Sub(half, Simd::Add(Simd::Mul(x0x, x0x), Simd::Mul(x0y, x0y))), zero),
+		Simd::Max(Simd::Sub(half, Simd::Add(Simd::Mul(x12x, x12x), Simd::Mul(x12y, x12y))), zero),
+		Simd::Max(Simd::Sub(half, Simd::Add(Simd::Mul(x12z, x12z), Simd::Mul(x12w, x12w))), zero)
+	};
+
+	Float cornerX[3] = { x0x, x12x, x12z };
+	Float cornerY[3] = { x0y, x12y, x12w };
+
+	Float noise = zero;
+	Float gradX = zero;
+	Float gradY = zero;
+	for (int i = 0; i < 3; ++i)
+	{
+		Float m2 = Simd::Mul(m[i], m[i]);
+		Float m4 = Simd::Mul(m2, m2);
+
+		Float scaled = Simd::Mul(p[i], Cw);
+		Float gx = Simd::Sub(Simd::Mul(Simd::Set1(2.0f), Simd::Sub(scaled, Simd::Floor(scaled))), one);
+		Float h = Simd::Sub(Simd::Abs(gx), half);
+		Float ox = Simd::Floor(Simd::Add(gx, half));
+		Float a0 = Simd::Sub(gx, ox);
+
+		Float norm = Simd::Sub(Simd::Set1(1.79284291400159f),
+			Simd::Mul(Simd::Set1(0.85373472095314f), Simd::Add(Simd::Mul(a0, a0), Simd::Mul(h, h))));
+		Float weight = Simd::Mul(m4, norm);
+		Float dot = Simd::Add(Simd::Mul(a0, cornerX[i]), Simd::Mul(h, cornerY[i]));
+
+		noise = Simd::Add(noise, Simd::Mul(weight, dot));
+
+		Float slope = Simd::Mul(Simd::Mul(Simd::Mul(Simd::Set1(-8.0f), Simd::Mul(m2, m[i])), norm), dot);
+		gradX = Simd::Add(gradX, Simd::Add(Simd::Mul(weight, a0), Simd::Mul(slope, cornerX[i])));
+		gradY = Simd::Add(gradY, Simd::Add(Simd::Mul(weight, h), Simd::Mul(slope, cornerY[i])));
+	}
+
+	gradientX = Simd::Mul(Simd::Set1(130.0f), gradX);
+	gradientY = Simd::Mul(Simd::Set1(130.0f), gradY);
+	return Simd::Mul(Simd::Set1(130.0f), noise);
+}
+
+template<typename Simd>
+void SimplexNoise::CurlNoise3DGradBatch(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z,
+	typename Simd::Float& curlX, typename Simd::Float& curlY, typename Simd::Float& curlZ)
+{
+	typedef typename Simd::Float Float;
+
+	// only the v derivatives are used, the rest of the gradient math is dead once this is inlined
+	Float unused;
+	Float gradientYZ, gradientZX, gradientXY;
+	SNoiseGradBatch<Simd>(y, z, unused, gradientYZ);
+	SNoiseGradBatch<Simd>(z, x, unused, gradientZX);
+	SNoiseGradBatch<Simd>(x, y, unused, gradientXY);
+
+	// times -1 rather than 0 - g, so a zero gradient gives -0 like the scalar negation
+	const Float minusOne = Simd::Set1(-1.0f);
+	curlX = Simd::Mul(gradientYZ, minusOne);
+	curlY = Simd::Mul(gradientZX, minusOne);
+	curlZ = Simd::Mul(gradientXY, minusOne);
+}
+
+template<typename Simd>
+void SimplexNoise::CurlNoise4DBatch(typename Simd::Float x, typename Simd::Float y, typename Simd::Float z, float w, float d,
+	typename Simd::Float& curlX, typename Simd::Float& curlY, typename Simd::Float& curlZ)
+{
+	typedef typename Simd::Float Float;
+
+	const Float time = Simd::Set1(w);
+	const Float delta = Simd::Set1(d);
+	const Float inverse = Simd::Set1(1.0f / (2.0f * d));
+
+	Float x0 = Simd::Sub(x, delta), x1 = Simd::Add(x, delta);
+	Float y0 = Simd::Sub(y, delta), y1 = Simd::Add(y, delta);
+	Float z0 = Simd::Sub(z, delta), z1 = Simd::Add(z, delta);
+
+	// dc/dy - db/dz, da/dz - dc/dx, db/dx - da/dy
+	Float dcdy = Simd::Sub(Potential4DBatch<Simd>(2, x, y1, z, time), Potential4DBatch<Simd>(2, x, y0, z, time));
+	Float dbdz = Simd::Sub(Potential4DBatch<Simd>(1, x, y, z1, time), Potential4DBatch<Simd>(1, x, y, z0, time));
+	Float dadz = Simd::Sub(Potential4DBatch<Simd>(0, x, y, z1, time), Potential4DBatch<Simd>(0, x, y, z0, time));
+	Float dcdx = Simd::Sub(Potential4DBatch<Simd>(2, x1, y, z, time), Potential4DBatch<Simd>(2, x0, y, z, time));
+	Float dbdx = Simd::Sub(Potential4DBatch<Simd>(1, x1, y, z, time), Potential4DBatch<Simd>(1, x0, y, z, time));
+	Float dady = Simd::Sub(Potential4DBatch<Simd>(0, x, y1, z, time), Potential4DBatch<Simd>(0, x, y0, z, time));
+
+	curlX = Simd::Mul(Simd::Sub(dcdy, dbdz), inverse);
+	curlY = Simd::Mul(Simd::Sub(dadz, dcdx), inverse);
+	curlZ = Simd::Mul(Simd::Sub(dbdx, dady), inverse);
+}
+
+template<typename Simd>
+typename Simd::Float SimplexNoise::CalcNoiseWithOctavesBatch(typename Simd::Float x, typename Simd::Float y,
+	float scale, float offset, float persistence, int iterations)
+{
+	typedef typename Simd::Float Float;
+
+	const Float half = Simd::Set1(0.5f);
+	const Float z = Simd::Set1(offset);
+
+	// the amplitudes and frequencies are the same for every lane, so they stay scalar
+	float maxAmp = 0.0f;
+	float amp = 1.0f;
+	Float noise = Simd::Zero();
+	float freq = scale;
+
+	for (int i = 0; i < iterations; ++i)
+	{
+		Float frequency = Simd::Set1(freq);
+		Float adjNoise = Simd::Add(Simd::Mul(SNoiseBatch<Simd>(Simd::Mul(x, frequency), Simd::Mul(y, frequency), z), half), half);
+		noise = Simd::Add(noise, Simd::Mul(adjNoise, Simd::Set1(amp)));
+		maxAmp += amp;
+		amp *= persistence;
+		freq *= 2.0f;
+	}
+
+	return Simd::Div(noise, Simd::Set1(maxAmp));
+}
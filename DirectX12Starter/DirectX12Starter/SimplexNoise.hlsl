@@ -115,6 +115,49 @@ float snoise(float2 v) {
 	return 130.0 * dot(m, g);
 }
 
+// snoise(float2) that also returns its gradient, d/dx (m^4 * dot(g, x)) = m^4 * g - 8 * m^3 * dot(g, x) * x
+float snoise_grad(float2 v, out float2 gradient) {
+	const float4 C = float4(0.211324865405187,  // (3.0-sqrt(3.0))/6.0
+		0.366025403784439,  // 0.5*(sqrt(3.0)-1.0)
+		-0.577350269189626,  // -1.0 + 2.0 * C.x
+		0.024390243902439); // 1.0 / 41.0
+
+	float2 i = floor(v + dot(v, C.yy));
+	float2 x0 = v - i + dot(i, C.xx);
+
+	float2 i1 = (x0.x > x0.y) ? float2(1.0, 0.0) : float2(0.0, 1.0);
+	float4 x12 = x0.xyxy + C.xxzz;
+	x12.xy -= i1;
+
+	i = mod289(i);
+	float3 p = permute(permute(i.y + float3(0.0, i1.y, 1.0))
+		+ i.x + float3(0.0, i1.x, 1.0));
+
+	float3 m = max(0.5 - float3(dot(x0, x0), dot(x12.xy, x12.xy), dot(x12.zw, x12.zw)), 0.0);
+	float3 m2 = m * m;
+	float3 m4 = m2 * m2;
+
+	float3 x = 2.0 * frac(p * C.www) - 1.0;
+	float3 h = abs(x) - 0.5;
+	float3 ox = floor(x + 0.5);
+	float3 a0 = x - ox;
+
+	float3 norm = 1.79284291400159 - 0.85373472095314 * (a0*a0 + h * h);
+
+	float3 g;
+	g.x = a0.x  * x0.x + h.x  * x0.y;
+	g.yz = a0.yz * x12.xz + h.yz * x12.yw;
+
+	float3 slope = -8.0 * m2 * m * norm * g;
+	float3 weight = m4 * norm;
+	gradient = weight.x * float2(a0.x, h.x) + slope.x * x0
+		+ weight.y * float2(a0.y, h.y) + slope.y * x12.xy
+		+ weight.z * float2(a0.z, h.z) + slope.z * x12.zw;
+	gradient *= 130.0;
+
+	return 130.0 * dot(weight, g);
+}
+
 float snoise(float3 v) {
 	const float2  C = float2(1.0 / 6.0, 1.0 / 3.0);
 	const float4  D = float4(0.0, 0.5, 1.0, 2.0);
@@ -189,6 +232,76 @@ float snoise(float3 v) {
 		dot(p2, x2), dot(p3, x3)));
 }
 
+// snoise(float3) that also returns its gradient
+float snoise_grad(float3 v, out float3 gradient) {
+	const float2  C = float2(1.0 / 6.0, 1.0 / 3.0);
+	const float4  D = float4(0.0, 0.5, 1.0, 2.0);
+
+	float3 i = floor(v + dot(v, C.yyy));
+	float3 x0 = v - i + dot(i, C.xxx);
+
+	float3 g = step(x0.yzx, x0.xyz);
+	float3 l = 1.0 - g;
+	float3 i1 = min(g.xyz, l.zxy);
+	float3 i2 = max(g.xyz, l.zxy);
+
+	float3 x1 = x0 - i1 + C.xxx;
+	float3 x2 = x0 - i2 + C.yyy;
+	float3 x3 = x0 - D.yyy;
+
+	i = mod289(i);
+	float4 p = permute(permute(permute(
+		i.z + float4(0.0, i1.z, i2.z, 1.0))
+		+ i.y + float4(0.0, i1.y, i2.y, 1.0))
+		+ i.x + float4(0.0, i1.x, i2.x, 1.0));
+
+	float n_ = 0.142857142857; // 1.0/7.0
+	float3  ns = n_ * D.wyz - D.xzx;
+
+	float4 j = p - 49.0 * floor(p * ns.z * ns.z);
+
+	float4 x_ = floor(j * ns.z);
+	float4 y_ = floor(j - 7.0 * x_);
+
+	float4 x = x_ * ns.x + ns.yyyy;
+	float4 y = y_ * ns.x + ns.yyyy;
+	float4 h = 1.0 - abs(x) - abs(y);
+
+	float4 b0 = float4(x.xy, y.xy);
+	float4 b1 = float4(x.zw, y.zw);
+
+	float4 s0 = floor(b0)*2.0 + 1.0;
+	float4 s1 = floor(b1)*2.0 + 1.0;
+	float4 sh = -step(h, float4(0, 0, 0, 0));
+
+	float4 a0 = b0.xzyw + s0.xzyw*sh.xxyy;
+	float4 a1 = b1.xzyw + s1.xzyw*sh.zzww;
+
+	float3 p0 = float3(a0.xy, h.x);
+	float3 p1 = float3(a0.zw, h.y);
+	float3 p2 = float3(a1.xy, h.z);
+	float3 p3 = float3(a1.zw, h.w);
+
+	float4 norm = taylorInvSqrt(float4(dot(p0, p0), dot(p1, p1), dot(p2, p2), dot(p3, p3)));
+	p0 *= norm.x;
+	p1 *= norm.y;
+	p2 *= norm.z;
+	p3 *= norm.w;
+
+	float4 m = max(0.5 - float4(dot(x0, x0), dot(x1, x1), dot(x2, x2), dot(x3, x3)), 0.0);
+	float4 m2 = m * m;
+	float4 m4 = m2 * m2;
+	float4 pdotx = float4(dot(p0, x0), dot(p1, x1), dot(p2, x2), dot(p3, x3));
+
+	float4 slope = -8.0 * m2 * m * pdotx;
+	gradient = 42.0 * (m4.x * p0 + slope.x * x0
+		+ m4.y * p1 + slope.y * x1
+		+ m4.z * p2 + slope.z * x2
+		+ m4.w * p3 + slope.w * x3);
+
+	return 42.0 * dot(m4, pdotx);
+}
+
 // (sqrt(5) - 1)/4 = F4, used once below
 #define F4 0.309016994374947451
 
@@ -325,6 +438,47 @@ float3 curlNoise3D(float3 p, float d) {
 }
 
 
+// the exact curl of the snoise3D potential from three gradients instead of eighteen noise lookups,
+// snoise3D(v).x = snoise(v.xy) has no z term and likewise for .y and .z, so only the second derivatives remain
+// every component ignores its own coordinate, the field is divergence-free,
+// curlNoise3D(p, d) approaches curlNoise3DGrad(p) * 4 * d * d as d goes to 0
+float3 curlNoise3DGrad(float3 p) {
+	float2 gradientYZ, gradientZX, gradientXY;
+	snoise_grad(p.yz, gradientYZ);
+	snoise_grad(p.zx, gradientZX);
+	snoise_grad(p.xy, gradientXY);
+
+	return -float3(gradientYZ.y, gradientZX.y, gradientXY.y);
+}
+
+
+// potential of curlNoise4D, the second and third components are the noise swizzled and shifted away from the first
+float3 potential4D(float3 p, float w) {
+	return float3(
+		snoise(float4(p, w)),
+		snoise(float4(p.yzx + float3(31.341, -17.239, 9.623), w)),
+		snoise(float4(p.zxy + float3(-23.087, 41.711, -5.197), w))
+		);
+}
+
+// the curl of a potential that drifts with w, e.g. TotalTime as w for a field that changes over time
+// unlike curlNoise3D none of the lookups cancel, so the twelve derivatives below are all needed
+float3 curlNoise4D(float3 p, float w, float d) {
+	float3 dx = float3(d, 0.0, 0.0);
+	float3 dy = float3(0.0, d, 0.0);
+	float3 dz = float3(0.0, 0.0, d);
+
+	float dcdy = potential4D(p + dy, w).z - potential4D(p - dy, w).z;
+	float dbdz = potential4D(p + dz, w).y - potential4D(p - dz, w).y;
+	float dadz = potential4D(p + dz, w).x - potential4D(p - dz, w).x;
+	float dcdx = potential4D(p + dx, w).z - potential4D(p - dx, w).z;
+	float dbdx = potential4D(p + dx, w).y - potential4D(p - dx, w).y;
+	float dady = potential4D(p + dy, w).x - potential4D(p - dy, w).x;
+
+	return float3(dcdy - dbdz, dadz - dcdx, dbdx - dady) / (2.0 * d);
+}
+
+
 // Calculates multiple octaves of noise and combines them
 // together - like "Generate Clouds" from Photoshop
 // http://cmaher.github.io/posts/working-with-simplex-noise/
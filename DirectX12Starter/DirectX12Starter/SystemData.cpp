@@ -66,9 +66,12 @@ void SystemData::LoadOBJFile(char* fileName, Microsoft::WRL::ComPtr<ID3D12Device
 	// File input object
 	std::ifstream obj(fileName);
 
-	// Check for successful open
+	// Check for successful open, a missing file leaves an empty sub system behind
 	if (!obj.is_open())
+	{
+		subSystemData[subSystemName] = newSubSystem;
 		return;
+	}
 
 	// Variables used while reading the file
 	std::vector<XMFLOAT3> objPositions;     // Positions from the file
@@ -217,9 +220,9 @@ void SystemData::LoadOBJFile(char* fileName, Microsoft::WRL::ComPtr<ID3D12Device
 			{
 				// Make the last vertex
 				Vertex v4;
-				v4.Position = positions[i[9] - 1];
-				v4.UV = uvs[i[10] - 1];
-				v4.Normal = normals[i[11] - 1];
+				v4.Position = objPositions[i[9] - 1];
+				v4.UV = objUvs[i[10] - 1];
+				v4.Normal = objNormals[i[11] - 1];
 
 				// Flip the UV, Z pos and normal
 				v4.UV.y = 1.0f - v4.UV.y;
@@ -0,0 +1,164 @@
+#include "WorkStealingScheduler.h"
+#include <algorithm>
+
+WorkStealingScheduler::WorkStealingScheduler(int threadCount) :
+	ranges(threadCount > 0 ? threadCount : (int)(std::max)(std::thread::hardware_concurrency(), 1u))
+{
+	this->threadCount = (int)ranges.size();
+
+	generation = 0;
+	activeWorkers = 0;
+	shuttingDown = false;
+	currentTask = nullptr;
+	stealCount = 0;
+
+	for (int i = 0; i < this->threadCount; ++i)
+		ranges[i].Range = PackRange(0, 0);
+
+	// the thread calling ParallelFor is worker 0
+	for (int i = 1; i < this->threadCount; ++i)
+		workers.push_back(std::thread(&WorkStealingScheduler::WorkerMain, this, i));
+}
+
+WorkStealingScheduler::~WorkStealingScheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		shuttingDown = true;
+	}
+	startCondition.notify_all();
+
+	for (auto& worker : workers)
+		worker.join();
+}
+
+int WorkStealingScheduler::GetThreadCount() const
+{
+	return threadCount;
+}
+
+unsigned long long WorkStealingScheduler::GetStealCount() const
+{
+	return stealCount;
+}
+
+void WorkStealingScheduler::ParallelFor(unsigned int taskCount, const std::function<void(unsigned int, int)>& task)
+{
+	if (taskCount == 0)
+		return;
+
+	if (threadCount == 1)
+	{
+		for (unsigned int i = 0; i < taskCount; ++i)
+			task(i, 0);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for (int i = 0; i < threadCount; ++i)
+		{
+			unsigned int begin = (unsigned int)((unsigned long long)taskCount * i / threadCount);
+			unsigned int end = (unsigned int)((unsigned long long)taskCount * (i + 1) / threadCount);
+			ranges[i].Range = PackRange(begin, end);
+		}
+
+		currentTask = &task;
+		activeWorkers = threadCount - 1;
+		generation++;
+	}
+	startCondition.notify_all();
+
+	RunTasks(0);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	doneCondition.wait(lock, [this] { return activeWorkers == 0; });
+	currentTask = nullptr;
+}
+
+void WorkStealingScheduler::WorkerMain(int threadIndex)
+{
+	unsigned long long seenGeneration = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			startCondition.wait(lock, [&] { return shuttingDown || generation != seenGeneration; });
+
+			if (shuttingDown)
+				return;
+
+			seenGeneration = generation;
+		}
+
+		RunTasks(threadIndex);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--activeWorkers == 0)
+			doneCondition.notify_one();
+	}
+}
+
+void WorkStealingScheduler::RunTasks(int threadIndex)
+{
+	unsigned int taskIndex;
+
+	do
+	{
+		while (PopTask(threadIndex, taskIndex))
+			(*currentTask)(taskIndex, threadIndex);
+	} while (StealTasks(threadIndex));
+}
+
+bool WorkStealingScheduler::PopTask(int threadIndex, unsigned int& taskIndex)
+{
+	std::atomic<unsigned long long>& range = ranges[threadIndex].Range;
+	unsigned long long current = range.load();
+
+	while (true)
+	{
+		unsigned int begin = (unsigned int)(current >> 32);
+		unsigned int end = (unsigned int)current;
+
+		if (begin >= end)
+			return false;
+
+		if (range.compare_exchange_weak(current, PackRange(begin + 1, end)))
+		{
+			taskIndex = begin;
+			return true;
+		}
+	}
+}
+
+bool WorkStealingScheduler::StealTasks(int threadIndex)
+{
+	for (int offset = 1; offset < threadCount; ++offset)
+	{
+		std::atomic<unsigned long long>& victim = ranges[(threadIndex + offset) % threadCount].Range;
+		unsigned long long current = victim.load();
+
+		while (true)
+		{
+			unsigned int begin = (unsigned int)(current >> 32);
+			unsigned int end = (unsigned int)current;
+
+			if (begin >= end)
+				break;
+
+			// take the back half, or the last task
+			unsigned int count = (end - begin + 1) / 2;
+			if (victim.compare_exchange_weak(current, PackRange(begin, end - count)))
+			{
+				// our own range is empty, so only thieves look at it and they skip empty ranges
+				ranges[threadIndex].Range = PackRange(end - count, end);
+				stealCount++;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// persistent worker threads running parallel-for loops over task indices
+// every thread starts with an even slice of the indices, pops from the front of its own slice and,
+// once that is empty, steals the back half of another thread's slice, so uneven tasks still balance
+class WorkStealingScheduler
+{
+public:
+	// threadCount includes the calling thread, 0 uses every hardware thread
+	WorkStealingScheduler(int threadCount);
+	WorkStealingScheduler(const WorkStealingScheduler& rhs) = delete;
+	WorkStealingScheduler& operator=(const WorkStealingScheduler& rhs) = delete;
+	~WorkStealingScheduler();
+
+	int GetThreadCount() const;
+	unsigned long long GetStealCount() const;
+
+	// calls task(taskIndex, threadIndex) once for every index in [0, taskCount) and returns when all have finished
+	void ParallelFor(unsigned int taskCount, const std::function<void(unsigned int, int)>& task);
+
+private:
+	// [begin, end) packed into one word so the owner and thieves race on a single compare-exchange
+	struct alignas(64) TaskRange
+	{
+		std::atomic<unsigned long long> Range;
+	};
+
+	int threadCount;
+	std::vector<std::thread> workers;
+	std::vector<TaskRange> ranges;
+
+	std::mutex mutex;
+	std::condition_variable startCondition;
+	std::condition_variable doneCondition;
+	unsigned long long generation;
+	int activeWorkers;
+	bool shuttingDown;
+
+	const std::function<void(unsigned int, int)>* currentTask;
+	std::atomic<unsigned long long> stealCount;
+
+	static unsigned long long PackRange(unsigned int begin, unsigned int end)
+	{
+		return ((unsigned long long)begin << 32) | end;
+	}
+
+	void WorkerMain(int threadIndex);
+	void RunTasks(int threadIndex);
+	bool PopTask(int threadIndex, unsigned int& taskIndex);
+	bool StealTasks(int threadIndex);
+};